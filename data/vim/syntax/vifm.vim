@@ -18,8 +18,8 @@ syntax keyword vifmCommand contained
 		\ cope[n] co[py] cq[uit] d[elete] delbmarks delm[arks] delsession di[splay]
 		\ dirs e[dit] el[se] empty en[dif] exi[t] file fin[d] fini[sh] go[to] gr[ep]
 		\ h[elp] hideui histnext his[tory] histprev jobs locate ls lstrash marks
-		\ media mes[sages] mkdir m[ove] noh[lsearch] on[ly] plugin plugins popd
-		\ pushd pu[t] pw[d] qa[ll] q[uit] redr[aw] reg[isters] regular rename
+		\ media mes[sages] mkdir m[ove] noh[lsearch] on[ly] perfstats plugin plugins
+		\ popd pushd pu[t] pw[d] qa[ll] q[uit] redr[aw] reg[isters] regular rename
 		\ restart restore rlink screen sh[ell] siblnext siblprev sor[t] sp[lit]
 		\ s[ubstitute] tabc[lose] tabm[ove] tabname tabnew tabn[ext] tabo[nly]
 		\ tabp[revious] touch tr trashes tree session sync undol[ist] ve[rsion]
@@ -49,6 +49,7 @@ static void process_general_args(args_t *args);
 static void show_help_msg(const char wrong_arg[]);
 static void show_version_msg(void);
 static void process_non_general_args(args_t *args);
+static void process_remote_batch(const args_t *args);
 static void quit_on_arg_parsing(int code);
 
 /* Command line arguments definition for getopt_long(). */
@@ -60,12 +61,14 @@ static struct option long_opts[] = {
 	{ "choose-dir",   required_argument, .flag = NULL, .val = 'D' },
 	{ "delimiter",    required_argument, .flag = NULL, .val = 'd' },
 	{ "on-choose",    required_argument, .flag = NULL, .val = 'o' },
+	{ "startuptime",  required_argument, .flag = NULL, .val = 'T' },
 
 #ifdef ENABLE_REMOTE_CMDS
 	{ "server-list",  no_argument,       .flag = NULL, .val = 'L' },
 	{ "server-name",  required_argument, .flag = NULL, .val = 'N' },
 	{ "remote",       no_argument,       .flag = NULL, .val = 'r' },
 	{ "remote-expr",  required_argument, .flag = NULL, .val = 'R' },
+	{ "remote-batch", no_argument,       .flag = NULL, .val = 'B' },
 #endif
 
 	{ "help",         no_argument,       .flag = NULL, .val = 'h' },
@@ -117,6 +120,10 @@ args_parse(args_t *args, int argc, char *argv[], const char dir[])
 			case 'R': /* --remote-expr <expr> */
 				args->remote_expr = optarg;
 				break;
+			case 'B': /* --remote-batch <items>... */
+				args->remote_batch = argv + optind;
+				done = 1;
+				break;
 
 			case 'h': /* -h, --help */
 				/* Only first one of -v and -h should take effect. */
@@ -146,6 +153,9 @@ args_parse(args_t *args, int argc, char *argv[], const char dir[])
 			case 'n': /* --no-configs */
 				args->no_configs = 1;
 				break;
+			case 'T': /* --startuptime <path> */
+				args->startup_time_path = optarg;
+				break;
 
 			case 's': /* --select <path> */
 				handle_arg_or_fail(optarg, 1, dir, args);
@@ -170,6 +180,7 @@ args_parse(args_t *args, int argc, char *argv[], const char dir[])
 #ifndef ENABLE_REMOTE_CMDS
 				if(starts_with("--remote", argv[optind - 1]) ||
 						starts_with("--remote-expr", argv[optind - 1]) ||
+						starts_with("--remote-batch", argv[optind - 1]) ||
 						starts_with("--server-list", argv[optind - 1]) ||
 						starts_with("--server-name", argv[optind - 1]))
 				{
@@ -187,7 +198,8 @@ args_parse(args_t *args, int argc, char *argv[], const char dir[])
 		}
 	}
 
-	if(args->remote_cmds != NULL || args->remote_expr != NULL)
+	if(args->remote_cmds != NULL || args->remote_expr != NULL ||
+			args->remote_batch != NULL)
 	{
 		args->target_name = args->server_name;
 		args->server_name = NULL;
@@ -406,6 +418,9 @@ show_help_msg(const char wrong_arg[])
 	puts("    log path is specified and permissions allow to open it for");
 	puts("    writing, then logging of early initialization (before value of");
 	puts("    $VIFM is determined) is put there.\n");
+	puts("  vifm --startuptime <path>");
+	puts("    append report on how much time different stages of startup took");
+	puts("    to the specified file.\n");
 
 #ifdef ENABLE_REMOTE_CMDS
 	puts("  vifm --server-list");
@@ -416,6 +431,10 @@ show_help_msg(const char wrong_arg[])
 	puts("    passes all arguments that left in command line to vifm server.\n");
 	puts("  vifm --remote-expr <expr>");
 	puts("    passes expression to vifm server and prints result.\n");
+	puts("  vifm --remote-batch");
+	puts("    passes all arguments that left in command line to vifm server as");
+	puts("    a single batch of commands and expressions (\"=<expr>\"), prints");
+	puts("    results of expressions.\n");
 #endif
 	puts("  vifm -c <command> | +<command>");
 	puts("    run <command> on startup.\n");
@@ -449,9 +468,11 @@ show_version_msg(void)
 static void
 process_non_general_args(args_t *args)
 {
-	if(args->remote_cmds != NULL && args->remote_expr != NULL)
+	if((args->remote_cmds != NULL) + (args->remote_expr != NULL) +
+			(args->remote_batch != NULL) > 1)
 	{
-		fprintf(stderr, "%s\n", "--remote and --remote-expr can't be combined.");
+		fprintf(stderr, "%s\n",
+				"--remote, --remote-expr and --remote-batch can't be combined.");
 		quit_on_arg_parsing(EXIT_FAILURE);
 		return;
 	}
@@ -481,6 +502,12 @@ process_non_general_args(args_t *args)
 		return;
 	}
 
+	if(args->remote_batch != NULL)
+	{
+		process_remote_batch(args);
+		return;
+	}
+
 	if(args->file_picker)
 	{
 		vim_get_list_file_path(args->chosen_files_out,
@@ -507,6 +534,50 @@ process_non_general_args(args_t *args)
 	}
 }
 
+/* Sends batch of commands and expressions to a server instance, prints results
+ * of expressions and quits. */
+static void
+process_remote_batch(const args_t *args)
+{
+	const int nitems = count_strings(args->remote_batch);
+	if(nitems == 0)
+	{
+		quit_on_arg_parsing(EXIT_SUCCESS);
+		return;
+	}
+
+	/* Commands can take a while to run, but a prompt on the server shouldn't
+	 * hang the client forever. */
+	enum { TIMEOUT_MS = 10*60*1000 };
+
+	char **const results = ipc_batch(curr_stats.ipc, args->target_name,
+			args->remote_batch, nitems, TIMEOUT_MS);
+	if(results == NULL)
+	{
+		fprintf(stderr, "%s\n", "Processing remote batch failed.");
+		quit_on_arg_parsing(EXIT_FAILURE);
+		return;
+	}
+
+	int failed = 0;
+	int i;
+	for(i = 0; i < nitems; ++i)
+	{
+		if(results[i] == NULL)
+		{
+			fprintf(stderr, "Failed: %s\n", args->remote_batch[i]);
+			failed = 1;
+		}
+		else if(args->remote_batch[i][0] == '=')
+		{
+			fprintf(stdout, "%s\n", results[i]);
+		}
+	}
+
+	free_string_array(results, nitems);
+	quit_on_arg_parsing(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
 /* Quits during argument parsing when it's allowed (e.g. not for remote
  * commands). */
 static void
@@ -32,6 +32,7 @@ typedef struct
 
 	int logging;            /* Enable logging. */
 	char *startup_log_path; /* Path for startup log (during initialization). */
+	const char *startup_time_path; /* Path for report on startup time or NULL. */
 
 	int no_configs;  /* Skip reading configuration files. */
 	int file_picker; /* Use predefined $VIFM/vimfiles for list of files. */
@@ -45,6 +46,7 @@ typedef struct
 	const char *target_name; /* Name of target server. */
 	char **remote_cmds;      /* Arguments to pass to server instance. */
 	char *remote_expr;       /* Expression to evaluate remotely. */
+	char **remote_batch;     /* Commands and expressions to process remotely. */
 
 	char lwin_path[PATH_MAX + 1]; /* Chosen path of the left pane. */
 	char rwin_path[PATH_MAX + 1]; /* Chosen path of the right pane. */
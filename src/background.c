@@ -35,7 +35,7 @@
 #include <assert.h> /* assert() */
 #include <errno.h> /* errno */
 #include <stddef.h> /* NULL wchar_t */
-#include <stdint.h> /* uintptr_t */
+#include <stdint.h> /* uint64_t uintptr_t */
 #include <stdlib.h> /* EXIT_FAILURE _Exit() free() malloc() */
 #include <string.h> /* strdup() */
 
@@ -52,6 +52,7 @@
 #include "utils/fs.h"
 #include "utils/log.h"
 #include "utils/path.h"
+#include "utils/perf.h"
 #include "utils/selector.h"
 #include "utils/str.h"
 #include "utils/utils.h"
@@ -1226,7 +1227,9 @@ background_task_bootstrap(void *arg)
 	block_all_thread_signals();
 	set_current_job(task_args->job);
 
+	const uint64_t start = perf_begin();
 	task_args->func(&task_args->job->bg_op, task_args->args);
+	perf_end(PP_BG_JOB, start);
 
 	/* Mark task as finished normally. */
 	mark_job_finished(task_args->job, 0);
@@ -24,6 +24,8 @@
 #define MYVIFMRC_EV "MYVIFMRC"
 #define TRASH "Trash"
 #define LOG "log"
+#define HASHES "hashes"
+#define DCACHE "dcache"
 #define VIFMRC "vifmrc"
 
 #ifndef __APPLE__
@@ -208,6 +210,8 @@ cfg_init(void)
 	cfg.view_dir_size = VDS_SIZE;
 
 	cfg.log_file[0] = '\0';
+	cfg.hashes_file[0] = '\0';
+	cfg.dcache_file[0] = '\0';
 
 	cfg_set_shell(env_get_def("SHELL", DEFAULT_SHELL_CMD));
 	cfg.shell_cmd_flag = strdup((curr_stats.shell_type == ST_CMD) ? "/C" : "-c");
@@ -563,6 +567,8 @@ store_config_paths(void)
 			cfg.config_dir);
 	snprintf(cfg.trash_dir, sizeof(cfg.trash_dir), trash_dir_fmt, trash_base);
 	snprintf(cfg.log_file, sizeof(cfg.log_file), "%s/" LOG, base);
+	snprintf(cfg.hashes_file, sizeof(cfg.hashes_file), "%s/" HASHES, base);
+	snprintf(cfg.dcache_file, sizeof(cfg.dcache_file), "%s/" DCACHE, base);
 
 	fuse_home = format_str("%s/fuse/", base);
 	(void)cfg_set_fuse_home(fuse_home);
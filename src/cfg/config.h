@@ -167,6 +167,8 @@ typedef struct config_t
 	/* This one should be set using trash_set_specs() function. */
 	char trash_dir[PATH_MAX + 64];
 	char log_file[PATH_MAX + 8];
+	char hashes_file[PATH_MAX + 8]; /* Persistent cache of hashes of files. */
+	char dcache_file[PATH_MAX + 8]; /* Persistent cache of directory sizes. */
 	char *vi_command;
 	int vi_cmd_bg;
 	char *vi_x_command;
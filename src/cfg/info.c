@@ -24,9 +24,11 @@
 #include <locale.h> /* setlocale() LC_ALL */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* FILE fpos_t fclose() fgetpos() fgets() fprintf() fputc()
-                      fscanf() fsetpos() snprintf() */
+                      fputs() fscanf() fsetpos() ftell() fwrite() setvbuf()
+                      snprintf() */
 #include <stdlib.h> /* abs() free() */
-#include <string.h> /* memcpy() memset() strtol() strcmp() strchr() strlen() */
+#include <string.h> /* memchr() memcpy() memset() strtol() strcmp() strchr()
+                       strlen() */
 #include <time.h> /* time_t time() */
 
 #include "../compat/fs_limits.h"
@@ -108,7 +110,7 @@
  *  regs = {
  *      "a" = [ "/path1", "/path2" ]
  *  }
- *  trash = [ {
+ *  trash = [ {  # only read if $VIFM/trash-index doesn't exist
  *      trashed = "/trash/0_file"
  *      original = "/file"
  *  } ]
@@ -175,9 +177,52 @@
  *  - for elements of arrays timestamps act more like generation numbers and
  *    while merging happens per element, effectively it's generations (defined
  *    by time of storing of the array) which are being merged
+ *
+ * Instead of rewriting vifminfo.json every time, instances append records to
+ * vifminfo.journal, one JSON object per line:
+ *  seen = 1234         # size of journal when the instance last synchronized
+ *  delta = { ... }     # top-level elements of the state that have changed
+ *
+ * Records are applied on top of vifminfo.json on reading.  If record's "seen"
+ * equals to its offset in the journal, nobody has written anything since its
+ * writer synchronized and its elements replace older ones, otherwise they are
+ * merged with older ones.  Once the journal grows large enough, it's merged
+ * into vifminfo.json by the next instance that writes the state.
  */
 
+/* Maximum size of vifminfo journal after which it's merged into vifminfo. */
+#define JOURNAL_MAX_SIZE (256*1024)
+
+/* Maximum length of name of a top-level element of vifminfo. */
+#define MAX_MEMBER_NAME_LEN 64
+
+/* Type of callback invoked by for_each_member().  The value isn't
+ * null-terminated.  Should return zero to continue iteration. */
+typedef int (*member_cb)(const char name[], const char value[], size_t len,
+		void *arg);
+
 static JSON_Value * read_legacy_info_file(const char info_file[]);
+static JSON_Value * read_info_state(const char info_file[],
+		const char journal[], long *journal_size);
+static void apply_journal_record(JSON_Value **state, const JSON_Value *record,
+		long offset);
+static int append_journal_record(const char info_file[], const char journal[]);
+static void sync_with_journal(long journal_size);
+static void load_info_file(int reread, int lazy);
+static JSON_Value * read_info_state_lazily(const char info_file[],
+		const char journal[], long *journal_size);
+static int apply_lazy_record(JSON_Value **state, const char line[],
+		long offset);
+static int take_member(const char name[], const char value[], size_t len,
+		void *arg);
+static int find_record_member(const char name[], const char value[],
+		size_t len, void *arg);
+static int find_lazy_section(const char name[]);
+static void materialize_lazy_sections(JSON_Object *root);
+static void drop_lazy_sections(void);
+static int for_each_member(const char text[], member_cb cb, void *arg);
+static const char * skip_json_value(const char text[]);
+static const char * skip_json_whitespace(const char text[]);
 static void load_state(JSON_Object *root, int reread);
 static void load_gtabs(JSON_Object *root, int reread);
 static tab_layout_t load_gtab_layout(const JSON_Object *gtab, int apply,
@@ -195,7 +240,11 @@ static void load_bmarks(JSON_Object *root);
 static void load_regs(JSON_Object *root);
 static void load_dir_stack(JSON_Object *root);
 static void load_trash(JSON_Object *root);
-static void load_history(JSON_Object *root, const char node[], hist_t *hist);
+static void load_trash_index(void);
+static void store_trash_index(void);
+static void get_trash_index_file(char path[]);
+static void load_history(JSON_Object *root, const char node[], hist_t *hist,
+		int extend);
 static void load_sorting(JSON_Object *ptab, view_t *view);
 static void ensure_history_not_full(hist_t *hist);
 static void put_dhistory_entry(view_t *view, int reread, const char dir[],
@@ -203,7 +252,8 @@ static void put_dhistory_entry(view_t *view, int reread, const char dir[],
 static void set_manual_filter(view_t *view, const char value[]);
 TSTATIC void write_info_file(void);
 static int copy_file(const char src[], const char dst[]);
-static void update_info_file(const char filename[], int vinfo, int merge);
+static void update_info_file(const char filename[], const char journal[],
+		int vinfo, int merge);
 TSTATIC char * drop_locale(void);
 TSTATIC void restore_locale(char locale[]);
 TSTATIC JSON_Value * serialize_state(int vinfo);
@@ -231,7 +281,9 @@ static void merge_history_by_order(JSON_Object *current,
 static void merge_regs(JSON_Object *current, const JSON_Object *admixture);
 static void merge_dir_stack(JSON_Object *current, const JSON_Object *admixture);
 static void merge_options(JSON_Object *current, const JSON_Object *admixture);
-static void merge_trash(JSON_Object *current, const JSON_Object *admixture);
+static void merge_record(JSON_Object *current, const JSON_Object *older);
+static void merge_timestamped_entries(JSON_Object *current,
+		const JSON_Object *older, const char node[]);
 static void store_gtab(int vinfo, JSON_Object *gtab, const char name[],
 		const tab_layout_t *layout, view_t *left, view_t *right);
 static void store_pane(int vinfo, JSON_Object *pane, view_t *view, int right);
@@ -251,7 +303,6 @@ static void store_bmark(const char path[], const char tags[], time_t timestamp,
 		void *arg);
 static void store_regs(JSON_Object *root);
 static void store_dir_stack(JSON_Object *root);
-static void store_trash(JSON_Object *root);
 static char * convert_old_trash_path(const char trash_path[]);
 static void store_dhistory(JSON_Object *obj, view_t *view);
 static char * read_vifminfo_line(FILE *fp, char buffer[]);
@@ -281,7 +332,12 @@ static void clone_array(JSON_Object *parent, const JSON_Array *array,
 		const char node[]);
 static void set_session(const char new_session[]);
 static void write_session_file(void);
-static void store_file(const char path[], filemon_t *mon, int vinfo);
+static void store_file(const char path[], const char journal[], filemon_t *mon,
+		int vinfo);
+static void put_journal_back(const char taken[], const char journal[]);
+static int append_to_journal(const char journal[], const char records[],
+		size_t len, long *end);
+static void get_info_files(char info_file[], char journal[]);
 static void get_session_dir(char buf[], size_t buf_size);
 
 /* Monitor to check for changes of vifminfo file. */
@@ -290,11 +346,43 @@ static filemon_t vifminfo_mon;
 static filemon_t session_mon;
 /* Callback to be invoked when active session has changed.  Can be NULL. */
 static sessions_changed session_changed_cb;
+/* State of this instance as of the last synchronization with vifminfo, records
+ * of the journal include only elements that differ from it.  NULL if there was
+ * no synchronization. */
+static JSON_Value *journal_base;
+/* Size of the journal at the moment of the last synchronization. */
+static long journal_offset;
+/* Monitor to check for changes of trash index file. */
+static filemon_t trash_index_mon;
+/* Value of trash_get_generation() as of the last synchronization with trash
+ * index file. */
+static int trash_index_generation;
+/* Whether trash index file exists, which makes trash list of vifminfo
+ * obsolete. */
+static int trash_index_found;
+
+/* Top-level elements of vifminfo which can be loaded on first use. */
+static const char *const lazy_section_names[] = {
+	"cmd-hist", "search-hist", "prompt-hist", "lfilt-hist", "regs",
+};
+/* Unparsed values of elements listed above that weren't loaded yet.  NULL for
+ * elements which are missing or loaded. */
+static char *lazy_sections[ARRAY_LEN(lazy_section_names)];
+/* Whether lazy loading was started and state_load_rest() has work to do. */
+static int lazy_pending;
+/* Size of the journal as of the start of lazy loading. */
+static long lazy_journal_size;
+/* Value of 'history' option as of the start of lazy loading. */
+static int lazy_history_len;
 
 void
 state_store(void)
 {
+	/* Make sure nothing is lost on writing. */
+	state_load_rest();
+
 	write_info_file();
+	store_trash_index();
 
 	if(sessions_active())
 	{
@@ -305,11 +393,63 @@ state_store(void)
 void
 state_load(int reread)
 {
-	char info_file[PATH_MAX + 16];
-	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
+	state_load_rest();
+	load_info_file(reread, 0);
+}
+
+void
+state_load_lazily(void)
+{
+	state_load_rest();
+	load_info_file(0, 1);
+}
+
+void
+state_load_rest(void)
+{
+	if(!lazy_pending)
+	{
+		return;
+	}
+
+	JSON_Value *root_value = json_value_init_object();
+	JSON_Object *root = json_object(root_value);
 
 	char *locale = drop_locale();
-	JSON_Value *state = json_parse_file(info_file);
+	materialize_lazy_sections(root);
+	restore_locale(locale);
+
+	/* Let vifminfo extend histories only if user didn't set their size in the
+	 * meantime, which would have shrunk them if they were loaded eagerly. */
+	const int extend = (cfg.history_len == lazy_history_len);
+
+	load_regs(root);
+	load_history(root, "cmd-hist", &curr_stats.cmd_hist, extend);
+	load_history(root, "search-hist", &curr_stats.search_hist, extend);
+	load_history(root, "prompt-hist", &curr_stats.prompt_hist, extend);
+	load_history(root, "lfilt-hist", &curr_stats.filter_hist, extend);
+	json_value_free(root_value);
+
+	lazy_pending = 0;
+	sync_with_journal(lazy_journal_size);
+}
+
+/* Reads vifminfo file populating internal structures with information it
+ * contains.  Lazy loading leaves histories and registers for
+ * state_load_rest(). */
+static void
+load_info_file(int reread, int lazy)
+{
+	char info_file[PATH_MAX + 32], journal[PATH_MAX + 32];
+	get_info_files(info_file, journal);
+
+	load_trash_index();
+
+	long journal_size;
+	char *locale = drop_locale();
+	JSON_Value *state = lazy
+	                  ? read_info_state_lazily(info_file, journal, &journal_size)
+	                  : read_info_state(info_file, journal, &journal_size);
 	restore_locale(locale);
 
 	if(state == NULL)
@@ -329,9 +469,501 @@ state_load(int reread)
 
 	(void)filemon_from_file(info_file, FMT_MODIFIED, &vifminfo_mon);
 
+	if(lazy_pending)
+	{
+		/* Synchronization needs complete state. */
+		lazy_journal_size = journal_size;
+		lazy_history_len = cfg.history_len;
+	}
+	else
+	{
+		sync_with_journal(journal_size);
+	}
+
 	dir_stack_freeze();
 }
 
+/* Same as read_info_state(), but leaves lazily loaded sections unparsed in
+ * lazy_sections array.  Returns JSON value or NULL if there is no state. */
+static JSON_Value *
+read_info_state_lazily(const char info_file[], const char journal[],
+		long *journal_size)
+{
+	size_t len;
+	char *text = NULL;
+	FILE *fp = os_fopen(info_file, "rb");
+	if(fp != NULL)
+	{
+		text = read_nonseekable_stream(fp, &len, NULL, NULL);
+		fclose(fp);
+	}
+
+	JSON_Value *state = json_value_init_object();
+	if(text == NULL || for_each_member(text, &take_member, state) != 0)
+	{
+		/* Leave anything unusual to the regular reader. */
+		free(text);
+		drop_lazy_sections();
+		json_value_free(state);
+		return read_info_state(info_file, journal, journal_size);
+	}
+	free(text);
+
+	lazy_pending = 1;
+
+	long offset = 0;
+	fp = os_fopen(journal, "rb");
+	if(fp != NULL)
+	{
+		int eager = 0;
+		char *line = NULL;
+		while((line = read_line(fp, line)) != NULL)
+		{
+			if(!eager && apply_lazy_record(&state, line, offset) != 0)
+			{
+				/* Merging needs values, so stop postponing parsing. */
+				materialize_lazy_sections(json_object(state));
+				eager = 1;
+			}
+
+			if(eager)
+			{
+				JSON_Value *record = json_parse_string(line);
+				if(record != NULL)
+				{
+					apply_journal_record(&state, record, offset);
+					json_value_free(record);
+				}
+			}
+			offset = ftell(fp);
+		}
+		fclose(fp);
+	}
+
+	*journal_size = offset;
+	return state;
+}
+
+/* Applies journal record that doesn't require merging parsing only sections
+ * that aren't loaded lazily.  Returns zero on success or when record is
+ * invalid and should be skipped, and non-zero if the record needs to be
+ * merged. */
+static int
+apply_lazy_record(JSON_Value **state, const char line[], long offset)
+{
+	const char *members[2] = { NULL, NULL };
+	if(for_each_member(line, &find_record_member, members) != 0 ||
+			members[0] == NULL || members[1] == NULL)
+	{
+		/* Not a record, maybe a partially written one. */
+		return 0;
+	}
+
+	char *end;
+	const long seen = strtol(members[0], &end, 10);
+	if(end == members[0] || seen != offset)
+	{
+		return 1;
+	}
+
+	JSON_Value *updated = json_value_init_object();
+	if(for_each_member(members[1], &take_member, updated) != 0)
+	{
+		json_value_free(updated);
+		return 0;
+	}
+
+	clone_missing(json_object(updated), json_object(*state));
+	json_value_free(*state);
+	*state = updated;
+	return 0;
+}
+
+/* Callback that puts value of a member into JSON object passed in arg or into
+ * lazy_sections array.  Returns zero on success. */
+static int
+take_member(const char name[], const char value[], size_t len, void *arg)
+{
+	char *text = format_str("%.*s", (int)len, value);
+	if(text == NULL)
+	{
+		return 1;
+	}
+
+	const int lazy_idx = find_lazy_section(name);
+	if(lazy_idx >= 0)
+	{
+		free(lazy_sections[lazy_idx]);
+		lazy_sections[lazy_idx] = text;
+		return 0;
+	}
+
+	JSON_Value *parsed = json_parse_string(text);
+	free(text);
+	if(parsed == NULL)
+	{
+		return 1;
+	}
+
+	json_object_set_value(json_object(arg), name, parsed);
+	return 0;
+}
+
+/* Callback that finds starts of "seen" and "delta" members of a journal
+ * record.  Returns zero. */
+static int
+find_record_member(const char name[], const char value[], size_t len,
+		void *arg)
+{
+	const char **members = arg;
+	if(strcmp(name, "seen") == 0)
+	{
+		members[0] = value;
+	}
+	else if(strcmp(name, "delta") == 0 && value[0] == '{')
+	{
+		members[1] = value;
+	}
+	return 0;
+}
+
+/* Looks up name in the list of lazily loaded sections.  Returns index of the
+ * section or -1. */
+static int
+find_lazy_section(const char name[])
+{
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(lazy_section_names); ++i)
+	{
+		if(strcmp(lazy_section_names[i], name) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Parses lazily loaded sections that weren't loaded yet and puts them into the
+ * root. */
+static void
+materialize_lazy_sections(JSON_Object *root)
+{
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(lazy_section_names); ++i)
+	{
+		if(lazy_sections[i] != NULL)
+		{
+			JSON_Value *value = json_parse_string(lazy_sections[i]);
+			if(value != NULL)
+			{
+				json_object_set_value(root, lazy_section_names[i], value);
+			}
+		}
+	}
+	drop_lazy_sections();
+}
+
+/* Frees unparsed lazily loaded sections. */
+static void
+drop_lazy_sections(void)
+{
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(lazy_sections); ++i)
+	{
+		update_string(&lazy_sections[i], NULL);
+	}
+}
+
+/* Calls cb for every member of JSON object at the start of the text without
+ * parsing their values, which allows splitting vifminfo into sections cheaply.
+ * Returns zero on success and non-zero if the text is malformed or callback
+ * has failed. */
+static int
+for_each_member(const char text[], member_cb cb, void *arg)
+{
+	text = skip_json_whitespace(text);
+	if(*text != '{')
+	{
+		return 1;
+	}
+
+	text = skip_json_whitespace(text + 1);
+	if(*text == '}')
+	{
+		return 0;
+	}
+
+	while(1)
+	{
+		const char *name_end = (*text == '"' ? skip_json_value(text) : NULL);
+		const size_t name_len = (name_end == NULL ? 0 : name_end - text - 2);
+		if(name_end == NULL || name_len >= MAX_MEMBER_NAME_LEN ||
+				memchr(text + 1, '\\', name_len) != NULL)
+		{
+			return 1;
+		}
+
+		char name[MAX_MEMBER_NAME_LEN];
+		copy_str(name, name_len + 1, text + 1);
+
+		text = skip_json_whitespace(name_end);
+		if(*text != ':')
+		{
+			return 1;
+		}
+
+		const char *value = skip_json_whitespace(text + 1);
+		const char *value_end = skip_json_value(value);
+		if(value_end == NULL || cb(name, value, value_end - value, arg) != 0)
+		{
+			return 1;
+		}
+
+		text = skip_json_whitespace(value_end);
+		if(*text == '}')
+		{
+			return 0;
+		}
+		if(*text != ',')
+		{
+			return 1;
+		}
+		text = skip_json_whitespace(text + 1);
+	}
+}
+
+/* Skips JSON value at the start of the text without validating it.  Returns
+ * pointer past the value or NULL if the value doesn't end. */
+static const char *
+skip_json_value(const char text[])
+{
+	if(*text == '"')
+	{
+		for(++text; *text != '"'; ++text)
+		{
+			if(*text == '\0' || (*text == '\\' && *++text == '\0'))
+			{
+				return NULL;
+			}
+		}
+		return text + 1;
+	}
+
+	if(*text == '{' || *text == '[')
+	{
+		int depth = 0;
+		do
+		{
+			if(*text == '"')
+			{
+				text = skip_json_value(text);
+				if(text == NULL)
+				{
+					return NULL;
+				}
+				continue;
+			}
+
+			if(*text == '{' || *text == '[')
+			{
+				++depth;
+			}
+			else if(*text == '}' || *text == ']')
+			{
+				--depth;
+			}
+			else if(*text == '\0')
+			{
+				return NULL;
+			}
+			++text;
+		}
+		while(depth != 0);
+		return text;
+	}
+
+	/* Numbers and literals. */
+	const char *const start = text;
+	while(*text != '\0' && *text != ',' && *text != '}' && *text != ']' &&
+			!isspace((unsigned char)*text))
+	{
+		++text;
+	}
+	return (text == start ? NULL : text);
+}
+
+/* Skips whitespace allowed by JSON.  Returns pointer to the first
+ * non-whitespace character. */
+static const char *
+skip_json_whitespace(const char text[])
+{
+	while(*text == ' ' || *text == '\t' || *text == '\n' || *text == '\r')
+	{
+		++text;
+	}
+	return text;
+}
+
+/* Reads vifminfo file and applies records of the journal (can be NULL) on top
+ * of it.  *journal_size is set to size of the journal that was processed, can
+ * be NULL.  Locale is expected to be dropped by the caller.  Returns JSON value
+ * or NULL if there is no state. */
+static JSON_Value *
+read_info_state(const char info_file[], const char journal[],
+		long *journal_size)
+{
+	JSON_Value *state = json_parse_file(info_file);
+	if(state != NULL && json_value_get_type(state) != JSONObject)
+	{
+		json_value_free(state);
+		state = NULL;
+	}
+
+	long offset = 0;
+	FILE *fp = (journal == NULL ? NULL : os_fopen(journal, "rb"));
+	if(fp != NULL)
+	{
+		char *line = NULL;
+		while((line = read_line(fp, line)) != NULL)
+		{
+			JSON_Value *record = json_parse_string(line);
+			if(record != NULL)
+			{
+				apply_journal_record(&state, record, offset);
+				json_value_free(record);
+			}
+			offset = ftell(fp);
+		}
+		fclose(fp);
+	}
+
+	if(journal_size != NULL)
+	{
+		*journal_size = offset;
+	}
+	return state;
+}
+
+/* Applies journal record located at the offset on top of the *state, which can
+ * be NULL. */
+static void
+apply_journal_record(JSON_Value **state, const JSON_Value *record, long offset)
+{
+	double seen;
+	const JSON_Object *delta = json_object_get_object(json_object(record),
+			"delta");
+	if(delta == NULL || !get_double(json_object(record), "seen", &seen))
+	{
+		/* Not a record, maybe a partially written one. */
+		return;
+	}
+
+	JSON_Value *updated =
+		json_value_deep_copy(json_object_get_wrapping_value(delta));
+	if(*state != NULL)
+	{
+		/* Something was written after the record's writer got the state, so older
+		 * elements might contain changes unknown to it. */
+		if((long)seen != offset)
+		{
+			merge_record(json_object(updated), json_object(*state));
+		}
+		clone_missing(json_object(updated), json_object(*state));
+		json_value_free(*state);
+	}
+	*state = updated;
+}
+
+/* Appends record with changes of the state since the last synchronization to
+ * the journal.  Returns zero on success and non-zero if vifminfo file needs to
+ * be written as a whole. */
+static int
+append_journal_record(const char info_file[], const char journal[])
+{
+	if(journal_base == NULL)
+	{
+		return 1;
+	}
+
+	/* Changes of vifminfo itself mean that the journal was merged into it. */
+	filemon_t current_mon;
+	if(filemon_from_file(info_file, FMT_MODIFIED, &current_mon) != 0 ||
+			!filemon_equal(&vifminfo_mon, &current_mon))
+	{
+		return 1;
+	}
+
+	if(path_exists(journal, NODEREF) &&
+			get_file_size(journal) >= JOURNAL_MAX_SIZE)
+	{
+		return 1;
+	}
+
+	char *locale = drop_locale();
+	JSON_Value *current = serialize_state(cfg.vifm_info);
+
+	JSON_Value *record_value = json_value_init_object();
+	JSON_Object *record = json_object(record_value);
+	set_double(record, "seen", journal_offset);
+	JSON_Object *delta = add_object(record, "delta");
+
+	const JSON_Object *state = json_object(current);
+	const JSON_Object *base = json_object(journal_base);
+	int i, n;
+	for(i = 0, n = json_object_get_count(state); i < n; ++i)
+	{
+		const char *name = json_object_get_name(state, i);
+		JSON_Value *value = json_object_get_value_at(state, i);
+		if(!json_value_equals(value, json_object_get_value(base, name)))
+		{
+			json_object_set_value(delta, name, json_value_deep_copy(value));
+		}
+	}
+
+	int error = 0;
+	if(json_object_get_count(delta) != 0)
+	{
+		char *const str = json_serialize_to_string(record_value);
+		char *const line = (str == NULL ? NULL : format_str("%s\n", str));
+		json_free_serialized_string(str);
+
+		long end;
+		error = (line == NULL ||
+				append_to_journal(journal, line, strlen(line), &end) != 0);
+		if(!error)
+		{
+			journal_offset = end;
+		}
+		free(line);
+	}
+
+	json_value_free(record_value);
+	restore_locale(locale);
+
+	if(error)
+	{
+		LOG_ERROR_MSG("Error appending state to: %s", journal);
+		json_value_free(current);
+		return 1;
+	}
+
+	json_value_free(journal_base);
+	journal_base = current;
+	return 0;
+}
+
+/* Remembers current state of the instance as the one known to vifminfo. */
+static void
+sync_with_journal(long journal_size)
+{
+	char *locale = drop_locale();
+	json_value_free(journal_base);
+	journal_base = serialize_state(cfg.vifm_info);
+	restore_locale(locale);
+
+	journal_offset = journal_size;
+}
+
 /* Reads legacy barely-structured vifminfo format as a JSON.  Returns JSON
  * value or NULL on error. */
 static JSON_Value *
@@ -672,10 +1304,10 @@ load_state(JSON_Object *root, int reread)
 	load_regs(root);
 	load_dir_stack(root);
 	load_trash(root);
-	load_history(root, "cmd-hist", &curr_stats.cmd_hist);
-	load_history(root, "search-hist", &curr_stats.search_hist);
-	load_history(root, "prompt-hist", &curr_stats.prompt_hist);
-	load_history(root, "lfilt-hist", &curr_stats.filter_hist);
+	load_history(root, "cmd-hist", &curr_stats.cmd_hist, 1);
+	load_history(root, "search-hist", &curr_stats.search_hist, 1);
+	load_history(root, "prompt-hist", &curr_stats.prompt_hist, 1);
+	load_history(root, "lfilt-hist", &curr_stats.filter_hist, 1);
 }
 
 /* Loads global tabs from JSON. */
@@ -1092,14 +1724,20 @@ load_regs(JSON_Object *root)
 		int j, m;
 		const char *name = json_object_get_name(regs, i);
 		JSON_Array *files = json_array(json_object_get_value_at(regs, i));
+
+		strlist_t list = {};
 		for(j = 0, m = json_array_get_count(files); j < m; ++j)
 		{
 			const char *file = json_array_get_string(files, j);
 			if(file != NULL)
 			{
-				regs_append(name[0], file);
+				list.nitems = add_to_string_array(&list.items, list.nitems, file);
 			}
 		}
+
+		regs_append_many(name[0], list.items, list.nitems);
+		/* Strings were passed to the register. */
+		free(list.items);
 	}
 }
 
@@ -1125,14 +1763,22 @@ load_dir_stack(JSON_Object *root)
 	}
 }
 
-/* Loads trash from JSON. */
+/* Loads trash from JSON unless it's superseded by trash index file. */
 static void
 load_trash(JSON_Object *root)
 {
 	JSON_Array *trash = json_object_get_array(root, "trash");
+	if(trash_index_found || trash == NULL)
+	{
+		return;
+	}
 
-	int i, n;
-	for(i = 0, n = json_array_get_count(trash); i < n; ++i)
+	const int n = json_array_get_count(trash);
+	char **originals = reallocarray(NULL, n, sizeof(*originals));
+	char **trash_names = reallocarray(NULL, n, sizeof(*trash_names));
+
+	int i, count = 0;
+	for(i = 0; i < n && originals != NULL && trash_names != NULL; ++i)
 	{
 		JSON_Object *entry = json_array_get_object(trash, i);
 
@@ -1140,14 +1786,90 @@ load_trash(JSON_Object *root)
 		if(get_str(entry, "trashed", &trashed) &&
 				get_str(entry, "original", &original))
 		{
-			(void)trash_add_entry(original, trashed);
+			/* Strings are only copied by trash_add_entries(). */
+			originals[count] = (char *)original;
+			trash_names[count] = (char *)trashed;
+			++count;
 		}
 	}
+
+	(void)trash_add_entries(originals, trash_names, count);
+
+	free(originals);
+	free(trash_names);
+}
+
+/* Loads trash index file if it has changed since the last synchronization.
+ * Entries of this instance are preserved. */
+static void
+load_trash_index(void)
+{
+	char path[PATH_MAX + 32];
+	get_trash_index_file(path);
+
+	filemon_t mon;
+	if(filemon_from_file(path, FMT_MODIFIED, &mon) != 0)
+	{
+		return;
+	}
+	trash_index_found = 1;
+
+	if(filemon_equal(&mon, &trash_index_mon))
+	{
+		return;
+	}
+
+	const int in_sync = (trash_get_generation() == trash_index_generation);
+	if(trash_index_read(path) != 0)
+	{
+		LOG_ERROR_MSG("Error reading trash index from: %s", path);
+		return;
+	}
+
+	trash_index_mon = mon;
+	if(in_sync)
+	{
+		trash_index_generation = trash_get_generation();
+	}
 }
 
-/* Loads history data from JSON. */
+/* Writes trash index file if trash list has changed since the last
+ * synchronization. */
 static void
-load_history(JSON_Object *root, const char node[], hist_t *hist)
+store_trash_index(void)
+{
+	if(trash_get_generation() == trash_index_generation)
+	{
+		return;
+	}
+
+	char path[PATH_MAX + 32];
+	get_trash_index_file(path);
+
+	if(trash_list_size == 0 && !path_exists(path, NODEREF))
+	{
+		trash_index_generation = trash_get_generation();
+		return;
+	}
+
+	/* Don't lose entries added by other instances. */
+	load_trash_index();
+
+	if(trash_index_write(path) != 0)
+	{
+		LOG_ERROR_MSG("Error storing trash index to: %s", path);
+		return;
+	}
+
+	(void)filemon_from_file(path, FMT_MODIFIED, &trash_index_mon);
+	trash_index_generation = trash_get_generation();
+	trash_index_found = 1;
+}
+
+/* Loads history data from JSON.  Extending makes the history grow to fit all
+ * of the entries. */
+static void
+load_history(JSON_Object *root, const char node[], hist_t *hist, int extend)
 {
 	JSON_Array *entries = json_object_get_array(root, node);
 
@@ -1162,7 +1884,10 @@ load_history(JSON_Object *root, const char node[], hist_t *hist)
 			double ts = -1;
 			get_double(entry, "ts", &ts);
 
-			ensure_history_not_full(hist);
+			if(extend)
+			{
+				ensure_history_not_full(hist);
+			}
 			hist_add(hist, text, (time_t)ts);
 		}
 	}
@@ -1266,10 +1991,16 @@ set_manual_filter(view_t *view, const char value[])
 TSTATIC void
 write_info_file(void)
 {
-	char info_file[PATH_MAX + 16];
-	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
+	state_load_rest();
 
-	store_file(info_file, &vifminfo_mon, cfg.vifm_info);
+	char info_file[PATH_MAX + 32], journal[PATH_MAX + 32];
+	get_info_files(info_file, journal);
+
+	if(append_journal_record(info_file, journal) != 0)
+	{
+		store_file(info_file, journal, &vifminfo_mon, cfg.vifm_info);
+		sync_with_journal(0);
+	}
 }
 
 /* Copies the src file to the dst location.  Returns zero on success. */
@@ -1285,17 +2016,19 @@ copy_file(const char src[], const char dst[])
 	return iop_cp(&args);
 }
 
-/* Reads contents of the filename file as a JSON info file and updates it with
- * the state of current instance. */
+/* Reads contents of the filename file as a JSON info file (with records of the
+ * journal applied, if it's not NULL) and updates it with the state of current
+ * instance. */
 static void
-update_info_file(const char filename[], int vinfo, int merge)
+update_info_file(const char filename[], const char journal[], int vinfo,
+		int merge)
 {
 	char *locale = drop_locale();
 	JSON_Value *current = serialize_state(vinfo);
 
 	if(merge)
 	{
-		JSON_Value *admixture = json_parse_file(filename);
+		JSON_Value *admixture = read_info_state(filename, journal, NULL);
 		if(admixture != NULL)
 		{
 			merge_states(vinfo, 0, json_object(current), json_object(admixture));
@@ -1369,8 +2102,6 @@ serialize_state(int vinfo)
 		set_int(root, "active-gtab", tabs_current(&lwin));
 	}
 
-	store_trash(root);
-
 	if(vinfo & VINFO_OPTIONS)
 	{
 		store_global_options(root);
@@ -1506,8 +2237,6 @@ merge_states(int vinfo, int session_load, JSON_Object *current,
 		merge_options(current, admixture);
 	}
 
-	merge_trash(current, admixture);
-
 	if(session_load)
 	{
 		clone_missing(current, admixture);
@@ -2035,32 +2764,51 @@ merge_options(JSON_Object *current, const JSON_Object *admixture)
 	}
 }
 
-/* Merges two trash states. */
+/* Merges older state into a journal record which was written without knowing
+ * about some changes.  Unlike merge_states(), this doesn't consult state of
+ * current instance. */
+static void
+merge_record(JSON_Object *current, const JSON_Object *older)
+{
+	merge_tabs(VINFO_DHISTORY, 0, current, older);
+	merge_commands(current, older);
+	merge_timestamped_entries(current, older, "marks");
+	merge_timestamped_entries(current, older, "bmarks");
+	merge_history(0, current, older, "cmd-hist");
+	merge_history(0, current, older, "search-hist");
+	merge_history(0, current, older, "prompt-hist");
+	merge_history(0, current, older, "lfilt-hist");
+	merge_regs(current, older);
+	merge_options(current, older);
+}
+
+/* Merges dictionaries of elements with timestamps leaving the newest version of
+ * every element. */
 static void
-merge_trash(JSON_Object *current, const JSON_Object *admixture)
+merge_timestamped_entries(JSON_Object *current, const JSON_Object *older,
+		const char node[])
 {
-	JSON_Array *trash = json_object_get_array(current, "trash");
-	JSON_Array *updated = json_object_get_array(admixture, "trash");
-	if(trash == NULL)
+	JSON_Object *entries = json_object_get_object(current, node);
+	JSON_Object *updated = json_object_get_object(older, node);
+	if(entries == NULL)
 	{
-		clone_array(current, updated, "trash");
+		clone_object(current, updated, node);
 		return;
 	}
 
 	int i, n;
-	for(i = 0, n = json_array_get_count(updated); i < n; ++i)
+	for(i = 0, n = json_object_get_count(updated); i < n; ++i)
 	{
-		JSON_Object *entry = json_array_get_object(updated, i);
+		const char *name = json_object_get_name(updated, i);
+		JSON_Object *entry = json_object(json_object_get_value_at(updated, i));
 
-		const char *trashed, *original;
-		if(get_str(entry, "trashed", &trashed) &&
-				get_str(entry, "original", &original))
+		double ts, current_ts;
+		JSON_Object *current_entry = json_object_get_object(entries, name);
+		if(current_entry == NULL || (get_double(entry, "ts", &ts) &&
+					get_double(current_entry, "ts", &current_ts) && ts > current_ts))
 		{
-			if(!trash_has_entry(original, trashed))
-			{
-				JSON_Value *value = json_object_get_wrapping_value(entry);
-				json_array_append_value(trash, json_value_deep_copy(value));
-			}
+			JSON_Value *value = json_object_get_wrapping_value(entry);
+			json_object_set_value(entries, name, json_value_deep_copy(value));
 		}
 	}
 }
@@ -2499,23 +3247,6 @@ store_dir_stack(JSON_Object *root)
 	}
 }
 
-/* Serializes trash into JSON table. */
-static void
-store_trash(JSON_Object *root)
-{
-	if(trash_list_size > 0)
-	{
-		int i;
-		JSON_Array *trash = add_array(root, "trash");
-		for(i = 0; i < trash_list_size; ++i)
-		{
-			JSON_Object *entry = append_object(trash);
-			set_str(entry, "trashed", trash_list[i].trash_name);
-			set_str(entry, "original", trash_list[i].path);
-		}
-	}
-}
-
 /* Performs conversions on files in trash required for partial backward
  * compatibility.  Returns newly allocated string that should be freed by the
  * caller. */
@@ -2903,6 +3634,8 @@ sessions_exists(const char name[])
 int
 sessions_load(const char name[])
 {
+	state_load_rest();
+
 	char sessions_dir[PATH_MAX + 16];
 	get_session_dir(sessions_dir, sizeof(sessions_dir));
 	char session_file[PATH_MAX + 32];
@@ -2920,9 +3653,11 @@ sessions_load(const char name[])
 		return 1;
 	}
 
-	char info_file[PATH_MAX + 16];
-	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
-	JSON_Value *common = json_parse_file(info_file);
+	char info_file[PATH_MAX + 32], journal[PATH_MAX + 32];
+	get_info_files(info_file, journal);
+
+	long journal_size;
+	JSON_Value *common = read_info_state(info_file, journal, &journal_size);
 	restore_locale(locale);
 
 	if(common != NULL)
@@ -2936,6 +3671,8 @@ sessions_load(const char name[])
 	load_state(json_object(session), 0);
 	json_value_free(session);
 
+	sync_with_journal(journal_size);
+
 	set_session(name);
 	(void)filemon_from_file(session_file, FMT_MODIFIED, &session_mon);
 
@@ -2971,23 +3708,39 @@ write_session_file(void)
 	snprintf(session_file, sizeof(session_file), "%s/%s.json", sessions_dir,
 			cfg.session);
 
-	store_file(session_file, &session_mon, cfg.session_options);
+	store_file(session_file, NULL, &session_mon, cfg.session_options);
 }
 
-/* Writes file updating it with state of the current instance if necessary. */
+/* Writes file updating it with state of the current instance if necessary.
+ * Records of the journal (can be NULL) are merged into the file. */
 static void
-store_file(const char path[], filemon_t *mon, int vinfo)
+store_file(const char path[], const char journal[], filemon_t *mon, int vinfo)
 {
 	char tmp_file[PATH_MAX + 64];
 	snprintf(tmp_file, sizeof(tmp_file), "%s_%u", path, get_pid());
 
+	/* Take the journal away, so that records appended from now on end up in a
+	 * new one instead of being lost. */
+	char taken_journal[PATH_MAX + 64] = "";
+	if(journal != NULL && path_exists(journal, NODEREF))
+	{
+		snprintf(taken_journal, sizeof(taken_journal), "%s_%u", journal,
+				get_pid());
+		if(rename_file(journal, taken_journal) != 0)
+		{
+			taken_journal[0] = '\0';
+		}
+	}
+	int have_journal = (taken_journal[0] != '\0');
+
 	if(os_access(path, R_OK) != 0 || copy_file(path, tmp_file) == 0)
 	{
 		filemon_t current_mon;
 		int file_changed = filemon_from_file(path, FMT_MODIFIED, &current_mon) != 0
 		                || !filemon_equal(mon, &current_mon);
 
-		update_info_file(tmp_file, vinfo, file_changed);
+		update_info_file(tmp_file, have_journal ? taken_journal : NULL, vinfo,
+				file_changed || have_journal);
 		(void)filemon_from_file(tmp_file, FMT_MODIFIED, mon);
 
 		if(rename_file(tmp_file, path) != 0)
@@ -2995,7 +3748,112 @@ store_file(const char path[], filemon_t *mon, int vinfo)
 			LOG_ERROR_MSG("Can't replace \"%s\" file with updated temporary", path);
 			(void)remove(tmp_file);
 		}
+		else if(have_journal)
+		{
+			(void)remove(taken_journal);
+			have_journal = 0;
+		}
+	}
+
+	if(have_journal)
+	{
+		/* Put records back if they weren't merged.  Another instance might have
+		 * started a new journal by now, so append to it instead of replacing. */
+		put_journal_back(taken_journal, journal);
+	}
+}
+
+/* Appends records of a journal that was taken away back to the journal.  They
+ * lose their "seen" mark to be merged with anything written in between.  All
+ * records are appended with a single write to not interleave with appends of
+ * other instances. */
+static void
+put_journal_back(const char taken[], const char journal[])
+{
+	FILE *const in = os_fopen(taken, "rb");
+	if(in == NULL)
+	{
+		return;
+	}
+
+	char *locale = drop_locale();
+
+	char *records = NULL;
+	size_t len = 0U;
+	int error = 0;
+	char *line = NULL;
+	while((line = read_line(in, line)) != NULL)
+	{
+		JSON_Value *record = json_parse_string(line);
+		if(record == NULL)
+		{
+			continue;
+		}
+
+		set_double(json_object(record), "seen", -1);
+		char *const str = json_serialize_to_string(record);
+		error |= (str == NULL || strappend(&records, &len, str) != 0 ||
+				strappendch(&records, &len, '\n') != 0);
+		json_free_serialized_string(str);
+		json_value_free(record);
+	}
+	fclose(in);
+
+	restore_locale(locale);
+
+	if(!error && len != 0U)
+	{
+		long end;
+		error = (append_to_journal(journal, records, len, &end) != 0);
+	}
+	free(records);
+
+	if(error)
+	{
+		LOG_ERROR_MSG("Failed to put records of \"%s\" back to \"%s\"", taken,
+				journal);
+		return;
 	}
+
+	(void)remove(taken);
+}
+
+/* Appends records to the journal in a single unbuffered write, so that
+ * concurrent appends of other instances can't get in the middle of a record.
+ * Sets *end to offset past the written data.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+append_to_journal(const char journal[], const char records[], size_t len,
+		long *end)
+{
+	FILE *const fp = os_fopen(journal, "ab");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	setvbuf(fp, NULL, _IONBF, 0);
+	int error = (fwrite(records, len, 1U, fp) != 1U);
+	*end = ftell(fp);
+	error |= (fclose(fp) != 0);
+	return error;
+}
+
+/* Fills buffers of size PATH_MAX + 32 with paths to vifminfo file and its
+ * journal. */
+static void
+get_info_files(char info_file[], char journal[])
+{
+	snprintf(info_file, PATH_MAX + 32, "%s/vifminfo.json", cfg.config_dir);
+	snprintf(journal, PATH_MAX + 32, "%s/vifminfo.journal", cfg.config_dir);
+}
+
+/* Formats path to trash index file.  The buffer should be at least
+ * PATH_MAX + 32 characters long. */
+static void
+get_trash_index_file(char path[])
+{
+	snprintf(path, PATH_MAX + 32, "%s/trash-index", cfg.config_dir);
 }
 
 int
@@ -30,6 +30,15 @@ typedef void (*sessions_changed)(const char new_session[]);
  * during startup process. */
 void state_load(int reread);
 
+/* Same as state_load(0), but leaves histories and registers unparsed until
+ * state_load_rest() is called to let UI show up sooner. */
+void state_load_lazily(void);
+
+/* Loads parts of the state left unloaded by state_load_lazily().  Does nothing
+ * if there is nothing to load.  Called implicitly before anything that needs
+ * complete state. */
+void state_load_rest(void);
+
 /* Stores state of the application.  Always writes vifminfo and stores session
  * if any is active. */
 void state_store(void);
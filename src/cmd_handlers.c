@@ -77,6 +77,7 @@
 #include "utils/matcher.h"
 #include "utils/matchers.h"
 #include "utils/path.h"
+#include "utils/perf.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
@@ -244,6 +245,7 @@ static int map_or_remap(const cmd_info_t *cmd_info, int no_remap);
 static int normal_cmd(const cmd_info_t *cmd_info);
 static int nunmap_cmd(const cmd_info_t *cmd_info);
 static int only_cmd(const cmd_info_t *cmd_info);
+static int perfstats_cmd(const cmd_info_t *cmd_info);
 static int plugin_cmd(const cmd_info_t *cmd_info);
 static int plugins_cmd(const cmd_info_t *cmd_info);
 static int popd_cmd(const cmd_info_t *cmd_info);
@@ -681,6 +683,10 @@ const cmd_add_t cmds_list[] = {
 	  .descr = "switch to single-view mode",
 	  .flags = HAS_COMMENT,
 	  .handler = &only_cmd,        .min_args = 0,   .max_args = 0, },
+	{ .name = "perfstats",         .abbr = NULL,    .id = -1,
+	  .descr = "display or control performance statistics",
+	  .flags = HAS_QUOTED_ARGS | HAS_COMMENT | HAS_ENVVARS,
+	  .handler = &perfstats_cmd,   .min_args = 0,   .max_args = 2, },
 	{ .name = "plugin",            .abbr = NULL,    .id = COM_PLUGIN,
 	  .descr = "manage plugins",
 	  .flags = HAS_COMMENT,
@@ -3616,6 +3622,59 @@ only_cmd(const cmd_info_t *cmd_info)
 	return 0;
 }
 
+/* Displays statistics of hot-path probes or controls their collection. */
+static int
+perfstats_cmd(const cmd_info_t *cmd_info)
+{
+	if(cmd_info->argc == 0)
+	{
+		return (show_perfstats_menu(curr_view) != 0);
+	}
+
+	if(strcmp(cmd_info->argv[0], "dump") == 0)
+	{
+		if(cmd_info->argc != 2)
+		{
+			return CMDS_ERR_TOO_FEW_ARGS;
+		}
+
+		char *const path = expand_tilde(cmd_info->argv[1]);
+		const int error = perf_dump(path);
+		free(path);
+
+		if(error)
+		{
+			ui_sb_errf("Failed to write trace to: %s", cmd_info->argv[1]);
+			return CMDS_ERR_CUSTOM;
+		}
+		return 0;
+	}
+
+	if(cmd_info->argc != 1)
+	{
+		return CMDS_ERR_TRAILING_CHARS;
+	}
+
+	if(strcmp(cmd_info->argv[0], "on") == 0)
+	{
+		perf_enable(1);
+		return 0;
+	}
+	if(strcmp(cmd_info->argv[0], "off") == 0)
+	{
+		perf_enable(0);
+		return 0;
+	}
+	if(strcmp(cmd_info->argv[0], "reset") == 0)
+	{
+		perf_reset();
+		return 0;
+	}
+
+	ui_sb_errf("Unknown subcommand: %s", cmd_info->argv[0]);
+	return CMDS_ERR_CUSTOM;
+}
+
 /* Manages plugins. */
 static int
 plugin_cmd(const cmd_info_t *cmd_info)
@@ -18,76 +18,243 @@
 
 #include "compare.h"
 
+#include <pthread.h> /* PTHREAD_* pthread_* */
+#include <unistd.h> /* R_OK */
+
 #include <assert.h> /* assert() */
+#include <errno.h> /* ETIMEDOUT */
 #include <stddef.h> /* size_t */
-#include <stdint.h> /* INTPTR_MAX INT64_MAX */
-#include <stdio.h> /* FILE fclose() feof() fopen() fread() */
-#include <stdlib.h> /* free() malloc() */
-#include <string.h> /* memcmp() */
+#include <stdint.h> /* INTPTR_MAX INT64_MAX uint64_t */
+#include <stdio.h> /* FILE fclose() feof() fopen() fread() snprintf() */
+#include <stdlib.h> /* calloc() free() qsort() */
+#include <string.h> /* memcmp() memset() strdup() strlen() */
+#include <time.h> /* CLOCK_REALTIME clock_gettime() timespec */
 
+#include "cfg/config.h"
 #include "compat/fs_limits.h"
 #include "compat/os.h"
 #include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
 #include "ui/statusbar.h"
+#include "ui/tabs.h"
 #include "ui/ui.h"
 #include "utils/dynarray.h"
 #include "utils/fs.h"
 #include "utils/fsdata.h"
+#include "utils/hcache.h"
+#include "utils/hmap.h"
 #include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
-#include "utils/trie.h"
 #include "utils/utils.h"
+#include "background.h"
 #include "filelist.h"
 #include "fops_cpmv.h"
 #include "fops_misc.h"
 #include "running.h"
+#include "status.h"
 
 /* This is the only unit that uses xxhash, so import it directly here. */
 #define XXH_PRIVATE_API
 #include "utils/xxhash.h"
 
+#if INTPTR_MAX == INT64_MAX
+#define XX_BITS 64
+#else
+#define XX_BITS 32
+#endif
+#define XX__(name, bits) XXH ## bits ## _ ## name
+#define XX_(name, bits) XX__(name, bits)
+#define XX(name) XX_(name, XX_BITS)
+
 /* Amount of data to read at once. */
 #define BLOCK_SIZE (32*1024)
 
 /* Amount of data to hash for coarse comparison. */
 #define PREFIX_SIZE (4*1024)
 
-/* Entry in singly-bounded list of files that have matched fingerprints. */
-typedef struct compare_record_t
+/* How often progress of comparison by contents is updated (in
+ * milliseconds). */
+#define PROGRESS_PERIOD_MS 100
+
+/* Maximum number of cells of tables used to align two lists side-by-side
+ * (cells take 5 bytes and all of them are visited). */
+#define MAX_ALIGN_CELLS (16*1024*1024)
+
+/* Id of entries that should be dropped from a list (valid ids are positive and
+ * -1 is reserved for unmatched entries). */
+#define DROP_ID 0
+
+/* Kind of processing of a file which is compared by contents. */
+typedef enum
+{
+	CS_NONE,   /* Nothing needs to be done. */
+	CS_ACCESS, /* Only check that the file is readable. */
+	CS_PREFIX, /* Hash first PREFIX_SIZE bytes of the file. */
+	CS_FULL,   /* Hash the whole file. */
+	CS_VERIFY, /* Compare file byte-by-byte to the file it's a duplicate of. */
+}
+ContentStage;
+
+/* File participating in comparison by contents. */
+typedef struct
 {
-	char *path;                    /* Full path to file with sample content. */
-	int id;                        /* Chosen id. */
-	struct compare_record_t *next; /* Next entry in the list. */
+	dir_entry_t *entry; /* Entry of the file in one of the lists. */
+	char *path;         /* Full path to the file. */
+	uint64_t size;      /* Size of the file. */
+	uint64_t hash;      /* Hash of prefix or all of the file. */
+	int seq;            /* Position of the file in order of listing. */
+	int list;           /* Index of the list that contains the entry. */
+	ContentStage todo;  /* What needs to be done with the file next. */
+	int failed;         /* Whether contents of the file can't be read. */
+	int dup_of;         /* Sequence number of the first file with identical
+	                       contents or -1 if not known yet. */
+	int id;             /* Id assigned to a group of identical files. */
+	hcache_rec_t rec;   /* Record of the file in the cache of hashes. */
+	int has_rec;        /* Whether rec field is initialized. */
+}
+content_file_t;
+
+/* State of parallel processing of a set of files. */
+typedef struct
+{
+	content_file_t **files; /* Files to process. */
+	int nfiles;             /* Number of elements in the files array. */
+	content_file_t *all;    /* All files indexed by their sequence number. */
+	const hcache_t *cache;  /* Persistent cache of hashes or NULL. */
+
+	pthread_mutex_t lock; /* Protects fields below. */
+	pthread_cond_t done;  /* Signaled when a worker finishes. */
+	int next;             /* Index of the next file to pick. */
+	int processed;        /* Number of processed files. */
+	int running;          /* Number of running workers. */
+	int cancelled;        /* Whether processing should stop. */
+}
+content_job_t;
+
+/* Record of a group of files with identical fingerprints. */
+typedef struct
+{
+	int id; /* Chosen id. */
 }
 compare_record_t;
 
-static void make_unique_lists(entries_t curr, entries_t other);
-static void leave_only_dups(entries_t *curr, entries_t *other);
+/* State of views relative to a comparison. */
+typedef enum
+{
+	VS_SHOWN,  /* Views display compared locations. */
+	VS_HIDDEN, /* Some of the views is in an inactive tab. */
+	VS_GONE,   /* Some of the views has moved elsewhere or its tab was closed. */
+}
+ViewsState;
+
+/* State of a comparison.  Comparison is performed either in foreground or in
+ * background, in the latter case results are picked up by the main thread which
+ * puts them into views. */
+typedef struct compare_t
+{
+	CompareType ct;   /* Kind of comparison. */
+	ListType lt;      /* Which files to list. */
+	int group_paths;  /* Whether to group files by paths (for two panes). */
+	int skip_empty;   /* Whether to ignore empty files. */
+	char *hashes_file; /* Path to cache of hashes or NULL. */
+
+	int nviews;            /* Number of compared views (1 or 2). */
+	view_t *views[2];      /* Compared views (accessed only by main thread). */
+	unsigned int tabs[2];  /* Ids of tabs of the views at the start. */
+	char *dirs[2];         /* Locations of the views. */
+	int hide_dot[2];       /* Whether dot files are hidden in the views. */
+	int from_custom[2];    /* Whether files come from custom view. */
+	strlist_t custom[2];   /* Files of custom views. */
+
+	bg_op_t *bg_op;     /* Background operation or NULL for foreground. */
+	int progress_count; /* Counter for throttling progress reports. */
+	int shown;          /* Whether results were put into views already. */
+
+	pthread_mutex_t lock;  /* Protects fields below. */
+	int cancelled;         /* Whether results are of no interest anymore. */
+	int interrupted;       /* Whether comparison was cancelled midway. */
+	int finished;          /* Whether final results are ready. */
+	int has_partial;       /* Whether partial results are ready. */
+	entries_t partial[2];  /* Partial results (only identified files). */
+	entries_t lists[2];    /* Final results. */
+
+	struct compare_t *next; /* Next element in the list of pending ones. */
+}
+compare_t;
+
+static compare_t * compare_alloc(CompareType ct, ListType lt, int skip_empty);
+static void compare_free(compare_t *cmp);
+static void add_view(compare_t *cmp, view_t *view);
+static int start_comparison(compare_t *cmp, const char descr[]);
+static void cancel_pending(const compare_t *cmp);
+static void cancel_comparison(compare_t *cmp);
+static void compare_bg(bg_op_t *bg_op, void *arg);
+static void perform_comparison(compare_t *cmp);
+static int is_cancelled(compare_t *cmp);
+static void report_progress(compare_t *cmp, const char msg[], int period);
+static int check_comparison(compare_t *cmp);
+static ViewsState get_views_state(const compare_t *cmp);
+static int present_results(compare_t *cmp, entries_t lists[], int final);
+static int present_two_panes(compare_t *cmp, entries_t curr, entries_t other,
+		int final);
+static void make_unique_lists(view_t *curr_side, view_t *other_side,
+		entries_t curr, entries_t other);
+static void leave_only_dups(view_t *curr_side, view_t *other_side,
+		entries_t *curr, entries_t *other);
 static int is_not_duplicate(view_t *view, const dir_entry_t *entry, void *arg);
-static void fill_side_by_side(entries_t curr, entries_t other, int group_paths);
+static void fill_side_by_side(view_t *curr_side, view_t *other_side,
+		entries_t curr, entries_t other, int group_paths);
+static void fill_one_after_another(view_t *curr_side, view_t *other_side,
+		entries_t curr, entries_t other);
+static int present_one_pane(compare_t *cmp, entries_t curr, int final);
+static void restore_pos(view_t *view, int pos);
 static int id_sorter(const void *first, const void *second);
 static void put_or_free(view_t *view, dir_entry_t *entry, int id, int take);
-static entries_t make_diff_list(trie_t *trie, view_t *view, int *next_id,
-		CompareType ct, int skip_empty, int dups_only);
+static entries_t make_diff_list(compare_t *cmp, int idx);
+static void assign_ids(compare_t *cmp, hmap_t *ids, entries_t *list,
+		int *next_id, int dups_only);
+static void assign_ids_by_contents(compare_t *cmp, entries_t *curr,
+		entries_t *other, int *next_id, int dups_only);
+static void publish_partial(compare_t *cmp, content_file_t all[],
+		content_file_t *files[], int nfiles, const int ends[], int ngroups,
+		int dups_only);
+static int * group_files(content_file_t *files[], int nfiles, int by_hash,
+		int *ngroups);
+static int size_sorter(const void *first, const void *second);
+static int hash_sorter(const void *first, const void *second);
+static int run_content_job(compare_t *cmp, content_file_t *all,
+		content_file_t **files, int nfiles, const hcache_t *cache,
+		const char title[]);
+static void * content_worker(void *arg);
+static void process_content_files(content_job_t *job);
+static int job_cancelled(content_job_t *job);
+static void process_content_file(content_job_t *job, content_file_t *file);
+static int get_hash(content_job_t *job, content_file_t *file, int full);
+static void update_hcache(hcache_t *cache, const content_file_t files[],
+		int nfiles);
+static int hash_contents(const char path[], uint64_t limit, content_job_t *job,
+		uint64_t *hash);
+static void drop_invalid_entries(view_t *view, entries_t *list);
+static int is_valid_entry(view_t *view, const dir_entry_t *entry, void *arg);
 static void list_view_entries(const view_t *view, strlist_t *list);
 static int append_valid_nodes(const char name[], int valid,
 		const void *parent_data, void *data, void *arg);
-static void list_files_recursively(const char path[], int skip_dot_files,
-		strlist_t *list);
+static void list_files_recursively(compare_t *cmp, const char path[],
+		int skip_dot_files, strlist_t *list);
 static char * get_file_fingerprint(const char path[], const dir_entry_t *entry,
 		CompareType ct);
 static char * get_contents_fingerprint(const char path[],
 		const dir_entry_t *entry);
-static int get_file_id(trie_t *trie, const char path[],
-		const char fingerprint[], int *id, CompareType ct);
-static int files_are_identical(const char a[], const char b[]);
-static void put_file_id(trie_t *trie, const char path[],
-		const char fingerprint[], int id, CompareType ct);
-static void free_compare_records(void *ptr);
+static hmap_key_t get_file_key(const char path[], const dir_entry_t *entry,
+		CompareType ct);
+static int files_are_identical(const char a[], const char b[],
+		content_job_t *job);
+
+/* List of comparisons running in background. */
+static compare_t *pending;
 
 int
 compare_two_panes(CompareType ct, ListType lt, int group_paths, int skip_empty)
@@ -101,31 +268,408 @@ compare_two_panes(CompareType ct, ListType lt, int group_paths, int skip_empty)
 		return 1;
 	}
 
+	compare_t *const cmp = compare_alloc(ct, lt, skip_empty);
+	if(cmp == NULL)
+	{
+		show_error_msg("Comparison", "Not enough memory");
+		return 1;
+	}
+
+	cmp->group_paths = group_paths;
+	add_view(cmp, curr_view);
+	add_view(cmp, other_view);
+	return start_comparison(cmp, "Comparing panes");
+}
+
+int
+compare_one_pane(view_t *view, CompareType ct, ListType lt, int skip_empty)
+{
+	compare_t *const cmp = compare_alloc(ct, lt, skip_empty);
+	if(cmp == NULL)
+	{
+		show_error_msg("Comparison", "Not enough memory");
+		return 1;
+	}
+
+	add_view(cmp, view);
+	return start_comparison(cmp, "Comparing files");
+}
+
+/* Allocates state of a comparison.  Returns the state or NULL on error. */
+static compare_t *
+compare_alloc(CompareType ct, ListType lt, int skip_empty)
+{
+	compare_t *const cmp = calloc(1, sizeof(*cmp));
+	if(cmp == NULL)
+	{
+		return NULL;
+	}
+
+	cmp->ct = ct;
+	cmp->lt = lt;
+	cmp->skip_empty = skip_empty;
+	cmp->hashes_file = (cfg.hashes_file[0] == '\0' ? NULL
+	                                               : strdup(cfg.hashes_file));
+	pthread_mutex_init(&cmp->lock, NULL);
+	return cmp;
+}
+
+/* Frees state of a comparison along with all results it holds. */
+static void
+compare_free(compare_t *cmp)
+{
+	int i;
+	for(i = 0; i < cmp->nviews; ++i)
+	{
+		view_t *const view = cmp->views[i];
+		free(cmp->dirs[i]);
+		free_string_array(cmp->custom[i].items, cmp->custom[i].nitems);
+		free_dir_entries(view, &cmp->partial[i].entries, &cmp->partial[i].nentries);
+		free_dir_entries(view, &cmp->lists[i].entries, &cmp->lists[i].nentries);
+	}
+
+	pthread_mutex_destroy(&cmp->lock);
+	free(cmp->hashes_file);
+	free(cmp);
+}
+
+/* Records state of a view, which is needed to compare its files and to later
+ * find out whether results are still applicable to it.  Lists entries of
+ * custom views as they can't be accessed outside of the main thread. */
+static void
+add_view(compare_t *cmp, view_t *view)
+{
+	const int i = cmp->nviews++;
+	cmp->views[i] = view;
+	cmp->tabs[i] = tabs_current_id(view);
+	cmp->dirs[i] = strdup(flist_get_dir(view));
+	cmp->hide_dot[i] = view->hide_dot;
+
+	cmp->from_custom[i] = flist_custom_active(view)
+	                   && ONE_OF(view->custom.type, CV_REGULAR, CV_VERY);
+	if(cmp->from_custom[i])
+	{
+		list_view_entries(view, &cmp->custom[i]);
+	}
+}
+
+/* Performs the comparison either right away or in background.  The descr is
+ * description of the background job.  Returns non-zero if status bar message
+ * should be preserved. */
+static int
+start_comparison(compare_t *cmp, const char descr[])
+{
+	cancel_pending(cmp);
+
+	/* Before TUI is fully loaded (e.g., for startup commands) results are
+	 * expected to be available once the command is done. */
+	if(curr_stats.load_stage < 3)
+	{
+		ui_cancellation_push_on();
+		perform_comparison(cmp);
+		ui_cancellation_pop();
+
+		/* Clear progress message displayed by make_diff_list(). */
+		ui_sb_quick_msg_clear();
+
+		const int result = present_results(cmp, cmp->lists, 1);
+		compare_free(cmp);
+		return result;
+	}
+
+	cmp->next = pending;
+	pending = cmp;
+
+	if(bg_execute(descr, "Listing...", BG_UNDEFINED_TOTAL, 1, &compare_bg,
+				cmp) != 0)
+	{
+		pending = cmp->next;
+		compare_free(cmp);
+		show_error_msg("Comparison", "Failed to start background operation");
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Marks pending comparisons that involve any of the views of the comparison as
+ * cancelled, their results are no longer needed. */
+static void
+cancel_pending(const compare_t *cmp)
+{
+	compare_t *p;
+	for(p = pending; p != NULL; p = p->next)
+	{
+		int i, j;
+		for(i = 0; i < p->nviews; ++i)
+		{
+			for(j = 0; j < cmp->nviews; ++j)
+			{
+				if(p->views[i] == cmp->views[j])
+				{
+					cancel_comparison(p);
+				}
+			}
+		}
+	}
+}
+
+/* Marks comparison as cancelled. */
+static void
+cancel_comparison(compare_t *cmp)
+{
+	pthread_mutex_lock(&cmp->lock);
+	cmp->cancelled = 1;
+	pthread_mutex_unlock(&cmp->lock);
+}
+
+/* Entry point of a background task that performs comparison. */
+static void
+compare_bg(bg_op_t *bg_op, void *arg)
+{
+	compare_t *const cmp = arg;
+	cmp->bg_op = bg_op;
+
+	perform_comparison(cmp);
+
+	pthread_mutex_lock(&cmp->lock);
+	cmp->finished = 1;
+	pthread_mutex_unlock(&cmp->lock);
+}
+
+/* Lists files and assigns ids to them.  Doesn't access views, so can be run
+ * outside of the main thread. */
+static void
+perform_comparison(compare_t *cmp)
+{
+	int i;
 	int next_id = 1;
-	entries_t curr, other;
+	entries_t lists[2] = {};
+	const int dups_only = (cmp->nviews == 2 && cmp->lt == LT_DUPS);
+
+	for(i = 0; i < cmp->nviews; ++i)
+	{
+		lists[i] = make_diff_list(cmp, i);
+	}
+
+	if(cmp->ct == CT_CONTENTS)
+	{
+		assign_ids_by_contents(cmp, &lists[0],
+				(cmp->nviews == 2 ? &lists[1] : NULL), &next_id, dups_only);
+	}
+	else
+	{
+		hmap_t *const ids = hmap_create(sizeof(compare_record_t));
+		for(i = 0; i < cmp->nviews && ids != NULL; ++i)
+		{
+			assign_ids(cmp, ids, &lists[i], &next_id, i != 0 && dups_only);
+		}
+		hmap_free(ids);
+	}
+
+	const int interrupted = is_cancelled(cmp);
+
+	pthread_mutex_lock(&cmp->lock);
+	cmp->lists[0] = lists[0];
+	cmp->lists[1] = lists[1];
+	cmp->interrupted = interrupted;
+	pthread_mutex_unlock(&cmp->lock);
+}
+
+/* Checks whether comparison should stop.  Returns non-zero if so. */
+static int
+is_cancelled(compare_t *cmp)
+{
+	if(cmp->bg_op == NULL)
+	{
+		return ui_cancellation_requested();
+	}
+
+	pthread_mutex_lock(&cmp->lock);
+	const int cancelled = cmp->cancelled;
+	pthread_mutex_unlock(&cmp->lock);
+
+	return cancelled || bg_op_cancelled(cmp->bg_op);
+}
+
+/* Reports progress of comparison either on status bar or as description of
+ * background job.  The period has the same meaning as for show_progress(). */
+static void
+report_progress(compare_t *cmp, const char msg[], int period)
+{
+	if(cmp->bg_op == NULL)
+	{
+		show_progress(msg, period);
+		return;
+	}
+
+	if(period == 0)
+	{
+		cmp->progress_count = 0;
+	}
+	else if(period > 1 && ++cmp->progress_count%period != 1)
+	{
+		return;
+	}
+
+	char descr[128];
+	if(period > 1)
+	{
+		snprintf(descr, sizeof(descr), "%s %d", msg, cmp->progress_count);
+		msg = descr;
+	}
+	bg_op_set_descr(cmp->bg_op, msg);
+}
+
+void
+compare_check_for_updates(void)
+{
+	compare_t **link = &pending;
+	while(*link != NULL)
+	{
+		compare_t *const cmp = *link;
+		if(check_comparison(cmp))
+		{
+			*link = cmp->next;
+			compare_free(cmp);
+		}
+		else
+		{
+			link = &cmp->next;
+		}
+	}
+}
+
+/* Puts available results of a background comparison into views if they are
+ * still showing what was compared.  Returns non-zero if the comparison is over
+ * and can be freed. */
+static int
+check_comparison(compare_t *cmp)
+{
+	int i;
+	entries_t partial[2] = {};
+
+	pthread_mutex_lock(&cmp->lock);
+	const int finished = cmp->finished;
+	const int cancelled = cmp->cancelled;
+	const int has_partial = cmp->has_partial;
+	if(has_partial)
+	{
+		partial[0] = cmp->partial[0];
+		partial[1] = cmp->partial[1];
+		memset(cmp->partial, 0, sizeof(cmp->partial));
+		cmp->has_partial = 0;
+	}
+	pthread_mutex_unlock(&cmp->lock);
 
-	trie_t *const trie = trie_create();
-	ui_cancellation_push_on();
+	const ViewsState state = (cancelled ? VS_GONE : get_views_state(cmp));
+	if(state == VS_GONE && !cancelled)
+	{
+		cancel_comparison(cmp);
+	}
+
+	if(state != VS_SHOWN || finished)
+	{
+		/* Partial results are superseded by the final ones or are of no use. */
+		for(i = 0; i < cmp->nviews; ++i)
+		{
+			free_dir_entries(cmp->views[i], &partial[i].entries,
+					&partial[i].nentries);
+		}
+	}
+
+	if(state == VS_SHOWN)
+	{
+		if(finished)
+		{
+			(void)present_results(cmp, cmp->lists, 1);
+			return 1;
+		}
+		if(has_partial)
+		{
+			(void)present_results(cmp, partial, 0);
+		}
+		return 0;
+	}
 
-	curr = make_diff_list(trie, curr_view, &next_id, ct, skip_empty, 0);
-	other = make_diff_list(trie, other_view, &next_id, ct, skip_empty,
-			lt == LT_DUPS);
+	/* Results for a view in an inactive tab are kept until it's activated. */
+	return (state == VS_GONE && finished);
+}
+
+/* Checks whether views still display locations that are being compared.
+ * Returns the state. */
+static ViewsState
+get_views_state(const compare_t *cmp)
+{
+	int i;
+	ViewsState state = VS_SHOWN;
+	for(i = 0; i < cmp->nviews; ++i)
+	{
+		view_t *const view = cmp->views[i];
+		if(tabs_current_id(view) != cmp->tabs[i])
+		{
+			if(!tabs_has_id(view, cmp->tabs[i]))
+			{
+				return VS_GONE;
+			}
+			state = VS_HIDDEN;
+			continue;
+		}
+
+		if(!paths_are_equal(flist_get_dir(view), cmp->dirs[i]) ||
+				(cmp->shown && !flist_custom_active(view)))
+		{
+			return VS_GONE;
+		}
+	}
+	return state;
+}
 
-	ui_cancellation_pop();
-	trie_free_with_data(trie, &free_compare_records);
+/* Puts results of comparison into its views.  Takes ownership of the lists.
+ * Non-final results are partial and can be empty.  Returns non-zero if status
+ * bar message should be preserved. */
+static int
+present_results(compare_t *cmp, entries_t lists[], int final)
+{
+	int i;
+	entries_t taken[2];
+	for(i = 0; i < 2; ++i)
+	{
+		taken[i] = lists[i];
+		lists[i] = (entries_t){};
+	}
 
-	/* Clear progress message displayed by make_diff_list(). */
-	ui_sb_quick_msg_clear();
+	for(i = 0; i < cmp->nviews; ++i)
+	{
+		drop_invalid_entries(cmp->views[i], &taken[i]);
+	}
 
-	if(ui_cancellation_requested())
+	if(final && cmp->interrupted)
 	{
-		free_dir_entries(curr_view, &curr.entries, &curr.nentries);
-		free_dir_entries(other_view, &other.entries, &other.nentries);
+		for(i = 0; i < cmp->nviews; ++i)
+		{
+			free_dir_entries(cmp->views[i], &taken[i].entries, &taken[i].nentries);
+		}
 		ui_sb_msg("Comparison has been cancelled");
 		return 1;
 	}
 
-	if(!group_paths || lt != LT_ALL)
+	return (cmp->nviews == 2)
+	     ? present_two_panes(cmp, taken[0], taken[1], final)
+	     : present_one_pane(cmp, taken[0], final);
+}
+
+/* Puts results of comparison of two panes into the views.  Takes ownership of
+ * the lists.  Returns non-zero if status bar message should be preserved. */
+static int
+present_two_panes(compare_t *cmp, entries_t curr, entries_t other, int final)
+{
+	view_t *const curr_side = cmp->views[0];
+	view_t *const other_side = cmp->views[1];
+	const ListType lt = cmp->lt;
+	const int pos = (cmp->shown ? curr_side->list_pos : 0);
+
+	if(!cmp->group_paths || lt != LT_ALL)
 	{
 		/* Sort both lists according to unique file numbers to group identical files
 		 * (sorting is stable, tags are set in make_diff_list()). */
@@ -136,54 +680,64 @@ compare_two_panes(CompareType ct, ListType lt, int group_paths, int skip_empty)
 
 	if(lt == LT_UNIQUE)
 	{
-		make_unique_lists(curr, other);
+		make_unique_lists(curr_side, other_side, curr, other);
+		restore_pos(curr_side, pos);
+		restore_pos(other_side, pos);
+		cmp->shown = 1;
 		return 0;
 	}
 
 	if(lt == LT_DUPS)
 	{
-		leave_only_dups(&curr, &other);
+		leave_only_dups(curr_side, other_side, &curr, &other);
 	}
 
-	flist_custom_start(curr_view, lt == LT_ALL ? "diff" : "dups diff");
-	flist_custom_start(other_view, lt == LT_ALL ? "diff" : "dups diff");
+	flist_custom_start(curr_side, lt == LT_ALL ? "diff" : "dups diff");
+	flist_custom_start(other_side, lt == LT_ALL ? "diff" : "dups diff");
 
-	fill_side_by_side(curr, other, group_paths);
+	fill_side_by_side(curr_side, other_side, curr, other, cmp->group_paths);
 
-	if(flist_custom_finish(curr_view, CV_DIFF, 0) != 0)
+	if(flist_custom_finish(curr_side, CV_DIFF, 0) != 0)
 	{
-		show_error_msg("Comparison", "No results to display");
+		/* Drop data of the other view too (it's empty as well). */
+		(void)flist_custom_finish(other_side, CV_DIFF, 0);
+		if(final)
+		{
+			show_error_msg("Comparison", "No results to display");
+		}
 		return 0;
 	}
-	if(flist_custom_finish(other_view, CV_DIFF, 0) != 0)
+	if(flist_custom_finish(other_side, CV_DIFF, 0) != 0)
 	{
 		assert(0 && "The error shouldn't be happening here.");
 	}
 
-	curr_view->list_pos = 0;
-	other_view->list_pos = 0;
-	curr_view->custom.diff_cmp_type = ct;
-	other_view->custom.diff_cmp_type = ct;
-	curr_view->custom.diff_path_group = group_paths;
-	other_view->custom.diff_path_group = group_paths;
+	restore_pos(curr_side, pos);
+	restore_pos(other_side, pos);
+	curr_side->custom.diff_cmp_type = cmp->ct;
+	other_side->custom.diff_cmp_type = cmp->ct;
+	curr_side->custom.diff_path_group = cmp->group_paths;
+	other_side->custom.diff_path_group = cmp->group_paths;
 
-	assert(curr_view->list_rows == other_view->list_rows &&
+	assert(curr_side->list_rows == other_side->list_rows &&
 			"Diff views must be in sync!");
 
-	ui_view_schedule_redraw(curr_view);
-	ui_view_schedule_redraw(other_view);
+	cmp->shown = 1;
+	ui_view_schedule_redraw(curr_side);
+	ui_view_schedule_redraw(other_side);
 	return 0;
 }
 
 /* Composes two views containing only files that are unique to each of them.
  * Assumes that both lists are sorted by id. */
 static void
-make_unique_lists(entries_t curr, entries_t other)
+make_unique_lists(view_t *curr_side, view_t *other_side, entries_t curr,
+		entries_t other)
 {
 	int i, j = 0;
 
-	flist_custom_start(curr_view, "unique");
-	flist_custom_start(other_view, "unique");
+	flist_custom_start(curr_side, "unique");
+	flist_custom_start(other_side, "unique");
 
 	for(i = 0; i < other.nentries; ++i)
 	{
@@ -191,23 +745,23 @@ make_unique_lists(entries_t curr, entries_t other)
 
 		while(j < curr.nentries && curr.entries[j].id < id)
 		{
-			flist_custom_put(curr_view, &curr.entries[j]);
+			flist_custom_put(curr_side, &curr.entries[j]);
 			++j;
 		}
 
 		if(j >= curr.nentries || curr.entries[j].id != id)
 		{
-			flist_custom_put(other_view, &other.entries[i]);
+			flist_custom_put(other_side, &other.entries[i]);
 			continue;
 		}
 
 		while(j < curr.nentries && curr.entries[j].id == id)
 		{
-			fentry_free(curr_view, &curr.entries[j++]);
+			fentry_free(curr_side, &curr.entries[j++]);
 		}
 		while(i < other.nentries && other.entries[i].id == id)
 		{
-			fentry_free(other_view, &other.entries[i++]);
+			fentry_free(other_side, &other.entries[i++]);
 		}
 		--i;
 	}
@@ -217,20 +771,18 @@ make_unique_lists(entries_t curr, entries_t other)
 	dynarray_free(curr.entries);
 	dynarray_free(other.entries);
 
-	(void)flist_custom_finish(curr_view, CV_REGULAR, 1);
-	(void)flist_custom_finish(other_view, CV_REGULAR, 1);
-
-	curr_view->list_pos = 0;
-	other_view->list_pos = 0;
+	(void)flist_custom_finish(curr_side, CV_REGULAR, 1);
+	(void)flist_custom_finish(other_side, CV_REGULAR, 1);
 
-	ui_view_schedule_redraw(curr_view);
-	ui_view_schedule_redraw(other_view);
+	ui_view_schedule_redraw(curr_side);
+	ui_view_schedule_redraw(other_side);
 }
 
 /* Synchronizes two lists of entries so that they contain only items that
  * present in both of the lists.  Assumes that both lists are sorted by id. */
 static void
-leave_only_dups(entries_t *curr, entries_t *other)
+leave_only_dups(view_t *curr_side, view_t *other_side, entries_t *curr,
+		entries_t *other)
 {
 	int new_id = 0;
 	int i = 0, j = 0;
@@ -279,9 +831,9 @@ leave_only_dups(entries_t *curr, entries_t *other)
 		curr->entries[j++].id = -1;
 	}
 
-	(void)zap_entries(other_view, other->entries, &other->nentries,
+	(void)zap_entries(other_side, other->entries, &other->nentries,
 			&is_not_duplicate, NULL, 1, 0);
-	(void)zap_entries(curr_view, curr->entries, &curr->nentries,
+	(void)zap_entries(curr_side, curr->entries, &curr->nentries,
 			&is_not_duplicate, NULL, 1, 0);
 }
 
@@ -295,11 +847,18 @@ is_not_duplicate(view_t *view, const dir_entry_t *entry, void *arg)
 
 /* Composes side-by-side comparison of files in two views. */
 static void
-fill_side_by_side(entries_t curr, entries_t other, int group_paths)
+fill_side_by_side(view_t *curr_side, view_t *other_side, entries_t curr,
+		entries_t other, int group_paths)
 {
 	enum { UP, LEFT, DIAG };
 
 	int i, j;
+	if((uint64_t)(curr.nentries + 1)*(other.nentries + 1) > MAX_ALIGN_CELLS)
+	{
+		fill_one_after_another(curr_side, other_side, curr, other);
+		return;
+	}
+
 	/* Describes results of solving sub-problems. */
 	int (*d)[other.nentries + 1] =
 		reallocarray(NULL, curr.nentries + 1, sizeof(*d));
@@ -307,6 +866,14 @@ fill_side_by_side(entries_t curr, entries_t other, int group_paths)
 	char (*p)[other.nentries + 1] =
 		reallocarray(NULL, curr.nentries + 1, sizeof(*p));
 
+	if(d == NULL || p == NULL)
+	{
+		free(d);
+		free(p);
+		fill_one_after_another(curr_side, other_side, curr, other);
+		return;
+	}
+
 	for(i = 0; i <= curr.nentries; ++i)
 	{
 		for(j = 0; j <= other.nentries; ++j)
@@ -350,17 +917,18 @@ fill_side_by_side(entries_t curr, entries_t other, int group_paths)
 
 			case UP:
 				e = &curr.entries[curr.nentries - 1 - --i];
-				flist_custom_put(curr_view, e);
-				flist_custom_add_separator(other_view, e->id);
+				flist_custom_put(curr_side, e);
+				flist_custom_add_separator(other_side, e->id);
 				break;
 			case LEFT:
 				e = &other.entries[other.nentries - 1 - --j];
-				flist_custom_put(other_view, e);
-				flist_custom_add_separator(curr_view, e->id);
+				flist_custom_put(other_side, e);
+				flist_custom_add_separator(curr_side, e->id);
 				break;
 			case DIAG:
-				flist_custom_put(curr_view, &curr.entries[curr.nentries - 1 - --i]);
-				flist_custom_put(other_view, &other.entries[other.nentries - 1 - --j]);
+				flist_custom_put(curr_side, &curr.entries[curr.nentries - 1 - --i]);
+				flist_custom_put(other_side,
+						&other.entries[other.nentries - 1 - --j]);
 				break;
 		}
 	}
@@ -374,41 +942,48 @@ fill_side_by_side(entries_t curr, entries_t other, int group_paths)
 	dynarray_free(other.entries);
 }
 
-int
-compare_one_pane(view_t *view, CompareType ct, ListType lt, int skip_empty)
+/* Composes comparison of files in two views without aligning them, which is a
+ * fallback for lists that are too long to be aligned. */
+static void
+fill_one_after_another(view_t *curr_side, view_t *other_side, entries_t curr,
+		entries_t other)
+{
+	int i;
+	for(i = 0; i < curr.nentries; ++i)
+	{
+		flist_custom_put(curr_side, &curr.entries[i]);
+		flist_custom_add_separator(other_side, curr.entries[i].id);
+	}
+	for(i = 0; i < other.nentries; ++i)
+	{
+		flist_custom_put(other_side, &other.entries[i]);
+		flist_custom_add_separator(curr_side, other.entries[i].id);
+	}
+
+	dynarray_free(curr.entries);
+	dynarray_free(other.entries);
+}
+
+/* Puts results of comparison of files of a single view into it.  Takes
+ * ownership of the list.  Returns non-zero if status bar message should be
+ * preserved. */
+static int
+present_one_pane(compare_t *cmp, entries_t curr, int final)
 {
 	int i, dup_id;
-	view_t *other = (view == curr_view) ? other_view : curr_view;
+	view_t *const view = cmp->views[0];
+	view_t *const other = (view == &lwin ? &rwin : &lwin);
+	const ListType lt = cmp->lt;
 	const char *const title = (lt == LT_ALL)  ? "compare"
 	                        : (lt == LT_DUPS) ? "dups" : "nondups";
-
-	int next_id = 1;
-	entries_t curr;
-
-	trie_t *trie = trie_create();
-	ui_cancellation_push_on();
-
-	curr = make_diff_list(trie, view, &next_id, ct, skip_empty, 0);
-
-	ui_cancellation_pop();
-	trie_free_with_data(trie, &free_compare_records);
-
-	/* Clear progress message displayed by make_diff_list(). */
-	ui_sb_quick_msg_clear();
-
-	if(ui_cancellation_requested())
-	{
-		free_dir_entries(view, &curr.entries, &curr.nentries);
-		ui_sb_msg("Comparison has been cancelled");
-		return 1;
-	}
+	const int pos = (cmp->shown ? view->list_pos : 0);
 
 	safe_qsort(curr.entries, curr.nentries, sizeof(*curr.entries), &id_sorter);
 
 	flist_custom_start(view, title);
 
+	int next_id = 0;
 	dup_id = -1;
-	next_id = 0;
 	for(i = 0; i < curr.nentries; ++i)
 	{
 		dir_entry_t *entry = &curr.entries[i];
@@ -445,7 +1020,11 @@ compare_one_pane(view_t *view, CompareType ct, ListType lt, int skip_empty)
 	if(flist_custom_finish(view, lt == LT_UNIQUE ? CV_REGULAR : CV_COMPARE,
 				0) != 0)
 	{
-		show_error_msg("Comparison", "No results to display");
+		/* Partial results can be empty. */
+		if(final)
+		{
+			show_error_msg("Comparison", "No results to display");
+		}
 		return 0;
 	}
 
@@ -456,11 +1035,20 @@ compare_one_pane(view_t *view, CompareType ct, ListType lt, int skip_empty)
 		rn_leave(other, 1);
 	}
 
-	view->list_pos = 0;
+	restore_pos(view, pos);
+	cmp->shown = 1;
 	ui_view_schedule_redraw(view);
 	return 0;
 }
 
+/* Sets cursor position in a view which might have been changed by the user
+ * after partial results of comparison were shown. */
+static void
+restore_pos(view_t *view, int pos)
+{
+	view->list_pos = MAX(0, MIN(pos, view->list_rows - 1));
+}
+
 /* qsort() comparer that stable sorts entries in ascending order.  Returns
  * standard -1, 0, 1 for comparisons. */
 static int
@@ -487,89 +1075,727 @@ put_or_free(view_t *view, dir_entry_t *entry, int id, int take)
 	}
 }
 
-/* Makes sorted by path list of entries that.  The trie is used to keep track of
- * identical files.  With non-zero dups_only, new files aren't added to the
- * trie. */
+/* Makes sorted by path list of entries of files of idx-th view to be compared.
+ * Ids of the entries are left unset, but tags are set to reflect the order. */
 static entries_t
-make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
-		int skip_empty, int dups_only)
+make_diff_list(compare_t *cmp, int idx)
 {
 	int i;
 	strlist_t files = {};
 	entries_t r = {};
 	int last_progress = 0;
+	/* The view is used only as an argument that isn't dereferenced. */
+	view_t *const view = cmp->views[idx];
 
-	show_progress("Listing...", 0);
-	if(flist_custom_active(view) &&
-			ONE_OF(view->custom.type, CV_REGULAR, CV_VERY))
+	report_progress(cmp, "Listing...", 0);
+	if(cmp->from_custom[idx])
 	{
-		list_view_entries(view, &files);
+		files = cmp->custom[idx];
+		cmp->custom[idx] = (strlist_t){};
 	}
 	else
 	{
-		list_files_recursively(flist_get_dir(view), view->hide_dot, &files);
+		list_files_recursively(cmp, cmp->dirs[idx], cmp->hide_dot[idx], &files);
 	}
 
-	show_progress("Querying...", 0);
-	for(i = 0; i < files.nitems && !ui_cancellation_requested(); ++i)
+	report_progress(cmp, "Querying...", 0);
+	for(i = 0; i < files.nitems && !is_cancelled(cmp); ++i)
 	{
 		int progress;
-		int existing_id;
-		char *fingerprint;
 		const char *const path = files.items[i];
 		dir_entry_t *const entry = entry_list_add(view, &r.entries, &r.nentries,
 				path);
-
-		if(skip_empty && entry->size == 0)
+		if(entry == NULL)
 		{
-			fentry_free(view, entry);
-			--r.nentries;
 			continue;
 		}
 
-		fingerprint = get_file_fingerprint(path, entry, ct);
-		/* In case we couldn't obtain fingerprint (e.g., comparing by contents and
-		 * files isn't readable), ignore the file and keep going. */
-		if(is_null_or_empty(fingerprint))
+		if(cmp->skip_empty && entry->size == 0)
 		{
-			free(fingerprint);
 			fentry_free(view, entry);
 			--r.nentries;
 			continue;
 		}
 
 		entry->tag = i;
-		if(get_file_id(trie, path, fingerprint, &existing_id, ct))
+		entry->id = DROP_ID;
+
+		progress = (i*100)/files.nitems;
+		if(progress != last_progress)
 		{
-			entry->id = existing_id;
+			char progress_msg[128];
+
+			last_progress = progress;
+			snprintf(progress_msg, sizeof(progress_msg), "Querying... %d (% 2d%%)", i,
+					progress);
+			report_progress(cmp, progress_msg, -1);
 		}
-		else if(dups_only)
+	}
+
+	free_string_array(files.items, files.nitems);
+	return r;
+}
+
+/* Assigns ids to entries of the list by looking them up in the map of ids,
+ * which is used to keep track of identical files.  With non-zero dups_only, new
+ * files aren't added to the map.  Not suitable for comparison by contents. */
+static void
+assign_ids(compare_t *cmp, hmap_t *ids, entries_t *list, int *next_id,
+		int dups_only)
+{
+	int i;
+	for(i = 0; i < list->nentries && !is_cancelled(cmp); ++i)
+	{
+		char path[PATH_MAX + 1];
+		dir_entry_t *const entry = &list->entries[i];
+
+		get_full_path_of(entry, sizeof(path), path);
+		const hmap_key_t key = get_file_key(path, entry, cmp->ct);
+
+		const compare_record_t *const existing = hmap_get(ids, key);
+		if(existing != NULL)
+		{
+			entry->id = existing->id;
+			continue;
+		}
+
+		if(dups_only)
 		{
 			entry->id = -1;
+			continue;
+		}
+
+		entry->id = *next_id;
+		++*next_id;
+
+		int created;
+		compare_record_t *const record = hmap_put(ids, key, &created);
+		if(record != NULL)
+		{
+			record->id = entry->id;
+		}
+	}
+}
+
+/* Assigns ids to entries of one or two lists (other can be NULL) by contents of
+ * their files in tiers: size, prefix hash, full hash and bytes.  With non-zero
+ * dups_only, other files don't get new ids.  Unreadable ones get DROP_ID. */
+static void
+assign_ids_by_contents(compare_t *cmp, entries_t *curr, entries_t *other,
+		int *next_id, int dups_only)
+{
+	int i, j;
+	entries_t *const lists[] = { curr, other };
+
+	int nfiles = curr->nentries + (other == NULL ? 0 : other->nentries);
+	content_file_t *const all = reallocarray(NULL, nfiles, sizeof(*all));
+	content_file_t **const files = reallocarray(NULL, nfiles, sizeof(*files));
+	if(all == NULL || files == NULL)
+	{
+		free(all);
+		free(files);
+		return;
+	}
+
+	nfiles = 0;
+	for(i = 0; i < (int)ARRAY_LEN(lists); ++i)
+	{
+		for(j = 0; lists[i] != NULL && j < lists[i]->nentries; ++j)
+		{
+			char path[PATH_MAX + 1];
+			dir_entry_t *const entry = &lists[i]->entries[j];
+			get_full_path_of(entry, sizeof(path), path);
+
+			content_file_t *const file = &all[nfiles];
+			file->entry = entry;
+			file->path = strdup(path);
+			file->size = entry->size;
+			file->hash = 0;
+			file->seq = nfiles;
+			file->list = i;
+			file->todo = CS_NONE;
+			file->failed = (file->path == NULL);
+			file->dup_of = -1;
+			file->id = DROP_ID;
+			file->has_rec = 0;
+
+			files[nfiles++] = file;
+		}
+	}
+
+	/* Tier #1: files of unique size or empty ones don't need to be read, others
+	 * need their prefix to be hashed. */
+	int ngroups;
+	int *const sizes = group_files(files, nfiles, 0, &ngroups);
+	for(i = 0; i < ngroups; ++i)
+	{
+		const int start = (i == 0 ? 0 : sizes[i - 1]);
+		const int unique = (sizes[i] - start == 1 || files[start]->size == 0);
+		for(j = start; j < sizes[i]; ++j)
+		{
+			files[j]->todo = (unique ? CS_ACCESS : CS_PREFIX);
+		}
+	}
+	free(sizes);
+
+	hcache_t *const cache = (cmp->hashes_file == NULL)
+	                      ? NULL
+	                      : hcache_load(cmp->hashes_file, XX_BITS);
+
+	int failed = run_content_job(cmp, all, files, nfiles, cache, "Hashing...");
+
+	/* Tier #2: files with colliding prefixes which are larger than the prefix
+	 * are hashed in full. */
+	int *const prefixes = group_files(files, nfiles, 1, &ngroups);
+	if(!failed)
+	{
+		publish_partial(cmp, all, files, nfiles, prefixes, ngroups, dups_only);
+	}
+	int nfull = 0;
+	for(i = 0; i < ngroups && !failed; ++i)
+	{
+		const int start = (i == 0 ? 0 : prefixes[i - 1]);
+		const int full = (prefixes[i] - start > 1 &&
+				files[start]->size > PREFIX_SIZE);
+		for(j = start; j < prefixes[i]; ++j)
+		{
+			files[j]->todo = (full ? CS_FULL : CS_NONE);
+			nfull += full;
+		}
+	}
+	free(prefixes);
+
+	if(nfull != 0 && !failed)
+	{
+		failed = run_content_job(cmp, all, files, nfiles, cache,
+				"Hashing in full...");
+	}
+
+	if(cache != NULL)
+	{
+		update_hcache(cache, all, nfiles);
+		(void)hcache_save(cache);
+		hcache_free(cache);
+	}
+
+	/* Tier #3: files with matching hashes are compared against the first file in
+	 * their group. */
+	int *const hashes = group_files(files, nfiles, 1, &ngroups);
+	if(nfull != 0 && !failed)
+	{
+		publish_partial(cmp, all, files, nfiles, hashes, ngroups, dups_only);
+	}
+	for(i = 0; i < ngroups && !failed; ++i)
+	{
+		const int start = (i == 0 ? 0 : hashes[i - 1]);
+		content_file_t *const first = files[start];
+		const int verify = (first->size != 0);
+		for(j = start; j < hashes[i]; ++j)
+		{
+			files[j]->dup_of = first->seq;
+			files[j]->todo = (verify && j != start ? CS_VERIFY : CS_NONE);
+		}
+	}
+	free(hashes);
+
+	if(!failed)
+	{
+		failed = run_content_job(cmp, all, files, nfiles, NULL, "Comparing...");
+	}
+
+	/* Files for which verification didn't succeed (that's a hash collision) are
+	 * matched against all previous files of their group. */
+	for(i = 0; i < nfiles && !failed; ++i)
+	{
+		content_file_t *const file = &all[i];
+		if(file->failed || file->dup_of != -1)
+		{
+			continue;
+		}
+
+		file->dup_of = file->seq;
+		for(j = 0; j < i; ++j)
+		{
+			content_file_t *const prev = &all[j];
+			if(!prev->failed && prev->dup_of == prev->seq &&
+					prev->size == file->size && prev->hash == file->hash &&
+					files_are_identical(file->path, prev->path, NULL))
+			{
+				file->dup_of = prev->seq;
+				break;
+			}
+		}
+	}
+
+	/* Ids are assigned in order of listing to make them independent of the way
+	 * files were processed. */
+	for(i = 0; i < nfiles && !failed; ++i)
+	{
+		content_file_t *const file = &all[i];
+		content_file_t *const first = &all[file->dup_of];
+
+		if(file->failed)
+		{
+			file->entry->id = DROP_ID;
+		}
+		else if(first->id != DROP_ID)
+		{
+			file->entry->id = first->id;
+		}
+		else if(dups_only && file->list != 0)
+		{
+			file->entry->id = -1;
 		}
 		else
 		{
-			entry->id = *next_id;
+			first->id = *next_id;
+			file->entry->id = *next_id;
 			++*next_id;
-			put_file_id(trie, path, fingerprint, entry->id, ct);
 		}
+	}
+
+	for(i = 0; i < nfiles; ++i)
+	{
+		free(all[i].path);
+	}
+	free(all);
+	free(files);
+}
 
-		free(fingerprint);
+/* Hands over to the main thread copies of entries whose ids are already known
+ * (unique and empty files).  Groups are described by ends array from
+ * group_files(). */
+static void
+publish_partial(compare_t *cmp, content_file_t all[], content_file_t *files[],
+		int nfiles, const int ends[], int ngroups, int dups_only)
+{
+	int i, j;
 
-		progress = (i*100)/files.nitems;
+	if(cmp->bg_op == NULL || ends == NULL)
+	{
+		return;
+	}
+
+	/* First file of a group for every identified file or -1. */
+	int *const firsts = reallocarray(NULL, nfiles, sizeof(*firsts));
+	/* Ids of groups by the first file. */
+	int *const ids = calloc(nfiles, sizeof(*ids));
+	if(firsts == NULL || ids == NULL)
+	{
+		free(firsts);
+		free(ids);
+		return;
+	}
+
+	for(i = 0; i < nfiles; ++i)
+	{
+		firsts[i] = -1;
+	}
+	for(i = 0; i < ngroups; ++i)
+	{
+		const int start = (i == 0 ? 0 : ends[i - 1]);
+		if(ends[i] - start == 1 || files[start]->size == 0)
+		{
+			for(j = start; j < ends[i]; ++j)
+			{
+				firsts[files[j]->seq] = files[start]->seq;
+			}
+		}
+	}
+
+	/* Ids are assigned in the same way as final ones. */
+	int next_id = 1;
+	entries_t partial[2] = {};
+	for(i = 0; i < nfiles; ++i)
+	{
+		const content_file_t *const file = &all[i];
+		if(firsts[i] == -1)
+		{
+			continue;
+		}
+
+		size_t count = partial[file->list].nentries;
+		dir_entry_t *const entry = add_dir_entry(&partial[file->list].entries,
+				&count, file->entry);
+		if(entry == NULL)
+		{
+			continue;
+		}
+		partial[file->list].nentries = count;
+
+		entry->name = strdup(entry->name);
+		entry->origin = strdup(entry->origin);
+		entry->owns_origin = 1;
+
+		if(ids[firsts[i]] != 0)
+		{
+			entry->id = ids[firsts[i]];
+		}
+		else if(dups_only && file->list != 0)
+		{
+			entry->id = -1;
+		}
+		else
+		{
+			ids[firsts[i]] = next_id;
+			entry->id = next_id++;
+		}
+	}
+
+	free(firsts);
+	free(ids);
+
+	pthread_mutex_lock(&cmp->lock);
+	for(i = 0; i < 2; ++i)
+	{
+		/* Previous results might have not been picked up. */
+		free_dir_entries(cmp->views[i], &cmp->partial[i].entries,
+				&cmp->partial[i].nentries);
+		cmp->partial[i] = partial[i];
+	}
+	cmp->has_partial = 1;
+	pthread_mutex_unlock(&cmp->lock);
+}
+
+/* Sorts files by their size (and hash if by_hash is non-zero) moving files
+ * that failed to be read to the end.  Sets *ngroups to number of groups of
+ * files with equal size (and hash), failed files are not part of any group.
+ * Returns array of indexes past the end of each group (a group starts where the
+ * previous one ends), which should be freed by the caller. */
+static int *
+group_files(content_file_t *files[], int nfiles, int by_hash, int *ngroups)
+{
+	int i;
+	int *const ends = reallocarray(NULL, nfiles, sizeof(*ends));
+
+	*ngroups = 0;
+	if(ends == NULL)
+	{
+		return NULL;
+	}
+
+	safe_qsort(files, nfiles, sizeof(*files),
+			by_hash ? &hash_sorter : &size_sorter);
+
+	for(i = 0; i < nfiles && !files[i]->failed; ++i)
+	{
+		const content_file_t *const file = files[i];
+		const content_file_t *const next = (i + 1 < nfiles ? files[i + 1] : NULL);
+		if(next == NULL || next->failed || next->size != file->size ||
+				(by_hash && next->hash != file->hash))
+		{
+			ends[(*ngroups)++] = i + 1;
+		}
+	}
+
+	return ends;
+}
+
+/* qsort() comparer that sorts files by their size putting failed ones last.
+ * Returns standard -1, 0, 1 for comparisons. */
+static int
+size_sorter(const void *first, const void *second)
+{
+	const content_file_t *a = *(const content_file_t **)first;
+	const content_file_t *b = *(const content_file_t **)second;
+
+	if(a->failed != b->failed)
+	{
+		return a->failed - b->failed;
+	}
+	if(a->size != b->size)
+	{
+		return (a->size < b->size ? -1 : 1);
+	}
+	return a->seq - b->seq;
+}
+
+/* qsort() comparer that sorts files by their size and hash putting failed ones
+ * last.  Returns standard -1, 0, 1 for comparisons. */
+static int
+hash_sorter(const void *first, const void *second)
+{
+	const content_file_t *a = *(const content_file_t **)first;
+	const content_file_t *b = *(const content_file_t **)second;
+
+	if(a->failed != b->failed)
+	{
+		return a->failed - b->failed;
+	}
+	if(a->size != b->size)
+	{
+		return (a->size < b->size ? -1 : 1);
+	}
+	if(a->hash != b->hash)
+	{
+		return (a->hash < b->hash ? -1 : 1);
+	}
+	return a->seq - b->seq;
+}
+
+/* Processes files according to their todo field on a number of threads.  The
+ * cache can be NULL.  Returns non-zero if processing was cancelled. */
+static int
+run_content_job(compare_t *cmp, content_file_t *all, content_file_t **files,
+		int nfiles, const hcache_t *cache, const char title[])
+{
+	int i;
+	int last_progress = -1;
+	content_job_t job = {
+		.files = files,
+		.nfiles = nfiles,
+		.all = all,
+		.cache = cache,
+	};
+
+	int nworkers = MIN(get_cpu_count(), nfiles);
+
+	pthread_mutex_init(&job.lock, NULL);
+	pthread_cond_init(&job.done, NULL);
+
+	pthread_mutex_lock(&job.lock);
+	for(i = 0; i < nworkers; ++i)
+	{
+		pthread_t id;
+		if(pthread_create(&id, NULL, &content_worker, &job) == 0)
+		{
+			(void)pthread_detach(id);
+			++job.running;
+		}
+	}
+
+	if(job.running == 0)
+	{
+		/* Fallback to doing all work on this thread. */
+		job.running = 1;
+		pthread_mutex_unlock(&job.lock);
+		process_content_files(&job);
+		pthread_mutex_lock(&job.lock);
+	}
+
+	while(job.running != 0)
+	{
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += PROGRESS_PERIOD_MS*1000000L;
+		deadline.tv_sec += deadline.tv_nsec/1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+
+		if(pthread_cond_timedwait(&job.done, &job.lock, &deadline) != ETIMEDOUT)
+		{
+			continue;
+		}
+
+		const int processed = job.processed;
+		pthread_mutex_unlock(&job.lock);
+
+		const int cancelled = is_cancelled(cmp);
+
+		const int progress = (processed*100)/nfiles;
 		if(progress != last_progress)
 		{
 			char progress_msg[128];
-
+			snprintf(progress_msg, sizeof(progress_msg), "%s %d of %d (% 2d%%)",
+					title, processed, nfiles, progress);
+			report_progress(cmp, progress_msg, -1);
 			last_progress = progress;
-			snprintf(progress_msg, sizeof(progress_msg), "Querying... %d (% 2d%%)", i,
-					progress);
-			show_progress(progress_msg, -1);
 		}
+
+		pthread_mutex_lock(&job.lock);
+		job.cancelled |= cancelled;
 	}
 
-	free_string_array(files.items, files.nitems);
-	return r;
+	const int cancelled = job.cancelled;
+	pthread_mutex_unlock(&job.lock);
+
+	pthread_cond_destroy(&job.done);
+	pthread_mutex_destroy(&job.lock);
+
+	return cancelled || is_cancelled(cmp);
+}
+
+/* Entry point of a thread that processes files of a content job.  Returns
+ * NULL. */
+static void *
+content_worker(void *arg)
+{
+	block_all_thread_signals();
+	process_content_files(arg);
+	return NULL;
+}
+
+/* Picks and processes files of the job until there are none left. */
+static void
+process_content_files(content_job_t *job)
+{
+	pthread_mutex_lock(&job->lock);
+	while(job->next < job->nfiles && !job->cancelled)
+	{
+		content_file_t *const file = job->files[job->next++];
+		pthread_mutex_unlock(&job->lock);
+
+		process_content_file(job, file);
+
+		pthread_mutex_lock(&job->lock);
+		++job->processed;
+	}
+	--job->running;
+	pthread_cond_signal(&job->done);
+	pthread_mutex_unlock(&job->lock);
+}
+
+/* Checks whether processing of a content job was cancelled.  Returns non-zero
+ * if so. */
+static int
+job_cancelled(content_job_t *job)
+{
+	pthread_mutex_lock(&job->lock);
+	const int cancelled = job->cancelled;
+	pthread_mutex_unlock(&job->lock);
+	return cancelled;
+}
+
+/* Performs action required by todo field of a file. */
+static void
+process_content_file(content_job_t *job, content_file_t *file)
+{
+	switch(file->todo)
+	{
+		case CS_NONE:
+			break;
+		case CS_ACCESS:
+			file->failed = (os_access(file->path, R_OK) != 0);
+			break;
+		case CS_PREFIX:
+			file->failed = get_hash(job, file, 0);
+			break;
+		case CS_FULL:
+			file->failed = get_hash(job, file, 1);
+			break;
+		case CS_VERIFY:
+			if(!files_are_identical(file->path, job->all[file->dup_of].path, job))
+			{
+				/* Needs to be resolved by the caller. */
+				file->dup_of = -1;
+			}
+			break;
+	}
+	file->todo = CS_NONE;
+}
+
+/* Obtains hash of a prefix or of whole contents of a file either from the
+ * cache or by reading the file.  Sets hash field of the file.  Returns zero on
+ * success and non-zero on failure to read the file. */
+static int
+get_hash(content_job_t *job, content_file_t *file, int full)
+{
+	const int flag = (full ? HCF_FULL : HCF_PREFIX);
+
+	if(job->cache != NULL && !file->has_rec)
+	{
+		file->has_rec = (hcache_rec_init(&file->rec, file->path) == 0);
+		if(file->has_rec)
+		{
+			(void)hcache_get(job->cache, &file->rec);
+		}
+	}
+
+	if(file->has_rec && (file->rec.flags & flag))
+	{
+		file->hash = (full ? file->rec.full : file->rec.prefix);
+		return 0;
+	}
+
+	if(hash_contents(file->path, full ? UINT64_MAX : PREFIX_SIZE, job,
+				&file->hash) != 0)
+	{
+		return 1;
+	}
+
+	if(file->has_rec)
+	{
+		*(full ? &file->rec.full : &file->rec.prefix) = file->hash;
+		file->rec.flags |= flag;
+	}
+	return 0;
+}
+
+/* Stores records of files in the cache marking them as used. */
+static void
+update_hcache(hcache_t *cache, const content_file_t files[], int nfiles)
+{
+	int i, n = 0;
+	hcache_rec_t *const recs = reallocarray(NULL, nfiles, sizeof(*recs));
+	if(recs == NULL)
+	{
+		return;
+	}
+
+	for(i = 0; i < nfiles; ++i)
+	{
+		if(files[i].has_rec && !files[i].failed)
+		{
+			recs[n++] = files[i].rec;
+		}
+	}
+
+	hcache_update(cache, recs, n);
+	free(recs);
+}
+
+/* Hashes up to limit first bytes of a file.  Returns zero on success and
+ * non-zero on failure to read the file or cancellation. */
+static int
+hash_contents(const char path[], uint64_t limit, content_job_t *job,
+		uint64_t *hash)
+{
+	XX(state_t) st;
+	char block[BLOCK_SIZE];
+	FILE *const in = os_fopen(path, "rb");
+	if(in == NULL)
+	{
+		return 1;
+	}
+
+	XX(reset)(&st, 0U);
+	while(limit != 0U)
+	{
+		const size_t portion = MIN(sizeof(block), limit);
+		const size_t nread = fread(&block, 1, portion, in);
+		if(nread == 0U)
+		{
+			break;
+		}
+
+		XX(update)(&st, block, nread);
+		limit -= nread;
+
+		if(job != NULL && job_cancelled(job))
+		{
+			fclose(in);
+			return 1;
+		}
+	}
+	fclose(in);
+
+	*hash = XX(digest)(&st);
+	return 0;
+}
+
+/* Leaves only entries with valid ids in the list. */
+static void
+drop_invalid_entries(view_t *view, entries_t *list)
+{
+	(void)zap_entries(view, list->entries, &list->nentries, &is_valid_entry,
+			NULL, 1, 0);
+}
+
+/* zap_entries() filter to filter-out entries whose files couldn't be compared.
+ * Returns non-zero if entry is to be kept and zero otherwise. */
+static int
+is_valid_entry(view_t *view, const dir_entry_t *entry, void *arg)
+{
+	return entry->id != DROP_ID;
 }
 
 /* Fills the list with entries of the view in hierarchical order (pre-order tree
@@ -617,7 +1843,8 @@ append_valid_nodes(const char name[], int valid, const void *parent_data,
 
 /* Collects files under specified file system tree. */
 static void
-list_files_recursively(const char path[], int skip_dot_files, strlist_t *list)
+list_files_recursively(compare_t *cmp, const char path[], int skip_dot_files,
+		strlist_t *list)
 {
 	int i;
 
@@ -630,7 +1857,7 @@ list_files_recursively(const char path[], int skip_dot_files, strlist_t *list)
 	}
 
 	/* Visit all subdirectories ignoring symbolic links to directories. */
-	for(i = 0; i < len && !ui_cancellation_requested(); ++i)
+	for(i = 0; i < len && !is_cancelled(cmp); ++i)
 	{
 		char *full_path;
 		if(skip_dot_files && lst[i][0] == '.')
@@ -644,7 +1871,7 @@ list_files_recursively(const char path[], int skip_dot_files, strlist_t *list)
 		{
 			if(!is_symlink(full_path))
 			{
-				list_files_recursively(full_path, skip_dot_files, list);
+				list_files_recursively(cmp, full_path, skip_dot_files, list);
 			}
 			free(full_path);
 			update_string(&lst[i], NULL);
@@ -655,7 +1882,7 @@ list_files_recursively(const char path[], int skip_dot_files, strlist_t *list)
 			lst[i] = full_path;
 		}
 
-		show_progress("Listing...", 1000);
+		report_progress(cmp, "Listing...", 1000);
 	}
 
 	/* Append files. */
@@ -702,90 +1929,51 @@ get_file_fingerprint(const char path[], const dir_entry_t *entry,
 static char *
 get_contents_fingerprint(const char path[], const dir_entry_t *entry)
 {
-#if INTPTR_MAX == INT64_MAX
-#define XX_BITS 64
-#else
-#define XX_BITS 32
-#endif
-#define XX__(name, bits) XXH ## bits ## _ ## name
-#define XX_(name, bits) XX__(name, bits)
-#define XX(name) XX_(name, XX_BITS)
-
-	XX(state_t) st;
-	char block[BLOCK_SIZE];
-	size_t to_read = PREFIX_SIZE;
-	FILE *in = os_fopen(path, "rb");
-	if(in == NULL)
+	uint64_t hash;
+	if(hash_contents(path, PREFIX_SIZE, NULL, &hash) != 0)
 	{
 		return strdup("");
 	}
 
-	XX(reset)(&st, 0U);
-	while(to_read != 0U)
-	{
-		const size_t portion = MIN(sizeof(block), to_read);
-		const size_t nread = fread(&block, 1, portion, in);
-		if(nread == 0U)
-		{
-			break;
-		}
-
-		XX(update)(&st, block, nread);
-		to_read -= nread;
-	}
-	fclose(in);
-
 	return format_str("%" PRINTF_ULL "|%" PRINTF_ULL,
-			(unsigned long long)entry->size, (unsigned long long)XX(digest)(&st));
-
-#undef XX_BITS
-#undef XX__
-#undef XX_
-#undef XX
+			(unsigned long long)entry->size, (unsigned long long)hash);
 }
 
-/* Retrieves file from the trie by its fingerprint.  Returns non-zero if it was
- * in the trie and sets *id, otherwise zero is returned. */
-static int
-get_file_id(trie_t *trie, const char path[], const char fingerprint[], int *id,
-		CompareType ct)
+/* Computes binary fingerprint of the file for comparison by name or size.
+ * Names are represented by two independent 64-bit hashes.  Returns the
+ * fingerprint. */
+static hmap_key_t
+get_file_key(const char path[], const dir_entry_t *entry, CompareType ct)
 {
-	void *data;
-	compare_record_t *record;
-	if(trie_get(trie, fingerprint, &data) != 0)
-	{
-		return 0;
-	}
-	record = data;
+	assert(ct != CT_CONTENTS && "Contents have no fixed-size fingerprint.");
 
-	/* Comparison by contents is the only one when we need to resolve fingerprint
-	 * conflicts. */
-	if(ct != CT_CONTENTS)
+	if(ct == CT_SIZE)
 	{
-		*id = record->id;
-		return 1;
+		const hmap_key_t key = { .hi = 0, .lo = entry->size };
+		return key;
 	}
 
-	/* Fingerprint does not guarantee a match, go through files and find file with
-	 * identical content. */
-	do
+	char lowered[NAME_MAX + 1];
+	const char *name = entry->name;
+	if(!case_sensitive_paths(path))
 	{
-		if(files_are_identical(path, record->path))
-		{
-			*id = record->id;
-			return 1;
-		}
-		record = record->next;
+		str_to_lower(entry->name, lowered, sizeof(lowered));
+		name = lowered;
 	}
-	while(record != NULL);
 
-	return 0;
+	const size_t len = strlen(name);
+	const hmap_key_t key = {
+		.hi = XXH64(name, len, 0U),
+		.lo = XXH64(name, len, 0x9e3779b97f4a7c15ULL),
+	};
+	return key;
 }
 
 /* Checks whether two files specified by their names hold identical content.
- * Returns non-zero if so, otherwise zero is returned. */
+ * The job is used for checking for cancellation and can be NULL.  Returns
+ * non-zero if so, otherwise zero is returned. */
 static int
-files_are_identical(const char a[], const char b[])
+files_are_identical(const char a[], const char b[], content_job_t *job)
 {
 	char a_block[BLOCK_SIZE], b_block[BLOCK_SIZE];
 	FILE *const a_file = fopen(a, "rb");
@@ -815,7 +2003,8 @@ files_are_identical(const char a[], const char b[])
 		}
 
 		if(a_read == 0 || b_read == 0U || a_read != b_read ||
-				memcmp(a_block, b_block, a_read) != 0)
+				memcmp(a_block, b_block, a_read) != 0 ||
+				(job != NULL && job_cancelled(job)))
 		{
 			fclose(a_file);
 			fclose(b_file);
@@ -828,44 +2017,6 @@ files_are_identical(const char a[], const char b[])
 	return 1;
 }
 
-/* Stores id of a file with given fingerprint in the trie. */
-static void
-put_file_id(trie_t *trie, const char path[], const char fingerprint[], int id,
-		CompareType ct)
-{
-	compare_record_t *const record = malloc(sizeof(*record));
-	void *data = NULL;
-	(void)trie_get(trie, fingerprint, &data);
-
-	record->id = id;
-	record->next = data;
-
-	/* Comparison by contents is the only one when we need to resolve fingerprint
-	 * conflicts. */
-	record->path = (ct == CT_CONTENTS ? strdup(path) : NULL);
-
-	if(trie_set(trie, fingerprint, record) < 0)
-	{
-		free(record->path);
-		free(record);
-	}
-}
-
-/* Frees list of compare entries.  Implements data free function for
- * trie_free_with_data(). */
-static void
-free_compare_records(void *ptr)
-{
-	compare_record_t *record = ptr;
-	while(record != NULL)
-	{
-		compare_record_t *const current = record;
-		record = record->next;
-		free(current->path);
-		free(current);
-	}
-}
-
 int
 compare_move(view_t *from, view_t *to)
 {
@@ -942,7 +2093,7 @@ compare_move(view_t *from, view_t *to)
 		int match = (strcmp(from_fingerprint, to_fingerprint) == 0);
 		if(match && ct == CT_CONTENTS)
 		{
-			match = files_are_identical(from_path, to_path);
+			match = files_are_identical(from_path, to_path, NULL);
 		}
 		if(match)
 		{
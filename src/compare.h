@@ -31,15 +31,23 @@ typedef enum
 ListType;
 
 /* Composes two panes containing information about derived from two file system
- * trees.  If group_paths is zero, views are sorted by ids.  Returns non-zero if
- * status bar message should be preserved. */
+ * trees.  If group_paths is zero, views are sorted by ids.  Once TUI is fully
+ * loaded, comparison is performed in background and views are updated by
+ * compare_check_for_updates().  Returns non-zero if status bar message should
+ * be preserved. */
 int compare_two_panes(CompareType ct, ListType lt, int group_paths,
 		int skip_empty);
 
-/* Replaces single pane with information derived from its files.  Returns
- * non-zero if status bar message should be preserved. */
+/* Replaces single pane with information derived from its files.  Once TUI is
+ * fully loaded, comparison is performed in background and the view is updated
+ * by compare_check_for_updates().  Returns non-zero if status bar message
+ * should be preserved. */
 int compare_one_pane(view_t *view, CompareType ct, ListType lt, int skip_empty);
 
+/* Puts results of comparisons running in background into views when they
+ * become available.  Should be called periodically on the main thread. */
+void compare_check_for_updates(void);
+
 /* Moves current file from one view to the other.  Returns non-zero if status
  * bar message should be preserved. */
 int compare_move(view_t *from, view_t *to);
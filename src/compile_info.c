@@ -0,0 +1 @@
+const char GIT_INFO[] = "8047dc4dc417-dirty";
@@ -62,10 +62,12 @@
 #include "utils/fs.h"
 #include "utils/fsdata.h"
 #include "utils/fswatch.h"
+#include "utils/hmap.h"
 #include "utils/log.h"
 #include "utils/macros.h"
 #include "utils/matcher.h"
 #include "utils/path.h"
+#include "utils/perf.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
@@ -137,9 +139,14 @@ static int add_file_entry_to_view(const char name[], const void *data,
 static void sort_dir_list(int msg, view_t *view);
 static void merge_lists(view_t *view, dir_entry_t *entries, int len);
 TSTATIC void check_file_uniqueness(view_t *view);
-static void add_to_trie(trie_t *trie, view_t *view, dir_entry_t *entry);
-static int is_in_trie(trie_t *trie, view_t *view, dir_entry_t *entry,
-		void **data);
+static hmap_t * reset_entries_index(size_t count);
+static int index_entries(int custom, const dir_entry_t entries[], int len);
+static int find_indexed_entry(int custom, const dir_entry_t entries[],
+		const dir_entry_t *entry);
+static int entries_match(int custom, const dir_entry_t *a,
+		const dir_entry_t *b);
+static hmap_key_t get_entry_key(int custom, const dir_entry_t *entry);
+static size_t get_origin_len(const char origin[]);
 static void merge_entries(dir_entry_t *new, const dir_entry_t *prev);
 static int correct_pos(view_t *view, int pos, int dist, int closest);
 static int rescue_from_empty_filelist(view_t *view);
@@ -177,6 +184,11 @@ static int add_directory_leaf(view_t *view, const char path[], int parent_pos);
 static int init_parent_entry(view_t *view, dir_entry_t *entry,
 		const char path[]);
 
+/* Index of file list entries by their names (paths for custom views) to
+ * position in the list.  It's used by reloads of both views one at a time and
+ * kept between them to reuse allocated memory. */
+static hmap_t *entries_index;
+
 void
 init_filelists(void)
 {
@@ -912,7 +924,10 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 	struct stat s;
 
 	/* Load the inode information or leave blank values in the entry. */
-	if(os_lstat(path, &s) != 0)
+	const uint64_t start = perf_begin();
+	const int error = os_lstat(path, &s);
+	perf_end(PP_STAT, start);
+	if(error != 0)
 	{
 		LOG_SERROR_MSG(errno, "Can't lstat() \"%s\"", path);
 		return 1;
@@ -1602,7 +1617,10 @@ entry_calc_nitems(const dir_entry_t *entry)
 int
 populate_dir_list(view_t *view, int reload)
 {
+	const uint64_t start = perf_begin();
 	const int result = populate_dir_list_internal(view, reload);
+	perf_end(PP_DIR_LOAD, start);
+
 	if(view->list_pos > view->list_rows - 1)
 	{
 		view->list_pos = view->list_rows - 1;
@@ -2354,46 +2372,56 @@ sort_dir_list(int msg, view_t *view)
 	}
 }
 
-/* Merges elements from previous list into the new one. */
+/* Merges elements from previous list into the new one.  Entries are matched in
+ * order while both lists agree and only the rest is looked up by name. */
 static void
 merge_lists(view_t *view, dir_entry_t *entries, int len)
 {
 	int i;
-	int closest_dist;
+	int closest_dist = INT_MIN;
+	int indexed = 0;
+	int next = 0;
 	const int prev_pos = view->list_pos;
-	trie_t *prev_names = trie_create();
-
-	for(i = 0; i < len; ++i)
-	{
-		add_to_trie(prev_names, view, &entries[i]);
+	const int custom = flist_custom_active(view);
 
-		/* We won't use the name later, so free some memory. */
-		update_string(&entries[i].name, NULL);
-	}
-
-	closest_dist = INT_MIN;
 	for(i = 0; i < view->list_rows; ++i)
 	{
-		int dist;
-		void *data;
+		int prev;
 		dir_entry_t *const entry = &view->dir_entry[i];
-		if(!is_in_trie(prev_names, view, entry, &data))
+
+		if(next < len && entries_match(custom, entry, &entries[next]))
 		{
-			continue;
+			prev = next;
+		}
+		else
+		{
+			if(!indexed)
+			{
+				indexed = 1;
+				if(!index_entries(custom, entries, len))
+				{
+					show_error_msg("Memory Error", "Unable to allocate enough memory");
+					break;
+				}
+			}
+
+			prev = find_indexed_entry(custom, entries, entry);
+			if(prev < 0)
+			{
+				continue;
+			}
 		}
+		next = prev + 1;
 
 		/* Transfer information from previous entry to the new one. */
-		merge_entries(entry, data);
+		merge_entries(entry, &entries[prev]);
 
 		/* Update number of selected files (should have been zeroed beforehand). */
 		view->selected_files += (entry->selected != 0);
 
 		/* Update cursor position in a smart way. */
-		dist = (dir_entry_t *)data - entries - prev_pos;
-		closest_dist = correct_pos(view, i, dist, closest_dist);
+		closest_dist = correct_pos(view, i, prev - prev_pos, closest_dist);
 	}
-
-	trie_free(prev_names);
 }
 
 /* Checks that entries don't have the same name (for non-cv).  And if there are
@@ -2402,17 +2430,44 @@ merge_lists(view_t *view, dir_entry_t *entries, int len)
 TSTATIC void
 check_file_uniqueness(view_t *view)
 {
-	trie_t *file_names = trie_create();
+	/* Custom views don't accept duplicates on adding entries. */
+	if(flist_custom_active(view))
+	{
+		return;
+	}
+
+	hmap_t *const names = reset_entries_index(view->list_rows);
+	if(names == NULL)
+	{
+		return;
+	}
 
 	int had_dups = view->has_dups;
 
 	int i;
 	for(i = 0; i < view->list_rows; ++i)
 	{
-		add_to_trie(file_names, view, &view->dir_entry[i]);
-	}
+		dir_entry_t *const entry = &view->dir_entry[i];
 
-	trie_free(file_names);
+		int created;
+		int *const first = hmap_put(names, get_entry_key(0, entry), &created);
+		if(first == NULL)
+		{
+			break;
+		}
+
+		if(created)
+		{
+			*first = i;
+		}
+		else if(entries_match(0, entry, &view->dir_entry[*first]))
+		{
+			LOG_INFO_MSG("Duplicated entry is `%s` in `%s`", entry->name,
+					entry->origin);
+			entry->temporary = 1;
+			view->has_dups = 1;
+		}
+	}
 
 	if(view->has_dups)
 	{
@@ -2425,51 +2480,112 @@ check_file_uniqueness(view_t *view)
 	}
 }
 
-/* Adds view entry into the trie mapping its name to entry structure.
- * Duplicated entries of a non-custom view are marked as temporary. */
-static void
-add_to_trie(trie_t *trie, view_t *view, dir_entry_t *entry)
+/* Empties index of entries by their names creating it if necessary and sizing
+ * it for count entries.  Returns the index or NULL on error. */
+static hmap_t *
+reset_entries_index(size_t count)
 {
-	if(flist_custom_active(view))
+	if(entries_index == NULL)
 	{
-		char full_path[PATH_MAX + 1];
-		get_full_path_of(entry, sizeof(full_path), full_path);
+		entries_index = hmap_create(sizeof(int));
+	}
+	else
+	{
+		hmap_clear(entries_index, count);
+	}
+	return entries_index;
+}
 
-		int error = trie_set(trie, full_path, entry);
-		assert(error == 0 && "Duplicated file names in the list?");
-		(void)error;
-		return;
+/* Fills index of entries by their names with the list.  Returns non-zero on
+ * success and zero otherwise. */
+static int
+index_entries(int custom, const dir_entry_t entries[], int len)
+{
+	hmap_t *const index = reset_entries_index(len);
+	if(index == NULL)
+	{
+		return 0;
 	}
 
-	if(trie_set(trie, entry->name, entry) != 0)
+	int i;
+	for(i = 0; i < len; ++i)
 	{
-		LOG_INFO_MSG("Duplicated entry is `%s` in `%s`", entry->name,
-				entry->origin);
-		entry->temporary = 1;
-		view->has_dups = 1;
+		int created;
+		int *const pos = hmap_put(index, get_entry_key(custom, &entries[i]),
+				&created);
+		if(pos == NULL)
+		{
+			return 0;
+		}
+
+		if(created)
+		{
+			*pos = i;
+		}
 	}
+
+	return 1;
 }
 
-/* Looks up entry in the trie by its name.  Retrieves directory entry stored by
- * add_to_trie() into *data (unchanged on lookup failure).  Returns non-zero if
- * item was successfully retrieved and zero otherwise. */
+/* Looks up an entry with the same name (path for custom views) in the list
+ * indexed by index_entries().  Returns position of the entry or -1. */
 static int
-is_in_trie(trie_t *trie, view_t *view, dir_entry_t *entry, void **data)
+find_indexed_entry(int custom, const dir_entry_t entries[],
+		const dir_entry_t *entry)
 {
-	int error;
+	const int *const pos = hmap_get(entries_index, get_entry_key(custom, entry));
+	if(pos != NULL && entries_match(custom, entry, &entries[*pos]))
+	{
+		return *pos;
+	}
+	return -1;
+}
 
-	if(flist_custom_active(view))
+/* Checks whether two entries refer to the same file by name (by path for
+ * custom views).  Returns non-zero if so, otherwise zero is returned. */
+static int
+entries_match(int custom, const dir_entry_t *a, const dir_entry_t *b)
+{
+	if(strcmp(a->name, b->name) != 0)
 	{
-		char full_path[PATH_MAX + 1];
-		get_full_path_of(entry, sizeof(full_path), full_path);
-		error = trie_get(trie, full_path, data);
+		return 0;
 	}
-	else
+	if(!custom || a->origin == b->origin)
 	{
-		error = trie_get(trie, entry->name, data);
+		return 1;
 	}
 
-	return (error == 0);
+	const size_t len = get_origin_len(a->origin);
+	return len == get_origin_len(b->origin)
+	    && strncmp(a->origin, b->origin, len) == 0;
+}
+
+/* Computes key of an entry for the index.  Returns the key. */
+static hmap_key_t
+get_entry_key(int custom, const dir_entry_t *entry)
+{
+	hmap_key_t key = hmap_str_key(entry->name, strlen(entry->name));
+	if(custom)
+	{
+		const hmap_key_t origin_key = hmap_str_key(entry->origin,
+				get_origin_len(entry->origin));
+		key.hi = (key.hi ^ origin_key.lo)*0x9e3779b97f4a7c15ULL;
+		key.lo = (key.lo ^ origin_key.hi)*0xc2b2ae3d27d4eb4fULL;
+	}
+	return key;
+}
+
+/* Computes length of origin of an entry ignoring trailing slashes, which don't
+ * make a difference for a full path.  Returns the length. */
+static size_t
+get_origin_len(const char origin[])
+{
+	size_t len = strlen(origin);
+	while(len > 1U && origin[len - 1U] == '/')
+	{
+		--len;
+	}
+	return len;
 }
 
 /* Merges data from previous entry into the new one.  Both entries should
@@ -29,12 +29,13 @@
 #include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "utils/matchers.h"
+#include "utils/matchers_set.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/path.h"
 #include "utils/utils.h"
 
-static const char * find_existing_cmd(const assoc_list_t *record_list,
+static const char * find_existing_cmd(assoc_list_t *record_list,
 		const char file[]);
 static assoc_record_t find_existing_cmd_record(const assoc_records_t *records);
 static void assoc_programs(matchers_t *matchers,
@@ -42,7 +43,8 @@ static void assoc_programs(matchers_t *matchers,
 static assoc_records_t parse_command_list(const char cmds[], int with_descr);
 static void register_assoc(assoc_t assoc, int for_x, int in_x);
 static assoc_records_t clone_all_matching_records(const char file[],
-		const assoc_list_t *record_list);
+		assoc_list_t *record_list);
+static int find_match(assoc_list_t *assoc_list, const char file[], int from);
 static void add_assoc(assoc_list_t *assoc_list, assoc_t assoc);
 static void assoc_viewers(matchers_t *matchers, const assoc_records_t *viewers);
 static assoc_records_t clone_assoc_records(const assoc_records_t *records,
@@ -117,15 +119,10 @@ ft_get_viewers(const char file[])
 	strlist_t viewers = {};
 
 	int i;
-	for(i = 0; i < fileviewers.count; ++i)
+	for(i = 0; (i = find_match(&fileviewers, file, i)) >= 0; ++i)
 	{
 		assoc_t *const assoc = &fileviewers.list[i];
 
-		if(!matchers_match(assoc->matchers, file))
-		{
-			continue;
-		}
-
 		int j;
 		for(j = 0; j < assoc->records.count; ++j)
 		{
@@ -145,20 +142,15 @@ ft_get_viewers(const char file[])
 /* Finds first existing command which pattern matches given file.  Returns the
  * command (it's lifetime is managed by this unit) or NULL on failure. */
 static const char *
-find_existing_cmd(const assoc_list_t *record_list, const char file[])
+find_existing_cmd(assoc_list_t *record_list, const char file[])
 {
 	int i;
 
-	for(i = 0; i < record_list->count; ++i)
+	for(i = 0; (i = find_match(record_list, file, i)) >= 0; ++i)
 	{
 		assoc_record_t prog;
 		assoc_t *const assoc = &record_list->list[i];
 
-		if(!matchers_match(assoc->matchers, file))
-		{
-			continue;
-		}
-
 		prog = find_existing_cmd_record(&assoc->records);
 		if(!is_assoc_record_empty(&prog))
 		{
@@ -276,21 +268,53 @@ ft_get_all_viewers(const char file[])
 /* Clones all records which pattern matches the file.  Returns list of records
  * composed of clones. */
 static assoc_records_t
-clone_all_matching_records(const char file[], const assoc_list_t *record_list)
+clone_all_matching_records(const char file[], assoc_list_t *record_list)
 {
 	int i;
 	assoc_records_t result = {};
 
-	for(i = 0; i < record_list->count; ++i)
+	for(i = 0; (i = find_match(record_list, file, i)) >= 0; ++i)
 	{
-		assoc_t *const assoc = &record_list->list[i];
-		if(matchers_match(assoc->matchers, file))
+		ft_assoc_record_add_all(&result, &record_list->list[i].records);
+	}
+
+	return result;
+}
+
+/* Finds first association at or after the from index which pattern matches
+ * the file.  Builds index of the list on first use.  Returns index of the
+ * association or -1 if there is none. */
+static int
+find_match(assoc_list_t *assoc_list, const char file[], int from)
+{
+	int i;
+
+	if(assoc_list->set == NULL)
+	{
+		assoc_list->set = matchers_set_alloc();
+		for(i = 0; i < assoc_list->count && assoc_list->set != NULL; ++i)
 		{
-			ft_assoc_record_add_all(&result, &assoc->records);
+			if(matchers_set_add(assoc_list->set, assoc_list->list[i].matchers) != 0)
+			{
+				matchers_set_free(assoc_list->set);
+				assoc_list->set = NULL;
+			}
 		}
 	}
 
-	return result;
+	if(assoc_list->set != NULL)
+	{
+		return matchers_set_find(assoc_list->set, file, from);
+	}
+
+	for(i = from; i < assoc_list->count; ++i)
+	{
+		if(matchers_match(assoc_list->list[i].matchers, file))
+		{
+			return i;
+		}
+	}
+	return -1;
 }
 
 void
@@ -348,6 +372,14 @@ add_assoc(assoc_list_t *assoc_list, assoc_t assoc)
 	assoc_list->list = p;
 	assoc_list->list[assoc_list->count] = assoc;
 	assoc_list->count++;
+
+	if(assoc_list->set != NULL &&
+			matchers_set_add(assoc_list->set, assoc.matchers) != 0)
+	{
+		/* Will be rebuilt on next use. */
+		matchers_set_free(assoc_list->set);
+		assoc_list->set = NULL;
+	}
 }
 
 ViewerKind
@@ -416,6 +448,9 @@ reset_list_head(assoc_list_t *assoc_list)
 	free(assoc_list->list);
 	assoc_list->list = NULL;
 	assoc_list->count = 0;
+
+	matchers_set_free(assoc_list->set);
+	assoc_list->set = NULL;
 }
 
 static void
@@ -70,6 +70,7 @@ typedef struct
 {
 	assoc_t *list;
 	int count;
+	struct matchers_set_t *set; /* Lazily built index of the list or NULL. */
 }
 assoc_list_t;
 
@@ -29,6 +29,7 @@
 #include "utils/dynarray.h"
 #include "utils/matcher.h"
 #include "utils/path.h"
+#include "utils/perf.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
 #include "utils/utils.h"
@@ -37,6 +38,8 @@
 #include "flist_sel.h"
 #include "opt_handlers.h"
 
+static int is_visible(view_t *view, const char dir[], const char name[],
+		int is_dir, int apply_local_filter);
 static void reset_filter(filter_t *filter);
 static int is_newly_filtered(view_t *view, const dir_entry_t *entry, void *arg);
 static void replace_matcher(matcher_t **matcher, const char expr[]);
@@ -299,6 +302,18 @@ filters_invert(view_t *view)
 int
 filters_file_is_visible(view_t *view, const char dir[], const char name[],
 		int is_dir, int apply_local_filter)
+{
+	const uint64_t start = perf_begin();
+	const int visible = is_visible(view, dir, name, is_dir, apply_local_filter);
+	perf_end(PP_FILTER, start);
+	return visible;
+}
+
+/* Implementation of filters_file_is_visible().  Returns non-zero if the file
+ * should be visible. */
+static int
+is_visible(view_t *view, const char dir[], const char name[], int is_dir,
+		int apply_local_filter)
 {
 	/* FIXME: some very long file names won't be matched against some regexps. */
 	char name_with_slash[NAME_MAX + 1 + 1];
@@ -85,6 +85,9 @@
 /* Key used to switch to progress dialog. */
 #define IO_DETAILS_KEY 'i'
 
+/* Minimal interval between progress updates in milliseconds (10 Hz). */
+#define IO_NOTIF_INTERVAL 100
+
 /* Object for auxiliary information related to progress of operations in
  * io_progress_changed() handler. */
 typedef struct
@@ -141,6 +144,7 @@ fops_init(line_prompt_func line_func, options_prompt_func options_func)
 	fops_line_prompt = line_func;
 	fops_options_prompt = options_func;
 	ionotif_register(&io_progress_changed);
+	ionotif_set_interval(IO_NOTIF_INTERVAL);
 }
 
 /* I/O operation update callback. */
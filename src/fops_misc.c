@@ -32,6 +32,7 @@
 #include "ui/statusbar.h"
 #include "ui/ui.h"
 #include "utils/cancellation.h"
+#include "utils/dynarray.h"
 #include "utils/fs.h"
 #include "utils/path.h"
 #include "utils/str.h"
@@ -147,6 +148,8 @@ fops_delete(view_t *view, int reg, int use_trash)
 
 	nmarked_files = fops_enqueue_marked_files(ops, view, NULL, use_trash);
 
+	trash_batch_start();
+
 	entry = NULL;
 	i = 0;
 	while(iter_marked_entries(view, &entry) && !ui_cancellation_requested())
@@ -167,6 +170,8 @@ fops_delete(view_t *view, int reg, int use_trash)
 		ops_advance(ops, result == 0);
 	}
 
+	trash_batch_finish();
+
 	regs_update_unnamed(reg);
 
 	un_group_close();
@@ -451,22 +456,37 @@ fops_yank(view_t *view, int reg)
 {
 	int nyanked_files;
 	dir_entry_t *entry;
+	char **paths = NULL;
+	int npaths = 0;
 
 	reg = prepare_register(reg);
 
-	nyanked_files = 0;
 	entry = NULL;
 	while(iter_marked_entries(view, &entry))
 	{
 		char full_path[PATH_MAX + 1];
 		get_full_path_of(entry, sizeof(full_path), full_path);
 
-		if(regs_append(reg, full_path) == 0)
+		char **const new_paths = dynarray_extend(paths, sizeof(*paths));
+		if(new_paths == NULL)
+		{
+			break;
+		}
+		paths = new_paths;
+
+		paths[npaths] = strdup(full_path);
+		if(paths[npaths] != NULL)
 		{
-			++nyanked_files;
+			++npaths;
 		}
 	}
 
+	/* Blackhole register doesn't store anything, but files are still yanked.
+	 * Strings are passed to the register. */
+	(void)regs_append_many(reg, paths, npaths);
+	nyanked_files = npaths;
+	dynarray_free(paths);
+
 	regs_update_unnamed(reg);
 
 	ui_sb_msgf("%d file%s yanked", nyanked_files,
@@ -1030,21 +1050,26 @@ fops_restore(view_t *view)
 	un_group_open("restore: ");
 	un_group_close();
 
-	m = 0;
+	strlist_t trash_names = {};
+
 	n = 0;
 	entry = NULL;
-	while(iter_marked_entries(view, &entry) && !ui_cancellation_requested())
+	while(iter_marked_entries(view, &entry))
 	{
 		char full_path[PATH_MAX + 1];
 		get_full_path_of(entry, sizeof(full_path), full_path);
 
-		if(trash_is_at_path(entry->origin) && trash_restore(full_path) == 0)
+		if(trash_is_at_path(entry->origin))
 		{
-			++m;
+			trash_names.nitems = add_to_string_array(&trash_names.items,
+					trash_names.nitems, full_path);
 		}
 		++n;
 	}
 
+	m = trash_restore_entries(trash_names.items, trash_names.nitems);
+	free_string_array(trash_names.items, trash_names.nitems);
+
 	ui_view_schedule_reload(view);
 
 	ui_sb_msgf("Restored %d of %d%s", m, n, fops_get_cancellation_suffix());
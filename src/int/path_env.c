@@ -18,9 +18,15 @@
 
 #include "path_env.h"
 
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h> /* IN_* inotify_* */
+#include <unistd.h> /* close() read() */
+#endif
+
 #include <stdio.h> /* snprintf() sprintf() */
-#include <stdlib.h> /* malloc() free() */
+#include <stdlib.h> /* calloc() malloc() free() */
 #include <string.h> /* strchr() strlen() */
+#include <time.h> /* time_t time() */
 
 #include "../cfg/config.h"
 #include "../compat/dtype.h"
@@ -29,20 +35,45 @@
 #include "../compat/reallocarray.h"
 #include "../engine/variables.h"
 #include "../utils/env.h"
+#include "../utils/filemon.h"
 #include "../utils/fs.h"
+#include "../utils/hmap.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
 
+/* Index of names of files in a directory of PATH. */
+typedef struct
+{
+	hmap_t *names; /* Case-insensitive set of names or NULL if not built. */
+	filemon_t mon; /* Modification time of the directory for the set. */
+	int wd;        /* inotify watch descriptor or -1. */
+}
+dir_index_t;
+
 static int path_env_was_changed(int force);
 static void append_scripts_dirs(void);
 static void add_dirs_to_path(const char *path);
 static void add_to_path(const char *path);
 static void split_path_list(void);
+static void reset_dir_indexes(void);
+static void check_dir_indexes(void);
+static hmap_t * get_dir_names(int i);
+static hmap_t * read_dir_names(const char path[]);
 
 static char **paths;
 static int paths_count;
 
+/* Indexes of contents of paths and their number. */
+static dir_index_t *dir_indexes;
+static int dir_indexes_count;
+#ifdef HAVE_INOTIFY
+/* inotify instance watching all absolute paths or -1. */
+static int inotify_fd = -1;
+#endif
+/* Last time modification times of indexed directories were checked. */
+static time_t last_mtime_check;
+
 static char *clean_path;
 static char *real_path;
 
@@ -50,6 +81,7 @@ char **
 get_paths(size_t *count)
 {
 	update_path_env(0);
+	check_dir_indexes();
 	*count = paths_count;
 	return paths;
 }
@@ -61,9 +93,23 @@ update_path_env(int force)
 	{
 		append_scripts_dirs();
 		split_path_list();
+		reset_dir_indexes();
 	}
 }
 
+int
+path_env_may_contain(size_t i, const char name[])
+{
+	if((int)i >= dir_indexes_count || contains_slash(name))
+	{
+		return 1;
+	}
+
+	const hmap_t *const names = get_dir_names(i);
+	return names == NULL
+	    || hmap_get(names, hmap_istr_key(name, strlen(name))) != NULL;
+}
+
 /* Checks if PATH environment variable was changed. Returns non-zero if path was
  * altered since last call. */
 static int
@@ -237,6 +283,179 @@ split_path_list(void)
 	paths_count = i;
 }
 
+/* Drops indexes of directories and starts watching directories of current list
+ * of paths. */
+static void
+reset_dir_indexes(void)
+{
+	int i;
+
+	for(i = 0; i < dir_indexes_count; ++i)
+	{
+		hmap_free(dir_indexes[i].names);
+	}
+	free(dir_indexes);
+
+#ifdef HAVE_INOTIFY
+	if(inotify_fd != -1)
+	{
+		close(inotify_fd);
+	}
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+
+	dir_indexes = calloc(paths_count, sizeof(*dir_indexes));
+	dir_indexes_count = (dir_indexes == NULL ? 0 : paths_count);
+	for(i = 0; i < dir_indexes_count; ++i)
+	{
+		dir_indexes[i].wd = -1;
+	}
+
+#ifdef HAVE_INOTIFY
+	if(inotify_fd != -1)
+	{
+		for(i = 0; i < dir_indexes_count; ++i)
+		{
+			if(is_path_absolute(paths[i]))
+			{
+				dir_indexes[i].wd = inotify_add_watch(inotify_fd, paths[i],
+						IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+						IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+			}
+		}
+	}
+#endif
+}
+
+/* Drops indexes of directories that have changed.  Directories are watched via
+ * inotify if possible, which makes the check free of file system queries,
+ * otherwise their modification times are checked at most once a second. */
+static void
+check_dir_indexes(void)
+{
+	int i;
+
+#ifdef HAVE_INOTIFY
+	if(inotify_fd != -1)
+	{
+		/* Union makes the buffer suitably aligned for the events. */
+		union
+		{
+			struct inotify_event event;
+			char bytes[16*(sizeof(struct inotify_event) + NAME_MAX + 1)];
+		}
+		buf;
+		ssize_t nread;
+		while((nread = read(inotify_fd, buf.bytes, sizeof(buf.bytes))) > 0)
+		{
+			const char *p = buf.bytes;
+			while(p < buf.bytes + nread)
+			{
+				const struct inotify_event *const e = (const void *)p;
+				for(i = 0; i < dir_indexes_count; ++i)
+				{
+					/* Overflow of the queue invalidates everything. */
+					if(dir_indexes[i].wd == e->wd || (e->mask & IN_Q_OVERFLOW))
+					{
+						hmap_free(dir_indexes[i].names);
+						dir_indexes[i].names = NULL;
+						/* Fall back to checking modification time if the watch is gone
+						 * (e.g., directory was removed). */
+						if(e->mask & IN_IGNORED)
+						{
+							dir_indexes[i].wd = -1;
+						}
+					}
+				}
+				p += sizeof(struct inotify_event) + e->len;
+			}
+		}
+	}
+#endif
+
+	const time_t now = time(NULL);
+	if(now == last_mtime_check)
+	{
+		return;
+	}
+	last_mtime_check = now;
+
+	for(i = 0; i < dir_indexes_count; ++i)
+	{
+		dir_index_t *const index = &dir_indexes[i];
+		if(index->names == NULL || index->wd >= 0)
+		{
+			continue;
+		}
+
+		filemon_t mon;
+		if(filemon_from_file(paths[i], FMT_MODIFIED, &mon) != 0 ||
+				!filemon_equal(&mon, &index->mon))
+		{
+			hmap_free(index->names);
+			index->names = NULL;
+		}
+	}
+}
+
+/* Retrieves set of names in i-th directory of paths building it if necessary.
+ * Relative paths aren't indexed as they depend on current directory.  Returns
+ * the set or NULL if the directory has no index. */
+static hmap_t *
+get_dir_names(int i)
+{
+#if defined(_WIN32) || defined(__CYGWIN__)
+	/* Names of executables can lack extensions, which makes index useless. */
+	return NULL;
+#endif
+
+	if(i >= dir_indexes_count || !is_path_absolute(paths[i]))
+	{
+		return NULL;
+	}
+
+	dir_index_t *const index = &dir_indexes[i];
+	if(index->names == NULL)
+	{
+		/* Get modification time before reading to not miss changes made in
+		 * between. */
+		if(filemon_from_file(paths[i], FMT_MODIFIED, &index->mon) != 0)
+		{
+			return NULL;
+		}
+		index->names = read_dir_names(paths[i]);
+	}
+	return index->names;
+}
+
+/* Lists names of files of a directory.  Returns the set or NULL on error. */
+static hmap_t *
+read_dir_names(const char path[])
+{
+	DIR *const dir = os_opendir(path);
+	if(dir == NULL)
+	{
+		return NULL;
+	}
+
+	hmap_t *names = hmap_create(sizeof(char));
+
+	struct dirent *dentry;
+	while(names != NULL && (dentry = os_readdir(dir)) != NULL)
+	{
+		int created;
+		const char *const name = dentry->d_name;
+		if(hmap_put(names, hmap_istr_key(name, strlen(name)), &created) == NULL)
+		{
+			hmap_free(names);
+			names = NULL;
+		}
+	}
+
+	os_closedir(dir);
+	return names;
+}
+
 void
 load_clean_path_env(void)
 {
@@ -29,6 +29,13 @@ void update_path_env(int force);
  * the count argument. */
 char ** get_paths(size_t *count);
 
+/* Checks whether i-th directory of the list returned by get_paths() might
+ * contain a file with the specified name according to an index of directory's
+ * contents, which is rebuilt when the directory changes.  Result is
+ * approximate, positive answers still need to be checked.  Returns zero if
+ * the file certainly isn't there, otherwise non-zero is returned. */
+int path_env_may_contain(size_t i, const char name[]);
+
 /* Sets PATH to its value that was set by user or another program. Use
  * load_real_path_env() function to revert this effect. */
 void load_clean_path_env(void);
@@ -36,6 +36,7 @@ ioeta_alloc(void *param, io_cancellation_t cancellation)
 	ioeta_estim_t *const estim = calloc(1U, sizeof(*estim));
 	estim->param = param;
 	estim->cancellation = cancellation;
+	estim->last_notif_stage = -1;
 	return estim;
 }
 
@@ -63,6 +63,11 @@ typedef struct ioeta_estim_t
 	/* Progress reported while this flag is on is ignored. */
 	int silent;
 
+	/* Throttling state of notifications: time of the last one in milliseconds
+	 * and stage it was issued for (-1 if none yet). */
+	long long last_notif_time;
+	int last_notif_stage;
+
 	/* Custom parameter for notification callbacks. */
 	void *param;
 
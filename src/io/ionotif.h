@@ -46,6 +46,12 @@ typedef void (*ionotif_progress_changed)(const io_progress_t *progress);
  * NULL to disable notifications. */
 void ionotif_register(ionotif_progress_changed handler);
 
+/* Sets minimal interval between two notifications about the same estimation
+ * in milliseconds.  Changes of paths of current item are not recorded by
+ * estimations in between notifications.  Stage changes are always reported.
+ * Zero interval (the default) disables throttling. */
+void ionotif_set_interval(int interval_ms);
+
 #endif /* VIFM__IO__IONOTIF_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
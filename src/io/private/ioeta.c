@@ -40,9 +40,11 @@ ioeta_add_item(ioeta_estim_t *estim, const char path[])
 {
 	++estim->total_items;
 
-	replace_string(&estim->item, path);
-
-	ionotif_notify(IO_PS_ESTIMATING, estim);
+	if(ionotif_due(IO_PS_ESTIMATING, estim))
+	{
+		replace_string(&estim->item, path);
+		ionotif_notify(IO_PS_ESTIMATING, estim);
+	}
 }
 
 void
@@ -64,9 +66,11 @@ ioeta_add_dir(ioeta_estim_t *estim, const char path[])
 	 *       progress reports and it even might be the reason of getting more than
 	 *       100% progress. */
 
-	replace_string(&estim->item, path);
-
-	ionotif_notify(IO_PS_ESTIMATING, estim);
+	if(ionotif_due(IO_PS_ESTIMATING, estim))
+	{
+		replace_string(&estim->item, path);
+		ionotif_notify(IO_PS_ESTIMATING, estim);
+	}
 }
 
 void
@@ -103,6 +107,13 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		estim->total_file_bytes = get_file_size(path);
 	}
 
+	/* Paths are copied only when they are about to be reported to avoid doing it
+	 * for every file when there are lots of them. */
+	if(!ionotif_due(IO_PS_IN_PROGRESS, estim))
+	{
+		return;
+	}
+
 	if(path != NULL)
 	{
 		replace_string(&estim->item, path);
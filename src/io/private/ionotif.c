@@ -19,12 +19,18 @@
 #include "ionotif.h"
 
 #include <stddef.h> /* NULL */
+#include <time.h> /* clock_gettime() */
 
 #include "../ioeta.h"
 #include "../ionotif.h"
 
+static long long time_in_ms(void);
+
 static ionotif_progress_changed progress_changed;
 
+/* Minimal interval between notifications in milliseconds. */
+static int notif_interval;
+
 void
 ionotif_register(ionotif_progress_changed handler)
 {
@@ -41,5 +47,45 @@ ionotif_notify(IoPs stage, ioeta_estim_t *estim)
 	}
 }
 
+void
+ionotif_set_interval(int interval_ms)
+{
+	notif_interval = (interval_ms < 0 ? 0 : interval_ms);
+}
+
+int
+ionotif_due(IoPs stage, ioeta_estim_t *estim)
+{
+	if(notif_interval == 0)
+	{
+		return 1;
+	}
+
+	const long long now = time_in_ms();
+	if((int)stage == estim->last_notif_stage &&
+			now - estim->last_notif_time < notif_interval)
+	{
+		return 0;
+	}
+
+	estim->last_notif_time = now;
+	estim->last_notif_stage = stage;
+	return 1;
+}
+
+/* Retrieves time suitable for measuring intervals.  Returns the time in
+ * milliseconds. */
+static long long
+time_in_ms(void)
+{
+	struct timespec current_time;
+	if(clock_gettime(CLOCK_MONOTONIC, &current_time) != 0)
+	{
+		return 0;
+	}
+
+	return current_time.tv_sec*1000LL + current_time.tv_nsec/1000000;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -28,6 +28,11 @@
  * ionotif_register(). */
 void ionotif_notify(IoPs stage, ioeta_estim_t *estim);
 
+/* Checks whether it's time to notify about progress of the estimation at the
+ * specified stage and if so, records that notification is going to happen.
+ * Returns non-zero if ionotif_notify() should be called. */
+int ionotif_due(IoPs stage, ioeta_estim_t *estim);
+
 #endif /* VIFM__IO__PRIVATE__IONOTIF_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
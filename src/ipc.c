@@ -24,11 +24,17 @@
 /* Named pipes don't work very well on Cygwin neither directly nor indirectly
  * (using //./pipe/ paths with POSIX API), so use Win32 API on Cygwin. */
 # define WIN32_PIPE_READ
+#elif !defined(__APPLE__)
+/* Sequenced-packet Unix domain sockets preserve boundaries of messages and
+ * allow replying over the same connection.  macOS lacks them, so FIFOs are used
+ * there. */
+# define UNIX_SOCKET_IPC
 #endif
 
 #ifndef WIN32_PIPE_READ
 # include <sys/types.h>
 # include <sys/select.h> /* FD_* select() */
+# include <sys/uio.h> /* iovec writev() */
 #else
 # define O_NONBLOCK 0
 # include <windows.h>
@@ -40,19 +46,33 @@
 # endif
 #endif
 
+#ifdef UNIX_SOCKET_IPC
+# include <sys/socket.h> /* AF_UNIX SOCK_SEQPACKET accept() bind() connect()
+                            listen() recv() recvmsg() sendmsg() socket() */
+# include <sys/un.h> /* sockaddr_un */
+# include <poll.h> /* POLLIN poll() pollfd */
+# include <signal.h> /* kill() */
+#endif
+
 #include <sys/stat.h> /* mkfifo() stat() */
 #include <dirent.h> /* DIR closedir() opendir() readdir() */
 #include <fcntl.h>
-#include <unistd.h> /* close() open() select() unlink() usleep() */
+#include <unistd.h> /* close() ftruncate() getpid() getuid() lseek() open()
+                       pwrite() read() select() unlink() usleep() */
 
-#include <errno.h> /* EACCES EEXIST EDQUOT ENOSPC ENXIO errno */
+#include <errno.h> /* EACCES EADDRINUSE ECONNREFUSED EEXIST EDQUOT EINTR
+                      EMSGSIZE ENAMETOOLONG ENOENT ENOSPC ENXIO EPERM errno */
+#include <limits.h> /* IOV_MAX */
 #include <stddef.h> /* NULL size_t ssize_t */
 #include <stdio.h> /* FILE fclose() fdopen() fread() fwrite() */
-#include <stdlib.h> /* free() malloc() snprintf() */
-#include <string.h> /* strcmp() strcpy() strlen() */
+#include <stdlib.h> /* free() malloc() realloc() snprintf() strtol() strtoul() */
+#include <string.h> /* memcpy() memset() strchr() strcmp() strcpy()
+                       strlen() */
 
 #include "compat/os.h"
+#include "compat/reallocarray.h"
 #include "utils/fs.h"
+#include "utils/hmap.h"
 #include "utils/log.h"
 #include "utils/macros.h"
 #include "utils/path.h"
@@ -88,16 +108,45 @@
  *  - "eval" to pass an expression for evaluation in a single line;
  *  - "eval-result" to communicate result of successful evaluation in a single
  *    line;
- *  - "eval-error" to communicate failure of evaluation with no strings.
+ *  - "eval-error" to communicate failure of evaluation with no strings;
+ *  - "batch" to pass a list of commands and expressions (prefixed with "=") to
+ *    be processed as a whole;
+ *  - "batch-result" to communicate results of processing a batch, one per item
+ *    of the batch, in the form of "+{result}" for success and "-" for failure;
+ *  - "batch-error" to communicate failure to process a batch with no strings.
  *
  * On version mismatch or unknown field name, packet is discarded which is
  * logged.
+ *
+ * Where Unix domain sockets of SOCK_SEQPACKET type are available, each package
+ * is a single message sent over a new connection and reply to "eval" comes back
+ * over the same connection.  Package that doesn't fit into a message is
+ * announced by a message of "\0{size}" form and sent in several parts.  Socket
+ * whose path is too long for an address is created in /tmp under a name
+ * derived from the path.  Running instances are listed in a per-user registry
+ * file (lines of "{pid} {name}"), so that looking for them doesn't involve
+ * probing every object in a directory.  FIFOs and Windows named pipes
+ * prefix each package with its size as a 32-bit integer and replies are sent
+ * to the pipe of the requesting instance.
  */
 
 /* Prefix for names of all pipes to distinguish them from other pipes. */
 #define PREFIX "vifm-ipc-"
 
-#ifndef WIN32_PIPE_READ
+#ifdef UNIX_SOCKET_IPC
+/* Name of registry file of instances, formatted with id of the user. */
+#define REGISTRY "vifm-ipc.%lu.registry"
+#endif
+
+#ifndef IOV_MAX
+/* The minimum guaranteed by POSIX. */
+#define IOV_MAX 16
+#endif
+
+#if defined(UNIX_SOCKET_IPC)
+typedef int read_pipe_t;
+#define NULL_READ_PIPE (-1)
+#elif !defined(WIN32_PIPE_READ)
 typedef FILE *read_pipe_t;
 #define NULL_READ_PIPE NULL
 #else
@@ -122,6 +171,8 @@ struct ipc_t
 	ipc_args_cb args_cb;
 	/* Stores callback used for evaluation of expressions. */
 	ipc_eval_cb eval_cb;
+	/* Stores callback used for processing batches or NULL. */
+	ipc_batch_cb batch_cb;
 	/* Whether this IPC instance should ignore check requests from outside. */
 	int locked;
 	/* Path to the pipe used by this instance. */
@@ -130,8 +181,35 @@ struct ipc_t
 	read_pipe_t pipe_file;
 	/* Holds result of expression evaluation or NULL on evaluation error. */
 	char *eval_result;
+	/* Holds results of processing a batch or NULL on error. */
+	char **batch_result;
+	/* Number of elements in batch_result array. */
+	int batch_len;
+#ifdef UNIX_SOCKET_IPC
+	/* Connection over which package being handled was received or -1. */
+	int reply_fd;
+#endif
 };
 
+/* Piece of a package, which is sent as is. */
+typedef struct
+{
+	const char *data; /* Start of the piece. */
+	size_t len;       /* Length of the piece. */
+}
+chunk_t;
+
+/* Package composed of a header and strings of a payload without copying the
+ * latter. */
+typedef struct
+{
+	char *header;    /* Header of the package. */
+	chunk_t *chunks; /* Header followed by strings of the payload. */
+	int nchunks;     /* Number of elements in chunks array. */
+	size_t len;      /* Total length of the package. */
+}
+pkg_t;
+
 static read_pipe_t create_pipe(const char name[], char path_buf[], size_t len);
 static char * receive_pkg(ipc_t *ipc, int *len);
 static read_pipe_t try_use_pipe(const char path[], int *fatal);
@@ -139,15 +217,49 @@ static void handle_pkg(ipc_t *ipc, const char pkg[], const char *end);
 static void handle_args(ipc_t *ipc, char ***array, int len);
 static void handle_expr(ipc_t *ipc, const char from[], char *array[], int len);
 static void handle_eval_result(ipc_t *ipc, char *array[], int len);
+static void handle_batch(ipc_t *ipc, const char from[], char *array[],
+		int len);
+static void handle_batch_result(ipc_t *ipc, char ***array, int len);
+static int request(ipc_t *ipc, const char whom[], char *data[],
+		const char type[], int timeout_ms);
+static int send_reply(ipc_t *ipc, const char from[], char *data[],
+		const char type[]);
 static int format_and_send(ipc_t *ipc, const char whom[], char *data[],
 		const char type[]);
-static int send_pkg(const char whom[], const char what[], size_t len);
+static int compose_pkg(const ipc_t *ipc, char *data[], const char type[],
+		pkg_t *pkg);
+static char * join_pkg(const pkg_t *pkg);
+static void free_pkg(pkg_t *pkg);
+#ifndef UNIX_SOCKET_IPC
+static int send_pkg(const char whom[], const pkg_t *pkg);
+#endif
 static char * get_the_only_target(const ipc_t *ipc);
 static char ** list_servers(const ipc_t *ipc, int *len);
+#ifndef UNIX_SOCKET_IPC
 static int add_to_list(const char name[], const void *data, void *param);
+#endif
 static const char * get_ipc_dir(void);
 static int sorter(const void *first, const void *second);
-#ifndef WIN32_PIPE_READ
+#if defined(UNIX_SOCKET_IPC)
+static int connect_and_send(ipc_t *ipc, const char whom[], char *data[],
+		const char type[]);
+static int send_over(int fd, const pkg_t *pkg);
+static int send_in_parts(int fd, const pkg_t *pkg);
+static ssize_t send_msg(int fd, struct msghdr *msg);
+static char * recv_pkg(int fd, int timeout_ms, int *len);
+static int recv_parts(int fd, int timeout_ms, char pkg[], size_t size);
+static int wait_for_msg(int fd, int timeout_ms);
+static int connect_to(const char path[]);
+static int make_socket(void);
+static int fill_addr(struct sockaddr_un *addr, const char path[]);
+static void get_socket_file(const char path[], char buf[], size_t len);
+static void remove_socket(const char path[]);
+static int socket_is_in_use(const char path[]);
+static int update_registry(const char name[], int add);
+static char * read_registry(int for_write, int *fd);
+static const char * parse_registry_entry(const char line[]);
+static void get_registry_path(char buf[], size_t len);
+#elif !defined(WIN32_PIPE_READ)
 static int pipe_is_in_use(const char path[]);
 #endif
 
@@ -161,6 +273,12 @@ static const char EVAL_TYPE[] = "eval";
 static const char EVAL_RESULT_TYPE[] = "eval-result";
 /* Reply to remote expression on error. */
 static const char EVAL_ERROR_TYPE[] = "eval-error";
+/* Request to process a batch of commands and expressions. */
+static const char BATCH_TYPE[] = "batch";
+/* Reply to a batch with results of its items. */
+static const char BATCH_RESULT_TYPE[] = "batch-result";
+/* Reply to a batch on error. */
+static const char BATCH_ERROR_TYPE[] = "batch-error";
 
 int
 ipc_enabled(void)
@@ -169,7 +287,8 @@ ipc_enabled(void)
 }
 
 ipc_t *
-ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb)
+ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb,
+		ipc_batch_cb batch_cb)
 {
 	ipc_t *const ipc = malloc(sizeof(*ipc));
 	if(ipc == NULL)
@@ -179,7 +298,14 @@ ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb)
 
 	ipc->args_cb = args_cb;
 	ipc->eval_cb = eval_cb;
+	ipc->batch_cb = batch_cb;
 	ipc->locked = 0;
+	ipc->eval_result = NULL;
+	ipc->batch_result = NULL;
+	ipc->batch_len = 0;
+#ifdef UNIX_SOCKET_IPC
+	ipc->reply_fd = -1;
+#endif
 
 	if(name == NULL)
 	{
@@ -193,6 +319,13 @@ ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb)
 		return NULL;
 	}
 
+#ifdef UNIX_SOCKET_IPC
+	if(update_registry(ipc_get_name(ipc), 1) != 0)
+	{
+		LOG_ERROR_MSG("Failed to add IPC instance to the registry");
+	}
+#endif
+
 	return ipc;
 }
 
@@ -204,7 +337,11 @@ ipc_free(ipc_t *ipc)
 		return;
 	}
 
-#ifndef WIN32_PIPE_READ
+#if defined(UNIX_SOCKET_IPC)
+	(void)update_registry(ipc_get_name(ipc), 0);
+	close(ipc->pipe_file);
+	remove_socket(ipc->pipe_path);
+#elif !defined(WIN32_PIPE_READ)
 	fclose(ipc->pipe_file);
 	unlink(ipc->pipe_path);
 #else
@@ -235,6 +372,10 @@ ipc_check(ipc_t *ipc)
 	{
 		handle_pkg(ipc, pkg, pkg + len);
 		free(pkg);
+#ifdef UNIX_SOCKET_IPC
+		close(ipc->reply_fd);
+		ipc->reply_fd = -1;
+#endif
 		return 1;
 	}
 	return 0;
@@ -246,7 +387,28 @@ ipc_check(ipc_t *ipc)
 static char *
 receive_pkg(ipc_t *ipc, int *len)
 {
-#ifndef WIN32_PIPE_READ
+#if defined(UNIX_SOCKET_IPC)
+	/* Sender writes right after connecting, so don't hold main loop up for long
+	 * because of a client that doesn't. */
+	enum { TIMEOUT_MS = 100 };
+
+	const int conn = accept(ipc->pipe_file, NULL, NULL);
+	if(conn == -1)
+	{
+		return NULL;
+	}
+	(void)fcntl(conn, F_SETFD, FD_CLOEXEC);
+
+	char *const pkg = recv_pkg(conn, TIMEOUT_MS, len);
+	if(pkg == NULL)
+	{
+		close(conn);
+		return NULL;
+	}
+
+	ipc->reply_fd = conn;
+	return pkg;
+#elif !defined(WIN32_PIPE_READ)
 	uint32_t size;
 	char *pkg;
 	char *p;
@@ -391,7 +553,54 @@ create_pipe(const char name[], char path_buf[], size_t len)
 static read_pipe_t
 try_use_pipe(const char path[], int *fatal)
 {
-#ifndef WIN32_PIPE_READ
+#if defined(UNIX_SOCKET_IPC)
+	struct sockaddr_un addr;
+
+	*fatal = 1;
+
+	if(fill_addr(&addr, path) != 0)
+	{
+		return NULL_READ_PIPE;
+	}
+
+	const int fd = make_socket();
+	if(fd == -1)
+	{
+		return NULL_READ_PIPE;
+	}
+
+	int error = 0;
+	if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		error = errno;
+		/* Take over socket file left by an instance that's gone. */
+		if(error == EADDRINUSE && !socket_is_in_use(path))
+		{
+			remove_socket(path);
+			error = (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+			      ? 0
+			      : errno;
+		}
+	}
+
+	if(error == 0 && (listen(fd, SOMAXCONN) != 0 ||
+				fcntl(fd, F_SETFL, O_NONBLOCK) != 0))
+	{
+		error = errno;
+		remove_socket(path);
+	}
+
+	if(error != 0)
+	{
+		/* Only a name conflict is worth another try. */
+		*fatal = (error != EADDRINUSE);
+		close(fd);
+		return NULL_READ_PIPE;
+	}
+
+	*fatal = 0;
+	return fd;
+#elif !defined(WIN32_PIPE_READ)
 	FILE *f;
 	int fd;
 
@@ -515,6 +724,18 @@ handle_pkg(ipc_t *ipc, const char pkg[], const char *end)
 	{
 		ipc->eval_result = NULL;
 	}
+	else if(strcmp(type, BATCH_TYPE) == 0)
+	{
+		handle_batch(ipc, from, array, len);
+	}
+	else if(strcmp(type, BATCH_RESULT_TYPE) == 0)
+	{
+		handle_batch_result(ipc, &array, len);
+	}
+	else if(strcmp(type, BATCH_ERROR_TYPE) == 0)
+	{
+		ipc->batch_result = NULL;
+	}
 	else
 	{
 		LOG_ERROR_MSG("Discarded remote package due to unknown type: `%s`", type);
@@ -558,7 +779,7 @@ handle_expr(ipc_t *ipc, const char from[], char *array[], int len)
 	if(result == NULL)
 	{
 		char *data[] = { NULL };
-		if(format_and_send(ipc, from, data, EVAL_ERROR_TYPE) != 0)
+		if(send_reply(ipc, from, data, EVAL_ERROR_TYPE) != 0)
 		{
 			LOG_ERROR_MSG("Failed to report evaluation failure");
 		}
@@ -566,7 +787,7 @@ handle_expr(ipc_t *ipc, const char from[], char *array[], int len)
 	else
 	{
 		char *data[] = { result, NULL };
-		if(format_and_send(ipc, from, data, EVAL_RESULT_TYPE) != 0)
+		if(send_reply(ipc, from, data, EVAL_RESULT_TYPE) != 0)
 		{
 			LOG_ERROR_MSG("Failed to report evaluation result");
 		}
@@ -585,6 +806,105 @@ handle_eval_result(ipc_t *ipc, char *array[], int len)
 	}
 }
 
+/* Handles received message with a batch to process. */
+static void
+handle_batch(ipc_t *ipc, const char from[], char *array[], int len)
+{
+	char **results = NULL;
+	if(len > 0 && ipc->batch_cb != NULL)
+	{
+		ipc->locked = 1;
+		results = ipc->batch_cb(array, len);
+		ipc->locked = 0;
+	}
+
+	/* Mark each result as failed or successful. */
+	char **data = (results == NULL)
+	            ? NULL
+	            : reallocarray(NULL, len + 1, sizeof(*data));
+	if(data != NULL)
+	{
+		int i;
+		for(i = 0; i < len; ++i)
+		{
+			data[i] = (results[i] == NULL) ? strdup("-")
+			                               : format_str("+%s", results[i]);
+		}
+		data[len] = NULL;
+
+		if(count_strings(data) != len)
+		{
+			free_string_array(data, len);
+			data = NULL;
+		}
+	}
+
+	if(data == NULL)
+	{
+		char *no_data[] = { NULL };
+		if(send_reply(ipc, from, no_data, BATCH_ERROR_TYPE) != 0)
+		{
+			LOG_ERROR_MSG("Failed to report batch failure");
+		}
+	}
+	else
+	{
+		if(send_reply(ipc, from, data, BATCH_RESULT_TYPE) != 0)
+		{
+			LOG_ERROR_MSG("Failed to report batch results");
+		}
+		free_string_array(data, len);
+	}
+
+	free_string_array(results, len);
+}
+
+/* Handles answer about processing of a batch.  Takes ownership of the array on
+ * success. */
+static void
+handle_batch_result(ipc_t *ipc, char ***array, int len)
+{
+	int i;
+	for(i = 0; i < len; ++i)
+	{
+		char *const item = (*array)[i];
+		if(item[0] == '+')
+		{
+			memmove(item, item + 1, strlen(item));
+		}
+		else
+		{
+			free(item);
+			(*array)[i] = NULL;
+		}
+	}
+
+	ipc->batch_result = *array;
+	ipc->batch_len = len;
+	*array = NULL;
+}
+
+/* Sends reply to a request that's being handled.  The data array should be
+ * NULL terminated.  Returns zero on successful send and non-zero otherwise. */
+static int
+send_reply(ipc_t *ipc, const char from[], char *data[], const char type[])
+{
+#ifdef UNIX_SOCKET_IPC
+	/* Replies go back over connection of the request. */
+	pkg_t pkg;
+	if(compose_pkg(ipc, data, type, &pkg) != 0)
+	{
+		return 1;
+	}
+
+	const int ret = send_over(ipc->reply_fd, &pkg);
+	free_pkg(&pkg);
+	return ret;
+#else
+	return format_and_send(ipc, from, data, type);
+#endif
+}
+
 int
 ipc_send(ipc_t *ipc, const char whom[], char *data[])
 {
@@ -594,30 +914,111 @@ ipc_send(ipc_t *ipc, const char whom[], char *data[])
 char *
 ipc_eval(ipc_t *ipc, const char whom[], const char expr[])
 {
-	enum { MAX_USEC = 1000000, MAX_REPEATS = 20 };
-	int repeats;
-
 	char *data[] = { (char *)expr, NULL };
-	if(format_and_send(ipc, whom, data, EVAL_TYPE) != 0)
+
+	enum { TIMEOUT_MS = 1000 };
+
+	ipc->eval_result = NULL;
+	if(request(ipc, whom, data, EVAL_TYPE, TIMEOUT_MS) != 0)
+	{
+		LOG_ERROR_MSG("Failed to evaluate expression remotely");
+		return NULL;
+	}
+
+	return ipc->eval_result;
+}
+
+char **
+ipc_batch(ipc_t *ipc, const char whom[], char *items[], int nitems,
+		int timeout_ms)
+{
+	if(nitems <= 0)
+	{
+		return NULL;
+	}
+
+	char **const data = reallocarray(NULL, nitems + 1, sizeof(*data));
+	if(data == NULL)
+	{
+		return NULL;
+	}
+	memcpy(data, items, sizeof(*data)*nitems);
+	data[nitems] = NULL;
+
+	ipc->batch_result = NULL;
+	ipc->batch_len = 0;
+	const int failed = request(ipc, whom, data, BATCH_TYPE, timeout_ms);
+	free(data);
+
+	char **const result = ipc->batch_result;
+	ipc->batch_result = NULL;
+
+	if(failed || result == NULL || ipc->batch_len != nitems)
 	{
-		LOG_ERROR_MSG("Failed to send expression");
+		LOG_ERROR_MSG("Failed to process batch remotely");
+		free_string_array(result, ipc->batch_len);
 		return NULL;
 	}
 
+	return result;
+}
+
+/* Sends a request and handles the reply to it waiting for it up to timeout_ms
+ * milliseconds (negative value means no limit).  Returns zero if reply was
+ * received, otherwise non-zero is returned. */
+static int
+request(ipc_t *ipc, const char whom[], char *data[], const char type[],
+		int timeout_ms)
+{
+#ifdef UNIX_SOCKET_IPC
+	const int fd = connect_and_send(ipc, whom, data, type);
+	if(fd == -1)
+	{
+		LOG_ERROR_MSG("Failed to send request");
+		return 1;
+	}
+
+	/* Reply comes over the same connection, so it can't be confused with
+	 * anything else. */
+	int len;
+	char *const pkg = recv_pkg(fd, timeout_ms, &len);
+	close(fd);
+
+	if(pkg == NULL)
+	{
+		LOG_ERROR_MSG("Timed out on waiting for a response");
+		return 1;
+	}
+
+	handle_pkg(ipc, pkg, pkg + len);
+	free(pkg);
+	return 0;
+#else
+	enum { SLEEP_MS = 50 };
+	int waited_ms;
+
+	if(format_and_send(ipc, whom, data, type) != 0)
+	{
+		LOG_ERROR_MSG("Failed to send request");
+		return 1;
+	}
+
 	/* Using sleep is just easier than doing read with timeout due to differences
 	 * between platforms... */
-	repeats = 0;
+	waited_ms = 0;
 	while(!ipc_check(ipc))
 	{
-		if(++repeats > MAX_REPEATS)
+		if(timeout_ms >= 0 && waited_ms >= timeout_ms)
 		{
-			LOG_ERROR_MSG("Timed out on waiting for --remote-expr response");
-			return NULL;
+			LOG_ERROR_MSG("Timed out on waiting for a response");
+			return 1;
 		}
-		usleep(MAX_USEC/MAX_REPEATS);
+		usleep(SLEEP_MS*1000);
+		waited_ms += SLEEP_MS;
 	}
 
-	return ipc->eval_result;
+	return 0;
+#endif
 }
 
 /* Formats and sends a message of specified type.  The data array should be NULL
@@ -625,62 +1026,139 @@ ipc_eval(ipc_t *ipc, const char whom[], const char expr[])
 static int
 format_and_send(ipc_t *ipc, const char whom[], char *data[], const char type[])
 {
-	/* FIXME: this shouldn't have fixed size.  Or maybe it should be PIPE_BUF to
-	 * guarantee atomic operation. */
-	char pkg[8192];
-	size_t len;
+#ifdef UNIX_SOCKET_IPC
+	const int fd = connect_and_send(ipc, whom, data, type);
+	if(fd == -1)
+	{
+		return 1;
+	}
+
+	close(fd);
+	return 0;
+#else
+	pkg_t pkg;
 	char *name = NULL;
 	int ret;
 
-	/* Compose "header". */
-	len = copy_str(pkg, sizeof(pkg), IPC_VERSION);
-	len += MIN(snprintf(pkg + len, sizeof(pkg) - len, "from:%s",
-				ipc_get_name(ipc)) + 1,
-			(int)(sizeof(pkg) - len));
-	len += MIN(snprintf(pkg + len, sizeof(pkg) - len, "body:%s", type) + 1,
-			(int)(sizeof(pkg) - len));
+	if(compose_pkg(ipc, data, type, &pkg) != 0)
+	{
+		return 1;
+	}
 
-	if(strcmp(type, ARGS_TYPE) == 0)
+	if(whom == NULL)
 	{
-		if(get_cwd(pkg + len, sizeof(pkg) - len) == NULL)
+		name = get_the_only_target(ipc);
+		if(name == NULL)
 		{
-			LOG_ERROR_MSG("Can't get working directory");
+			free_pkg(&pkg);
 			return 1;
 		}
-		len += strlen(pkg + len) + 1;
+		whom = name;
+	}
+
+	ret = send_pkg(whom, &pkg);
+
+	free_pkg(&pkg);
+	free(name);
+	return ret;
+#endif
+}
+
+/* Composes a package of specified type out of NULL terminated data array
+ * without copying its strings, so the array must outlive the package.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+compose_pkg(const ipc_t *ipc, char *data[], const char type[], pkg_t *pkg)
+{
+	char cwd[PATH_MAX + 1];
+	const int with_cwd = (strcmp(type, ARGS_TYPE) == 0);
+	if(with_cwd && get_cwd(cwd, sizeof(cwd)) == NULL)
+	{
+		LOG_ERROR_MSG("Can't get working directory");
+		return 1;
+	}
+
+	const char *const name = ipc_get_name(ipc);
+	const size_t header_len = sizeof(IPC_VERSION)
+	                        + strlen("from:") + strlen(name) + 1U
+	                        + strlen("body:") + strlen(type) + 1U
+	                        + (with_cwd ? strlen(cwd) + 1U : 0U);
+
+	const int ndata = count_strings(data);
+	pkg->header = malloc(header_len);
+	pkg->chunks = reallocarray(NULL, 1 + ndata, sizeof(*pkg->chunks));
+	if(pkg->header == NULL || pkg->chunks == NULL)
+	{
+		free_pkg(pkg);
+		return 1;
+	}
+
+	/* Compose "header". */
+	char *p = pkg->header;
+	p += snprintf(p, header_len, "%s", IPC_VERSION) + 1;
+	p += snprintf(p, header_len - (p - pkg->header), "from:%s", name) + 1;
+	p += snprintf(p, header_len - (p - pkg->header), "body:%s", type) + 1;
+	if(with_cwd)
+	{
+		p += snprintf(p, header_len - (p - pkg->header), "%s", cwd) + 1;
 	}
 
+	pkg->chunks[0].data = pkg->header;
+	pkg->chunks[0].len = header_len;
+	pkg->nchunks = 1;
+	pkg->len = header_len;
+
 	while(*data != NULL)
 	{
-		len += copy_str(pkg + len, sizeof(pkg) - len, *data);
+		chunk_t *const chunk = &pkg->chunks[pkg->nchunks++];
+		chunk->data = *data;
+		chunk->len = strlen(*data) + 1U;
+		pkg->len += chunk->len;
 		++data;
 	}
 
-	if(whom == NULL)
+	return 0;
+}
+
+/* Puts all pieces of a package into a single buffer.  Returns newly allocated
+ * buffer of pkg->len bytes or NULL on error. */
+static char *
+join_pkg(const pkg_t *pkg)
+{
+	char *const buf = malloc(pkg->len);
+	if(buf != NULL)
 	{
-		name = get_the_only_target(ipc);
-		if(name == NULL)
+		char *p = buf;
+		int i;
+		for(i = 0; i < pkg->nchunks; ++i)
 		{
-			return 1;
+			memcpy(p, pkg->chunks[i].data, pkg->chunks[i].len);
+			p += pkg->chunks[i].len;
 		}
-		whom = name;
 	}
+	return buf;
+}
 
-	ret = send_pkg(whom, pkg, len);
-
-	free(name);
-	return ret;
+/* Frees resources of a package. */
+static void
+free_pkg(pkg_t *pkg)
+{
+	free(pkg->header);
+	free(pkg->chunks);
+	pkg->header = NULL;
+	pkg->chunks = NULL;
 }
 
+#ifndef UNIX_SOCKET_IPC
+
 /* Performs actual sending of package to another instance.  Returns zero on
  * success and non-zero otherwise. */
 static int
-send_pkg(const char whom[], const char what[], size_t len)
+send_pkg(const char whom[], const pkg_t *pkg)
 {
 #ifndef WIN32_PIPE_READ
 	char path[PATH_MAX + 1];
 	int fd;
-	FILE *dst;
 	uint32_t size;
 
 	snprintf(path, sizeof(path), "%s/" PREFIX "%s", get_ipc_dir(), whom);
@@ -692,24 +1170,53 @@ send_pkg(const char whom[], const char what[], size_t len)
 		return 1;
 	}
 
-	dst = fdopen(fd, "w");
-	if(dst == NULL)
+	size = pkg->len;
+
+	/* Write size followed by all pieces at once unless there are too many of
+	 * them. */
+	const int niov = 1 + pkg->nchunks;
+	struct iovec *const iov = (niov <= IOV_MAX)
+	                        ? reallocarray(NULL, niov, sizeof(*iov))
+	                        : NULL;
+	char *const joined = (iov == NULL) ? join_pkg(pkg) : NULL;
+	if(iov == NULL && joined == NULL)
 	{
-		LOG_SERROR_MSG(errno, "Failed to turn file descriptor into a FILE");
 		close(fd);
 		return 1;
 	}
 
-	size = len;
-	if(fwrite(&size, sizeof(size), 1U, dst) != 1U ||
-			fwrite(what, len, 1U, dst) != 1U)
+	ssize_t nwritten;
+	if(iov != NULL)
+	{
+		iov[0].iov_base = &size;
+		iov[0].iov_len = sizeof(size);
+
+		int i;
+		for(i = 0; i < pkg->nchunks; ++i)
+		{
+			iov[1 + i].iov_base = (char *)pkg->chunks[i].data;
+			iov[1 + i].iov_len = pkg->chunks[i].len;
+		}
+
+		nwritten = writev(fd, iov, niov);
+		free(iov);
+	}
+	else
+	{
+		nwritten = (write(fd, &size, sizeof(size)) == sizeof(size))
+		         ? write(fd, joined, pkg->len) + (ssize_t)sizeof(size)
+		         : -1;
+		free(joined);
+	}
+
+	if(nwritten != (ssize_t)(sizeof(size) + pkg->len))
 	{
 		LOG_SERROR_MSG(errno, "Failed to write into a pipe");
-		(void)fclose(dst);
+		(void)close(fd);
 		return 1;
 	}
 
-	if(fclose(dst) != 0)
+	if(close(fd) != 0)
 	{
 		LOG_SERROR_MSG(errno, "Failure on close a pipe");
 	}
@@ -722,27 +1229,39 @@ send_pkg(const char whom[], const char what[], size_t len)
 
 	snprintf(path, sizeof(path), "%s/" PREFIX "%s", get_ipc_dir(), whom);
 
+	char *const what = join_pkg(pkg);
+	if(what == NULL)
+	{
+		return 1;
+	}
+
 	h = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
 			0, NULL);
 	if(h == INVALID_HANDLE_VALUE)
 	{
+		free(what);
 		return 1;
 	}
 
-	size = len;
+	size = pkg->len;
 	if(WriteFile(h, &size, sizeof(size), &nwritten, NULL) == FALSE ||
 			nwritten != sizeof(size) ||
-			WriteFile(h, what, len, &nwritten, NULL) == FALSE || nwritten != len)
+			WriteFile(h, what, pkg->len, &nwritten, NULL) == FALSE ||
+			nwritten != pkg->len)
 	{
 		CloseHandle(h);
+		free(what);
 		return 1;
 	}
 
 	CloseHandle(h);
+	free(what);
 	return 0;
 #endif
 }
 
+#endif
+
 /* Automatically picks target instance to send data to.  Returns newly allocated
  * string or NULL on error (no other instances or memory allocation failure). */
 static char *
@@ -778,20 +1297,50 @@ list_servers(const ipc_t *ipc, int *len)
 {
 	list_data_t data = { .ipc_dir = get_ipc_dir(), .ipc = ipc };
 
-#ifndef WIN32_PIPE_READ
-	if(enum_dir_content(data.ipc_dir, &add_to_list, &data) != 0)
+#if defined(UNIX_SOCKET_IPC)
+	int fd;
+	char *const registry = read_registry(0, &fd);
+	if(registry == NULL)
 	{
 		*len = 0;
 		return NULL;
 	}
-#else
+	close(fd);
+
+	char *line = registry;
+	while(line != NULL)
 	{
-		char find_pat[PATH_MAX + 1];
-		HANDLE hfind;
-		WIN32_FIND_DATAA ffd;
+		char *const eol = strchr(line, '\n');
+		if(eol != NULL)
+		{
+			*eol = '\0';
+		}
 
-		snprintf(find_pat, sizeof(find_pat), "%s/*", data.ipc_dir);
-		hfind = FindFirstFileA(find_pat, &ffd);
+		const char *const name = parse_registry_entry(line);
+		/* Skip ourself. */
+		if(name != NULL &&
+				(ipc == NULL || stroscmp(name, ipc_get_name(ipc)) != 0))
+		{
+			data.len = add_to_string_array(&data.lst, data.len, name);
+		}
+
+		line = (eol == NULL ? NULL : eol + 1);
+	}
+	free(registry);
+#elif !defined(WIN32_PIPE_READ)
+	if(enum_dir_content(data.ipc_dir, &add_to_list, &data) != 0)
+	{
+		*len = 0;
+		return NULL;
+	}
+#else
+	{
+		char find_pat[PATH_MAX + 1];
+		HANDLE hfind;
+		WIN32_FIND_DATAA ffd;
+
+		snprintf(find_pat, sizeof(find_pat), "%s/*", data.ipc_dir);
+		hfind = FindFirstFileA(find_pat, &ffd);
 
 		if(hfind == INVALID_HANDLE_VALUE)
 		{
@@ -817,6 +1366,8 @@ list_servers(const ipc_t *ipc, int *len)
 	return data.lst;
 }
 
+#ifndef UNIX_SOCKET_IPC
+
 /* Analyzes pipe and adds it to the list of pipes.  Returns zero on success or
  * non-zero on error. */
 static int
@@ -856,6 +1407,8 @@ add_to_list(const char name[], const void *data, void *param)
 	return 0;
 }
 
+#endif
+
 /* Retrieves directory where FIFO objects are created.  Returns the path. */
 static const char *
 get_ipc_dir(void)
@@ -876,7 +1429,551 @@ sorter(const void *first, const void *second)
 	return strcmp(*a, *b);
 }
 
-#ifndef WIN32_PIPE_READ
+#if defined(UNIX_SOCKET_IPC)
+
+/* Connects to an instance and sends it a package.  If whom argument is NULL,
+ * target instance is automatically determined.  Returns connected socket on
+ * success and -1 otherwise. */
+static int
+connect_and_send(ipc_t *ipc, const char whom[], char *data[],
+		const char type[])
+{
+	char path[PATH_MAX + 1];
+	char *name = NULL;
+	pkg_t pkg;
+
+	if(compose_pkg(ipc, data, type, &pkg) != 0)
+	{
+		return -1;
+	}
+
+	if(whom == NULL)
+	{
+		name = get_the_only_target(ipc);
+		if(name == NULL)
+		{
+			free_pkg(&pkg);
+			return -1;
+		}
+		whom = name;
+	}
+
+	snprintf(path, sizeof(path), "%s/" PREFIX "%s", get_ipc_dir(), whom);
+	free(name);
+
+	const int fd = connect_to(path);
+	if(fd == -1)
+	{
+		LOG_SERROR_MSG(errno, "Failed to connect to destination socket");
+	}
+	else if(send_over(fd, &pkg) != 0)
+	{
+		close(fd);
+		free_pkg(&pkg);
+		return -1;
+	}
+
+	free_pkg(&pkg);
+	return fd;
+}
+
+/* Sends package as a single message with one system call or in several parts
+ * if it's too large for that.  Returns zero on success and non-zero
+ * otherwise. */
+static int
+send_over(int fd, const pkg_t *pkg)
+{
+	char *joined = NULL;
+	struct iovec *iov = NULL;
+	struct msghdr msg = { .msg_iovlen = pkg->nchunks };
+
+	/* Message must be sent at once, so join pieces if there are too many. */
+	if(pkg->nchunks > IOV_MAX)
+	{
+		joined = join_pkg(pkg);
+		iov = malloc(sizeof(*iov));
+		if(joined == NULL || iov == NULL)
+		{
+			free(joined);
+			free(iov);
+			return 1;
+		}
+
+		iov[0].iov_base = joined;
+		iov[0].iov_len = pkg->len;
+		msg.msg_iovlen = 1;
+	}
+	else
+	{
+		iov = reallocarray(NULL, pkg->nchunks, sizeof(*iov));
+		if(iov == NULL)
+		{
+			return 1;
+		}
+
+		int i;
+		for(i = 0; i < pkg->nchunks; ++i)
+		{
+			iov[i].iov_base = (char *)pkg->chunks[i].data;
+			iov[i].iov_len = pkg->chunks[i].len;
+		}
+	}
+	msg.msg_iov = iov;
+
+	const ssize_t nsent = send_msg(fd, &msg);
+	const int error = errno;
+
+	free(iov);
+	free(joined);
+
+	if(nsent == -1 && error == EMSGSIZE)
+	{
+		/* Size of a message is limited by size of socket's buffer. */
+		return send_in_parts(fd, pkg);
+	}
+
+	if(nsent != (ssize_t)pkg->len)
+	{
+		LOG_SERROR_MSG(error, "Failed to send a package");
+		return 1;
+	}
+	return 0;
+}
+
+/* Sends package that doesn't fit into a single message as its size followed by
+ * its contents split into several messages.  Returns zero on success and
+ * non-zero otherwise. */
+static int
+send_in_parts(int fd, const pkg_t *pkg)
+{
+	/* Small enough to fit into default size of socket's buffer. */
+	enum { PART_SIZE = 64*1024 };
+
+	char *const joined = join_pkg(pkg);
+	if(joined == NULL)
+	{
+		return 1;
+	}
+
+	char size[32];
+	size[0] = '\0';
+	const int size_len = 1 + snprintf(size + 1, sizeof(size) - 1, "%lu",
+			(unsigned long)pkg->len);
+
+	struct iovec iov = { .iov_base = size, .iov_len = size_len };
+	struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+	int error = (send_msg(fd, &msg) != size_len);
+
+	size_t sent = 0U;
+	while(!error && sent < pkg->len)
+	{
+		iov.iov_base = joined + sent;
+		iov.iov_len = MIN(pkg->len - sent, (size_t)PART_SIZE);
+		error = (send_msg(fd, &msg) != (ssize_t)iov.iov_len);
+		sent += iov.iov_len;
+	}
+
+	if(error)
+	{
+		LOG_SERROR_MSG(errno, "Failed to send a package in parts");
+	}
+
+	free(joined);
+	return error;
+}
+
+/* Sends a single message over a socket retrying on interrupts.  Returns number
+ * of sent bytes or -1 on error (errno is set). */
+static ssize_t
+send_msg(int fd, struct msghdr *msg)
+{
+#ifndef MSG_NOSIGNAL
+	/* Not all systems have it, SIGPIPE is still possible there. */
+	enum { MSG_NOSIGNAL = 0 };
+#endif
+
+	ssize_t nsent;
+	do
+	{
+		nsent = sendmsg(fd, msg, MSG_NOSIGNAL);
+	}
+	while(nsent == -1 && errno == EINTR);
+	return nsent;
+}
+
+/* Waits up to timeout_ms milliseconds (negative value means no limit) for a
+ * message on a connection and reads it.  Returns NULL if there was no message
+ * or on failure to read it, otherwise newly allocated string is returned. */
+static char *
+recv_pkg(int fd, int timeout_ms, int *len)
+{
+	if(!wait_for_msg(fd, timeout_ms))
+	{
+		return NULL;
+	}
+
+	/* Look at the message to find out its size without consuming it. */
+	size_t size = 4096U;
+	char *pkg = NULL;
+	while(1)
+	{
+		char *const new_pkg = realloc(pkg, size + 1U);
+		if(new_pkg == NULL)
+		{
+			free(pkg);
+			LOG_ERROR_MSG("Failed to allocate memory: %lu",
+					(unsigned long)(size + 1U));
+			return NULL;
+		}
+		pkg = new_pkg;
+
+		struct iovec iov = { .iov_base = pkg, .iov_len = size };
+		struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+		const ssize_t n = recvmsg(fd, &msg, MSG_PEEK);
+		if(n <= 0)
+		{
+			/* Peer has closed connection without sending anything. */
+			free(pkg);
+			return NULL;
+		}
+
+		if(!(msg.msg_flags & MSG_TRUNC))
+		{
+			break;
+		}
+		size *= 2U;
+	}
+
+	ssize_t n = recv(fd, pkg, size, 0);
+	if(n <= 0)
+	{
+		free(pkg);
+		return NULL;
+	}
+
+	if(pkg[0] == '\0')
+	{
+		/* Package is sent in parts after its size. */
+		pkg[n] = '\0';
+		const size_t total = strtoul(pkg + 1, NULL, 10);
+		char *const new_pkg = (total == 0U ? NULL : realloc(pkg, total + 1U));
+		if(new_pkg == NULL || recv_parts(fd, timeout_ms, new_pkg, total) != 0)
+		{
+			free(new_pkg == NULL ? pkg : new_pkg);
+			return NULL;
+		}
+		pkg = new_pkg;
+		n = total;
+	}
+
+	/* Make sure we have a trailing zero. */
+	pkg[n] = '\0';
+	*len = n;
+	return pkg;
+}
+
+/* Receives parts of a package into a buffer of the specified size.  Returns
+ * zero on success and non-zero otherwise. */
+static int
+recv_parts(int fd, int timeout_ms, char pkg[], size_t size)
+{
+	size_t received = 0U;
+	while(received < size)
+	{
+		if(!wait_for_msg(fd, timeout_ms))
+		{
+			return 1;
+		}
+
+		const ssize_t n = recv(fd, pkg + received, size - received, 0);
+		if(n <= 0)
+		{
+			return 1;
+		}
+		received += n;
+	}
+	return 0;
+}
+
+/* Waits up to timeout_ms milliseconds (negative value means no limit) for
+ * something to read on a connection.  Returns non-zero if there is something,
+ * otherwise zero is returned. */
+static int
+wait_for_msg(int fd, int timeout_ms)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	int ready;
+	do
+	{
+		ready = poll(&pfd, 1, timeout_ms);
+	}
+	while(ready == -1 && errno == EINTR);
+
+	return (ready > 0);
+}
+
+/* Connects to a socket at specified path.  Returns connected socket on success
+ * and -1 otherwise (errno is set). */
+static int
+connect_to(const char path[])
+{
+	struct sockaddr_un addr;
+	if(fill_addr(&addr, path) != 0)
+	{
+		return -1;
+	}
+
+	const int fd = make_socket();
+	if(fd == -1)
+	{
+		return -1;
+	}
+
+	if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		const int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+
+	return fd;
+}
+
+/* Creates a socket that isn't inherited by child processes.  Returns the socket
+ * or -1 on error. */
+static int
+make_socket(void)
+{
+	const int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if(fd != -1)
+	{
+		(void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+	return fd;
+}
+
+/* Fills address of a socket.  Returns zero on success and non-zero if path is
+ * too long. */
+static int
+fill_addr(struct sockaddr_un *addr, const char path[])
+{
+	char file[PATH_MAX + 1];
+	get_socket_file(path, file, sizeof(file));
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if(strlen(file) >= sizeof(addr->sun_path))
+	{
+		LOG_ERROR_MSG("Socket path is too long: %s", file);
+		errno = ENAMETOOLONG;
+		return 1;
+	}
+	strcpy(addr->sun_path, file);
+	return 0;
+}
+
+/* Maps path of a socket to the file that backs it, which is a short alias in
+ * /tmp derived from the path if the path doesn't fit into an address (e.g.,
+ * because of long $TMPDIR).  All instances agree on the alias. */
+static void
+get_socket_file(const char path[], char buf[], size_t len)
+{
+	struct sockaddr_un addr;
+	if(strlen(path) < sizeof(addr.sun_path))
+	{
+		copy_str(buf, len, path);
+		return;
+	}
+
+	const hmap_key_t key = hmap_str_key(path, strlen(path));
+	snprintf(buf, len, "/tmp/" PREFIX "%lu-%016llx%016llx",
+			(unsigned long)getuid(), (unsigned long long)key.hi,
+			(unsigned long long)key.lo);
+}
+
+/* Removes file of a socket. */
+static void
+remove_socket(const char path[])
+{
+	char file[PATH_MAX + 1];
+	get_socket_file(path, file, sizeof(file));
+	(void)unlink(file);
+}
+
+/* Checks whether somebody listens on a socket or it's abandoned.  Returns
+ * non-zero if it's in use and zero otherwise. */
+static int
+socket_is_in_use(const char path[])
+{
+	const int fd = connect_to(path);
+	if(fd == -1)
+	{
+		return (errno != ECONNREFUSED && errno != ENOENT);
+	}
+
+	close(fd);
+	return 1;
+}
+
+/* Adds (add is non-zero) or removes entry of this process with specified name
+ * to/from the registry dropping entries of processes that are gone along the
+ * way.  Returns zero on success, otherwise non-zero is returned. */
+static int
+update_registry(const char name[], int add)
+{
+	int fd;
+	char *const registry = read_registry(1, &fd);
+	if(registry == NULL)
+	{
+		return 1;
+	}
+
+	char *updated = NULL;
+	size_t len = 0U;
+
+	char *line = registry;
+	while(line != NULL)
+	{
+		char *const eol = strchr(line, '\n');
+		if(eol != NULL)
+		{
+			*eol = '\0';
+		}
+
+		const char *const entry_name = parse_registry_entry(line);
+		if(entry_name != NULL && stroscmp(entry_name, name) != 0)
+		{
+			(void)strappend(&updated, &len, line);
+			(void)strappendch(&updated, &len, '\n');
+		}
+
+		line = (eol == NULL ? NULL : eol + 1);
+	}
+	free(registry);
+
+	if(add)
+	{
+		char entry[NAME_MAX + 32];
+		snprintf(entry, sizeof(entry), "%ld %s\n", (long)getpid(), name);
+		(void)strappend(&updated, &len, entry);
+	}
+
+	int ret = 0;
+	if(len != 0U && pwrite(fd, updated, len, 0) != (ssize_t)len)
+	{
+		ret = 1;
+	}
+	else if(ftruncate(fd, len) != 0)
+	{
+		ret = 1;
+	}
+
+	free(updated);
+	/* This also releases the lock. */
+	close(fd);
+	return ret;
+}
+
+/* Opens and locks the registry (for writing if for_write is non-zero) and reads
+ * its contents.  Missing registry is created if for_write is set.  Returns
+ * newly allocated string and sets *fd to locked descriptor, which should be
+ * closed by the caller, or returns NULL on error. */
+static char *
+read_registry(int for_write, int *fd)
+{
+	char path[PATH_MAX + 1];
+	get_registry_path(path, sizeof(path));
+
+	*fd = for_write ? open(path, O_RDWR | O_CREAT, 0600) : open(path, O_RDONLY);
+	if(*fd == -1)
+	{
+		return NULL;
+	}
+	(void)fcntl(*fd, F_SETFD, FD_CLOEXEC);
+
+	struct flock lock = {
+		.l_type = for_write ? F_WRLCK : F_RDLCK,
+		.l_whence = SEEK_SET,
+	};
+	int ret;
+	do
+	{
+		ret = fcntl(*fd, F_SETLKW, &lock);
+	}
+	while(ret == -1 && errno == EINTR);
+
+	size_t len = 0U;
+	char *contents = NULL;
+	if(ret == 0)
+	{
+		contents = malloc(1U);
+		while(contents != NULL)
+		{
+			char buf[4096];
+			const ssize_t n = read(*fd, buf, sizeof(buf));
+			if(n <= 0)
+			{
+				if(n < 0)
+				{
+					free(contents);
+					contents = NULL;
+				}
+				break;
+			}
+
+			char *const new_contents = realloc(contents, len + n + 1U);
+			if(new_contents == NULL)
+			{
+				free(contents);
+				contents = NULL;
+				break;
+			}
+			contents = new_contents;
+			memcpy(contents + len, buf, n);
+			len += n;
+		}
+	}
+
+	if(contents == NULL)
+	{
+		close(*fd);
+		return NULL;
+	}
+
+	contents[len] = '\0';
+	return contents;
+}
+
+/* Parses entry of the registry.  Returns pointer to the name within the line if
+ * the entry is valid and its process still exists, otherwise NULL is
+ * returned. */
+static const char *
+parse_registry_entry(const char line[])
+{
+	char *end;
+	const long pid = strtol(line, &end, 10);
+	if(end == line || pid <= 0 || *end != ' ' || end[1] == '\0')
+	{
+		return NULL;
+	}
+
+	if(kill((pid_t)pid, 0) != 0 && errno != EPERM)
+	{
+		return NULL;
+	}
+
+	return end + 1;
+}
+
+/* Formats path to the registry file of current user. */
+static void
+get_registry_path(char buf[], size_t len)
+{
+	snprintf(buf, len, "%s/" REGISTRY, get_ipc_dir(), (unsigned long)getuid());
+}
+
+#elif !defined(WIN32_PIPE_READ)
 
 /* Tries to open a pipe to check whether it has any readers or it's
  * abandoned.  Returns non-zero if somebody is reading from the pipe and zero
@@ -916,7 +2013,8 @@ ipc_list(int *len)
 }
 
 ipc_t *
-ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb)
+ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb,
+		ipc_batch_cb batch_cb)
 {
 	return NULL;
 }
@@ -950,6 +2048,13 @@ ipc_eval(ipc_t *ipc, const char whom[], const char expr[])
 	return NULL;
 }
 
+char **
+ipc_batch(ipc_t *ipc, const char whom[], char *items[], int nitems,
+		int timeout_ms)
+{
+	return NULL;
+}
+
 #endif
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
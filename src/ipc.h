@@ -32,6 +32,12 @@ typedef void (*ipc_args_cb)(char *args[]);
  * with the result or NULL on error. */
 typedef char * (*ipc_eval_cb)(const char expr[]);
 
+/* Type of function that is invoked when a batch is received.  items is an
+ * array of nitems commands and expressions (the latter start with "=").  Should
+ * return array of nitems newly allocated results (empty strings for commands,
+ * NULL for failed items) or NULL on error. */
+typedef char ** (*ipc_batch_cb)(char *items[], int nitems);
+
 /* Checks whether IPC is in use.  Returns non-zero if so, otherwise zero is
  * returned. */
 int ipc_enabled(void);
@@ -41,8 +47,10 @@ int ipc_enabled(void);
 char ** ipc_list(int *len);
 
 /* Initializes IPC unit state.  name can be NULL, which will use the default
- * one (VIFM).  Callbacks will be called on ipc_check(). */
-ipc_t * ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb);
+ * one (VIFM).  Callbacks will be called on ipc_check().  batch_cb can be NULL,
+ * batches are rejected then. */
+ipc_t * ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb,
+		ipc_batch_cb batch_cb);
 
 /* Frees resources associated with an instance of IPC.  The parameter can be
  * NULL. */
@@ -64,6 +72,14 @@ int ipc_send(ipc_t *ipc, const char whom[], char *data[]);
  * of ipc_send().  Returns result converted to a string or NULL on error. */
 char * ipc_eval(ipc_t *ipc, const char whom[], const char expr[]);
 
+/* Executes commands and evaluates expressions (prefixed with "=") in a remote
+ * instance as a single request.  Rules for whom argument match those of
+ * ipc_send().  nitems should be positive.  Waits for the reply up to
+ * timeout_ms milliseconds.  Returns array of nitems results (NULL elements
+ * correspond to failed items) or NULL on error. */
+char ** ipc_batch(ipc_t *ipc, const char whom[], char *items[], int nitems,
+		int timeout_ms);
+
 #endif /* VIFM__IPC_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -0,0 +1,75 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "perfstats_menu.h"
+
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strdup() */
+
+#include "../ui/ui.h"
+#include "../utils/perf.h"
+#include "../utils/string_array.h"
+#include "menus.h"
+
+int
+show_perfstats_menu(view_t *view)
+{
+	static menu_data_t m;
+
+	menus_init_data(&m, view,
+			strdup(perf_enabled() ? "Probe --- Statistics (collecting)"
+			                      : "Probe --- Statistics (not collecting)"),
+			NULL);
+
+	int i;
+	for(i = 0; i < PP_COUNT; ++i)
+	{
+		char item[128];
+		const perf_stats_t s = perf_get(i);
+
+		if(!perf_is_timed(i))
+		{
+			snprintf(item, sizeof(item), "%-12s %10llu events", perf_probe_name(i),
+					(unsigned long long)s.count);
+		}
+		else
+		{
+			const double avg_ms = (s.count == 0 ? 0 : s.total_ns/1e6/s.count);
+			snprintf(item, sizeof(item),
+					"%-12s %10llu calls  total %10.3f ms  avg %8.3f ms  max %8.3f ms",
+					perf_probe_name(i), (unsigned long long)s.count, s.total_ns/1e6,
+					avg_ms, s.max_ns/1e6);
+		}
+
+		m.len = add_to_string_array(&m.items, m.len, item);
+	}
+
+	const unsigned long long dropped = perf_dropped();
+	if(dropped != 0)
+	{
+		char item[64];
+		snprintf(item, sizeof(item), "(%llu events didn't fit into trace)",
+				dropped);
+		m.len = add_to_string_array(&m.items, m.len, item);
+	}
+
+	return menus_enter(m.state, view);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -30,6 +30,7 @@
 #include "../ui/ui.h"
 #include "../utils/log.h"
 #include "../utils/macros.h"
+#include "../compare.h"
 #include "../event_loop.h"
 #include "../status.h"
 #include "dialogs/attr_dialog.h"
@@ -139,6 +140,7 @@ modes_periodic(void)
 {
 	/* Trigger possible view updates. */
 	modview_check_for_updates();
+	compare_check_for_updates();
 }
 
 void
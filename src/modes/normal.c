@@ -70,6 +70,7 @@
 #include "../running.h"
 #include "../search.h"
 #include "../status.h"
+#include "../trash.h"
 #include "../types.h"
 #include "../undo.h"
 #include "../vifm.h"
@@ -690,7 +691,12 @@ cmd_ctrl_r(key_info_t key_info, keys_info_t *keys_info)
 
 	ui_sb_msg("Redoing...");
 
-	switch(un_group_redo())
+	/* Groups can move many files in and out of trash. */
+	trash_batch_start();
+	const UnErrCode err = un_group_redo();
+	trash_batch_finish();
+
+	switch(err)
 	{
 		case UN_ERR_SUCCESS:
 			ui_views_reload_visible_filelists();
@@ -1859,7 +1865,12 @@ cmd_u(key_info_t key_info, keys_info_t *keys_info)
 
 	ui_sb_msg("Undoing...");
 
-	switch(un_group_undo())
+	/* Groups can move many files in and out of trash. */
+	trash_batch_start();
+	const UnErrCode err = un_group_undo();
+	trash_batch_finish();
+
+	switch(err)
 	{
 		case UN_ERR_SUCCESS:
 			ui_views_reload_visible_filelists();
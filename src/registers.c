@@ -20,9 +20,10 @@
 #include "registers.h"
 
 #include <stddef.h>   /* NULL size_t */
+#include <stdint.h>   /* uint32_t */
 #include <stdio.h>    /* snprintf() */
-#include <string.h>   /* memmove() */
-#include <stdlib.h>   /* free */
+#include <string.h>   /* memcpy() memmove() memset() strdup() strlen() */
+#include <stdlib.h>   /* free() */
 
 #include <fcntl.h>    /* O_RDWR, O_EXCL, O_CREAT, ... */
 #include <unistd.h>   /* ftruncate */
@@ -65,10 +66,19 @@ const char valid_registers[] = {
  * uppercase registers (virtual ones) + termination null character. */
 ARRAY_GUARD(valid_registers, NUM_REGISTERS + NUM_LETTER_REGISTERS + 1);
 
+/* Version of layout of shared memory, should be changed on incompatible
+ * changes to it. */
+#define SHARED_LAYOUT_VERSION 2
+
+/* Each path of a register in shared memory is stored as its length (without
+ * any alignment) followed by the path and its terminating null character, so
+ * that entries can be walked and copied without measuring them. */
+typedef uint32_t entry_len_t;
+
 /* Describes register contents in a shared memory. */
 typedef struct
 {
-	unsigned int generation; /* Generation of the data. */
+	unsigned int generation; /* Generation at which the register was written. */
 	size_t num_entries;      /* Number of file paths in the register. */
 	size_t offset;           /* Offset of the first path. */
 	size_t length_used;      /* Length currently used. */
@@ -79,6 +89,9 @@ reg_metadata_t;
 /* Describes shared state. */
 typedef struct
 {
+	/* Version of the layout (SHARED_LAYOUT_VERSION). */
+	unsigned int layout;
+
 	/* Whether data is in consistent state.  Probably not bulletproof, but still
 	 * an attempt to avoid using broken data. */
 	int data_is_consistent;
@@ -87,7 +100,7 @@ typedef struct
 	 * shared_initial and shared_mmap_bytes. */
 	size_t size_backed;
 
-	unsigned int generation; /* Generation of the data. */
+	unsigned int generation; /* Generation of the data, bumped on every write. */
 	size_t length_area_used; /* Length without metadata. */
 
 	reg_metadata_t reg_metadata[NUM_REGISTERS]; /* BLACKHOLE, DEFAULT, a-z */
@@ -159,23 +172,30 @@ static char *shmem_raw;
 static shared_state_t *shmem;
 /* Last generation number that we've seen. */
 static unsigned int seen_generation;
+/* Generations of shared data which local registers correspond to. */
+static unsigned int reg_seen_generation[NUM_REGISTERS];
+/* Whether local registers were changed since they were last synchronized. */
+static char reg_dirty[NUM_REGISTERS];
 /* Whether we're in debug mode. */
 static int debug_print_to_stdout;
 
+static void mark_dirty(const reg_t *reg);
+static int path_ptr_cmp(const void *a, const void *b);
 static int find_in_reg(const reg_t *reg, const char file[]);
 static void regs_sync_error(const char msg[]);
 static int regs_sync_to_shared_memory_critical(void);
 static int regs_sync_enter_critical_section(void);
-static void regs_sync_rewrite_critical(void);
-static size_t regs_sync_store_register_contents_critical(size_t current_offset,
-	size_t reg_id);
-static size_t regs_sync_store_register_contents_in_place(size_t current_offset,
-	size_t reg_id);
+static int regs_sync_relayout_critical(size_t new_size_backed,
+		const size_t new_sizes[], unsigned int generation);
+static size_t regs_sync_serialized_size(const reg_t *reg);
+static size_t regs_sync_store_register(size_t offset, int reg_id,
+		unsigned int generation);
+static void regs_sync_load_register(int reg_id);
 static int regs_sync_resize_allocation(size_t newsz);
 static void regs_sync_leave_critical_section(void);
 TSTATIC int regs_sync_enabled(void);
 TSTATIC void regs_sync_debug_print_memory(void);
-static void regs_sync_debug_print_area(size_t offset, size_t length);
+static void regs_sync_debug_print_entries(int reg_id);
 TSTATIC void regs_sync_enable_test_mode(void);
 
 void
@@ -187,6 +207,7 @@ regs_init(void)
 		registers[i].name = valid_registers[i];
 		registers[i].nfiles = 0;
 		registers[i].files = NULL;
+		reg_dirty[i] = 1;
 	}
 }
 
@@ -242,9 +263,89 @@ regs_append(int reg_name, const char file[])
 	memmove(reg->files + pos + 1, reg->files + pos,
 			sizeof(*reg->files)*(nfiles - 1 - pos));
 	reg->files[pos] = file_copy;
+	mark_dirty(reg);
 	return 0;
 }
 
+int
+regs_append_many(int reg_name, char *files[], int nfiles)
+{
+	if(nfiles <= 0)
+	{
+		return 0;
+	}
+
+	reg_t *reg = (reg_name == BLACKHOLE_REG_NAME ? NULL : regs_find(reg_name));
+	if(reg == NULL)
+	{
+		free_strings(files, nfiles);
+		return 0;
+	}
+
+	char **sorted = reallocarray(NULL, nfiles, sizeof(*sorted));
+	char **merged = reallocarray(NULL, reg->nfiles + nfiles, sizeof(*merged));
+	if(sorted == NULL || merged == NULL)
+	{
+		free(sorted);
+		free(merged);
+		free_strings(files, nfiles);
+		return 0;
+	}
+
+	memcpy(sorted, files, sizeof(*sorted)*nfiles);
+	safe_qsort(sorted, nfiles, sizeof(*sorted), &path_ptr_cmp);
+
+	/* Both lists are sorted, so a single merge pass is enough.  Duplicates are
+	 * always adjacent to the last added element. */
+	int i = 0, j = 0, n = 0, added = 0;
+	while(i < reg->nfiles || j < nfiles)
+	{
+		if(j < nfiles && n > 0 && stroscmp(merged[n - 1], sorted[j]) == 0)
+		{
+			free(sorted[j++]);
+			continue;
+		}
+
+		if(j == nfiles || (i < reg->nfiles &&
+					stroscmp(reg->files[i], sorted[j]) <= 0))
+		{
+			merged[n++] = reg->files[i++];
+			continue;
+		}
+
+		merged[n++] = sorted[j++];
+		++added;
+	}
+
+	free(sorted);
+	free(reg->files);
+	reg->files = merged;
+	reg->nfiles = n;
+
+	if(added != 0)
+	{
+		mark_dirty(reg);
+	}
+	return added;
+}
+
+/* Remembers that register needs to be synchronized. */
+static void
+mark_dirty(const reg_t *reg)
+{
+	reg_dirty[reg - registers] = 1;
+}
+
+/* qsort() comparer for pointers to paths.  Returns standard -1, 0, 1 for
+ * comparisons. */
+static int
+path_ptr_cmp(const void *a, const void *b)
+{
+	const char *const *const path_a = a;
+	const char *const *const path_b = b;
+	return stroscmp(*path_a, *path_b);
+}
+
 void
 regs_reset(void)
 {
@@ -267,6 +368,7 @@ regs_clear(int reg_name)
 	free_string_array(reg->files, reg->nfiles);
 	reg->files = NULL;
 	reg->nfiles = 0;
+	mark_dirty(reg);
 }
 
 void
@@ -288,6 +390,7 @@ regs_pack(int reg_name)
 		}
 	}
 	reg->nfiles = j;
+	mark_dirty(reg);
 }
 
 char **
@@ -328,11 +431,15 @@ regs_rename_contents(const char old[], const char new[])
 	for(i = 0; i < NUM_REGISTERS; ++i)
 	{
 		/* Registers don't contain duplicates, so updating single element is
-		 * enough. */
+		 * enough.  Changing it in place would break the order of the register, so
+		 * it's reinserted. */
 		const int pos = find_in_reg(&registers[i], old);
 		if(pos >= 0)
 		{
-			(void)replace_string(&registers[i].files[pos], new);
+			remove_from_string_array(registers[i].files, registers[i].nfiles, pos);
+			--registers[i].nfiles;
+			mark_dirty(&registers[i]);
+			(void)regs_append(registers[i].name, new);
 		}
 	}
 }
@@ -489,9 +596,13 @@ regs_sync_enable(const char shared_memory_name[])
 	if(shmem_created_by_us(shmem_obj))
 	{
 		seen_generation = shmem->generation;
+		shmem->layout = SHARED_LAYOUT_VERSION;
 		shmem->data_is_consistent = 0;
 		shmem->size_backed = shared_initial;
 
+		/* Everything needs to be written. */
+		memset(reg_dirty, 1, sizeof(reg_dirty));
+
 		if(!regs_sync_to_shared_memory_critical())
 		{
 			shmem_destroy(shmem_obj);
@@ -501,6 +612,19 @@ regs_sync_enable(const char shared_memory_name[])
 			return;
 		}
 	}
+	else if(shmem->layout != SHARED_LAYOUT_VERSION)
+	{
+		/* Disabling will unlock the mutex. */
+		regs_sync_disable();
+		regs_sync_error("Shared memory is in use by an incompatible version.");
+		return;
+	}
+	else
+	{
+		/* Everything needs to be read. */
+		seen_generation = shmem->generation - 1;
+		memset(reg_seen_generation, 0, sizeof(reg_seen_generation));
+	}
 
 	regs_sync_leave_critical_section();
 }
@@ -541,93 +665,92 @@ regs_sync_to_shared_memory(void)
 	}
 }
 
-/* Puts contents of our registers into shared memory.  Returns 1 on success, 0
- * on failure (cleans up as needed on fail). */
+/* Puts contents of registers changed since last synchronization into shared
+ * memory.  Returns 1 on success, 0 on failure (cleans up as needed on fail). */
 static int
 regs_sync_to_shared_memory_critical(void)
 {
-	shmem->data_is_consistent = 0;
-	seen_generation = ++shmem->generation;
-
-	/* Determine memory requirements for state to be synchronized. */
-	size_t new_register_sizes_total = 0;
-	size_t new_register_sizes[NUM_REGISTERS];
+	/* Determine memory requirements for state to be synchronized, only changed
+	 * registers need to be measured. */
+	size_t new_sizes[NUM_REGISTERS];
+	size_t total_size = 0;
+	size_t size_not_fit_to_existing = 0;
+	int ndirty = 0;
 
 	int i;
-	int j;
-
 	for(i = 0; i < NUM_REGISTERS; ++i)
 	{
-		new_register_sizes[i] = 0;
-		for(j = 0; j < registers[i].nfiles; ++j)
+		const reg_metadata_t *const md = &shmem->reg_metadata[i];
+		if(reg_dirty[i])
 		{
-			/* +1 to count the 0 terminator byte. */
-			new_register_sizes[i] += strlen(registers[i].files[j]) + 1;
+			new_sizes[i] = regs_sync_serialized_size(&registers[i]);
+			if(new_sizes[i] > md->length_available)
+			{
+				size_not_fit_to_existing += new_sizes[i];
+			}
+			++ndirty;
+		}
+		else
+		{
+			new_sizes[i] = md->length_used;
 		}
-		new_register_sizes_total += new_register_sizes[i];
+		total_size += new_sizes[i];
 	}
 
-	/* Check which registers grow over their currently available space. */
-	size_t size_not_fit_to_existing = 0;
-	for(i = 0; i < NUM_REGISTERS; ++i)
+	if(ndirty == 0)
 	{
-		if(new_register_sizes[i] > shmem->reg_metadata[i].length_available)
-		{
-			size_not_fit_to_existing += new_register_sizes[i];
-		}
+		return 1;
 	}
 
-	if(size_not_fit_to_existing <= shmem->size_backed - SHARED_ALL_METADATA_SIZE -
+	shmem->data_is_consistent = 0;
+	const unsigned int generation = ++shmem->generation;
+	if(seen_generation + 1 == generation)
+	{
+		/* We were up to date before writing. */
+		seen_generation = generation;
+	}
+
+	const size_t halved_size = shmem->size_backed/2;
+	if(total_size < halved_size - SHARED_ALL_METADATA_SIZE &&
+			shmem->size_backed > shared_initial)
+	{
+		return regs_sync_relayout_critical(halved_size, new_sizes, generation);
+	}
+
+	if(size_not_fit_to_existing > shmem->size_backed - SHARED_ALL_METADATA_SIZE -
 			shmem->length_area_used)
 	{
-		const size_t halved_size = shmem->size_backed/2;
-		if(new_register_sizes_total < (halved_size - SHARED_ALL_METADATA_SIZE)
-				&& shmem->size_backed > shared_initial)
-		{
-			/* Halve allocation size. */
-			if(!regs_sync_resize_allocation(halved_size))
-			{
-				return 0;
-			}
-			regs_sync_rewrite_critical();
-		}
-		else
-		{
-			size_t offset = SHARED_ALL_METADATA_SIZE + shmem->length_area_used;
-			for(i = 0; i < NUM_REGISTERS; ++i)
-			{
-				if(new_register_sizes[i] >
-						shmem->reg_metadata[i].length_available)
-				{
-					/* Append at the end. */
-					offset = regs_sync_store_register_contents_critical(offset, i);
-				}
-				else
-				{
-					/* Update in place. */
-					regs_sync_store_register_contents_in_place(
-						shmem->reg_metadata[i].offset, i);
-				}
-			}
-			shmem->length_area_used = offset - SHARED_ALL_METADATA_SIZE;
-		}
-	} else {
 		/* Double allocation size till fit. */
 		size_t new_size_backed = shmem->size_backed;
-		while(new_register_sizes_total >
-				(new_size_backed - SHARED_ALL_METADATA_SIZE))
+		while(total_size > new_size_backed - SHARED_ALL_METADATA_SIZE)
 		{
 			new_size_backed *= 2;
 		}
+		return regs_sync_relayout_critical(new_size_backed, new_sizes, generation);
+	}
 
-		if(new_size_backed != shmem->size_backed &&
-				!regs_sync_resize_allocation(new_size_backed))
+	size_t offset = SHARED_ALL_METADATA_SIZE + shmem->length_area_used;
+	for(i = 0; i < NUM_REGISTERS; ++i)
+	{
+		reg_metadata_t *const md = &shmem->reg_metadata[i];
+		if(!reg_dirty[i])
 		{
-			return 0;
+			continue;
 		}
 
-		regs_sync_rewrite_critical();
+		if(new_sizes[i] > md->length_available)
+		{
+			/* Append at the end. */
+			offset = regs_sync_store_register(offset, i, generation);
+			md->length_available = md->length_used;
+		}
+		else
+		{
+			/* Update in place. */
+			(void)regs_sync_store_register(md->offset, i, generation);
+		}
 	}
+	shmem->length_area_used = offset - SHARED_ALL_METADATA_SIZE;
 
 	return 1;
 }
@@ -652,50 +775,145 @@ regs_sync_enter_critical_section(void)
 	return 1;
 }
 
-/* Rewrites shared memory from scratch. */
-static void
-regs_sync_rewrite_critical(void)
+/* Lays out registers in shared memory anew after resizing it.  Registers that
+ * didn't change are moved as is.  Returns 1 on success, 0 on failure. */
+static int
+regs_sync_relayout_critical(size_t new_size_backed, const size_t new_sizes[],
+		unsigned int generation)
 {
+	size_t kept_size = 0;
+	int i;
+	for(i = 0; i < NUM_REGISTERS; ++i)
+	{
+		kept_size += (reg_dirty[i] ? 0 : new_sizes[i]);
+	}
+
+	/* Save contents which is going to be overwritten or cut off. */
+	char *const kept = malloc(kept_size + 1);
+	if(kept == NULL)
+	{
+		regs_sync_error("Not enough memory to rearrange shared memory.");
+		return 0;
+	}
+
+	size_t pos = 0;
+	for(i = 0; i < NUM_REGISTERS; ++i)
+	{
+		if(!reg_dirty[i])
+		{
+			memcpy(kept + pos, shmem_raw + shmem->reg_metadata[i].offset,
+					new_sizes[i]);
+			pos += new_sizes[i];
+		}
+	}
+
+	if(new_size_backed != shmem->size_backed &&
+			!regs_sync_resize_allocation(new_size_backed))
+	{
+		free(kept);
+		return 0;
+	}
+
 	/* Assumption: enough space in shared memory. */
 	size_t offset = SHARED_ALL_METADATA_SIZE;
-	int i;
+	pos = 0;
 	for(i = 0; i < NUM_REGISTERS; ++i)
 	{
-		offset = regs_sync_store_register_contents_critical(offset, i);
+		reg_metadata_t *const md = &shmem->reg_metadata[i];
+		if(reg_dirty[i])
+		{
+			offset = regs_sync_store_register(offset, i, generation);
+		}
+		else
+		{
+			memcpy(shmem_raw + offset, kept + pos, new_sizes[i]);
+			pos += new_sizes[i];
+			md->offset = offset;
+			offset += new_sizes[i];
+		}
+		md->length_available = md->length_used;
 	}
 	shmem->length_area_used = offset - SHARED_ALL_METADATA_SIZE;
+
+	free(kept);
+	return 1;
 }
 
-/* Dumps contents of a register into shared memory at specified offset anew.
- * Returns new offset. */
+/* Computes size of register contents in shared memory.  Returns the size. */
 static size_t
-regs_sync_store_register_contents_critical(size_t current_offset, size_t reg_id)
+regs_sync_serialized_size(const reg_t *reg)
 {
-	const size_t new_offset =
-		regs_sync_store_register_contents_in_place(current_offset, reg_id);
-	shmem->reg_metadata[reg_id].length_available =
-		shmem->reg_metadata[reg_id].length_used;
-	return new_offset;
+	size_t size = 0;
+	int i;
+	for(i = 0; i < reg->nfiles; ++i)
+	{
+		/* +1 to count the 0 terminator byte. */
+		size += sizeof(entry_len_t) + strlen(reg->files[i]) + 1;
+	}
+	return size;
 }
 
-/* Dumps contents of a register into shared memory at specified offset.
- * Returns new offset. */
+/* Dumps contents of a register into shared memory at specified offset marking
+ * it as synchronized.  Returns new offset. */
 static size_t
-regs_sync_store_register_contents_in_place(size_t current_offset, size_t reg_id)
+regs_sync_store_register(size_t offset, int reg_id, unsigned int generation)
 {
+	const reg_t *const reg = &registers[reg_id];
+	reg_metadata_t *const md = &shmem->reg_metadata[reg_id];
+
+	md->generation = generation;
+	md->num_entries = reg->nfiles;
+	md->offset = offset;
+
 	int i;
-	shmem->reg_metadata[reg_id].generation  = seen_generation;
-	shmem->reg_metadata[reg_id].num_entries = registers[reg_id].nfiles;
-	shmem->reg_metadata[reg_id].offset      = current_offset;
-	for(i = 0; i < registers[reg_id].nfiles; ++i)
+	for(i = 0; i < reg->nfiles; ++i)
 	{
-		const size_t entry_len = strlen(registers[reg_id].files[i]) + 1;
-		memcpy(shmem_raw + current_offset, registers[reg_id].files[i], entry_len);
-		current_offset += entry_len;
+		const entry_len_t len = strlen(reg->files[i]);
+		memcpy(shmem_raw + offset, &len, sizeof(len));
+		offset += sizeof(len);
+		memcpy(shmem_raw + offset, reg->files[i], len + 1);
+		offset += len + 1;
 	}
-	shmem->reg_metadata[reg_id].length_used =
-		current_offset - shmem->reg_metadata[reg_id].offset;
-	return current_offset;
+	md->length_used = offset - md->offset;
+
+	reg_dirty[reg_id] = 0;
+	reg_seen_generation[reg_id] = generation;
+	return offset;
+}
+
+/* Replaces contents of a register with its contents in shared memory.  Paths
+ * are copied because other instances can change the memory once it's
+ * unlocked. */
+static void
+regs_sync_load_register(int reg_id)
+{
+	reg_t *const reg = &registers[reg_id];
+	const reg_metadata_t *const md = &shmem->reg_metadata[reg_id];
+
+	free_string_array(reg->files, reg->nfiles);
+	reg->nfiles = 0;
+	reg->files = reallocarray(NULL, md->num_entries, sizeof(*reg->files));
+
+	const char *entry = shmem_raw + md->offset;
+	size_t i;
+	for(i = 0; i < md->num_entries && reg->files != NULL; ++i)
+	{
+		entry_len_t len;
+		memcpy(&len, entry, sizeof(len));
+		entry += sizeof(len);
+
+		char *const path = malloc(len + 1);
+		if(path == NULL)
+		{
+			break;
+		}
+		memcpy(path, entry, len + 1);
+		reg->files[reg->nfiles++] = path;
+		entry += len + 1;
+	}
+
+	reg_dirty[reg_id] = 0;
+	reg_seen_generation[reg_id] = md->generation;
 }
 
 /* Changes size of shared area.  Returns 1 on success, 0 on failure (performs
@@ -740,23 +958,9 @@ regs_sync_from_shared_memory(void)
 		int i;
 		for(i = 0; i < NUM_REGISTERS; ++i)
 		{
-			if(shmem->reg_metadata[i].generation != seen_generation)
+			if(shmem->reg_metadata[i].generation != reg_seen_generation[i])
 			{
-				free_string_array(registers[i].files, registers[i].nfiles);
-
-				registers[i].nfiles = shmem->reg_metadata[i].num_entries;
-				registers[i].files = reallocarray(NULL, registers[i].nfiles,
-						sizeof(char *));
-
-				int j;
-				const char *curstrptr = shmem_raw + shmem->reg_metadata[i].offset;
-				for(j = 0; j < registers[i].nfiles; ++j)
-				{
-					size_t curlen = strlen(curstrptr) + 1;
-					registers[i].files[j] = malloc(curlen);
-					memcpy(registers[i].files[j], curstrptr, curlen);
-					curstrptr += curlen;
-				}
+				regs_sync_load_register(i);
 			}
 		}
 		seen_generation = shmem->generation;
@@ -780,8 +984,9 @@ regs_sync_debug_print_memory(void)
 	printf("| local\n");
 	for(i = 0; i < NUM_REGISTERS; ++i)
 	{
-		printf("| | register %2d name=%c, nfiles=%d, files=\n", i,
-			registers[i].name, registers[i].nfiles);
+		printf("| | register %2d name=%c, nfiles=%d, dirty=%d, seen_generation=%u, "
+			"files=\n", i, registers[i].name, registers[i].nfiles, reg_dirty[i],
+			reg_seen_generation[i]);
 
 		int j;
 		for(j = 0; j < registers[i].nfiles; ++j)
@@ -808,38 +1013,26 @@ regs_sync_debug_print_memory(void)
 				(int)shmem->reg_metadata[i].length_used,
 				(int)shmem->reg_metadata[i].length_available
 			);
-			printf("| | | used  =");
-			regs_sync_debug_print_area(shmem->reg_metadata[i].offset,
-				shmem->reg_metadata[i].length_used);
-			printf("| | | unused=");
-			regs_sync_debug_print_area(
-				shmem->reg_metadata[i].length_used,
-				shmem->reg_metadata[i].length_available -
-					shmem->reg_metadata[i].length_used
-			);
+			regs_sync_debug_print_entries(i);
 		}
 	}
 	printf("-- END   VIFM shared memory synchronization DUMP --\n");
 }
 
-/* Dumps region of shared memory to stdout. */
+/* Dumps entries of a register in shared memory to stdout. */
 static void
-regs_sync_debug_print_area(size_t offset, size_t length)
+regs_sync_debug_print_entries(int reg_id)
 {
+	const reg_metadata_t *const md = &shmem->reg_metadata[reg_id];
+	const char *entry = shmem_raw + md->offset;
 	size_t i;
-	for(i = 0; i < length; ++i)
+	for(i = 0; i < md->num_entries; ++i)
 	{
-		const char val = shmem_raw[offset + i];
-		if(val == 0)
-		{
-			printf("(0)");
-		}
-		else
-		{
-			putchar(val);
-		}
+		entry_len_t len;
+		memcpy(&len, entry, sizeof(len));
+		printf("| | | %s\n", entry + sizeof(len));
+		entry += sizeof(len) + len + 1;
 	}
-	putchar('\n');
 }
 
 TSTATIC void
@@ -62,6 +62,13 @@ reg_t * regs_find(int reg_name);
  * is added, otherwise non-zero is returned. */
 int regs_append(int reg_name, const char file[]);
 
+/* Appends multiple paths to register specified by name at once.  It's much
+ * cheaper than calling regs_append() for each path as the list is sorted and
+ * merged into the register only once.  Paths that are already in the register
+ * or repeat in the list are skipped.  Takes ownership of the strings (but not
+ * of the array).  Returns number of added paths. */
+int regs_append_many(int reg_name, char *files[], int nfiles);
+
 /* Clears all registers.  Pair of regs_init(). */
 void regs_reset(void);
 
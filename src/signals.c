@@ -138,6 +138,7 @@ shutdown_nicely(int sig, const char descr[])
 	fuse_unmount_all();
 	state_store();
 	vcache_finish();
+	(void)dcache_save();
 	fprintf(stdout, "Vifm killed by signal: %d (%s).\n", sig, descr);
 
 	/* Alternatively we could do this sequence:
@@ -33,6 +33,7 @@
 #include "utils/fs.h"
 #include "utils/fsdata.h"
 #include "utils/path.h"
+#include "utils/perf.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
@@ -43,6 +44,7 @@
 #include "status.h"
 #include "types.h"
 
+static void sort_view_internal(view_t *v);
 static void sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
 		size_t nchildren, int root);
 static void sort_sequence(dir_entry_t *entries, size_t nentries);
@@ -85,6 +87,15 @@ static void *sort_data;
 
 void
 sort_view(view_t *v)
+{
+	const uint64_t start = perf_begin();
+	sort_view_internal(v);
+	perf_end(PP_SORT, start);
+}
+
+/* Implementation of sort_view(). */
+static void
+sort_view_internal(view_t *v)
 {
 	dir_entry_t *unsorted_list;
 
@@ -0,0 +1,187 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "startup.h"
+
+#include <sys/stat.h> /* stat */
+
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fprintf() snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() timespec */
+
+#include "compat/fs_limits.h"
+#include "compat/os.h"
+#include "compat/pthread.h"
+#include "utils/path.h"
+#include "utils/utils.h"
+
+static void * prefetch_thread(void *arg);
+static void report(const char stage[], uint64_t start, uint64_t end);
+static uint64_t now(void);
+
+/* Protects all state below. */
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+/* File to report to or NULL if reporting is disabled. */
+static FILE *report_file;
+/* Moment at which reporting started. */
+static uint64_t report_start;
+/* Moment at which the last stage was finished. */
+static uint64_t last_mark;
+
+int
+startup_time_open(const char path[])
+{
+	FILE *const fp = os_fopen(path, "a");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	fprintf(fp, "\n\ntimes in msec\n"
+	            " clock   elapsed: stage\n"
+	            "\n");
+
+	pthread_mutex_lock(&report_lock);
+	report_file = fp;
+	report_start = now();
+	last_mark = report_start;
+	pthread_mutex_unlock(&report_lock);
+
+	startup_time_mark("--- VIFM STARTING ---");
+	return 0;
+}
+
+void
+startup_time_mark(const char stage[])
+{
+	pthread_mutex_lock(&report_lock);
+	if(report_file != NULL)
+	{
+		const uint64_t end = now();
+		report(stage, last_mark, end);
+		last_mark = end;
+	}
+	pthread_mutex_unlock(&report_lock);
+}
+
+void
+startup_time_close(void)
+{
+	startup_time_mark("--- VIFM STARTED ---");
+
+	pthread_mutex_lock(&report_lock);
+	if(report_file != NULL)
+	{
+		fclose(report_file);
+		report_file = NULL;
+	}
+	pthread_mutex_unlock(&report_lock);
+}
+
+void
+startup_prefetch_dir(const char path[])
+{
+	char *const dir = strdup(path);
+	if(dir == NULL)
+	{
+		return;
+	}
+
+	pthread_t id;
+	if(pthread_create(&id, NULL, &prefetch_thread, dir) != 0)
+	{
+		free(dir);
+	}
+}
+
+/* Entry point of a thread that reads directory.  Takes ownership of the arg,
+ * which is path to the directory. */
+static void *
+prefetch_thread(void *arg)
+{
+	char *const dir = arg;
+
+	(void)pthread_detach(pthread_self());
+	block_all_thread_signals();
+
+	const uint64_t start = now();
+
+	int nentries = 0;
+	DIR *const d = os_opendir(dir);
+	if(d != NULL)
+	{
+		struct dirent *entry;
+		while((entry = os_readdir(d)) != NULL)
+		{
+			if(is_builtin_dir(entry->d_name))
+			{
+				continue;
+			}
+
+			/* Results aren't needed, views will query the same information from
+			 * caches of the OS. */
+			char full_path[PATH_MAX + 1];
+			struct stat st;
+			snprintf(full_path, sizeof(full_path), "%s/%s", dir, entry->d_name);
+			(void)os_lstat(full_path, &st);
+			++nentries;
+		}
+		os_closedir(d);
+	}
+
+	char stage[PATH_MAX + 64];
+	snprintf(stage, sizeof(stage), "[thread] prefetched %d entries of %s",
+			nentries, dir);
+
+	pthread_mutex_lock(&report_lock);
+	if(report_file != NULL)
+	{
+		report(stage, start, now());
+	}
+	pthread_mutex_unlock(&report_lock);
+
+	free(dir);
+	return NULL;
+}
+
+/* Writes line about a stage to the report.  Must be called with report_lock
+ * held. */
+static void
+report(const char stage[], uint64_t start, uint64_t end)
+{
+	const uint64_t clock_us = (end - report_start)/1000U;
+	const uint64_t elapsed_us = (end - start)/1000U;
+	fprintf(report_file, "%03d.%03d  %03d.%03d: %s\n",
+			(int)(clock_us/1000U), (int)(clock_us%1000U),
+			(int)(elapsed_us/1000U), (int)(elapsed_us%1000U), stage);
+}
+
+/* Retrieves current monotonic time.  Returns the time in nanoseconds. */
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000U + ts.tv_nsec;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
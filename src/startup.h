@@ -0,0 +1,47 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__STARTUP_H__
+#define VIFM__STARTUP_H__
+
+/* startup - support for making startup faster and for seeing where its time
+ * goes.  Directories of views can be read by worker threads while the main
+ * thread is busy with configuration and terminal, this fills caches of the OS
+ * (which matters the most for network file systems) for the time views load
+ * their lists.  Stages of startup can be timed and reported to a file. */
+
+/* Starts reporting of startup time to the file, whose previous contents is
+ * preserved.  Returns zero on success, otherwise non-zero is returned. */
+int startup_time_open(const char path[]);
+
+/* Records end of a stage of startup, which started at the end of the previous
+ * one.  Does nothing if reporting isn't enabled. */
+void startup_time_mark(const char stage[]);
+
+/* Finishes reporting of startup time.  Does nothing if reporting isn't
+ * enabled.  Work of unfinished threads isn't reported. */
+void startup_time_close(void);
+
+/* Starts reading listing and information about files of the directory on a
+ * separate thread.  Failure to do so isn't an error. */
+void startup_prefetch_dir(const char path[]);
+
+#endif /* VIFM__STARTUP_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
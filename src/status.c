@@ -30,22 +30,28 @@
 
 #include <assert.h> /* assert() */
 #include <limits.h> /* INT_MIN */
-#include <stddef.h> /* NULL */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* int64_t uint32_t uint64_t */
+#include <stdio.h> /* FILE fclose() fread() fwrite() remove() snprintf() */
+#include <stdlib.h> /* free() */
 #include <string.h>
 #include <time.h> /* time_t time() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
+#include "compat/os.h"
 #include "compat/pthread.h"
 #include "compat/reallocarray.h"
 #include "modes/modes.h"
 #include "ui/colors.h"
 #include "ui/ui.h"
 #include "utils/env.h"
-#include "utils/fsdata.h"
+#include "utils/fs.h"
+#include "utils/hmap.h"
 #include "utils/log.h"
 #include "utils/macros.h"
 #include "utils/path.h"
+#include "utils/seqmap.h"
 #include "utils/str.h"
 #include "utils/utils.h"
 #include "cmd_completion.h"
@@ -59,6 +65,12 @@
 #define SCREEN_ENVVAR "STY"
 #define TMUX_ENVVAR "TMUX"
 
+/* Identifies format of dcache file. */
+#define DCACHE_MAGIC "VIFMDCH1"
+
+/* Maximum number of records to keep in dcache file. */
+#define DCACHE_MAX_RECORDS (1024*1024)
+
 /* dcache entry. */
 typedef struct
 {
@@ -70,6 +82,50 @@ typedef struct
 }
 dcache_data_t;
 
+/* Record of dcache, its halves are set independently. */
+typedef struct
+{
+	dcache_data_t size;   /* Size of a directory. */
+	dcache_data_t nitems; /* Number of items in a directory. */
+}
+dcache_rec_t;
+
+/* Header of dcache file. */
+typedef struct
+{
+	char magic[8];     /* Must be equal to DCACHE_MAGIC. */
+	uint32_t rec_size; /* Size of a record to detect layout changes. */
+	uint32_t count;    /* Number of records that follow the header. */
+}
+dcache_header_t;
+
+/* dcache_data_t as it's stored in a file. */
+typedef struct
+{
+	uint64_t value;    /* Stored value. */
+	uint64_t inode;    /* Inode number. */
+	int64_t timestamp; /* When the value was set. */
+}
+dcache_file_data_t;
+
+/* Record of dcache file. */
+typedef struct
+{
+	hmap_key_t key;            /* Key of the path. */
+	dcache_file_data_t size;   /* Size of a directory. */
+	dcache_file_data_t nitems; /* Number of items in a directory. */
+}
+dcache_file_rec_t;
+
+/* List of records of dcache file. */
+typedef struct
+{
+	dcache_file_rec_t *recs; /* Records. */
+	size_t count;            /* Number of records. */
+	size_t capacity;         /* Number of allocated records. */
+}
+dcache_file_recs_t;
+
 static void load_def_values(status_t *stats, config_t *config);
 static void determine_fuse_umount_cmd(status_t *stats);
 static void set_gtk_available(status_t *stats);
@@ -77,7 +133,19 @@ static int reset_dircache(void);
 static void set_last_cmdline_command(const char cmd[]);
 static void dcache_get(const char path[], time_t mtime, uint64_t inode,
 		dcache_result_t *size, dcache_result_t *nitems);
-static void size_updater(void *data, void *arg);
+static void dcache_load(void);
+static void read_dcache_file(const char path[]);
+static void loaded_rec_updater(void *data, int created, void *arg);
+static int write_dcache_file(FILE *fp, const dcache_file_rec_t recs[],
+		size_t count);
+static void collect_rec(hmap_key_t key, const void *rec, void *arg);
+static int newer_rec_first(const void *a, const void *b);
+static void fill_dcache_result(const dcache_data_t *data, time_t mtime,
+		uint64_t inode, dcache_result_t *result);
+static void size_updater(void *data, int created, void *arg);
+static void rec_updater(void *data, int created, void *arg);
+static hmap_key_t get_path_key(const char path[], size_t len);
+static int is_root_prefix(const char path[], size_t len);
 
 status_t curr_stats;
 
@@ -89,14 +157,16 @@ static int pending_refresh;
 static int inside_screen;
 static int inside_tmux;
 
-/* Thread-safety guard for dcache_size variable. */
-static pthread_mutex_t dcache_size_mutex = PTHREAD_MUTEX_INITIALIZER;
-/* Thread-safety guard for dcache_nitems variable. */
-static pthread_mutex_t dcache_nitems_mutex = PTHREAD_MUTEX_INITIALIZER;
-/* Cache for directory sizes. */
-static fsdata_t *dcache_size;
-/* Cache for directory item count. */
-static fsdata_t *dcache_nitems;
+/* Cache for directory sizes and item counts keyed by resolved paths.  It's
+ * queried while drawing views and reading never waits for background jobs that
+ * update it. */
+static seqmap_t *dcache;
+/* Thread-safety guard for loading dcache from a file. */
+static pthread_mutex_t dcache_load_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Whether dcache was populated from its file. */
+static int dcache_loaded;
+/* Whether dcache has changes that aren't written to its file. */
+static int dcache_changed;
 
 /* Whether UI updates should be "paused" (a counter, not a flag). */
 static int silent_ui;
@@ -254,13 +324,11 @@ stats_reset(const config_t *config)
 static int
 reset_dircache(void)
 {
-	fsdata_free(dcache_size);
-	dcache_size = fsdata_create(0, 1);
-
-	fsdata_free(dcache_nitems);
-	dcache_nitems = fsdata_create(0, 1);
-
-	return (dcache_size == NULL || dcache_nitems == NULL);
+	seqmap_free(dcache);
+	dcache = seqmap_create(sizeof(dcache_rec_t));
+	dcache_loaded = 0;
+	dcache_changed = 0;
+	return (dcache == NULL);
 }
 
 void
@@ -459,6 +527,20 @@ stats_silence_ui(int more)
 	}
 }
 
+void
+stats_silence_ui_end_later(void)
+{
+	if(--silent_ui <= 0)
+	{
+		silent_ui = 0;
+		if(silence_skipped_updates)
+		{
+			silence_skipped_updates = 0;
+			pending_redraw = 1;
+		}
+	}
+}
+
 int
 stats_silenced_ui(void)
 {
@@ -589,92 +671,369 @@ dcache_get(const char path[], time_t mtime, uint64_t inode,
 	{
 		size->value = DCACHE_UNKNOWN;
 		size->is_valid = 0;
-
-		pthread_mutex_lock(&dcache_size_mutex);
-		dcache_data_t size_data;
-		if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
-		{
-			size->value = size_data.value;
-			/* We check strictly for less than to handle scenario when multiple
-			 * changes occurred during the same second. */
-			size->is_valid = (mtime < size_data.timestamp);
-#ifndef _WIN32
-			size->is_valid &= (inode == size_data.inode);
-#endif
-		}
-		pthread_mutex_unlock(&dcache_size_mutex);
 	}
-
 	if(nitems != NULL)
 	{
 		nitems->value = DCACHE_UNKNOWN;
 		nitems->is_valid = 0;
+	}
 
-		pthread_mutex_lock(&dcache_nitems_mutex);
-		dcache_data_t nitems_data;
-		if(fsdata_get(dcache_nitems, path, &nitems_data, sizeof(nitems_data)) == 0)
-		{
-			nitems->value = nitems_data.value;
-			/* We check strictly for less than to handle scenario when multiple
-			 * changes occurred during the same second. */
-			nitems->is_valid = (mtime < nitems_data.timestamp);
+	char real_path[PATH_MAX + 1];
+	if(os_realpath(path, real_path) != real_path)
+	{
+		return;
+	}
+
+	dcache_load();
+
+	dcache_rec_t rec;
+	if(seqmap_get(dcache, get_path_key(real_path, strlen(real_path)), &rec) != 0)
+	{
+		return;
+	}
+
+	if(size != NULL)
+	{
+		fill_dcache_result(&rec.size, mtime, inode, size);
+	}
+	if(nitems != NULL)
+	{
+		fill_dcache_result(&rec.nitems, mtime, inode, nitems);
+	}
+}
+
+/* Fills result of a query from cached data checking whether it's outdated. */
+static void
+fill_dcache_result(const dcache_data_t *data, time_t mtime, uint64_t inode,
+		dcache_result_t *result)
+{
+	result->value = data->value;
+	/* We check strictly for less than to handle scenario when multiple changes
+	 * occurred during the same second. */
+	result->is_valid = (mtime < data->timestamp);
 #ifndef _WIN32
-			nitems->is_valid &= (inode == nitems_data.inode);
+	result->is_valid &= (inode == data->inode);
 #endif
-		}
-		pthread_mutex_unlock(&dcache_nitems_mutex);
-	}
 }
 
 void
 dcache_update_parent_sizes(const char path[], uint64_t by)
 {
-	pthread_mutex_lock(&dcache_size_mutex);
-	(void)fsdata_map_parents(dcache_size, path, &size_updater, &by);
-	pthread_mutex_unlock(&dcache_size_mutex);
+	char real_path[PATH_MAX + 1];
+	if(os_realpath(path, real_path) != real_path || is_root_dir(real_path))
+	{
+		return;
+	}
+
+	dcache_load();
+	__atomic_store_n(&dcache_changed, 1, __ATOMIC_RELAXED);
+
+	/* Parents are updated in batches to lock each shard of the cache once. */
+	hmap_key_t keys[64];
+	size_t nkeys = 0U;
+
+	size_t len = strlen(real_path);
+	while(1)
+	{
+		while(len > 0U && real_path[len - 1U] != '/')
+		{
+			--len;
+		}
+		if(len == 0U)
+		{
+			break;
+		}
+
+		const size_t parent_len = (is_root_prefix(real_path, len) ? len : len - 1U);
+		keys[nkeys++] = get_path_key(real_path, parent_len);
+		if(nkeys == ARRAY_LEN(keys))
+		{
+			(void)seqmap_update(dcache, keys, nkeys, 0, &size_updater, &by);
+			nkeys = 0U;
+		}
+
+		if(parent_len == len)
+		{
+			break;
+		}
+		len = parent_len;
+	}
+
+	(void)seqmap_update(dcache, keys, nkeys, 0, &size_updater, &by);
 }
 
-/* Updates cached value by a fixed amount. */
+/* Updates cached size by a fixed amount. */
 static void
-size_updater(void *data, void *arg)
+size_updater(void *data, int created, void *arg)
 {
 	const uint64_t *const by = arg;
-	dcache_data_t *const what = data;
+	dcache_rec_t *const rec = data;
 
-	what->value += *by;
+	if(rec->size.value != DCACHE_UNKNOWN)
+	{
+		rec->size.value += *by;
+	}
 }
 
 int
 dcache_set_at(const char path[], uint64_t inode, uint64_t size, uint64_t nitems)
 {
-	int ret = 0;
 	const time_t ts = time(NULL);
 
-	if(size != DCACHE_UNKNOWN)
-	{
-		dcache_data_t data = { .value = size, .timestamp = ts };
+	dcache_rec_t rec = {
+		.size = { .value = size, .timestamp = ts },
+		.nitems = { .value = nitems, .timestamp = ts },
+	};
 #ifndef _WIN32
-		data.inode = (ino_t)inode;
+	rec.size.inode = (ino_t)inode;
+	rec.nitems.inode = (ino_t)inode;
 #endif
 
-		pthread_mutex_lock(&dcache_size_mutex);
-		ret |= fsdata_set(dcache_size, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_size_mutex);
+	char real_path[PATH_MAX + 1];
+	if(os_realpath(path, real_path) != real_path)
+	{
+		return 1;
+	}
+
+	dcache_load();
+	__atomic_store_n(&dcache_changed, 1, __ATOMIC_RELAXED);
+
+	const hmap_key_t key = get_path_key(real_path, strlen(real_path));
+	return seqmap_update(dcache, &key, 1U, 1, &rec_updater, &rec);
+}
+
+/* Replaces known halves of a cache record. */
+static void
+rec_updater(void *data, int created, void *arg)
+{
+	const dcache_rec_t *const new_rec = arg;
+	dcache_rec_t *const rec = data;
+
+	if(created)
+	{
+		rec->size.value = DCACHE_UNKNOWN;
+		rec->nitems.value = DCACHE_UNKNOWN;
+	}
+
+	if(new_rec->size.value != DCACHE_UNKNOWN)
+	{
+		rec->size = new_rec->size;
+	}
+	if(new_rec->nitems.value != DCACHE_UNKNOWN)
+	{
+		rec->nitems = new_rec->nitems;
+	}
+}
+
+int
+dcache_save(void)
+{
+	if(dcache == NULL || cfg.dcache_file[0] == '\0' ||
+			!__atomic_load_n(&dcache_changed, __ATOMIC_RELAXED))
+	{
+		return 0;
+	}
+
+	/* Pick up changes made by other instances, our records take precedence. */
+	read_dcache_file(cfg.dcache_file);
+
+	dcache_file_recs_t recs = { .recs = NULL };
+	seqmap_traverse(dcache, &collect_rec, &recs);
+	if(recs.count > DCACHE_MAX_RECORDS)
+	{
+		/* Drop records that weren't updated for the longest time. */
+		safe_qsort(recs.recs, recs.count, sizeof(*recs.recs), &newer_rec_first);
+		recs.count = DCACHE_MAX_RECORDS;
+	}
+
+	char tmp_file[PATH_MAX + 64];
+	FILE *const fp = make_file_for_rename(cfg.dcache_file, tmp_file,
+			sizeof(tmp_file));
+	if(fp == NULL)
+	{
+		free(recs.recs);
+		return 1;
+	}
+
+	int error = (write_dcache_file(fp, recs.recs, recs.count) != 0 ||
+			rename_file(tmp_file, cfg.dcache_file) != 0);
+	free(recs.recs);
+
+	if(error)
+	{
+		(void)remove(tmp_file);
+		return 1;
+	}
+
+	__atomic_store_n(&dcache_changed, 0, __ATOMIC_RELAXED);
+	return 0;
+}
+
+/* Populates dcache from its file on first use. */
+static void
+dcache_load(void)
+{
+	if(__atomic_load_n(&dcache_loaded, __ATOMIC_ACQUIRE))
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&dcache_load_mutex);
+	if(!dcache_loaded)
+	{
+		if(cfg.dcache_file[0] != '\0')
+		{
+			read_dcache_file(cfg.dcache_file);
+		}
+		__atomic_store_n(&dcache_loaded, 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&dcache_load_mutex);
+}
+
+/* Adds records of the file to dcache which aren't there yet.  Missing or broken
+ * file is ignored. */
+static void
+read_dcache_file(const char path[])
+{
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	dcache_header_t header;
+	if(fread(&header, sizeof(header), 1, fp) != 1 ||
+			memcmp(header.magic, DCACHE_MAGIC, sizeof(header.magic)) != 0 ||
+			header.rec_size != sizeof(dcache_file_rec_t) ||
+			header.count > DCACHE_MAX_RECORDS)
+	{
+		fclose(fp);
+		return;
+	}
+
+	dcache_file_rec_t rec;
+	uint32_t i;
+	for(i = 0U; i < header.count; ++i)
+	{
+		if(fread(&rec, sizeof(rec), 1, fp) != 1)
+		{
+			break;
+		}
+		(void)seqmap_update(dcache, &rec.key, 1U, 1, &loaded_rec_updater, &rec);
 	}
 
-	if(nitems != DCACHE_UNKNOWN)
+	fclose(fp);
+}
+
+/* Fills newly created record of dcache from a record of its file. */
+static void
+loaded_rec_updater(void *data, int created, void *arg)
+{
+	const dcache_file_rec_t *const file_rec = arg;
+	dcache_rec_t *const rec = data;
+
+	if(!created)
 	{
-		dcache_data_t data = { .value = nitems, .timestamp = ts };
+		return;
+	}
+
+	rec->size.value = file_rec->size.value;
+	rec->size.timestamp = file_rec->size.timestamp;
+	rec->nitems.value = file_rec->nitems.value;
+	rec->nitems.timestamp = file_rec->nitems.timestamp;
 #ifndef _WIN32
-		data.inode = (ino_t)inode;
+	rec->size.inode = (ino_t)file_rec->size.inode;
+	rec->nitems.inode = (ino_t)file_rec->nitems.inode;
 #endif
+}
+
+/* Writes dcache file and closes it.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+write_dcache_file(FILE *fp, const dcache_file_rec_t recs[], size_t count)
+{
+	dcache_header_t header = { .rec_size = sizeof(*recs), .count = count };
+	memcpy(header.magic, DCACHE_MAGIC, sizeof(header.magic));
+
+	int error = (fwrite(&header, sizeof(header), 1, fp) != 1);
+	if(!error && count != 0U)
+	{
+		error = (fwrite(recs, sizeof(*recs), count, fp) != count);
+	}
+
+	error |= (fclose(fp) != 0);
+	return error;
+}
+
+/* Appends record of dcache to a list of records of its file. */
+static void
+collect_rec(hmap_key_t key, const void *data, void *arg)
+{
+	const dcache_rec_t *const rec = data;
+	dcache_file_recs_t *const recs = arg;
 
-		pthread_mutex_lock(&dcache_nitems_mutex);
-		ret |= fsdata_set(dcache_nitems, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_nitems_mutex);
+	if(recs->count == recs->capacity)
+	{
+		const size_t capacity = (recs->capacity == 0U ? 256U : recs->capacity*2U);
+		void *const ptr = reallocarray(recs->recs, capacity, sizeof(*recs->recs));
+		if(ptr == NULL)
+		{
+			return;
+		}
+		recs->recs = ptr;
+		recs->capacity = capacity;
 	}
 
-	return ret;
+	dcache_file_rec_t *const file_rec = &recs->recs[recs->count++];
+	memset(file_rec, 0, sizeof(*file_rec));
+	file_rec->key = key;
+	file_rec->size.value = rec->size.value;
+	file_rec->size.timestamp = rec->size.timestamp;
+	file_rec->nitems.value = rec->nitems.value;
+	file_rec->nitems.timestamp = rec->nitems.timestamp;
+#ifndef _WIN32
+	file_rec->size.inode = rec->size.inode;
+	file_rec->nitems.inode = rec->nitems.inode;
+#endif
+}
+
+/* qsort() comparer that puts recently updated records first.  Returns standard
+ * -1, 0, 1 for comparisons. */
+static int
+newer_rec_first(const void *a, const void *b)
+{
+	const dcache_file_rec_t *const rec_a = a;
+	const dcache_file_rec_t *const rec_b = b;
+
+	const int64_t ts_a = MAX(rec_a->size.timestamp, rec_a->nitems.timestamp);
+	const int64_t ts_b = MAX(rec_b->size.timestamp, rec_b->nitems.timestamp);
+	return (ts_a < ts_b) - (ts_a > ts_b);
+}
+
+/* Computes key of a resolved path in the cache.  Returns the key. */
+static hmap_key_t
+get_path_key(const char path[], size_t len)
+{
+#ifndef _WIN32
+	return hmap_str_key(path, len);
+#else
+	return hmap_istr_key(path, len);
+#endif
+}
+
+/* Checks whether the prefix of the path of specified length (which ends with a
+ * slash) is a root directory.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+is_root_prefix(const char path[], size_t len)
+{
+#ifdef _WIN32
+	if(len == 3U && path[1] == ':')
+	{
+		return 1;
+	}
+#endif
+	return (len == 1U);
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
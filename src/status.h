@@ -301,6 +301,10 @@ int stats_redraw_planned(void);
  * After calls with non-zero and zero arguments balance out, UI gets updated. */
 void stats_silence_ui(int more);
 
+/* Same as `stats_silence_ui(0)`, but instead of updating UI right away
+ * schedules a redraw to be picked up by stats_update_fetch(). */
+void stats_silence_ui_end_later(void);
+
 /* Checks whether UI is currently silenced. */
 int stats_silenced_ui(void);
 
@@ -351,6 +355,11 @@ void dcache_update_parent_sizes(const char path[], uint64_t by);
 int dcache_set_at(const char path[], uint64_t inode, uint64_t size,
 		uint64_t nitems);
 
+/* Writes cached information to the file specified by cfg.dcache_file if there
+ * were any changes, cache is loaded from the file lazily on first use.  Returns
+ * zero on success, otherwise non-zero is returned. */
+int dcache_save(void);
+
 #endif /* VIFM__STATUS_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
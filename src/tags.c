@@ -160,10 +160,12 @@ const char *tags[] = {
 	"vifm---no-configs",
 	"vifm---on-choose",
 	"vifm---remote",
+	"vifm---remote-batch",
 	"vifm---remote-expr",
 	"vifm---select",
 	"vifm---server-list",
 	"vifm---server-name",
+	"vifm---startuptime",
 	"vifm---version",
 	"vifm--c",
 	"vifm--f",
@@ -310,6 +312,7 @@ const char *tags[] = {
 	"vifm-:nunmap",
 	"vifm-:on",
 	"vifm-:only",
+	"vifm-:perfstats",
 	"vifm-:plugin",
 	"vifm-:plugins",
 	"vifm-:popd",
@@ -25,18 +25,24 @@
 #include <errno.h> /* EROFS errno */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* remove() snprintf() */
-#include <stdlib.h> /* free() realloc() */
-#include <string.h> /* memmove() strchr() strcmp() strdup() strlen() strspn() */
+#include <stdlib.h> /* bsearch() free() qsort() realloc() */
+#include <string.h> /* memmove() strchr() strcmp() strdup() strlen() strrchr()
+                       strspn() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
 #include "compat/os.h"
 #include "compat/mntent.h"
+#include "compat/pthread.h"
 #include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
+#include "ui/cancellation.h"
 #include "utils/fs.h"
+#include "utils/hmap.h"
 #include "utils/log.h"
+#include "utils/macros.h"
 #include "utils/path.h"
+#include "utils/rmtree.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/utils.h"
@@ -48,6 +54,13 @@
 #define ROOTED_SPEC_PREFIX "%r/"
 #define ROOTED_SPEC_PREFIX_LEN (sizeof(ROOTED_SPEC_PREFIX) - 1U)
 
+/* First line of trash index file, identifies its format. */
+#define INDEX_HEADER "vifm trash index 1\n"
+#define INDEX_HEADER_LEN (sizeof(INDEX_HEADER) - 1U)
+
+/* Maximum number of threads removing files on a single device. */
+#define MAX_EMPTY_WORKERS 8
+
 /* Describes file location relative to one of registered trash directories.
  * Argument for get_resident_type_traverser().*/
 typedef enum
@@ -94,14 +107,28 @@ static int create_trash_dir(const char trash_dir[], int user_specific);
 static int try_create_trash_dir(const char trash_dir[], int user_specific);
 static void empty_trash_dirs(void);
 static void empty_trash_dir(const char trash_dir[], int can_delete);
+static void empty_trash_group(trashes_list *group);
 static void empty_trash_in_bg(bg_op_t *bg_op, void *arg);
+static int report_empty_progress(long long removed, void *arg);
 static void remove_trash_entries(const char trash_dir[]);
+static int queue_change(const char original_path[], const char trash_name[]);
+static void flush_pending(void);
+static int add_entries(char *const originals[], char *const trash_names[],
+		int count);
+static void remove_entries(char *const trash_names[], int count);
+static int compare_entries(trash_entry_t *a, trash_entry_t *b);
+static int entry_sorter(const void *a, const void *b);
+static void free_entries(trash_entry_t entries[], int count);
 static int find_in_trash(const char original_path[], const char trash_path[]);
 static trashes_list get_list_of_trashes(int allow_empty);
 static int get_list_of_trashes_traverser(struct mntent *entry, void *arg);
 static int is_trash_valid(const char trash_dir[], int allow_empty);
 static void add_trash_to_list(trashes_list *list, const char path[],
 		int can_delete);
+static int * make_trash_name_order(void);
+static int trash_name_sorter(const void *a, const void *b);
+static int find_by_trash_name(const char trash_name[], const int order[]);
+static int restore_entry(int pos, const char trash_name[]);
 static void remove_from_trash(const char trash_name[]);
 static void free_entry(const trash_entry_t *entry);
 static int pick_trash_dir_traverser(const char base_path[],
@@ -121,6 +148,8 @@ static void traverse_specs(const char base_path[], traverser client, void *arg);
 static char * expand_uid(const char spec[], int *expanded);
 static char * get_rooted_trash_dir(const char base_path[], const char spec[]);
 static char * format_root_spec(const char spec[], const char mount_point[]);
+static int is_in_dir_listing(hmap_t *dirs, hmap_t *paths, const char path[]);
+static int list_dir_paths(const char path[], size_t dir_len, hmap_t *paths);
 
 trash_entry_t *trash_list;
 int trash_list_size;
@@ -128,6 +157,21 @@ int trash_list_size;
 static char **specs;
 static int nspecs;
 
+/* Protects batch_depth and pending_* variables, because files can be moved to
+ * or from trash by background operations while a batch is active. */
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Nesting level of trash_batch_start() calls. */
+static int batch_depth;
+/* Changes of trash_list postponed until the end of a batch.  NULL original path
+ * marks removal of entries with the trash name. */
+static char **pending_paths;
+static char **pending_names;
+/* Number of elements and capacity of both pending_* arrays. */
+static int npending;
+static int pending_capacity;
+/* Incremented on every change of trash_list. */
+static int generation;
+
 int
 trash_set_specs(const char new_specs[])
 {
@@ -268,17 +312,70 @@ trash_empty_all(void)
 }
 
 /* Empties all trash directories (all specifications on all mount points are
- * expanded). */
+ * expanded).  Directories are grouped by device they reside on and each group
+ * is processed by a separate task. */
 static void
 empty_trash_dirs(void)
 {
 	const trashes_list list = get_list_of_trashes(1);
+
+	trashes_list *groups = NULL;
+	dev_t *devs = NULL;
+	int ngroups = 0;
+
 	int i;
 	for(i = 0; i < list.ntrashes; ++i)
 	{
-		empty_trash_dir(list.trashes[i], list.can_delete[i] == '1');
+		struct stat st;
+		const int can_delete = (list.can_delete[i] == '1');
+		if(os_stat(list.trashes[i], &st) != 0)
+		{
+			empty_trash_dir(list.trashes[i], can_delete);
+			continue;
+		}
+
+		int j;
+		for(j = 0; j < ngroups; ++j)
+		{
+			if(devs[j] == st.st_dev)
+			{
+				break;
+			}
+		}
+
+		if(j == ngroups)
+		{
+			void *const p = reallocarray(groups, ngroups + 1, sizeof(*groups));
+			if(p == NULL)
+			{
+				empty_trash_dir(list.trashes[i], can_delete);
+				continue;
+			}
+			groups = p;
+
+			void *const q = reallocarray(devs, ngroups + 1, sizeof(*devs));
+			if(q == NULL)
+			{
+				empty_trash_dir(list.trashes[i], can_delete);
+				continue;
+			}
+			devs = q;
+
+			groups[ngroups] = (trashes_list){ .ntrashes = 0 };
+			devs[ngroups] = st.st_dev;
+			++ngroups;
+		}
+
+		add_trash_to_list(&groups[j], list.trashes[i], can_delete);
+	}
+
+	for(i = 0; i < ngroups; ++i)
+	{
+		empty_trash_group(&groups[i]);
 	}
 
+	free(groups);
+	free(devs);
 	free_string_array(list.trashes, list.ntrashes);
 	free(list.can_delete);
 }
@@ -296,40 +393,99 @@ trash_empty(const char trash_dir[])
  * of vifm is not aware of). */
 static void
 empty_trash_dir(const char trash_dir[], int can_delete)
+{
+	trashes_list group = { .ntrashes = 0 };
+	add_trash_to_list(&group, trash_dir, can_delete);
+	empty_trash_group(&group);
+}
+
+/* Starts a background task that empties a group of trash directories, which
+ * share the same device.  Takes ownership of the group's data. */
+static void
+empty_trash_group(trashes_list *group)
 {
 	/* XXX: should we rename directory and delete files from it to exclude
 	 *      possibility of deleting newly added files? */
 
-	char *const task_desc = format_str("Empty trash: %s", trash_dir);
-	char *const op_desc = format_str("Emptying %s", replace_home_part(trash_dir));
+	if(group->ntrashes == 0)
+	{
+		free(group->can_delete);
+		return;
+	}
 
-	/* Yes, this isn't pretty.  It's a simple way to bundle string and bool. */
-	char *trash_dir_copy = format_str("%c%s", can_delete ? '1' : '0', trash_dir);
+	char *task_desc, *op_desc;
+	if(group->ntrashes == 1)
+	{
+		task_desc = format_str("Empty trash: %s", group->trashes[0]);
+		op_desc = format_str("Emptying %s", replace_home_part(group->trashes[0]));
+	}
+	else
+	{
+		task_desc = format_str("Empty trash: %s and %d more", group->trashes[0],
+				group->ntrashes - 1);
+		op_desc = format_str("Emptying %d trashes", group->ntrashes);
+	}
 
-	if(bg_execute(task_desc, op_desc, BG_UNDEFINED_TOTAL, 1, &empty_trash_in_bg,
-			trash_dir_copy) != 0)
+	trashes_list *const arg = malloc(sizeof(*arg));
+	if(arg != NULL)
 	{
-		free(trash_dir_copy);
+		*arg = *group;
+	}
+
+	if(arg == NULL || bg_execute(task_desc, op_desc, BG_UNDEFINED_TOTAL, 1,
+				&empty_trash_in_bg, arg) != 0)
+	{
+		free_string_array(group->trashes, group->ntrashes);
+		free(group->can_delete);
+		free(arg);
 	}
 
 	free(op_desc);
 	free(task_desc);
 }
 
-/* Entry point for a background task that removes files in a single trash
- * directory. */
+/* Entry point for a background task that removes files in a group of trash
+ * directories located on the same device.  Contents of all directories is
+ * removed by a pool of workers. */
 static void
 empty_trash_in_bg(bg_op_t *bg_op, void *arg)
 {
-	char *const trash_info = arg;
+	trashes_list *const group = arg;
 
-	remove_dir_content(trash_info + 1);
-	if(trash_info[0] == '1')
+	const int nworkers = MIN(get_cpu_count(), MAX_EMPTY_WORKERS);
+	(void)rmtree_remove_contents(group->trashes, group->ntrashes, nworkers,
+			&report_empty_progress, bg_op);
+
+	/* Removal of directories fails harmlessly if they aren't empty. */
+	if(!bg_op_cancelled(bg_op))
 	{
-		(void)os_rmdir(trash_info + 1);
+		int i;
+		for(i = 0; i < group->ntrashes; ++i)
+		{
+			if(group->can_delete[i] == '1')
+			{
+				(void)os_rmdir(group->trashes[i]);
+			}
+		}
 	}
 
-	free(trash_info);
+	free_string_array(group->trashes, group->ntrashes);
+	free(group->can_delete);
+	free(group);
+}
+
+/* rmtree_remove_contents() callback that reports progress of emptying trash.
+ * Returns non-zero if emptying should be cancelled. */
+static int
+report_empty_progress(long long removed, void *arg)
+{
+	bg_op_t *const bg_op = arg;
+
+	char msg[64];
+	snprintf(msg, sizeof(msg), "%lld removed", removed);
+	bg_op_set_descr(bg_op, msg);
+
+	return bg_op_cancelled(bg_op);
 }
 
 /* Removes entries that belong to specified trash directory.  Removes all if
@@ -340,6 +496,8 @@ remove_trash_entries(const char trash_dir[])
 	int i;
 	int j = 0;
 
+	flush_pending();
+
 	for(i = 0; i < trash_list_size; ++i)
 	{
 		if(trash_dir == NULL || entry_is(PREFIXED_WITH, &trash_list[i], trash_dir))
@@ -351,6 +509,11 @@ remove_trash_entries(const char trash_dir[])
 		trash_list[j++] = trash_list[i];
 	}
 
+	if(j != trash_list_size)
+	{
+		++generation;
+	}
+
 	trash_list_size = j;
 	if(trash_list_size == 0)
 	{
@@ -364,6 +527,11 @@ trash_file_moved(const char src[], const char dst[])
 {
 	if(trash_has_path(dst))
 	{
+		if(queue_change(src, dst) == 0)
+		{
+			return;
+		}
+
 		if(trash_add_entry(src, dst) != 0)
 		{
 			LOG_ERROR_MSG("Failed to add to trash: (`%s`, `%s`)", src, dst);
@@ -371,13 +539,140 @@ trash_file_moved(const char src[], const char dst[])
 	}
 	else if(trash_has_path(src))
 	{
-		remove_from_trash(src);
+		if(queue_change(NULL, src) != 0)
+		{
+			remove_from_trash(src);
+		}
+	}
+}
+
+void
+trash_batch_start(void)
+{
+	pthread_mutex_lock(&pending_lock);
+	++batch_depth;
+	pthread_mutex_unlock(&pending_lock);
+}
+
+void
+trash_batch_finish(void)
+{
+	pthread_mutex_lock(&pending_lock);
+	assert(batch_depth > 0 && "Unbalanced trash_batch_finish() call.");
+	const int finished = (--batch_depth == 0);
+	pthread_mutex_unlock(&pending_lock);
+
+	if(finished)
+	{
+		flush_pending();
+	}
+}
+
+/* Postpones addition (non-NULL original_path) or removal (NULL original_path)
+ * of a trash entry until the end of a batch.  Returns zero on success,
+ * otherwise (including when there is no active batch) non-zero is returned. */
+static int
+queue_change(const char original_path[], const char trash_name[])
+{
+	char *path = (original_path == NULL ? NULL : strdup(original_path));
+	char *name = strdup(trash_name);
+	if(name == NULL || (original_path != NULL && path == NULL))
+	{
+		free(path);
+		free(name);
+		return 1;
 	}
+
+	pthread_mutex_lock(&pending_lock);
+
+	if(batch_depth == 0)
+	{
+		pthread_mutex_unlock(&pending_lock);
+		free(path);
+		free(name);
+		return 1;
+	}
+
+	if(npending == pending_capacity)
+	{
+		const int capacity = (pending_capacity == 0) ? 64 : pending_capacity*2;
+
+		char **paths = reallocarray(pending_paths, capacity, sizeof(*paths));
+		char **names = (paths == NULL)
+		             ? NULL
+		             : reallocarray(pending_names, capacity, sizeof(*names));
+		if(paths != NULL)
+		{
+			pending_paths = paths;
+		}
+		if(names == NULL)
+		{
+			pthread_mutex_unlock(&pending_lock);
+			free(path);
+			free(name);
+			return 1;
+		}
+		pending_names = names;
+
+		pending_capacity = capacity;
+	}
+
+	pending_paths[npending] = path;
+	pending_names[npending] = name;
+	++npending;
+
+	pthread_mutex_unlock(&pending_lock);
+	return 0;
+}
+
+/* Applies changes collected during a batch.  Consecutive changes of the same
+ * kind are applied at once, which preserves their order. */
+static void
+flush_pending(void)
+{
+	/* Take the queue, so that it's not applied twice by concurrent calls. */
+	pthread_mutex_lock(&pending_lock);
+	char **const paths = pending_paths;
+	char **const names = pending_names;
+	const int count = npending;
+	pending_paths = NULL;
+	pending_names = NULL;
+	npending = 0;
+	pending_capacity = 0;
+	pthread_mutex_unlock(&pending_lock);
+
+	int i = 0;
+	while(i < count)
+	{
+		const int adding = (paths[i] != NULL);
+
+		int j = i + 1;
+		while(j < count && (paths[j] != NULL) == adding)
+		{
+			++j;
+		}
+
+		if(!adding)
+		{
+			remove_entries(names + i, j - i);
+		}
+		else if(add_entries(paths + i, names + i, j - i) != 0)
+		{
+			LOG_ERROR_MSG("Failed to add %d entries to trash", j - i);
+		}
+
+		i = j;
+	}
+
+	free_string_array(paths, count);
+	free_string_array(names, count);
 }
 
 int
 trash_add_entry(const char original_path[], const char trash_name[])
 {
+	flush_pending();
+
 	/* XXX: we check duplicates by original_path+trash_name, which allows
 	 *      multiple original path to be mapped to one trash file, might want to
 	 *      forbid this.  */
@@ -412,15 +707,210 @@ trash_add_entry(const char original_path[], const char trash_name[])
 	memmove(trash_list + pos + 1, trash_list + pos,
 			sizeof(*trash_list)*(trash_list_size - 1 - pos));
 	trash_list[pos] = entry;
+	++generation;
 	return 0;
 }
 
+int
+trash_add_entries(char *const originals[], char *const trash_names[],
+		int count)
+{
+	flush_pending();
+	return add_entries(originals, trash_names, count);
+}
+
+/* Implementation of trash_add_entries() which sorts new entries (unless they
+ * are already sorted) and merges them into trash_list in a single pass. */
+static int
+add_entries(char *const originals[], char *const trash_names[], int count)
+{
+	if(count <= 0)
+	{
+		return 0;
+	}
+
+	trash_entry_t *added = reallocarray(NULL, count, sizeof(*added));
+	if(added == NULL)
+	{
+		return -1;
+	}
+
+	int i;
+	int sorted = 1;
+	for(i = 0; i < count; ++i)
+	{
+		added[i].path = strdup(originals[i]);
+		added[i].trash_name = strdup(trash_names[i]);
+		added[i].real_trash_name = NULL;
+		if(added[i].path == NULL || added[i].trash_name == NULL)
+		{
+			free_entries(added, i + 1);
+			return -1;
+		}
+
+		if(sorted && i > 0 && compare_entries(&added[i - 1], &added[i]) > 0)
+		{
+			sorted = 0;
+		}
+	}
+
+	if(!sorted)
+	{
+		qsort(added, count, sizeof(*added), &entry_sorter);
+	}
+
+	trash_entry_t *merged = reallocarray(NULL, trash_list_size + count,
+			sizeof(*merged));
+	if(merged == NULL)
+	{
+		free_entries(added, count);
+		return -1;
+	}
+
+	int from_list = 0, from_added = 0, n = 0;
+	while(from_list < trash_list_size || from_added < count)
+	{
+		int cmp;
+		if(from_added == count)
+		{
+			cmp = -1;
+		}
+		else if(from_list == trash_list_size)
+		{
+			cmp = 1;
+		}
+		else
+		{
+			cmp = compare_entries(&trash_list[from_list], &added[from_added]);
+		}
+
+		if(cmp < 0)
+		{
+			merged[n++] = trash_list[from_list++];
+		}
+		else if(cmp == 0 ||
+				(n > 0 && compare_entries(&merged[n - 1], &added[from_added]) == 0))
+		{
+			LOG_INFO_MSG("File is already in trash: (`%s`, `%s`)",
+					added[from_added].path, added[from_added].trash_name);
+			free_entry(&added[from_added++]);
+		}
+		else
+		{
+			merged[n++] = added[from_added++];
+		}
+	}
+
+	free(added);
+	free(trash_list);
+	trash_list = merged;
+	trash_list_size = n;
+	++generation;
+	return 0;
+}
+
+void
+trash_remove_entries(char *const trash_names[], int count)
+{
+	flush_pending();
+	remove_entries(trash_names, count);
+}
+
+/* Implementation of trash_remove_entries() which resolves and sorts trash names
+ * once and then removes matching entries in a single pass over trash_list. */
+static void
+remove_entries(char *const trash_names[], int count)
+{
+	char **reals = reallocarray(NULL, count, sizeof(*reals));
+	if(reals == NULL)
+	{
+		LOG_ERROR_MSG("Failed to remove %d entries from trash", count);
+		return;
+	}
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char real[PATH_MAX*2 + 1];
+		make_real_path(trash_names[i], real, sizeof(real));
+		reals[i] = strdup(real);
+		if(reals[i] == NULL)
+		{
+			LOG_ERROR_MSG("Failed to remove %d entries from trash", count);
+			free_string_array(reals, i);
+			return;
+		}
+	}
+
+	qsort(reals, count, sizeof(*reals), &strossorter);
+
+	int j = 0;
+	for(i = 0; i < trash_list_size; ++i)
+	{
+		const char *const real = get_real_trash_name(&trash_list[i]);
+		if(bsearch(&real, reals, count, sizeof(*reals), &strossorter) != NULL)
+		{
+			free_entry(&trash_list[i]);
+			continue;
+		}
+
+		trash_list[j++] = trash_list[i];
+	}
+
+	free_string_array(reals, count);
+
+	if(j != trash_list_size)
+	{
+		trash_list_size = j;
+		++generation;
+	}
+}
+
+/* Compares two entries by their original paths and then by trash names with
+ * symbolic links resolved.  Returns negative number, zero or positive number
+ * like strcmp() does. */
+static int
+compare_entries(trash_entry_t *a, trash_entry_t *b)
+{
+	const int cmp = stroscmp(a->path, b->path);
+	return (cmp != 0)
+	     ? cmp
+	     : stroscmp(get_real_trash_name(a), get_real_trash_name(b));
+}
+
+/* Wraps compare_entries() for use with qsort(). */
+static int
+entry_sorter(const void *a, const void *b)
+{
+	/* Entries are modified only to cache resolved trash names. */
+	return compare_entries((trash_entry_t *)a, (trash_entry_t *)b);
+}
+
+/* Frees array of entries along with the entries themselves. */
+static void
+free_entries(trash_entry_t entries[], int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		free_entry(&entries[i]);
+	}
+	free(entries);
+}
+
 int
 trash_has_entry(const char original_path[], const char trash_path[])
 {
+	flush_pending();
 	return (find_in_trash(original_path, trash_path) >= 0);
 }
 
+int
+trash_get_generation(void)
+{
+	return generation;
+}
+
 /* Finds position of an entry in trash_list or whereto it should be inserted in
  * it.  Returns non-negative number of successful search and negative index
  * offset by one otherwise (0 -> -1, 1 -> -2, etc.). */
@@ -549,50 +1039,170 @@ is_trash_valid(const char trash_dir[], int allow_empty)
 int
 trash_restore(const char trash_name[])
 {
+	char *const trash_names[] = { (char *)trash_name };
+	return (trash_restore_entries(trash_names, 1) == 1) ? 0 : -1;
+}
+
+int
+trash_restore_entries(char *const trash_names[], int count)
+{
+	flush_pending();
+
+	/* Looking up many entries by trash name is faster with an index. */
+	int *order = (count > 1) ? make_trash_name_order() : NULL;
+	int order_generation = generation;
+
+	trash_batch_start();
+
 	int i;
-	char full[PATH_MAX + 1];
-	char path[PATH_MAX + 1];
+	int restored = 0;
+	for(i = 0; i < count && !ui_cancellation_requested(); ++i)
+	{
+		if(order != NULL && order_generation != generation)
+		{
+			/* Something was applied immediately instead of being postponed. */
+			free(order);
+			order = make_trash_name_order();
+			order_generation = generation;
+		}
+
+		const int pos = find_by_trash_name(trash_names[i], order);
+		if(pos >= 0 && restore_entry(pos, trash_names[i]) == 0)
+		{
+			++restored;
+		}
+	}
+
+	free(order);
+
+	trash_batch_finish();
+	return restored;
+}
 
+/* Makes an array of positions of entries of trash_list ordered by their trash
+ * names with symbolic links resolved.  Returns the array or NULL on error. */
+static int *
+make_trash_name_order(void)
+{
+	int *order = reallocarray(NULL, trash_list_size, sizeof(*order));
+	if(order == NULL)
+	{
+		return NULL;
+	}
+
+	int i;
 	for(i = 0; i < trash_list_size; ++i)
 	{
-		if(entry_is(SAME_AS, &trash_list[i], trash_name))
+		if(get_real_trash_name(&trash_list[i]) == NULL)
 		{
-			break;
+			free(order);
+			return NULL;
 		}
+		order[i] = i;
 	}
-	if(i >= trash_list_size)
+
+	qsort(order, trash_list_size, sizeof(*order), &trash_name_sorter);
+	return order;
+}
+
+/* Compares entries at two positions of trash_list by their resolved trash
+ * names for qsort(). */
+static int
+trash_name_sorter(const void *a, const void *b)
+{
+	const trash_entry_t *const x = &trash_list[*(const int *)a];
+	const trash_entry_t *const y = &trash_list[*(const int *)b];
+	return stroscmp(x->real_trash_name, y->real_trash_name);
+}
+
+/* Finds an entry by its trash name using order built by
+ * make_trash_name_order() or by scanning trash_list if order is NULL.  Returns
+ * position of the entry in trash_list or -1 if there is no such entry. */
+static int
+find_by_trash_name(const char trash_name[], const int order[])
+{
+	char real[PATH_MAX*2 + 1];
+	make_real_path(trash_name, real, sizeof(real));
+
+	int i;
+	if(order == NULL)
 	{
+		for(i = 0; i < trash_list_size; ++i)
+		{
+			if(stroscmp(get_real_trash_name(&trash_list[i]), real) == 0)
+			{
+				return i;
+			}
+		}
 		return -1;
 	}
 
-	copy_str(path, sizeof(path), trash_list[i].path);
-	copy_str(full, sizeof(full), trash_list[i].trash_name);
-	if(perform_operation(OP_MOVE, NULL, NULL, full, path) == 0)
+	int l = 0;
+	int u = trash_list_size - 1;
+	while(l <= u)
 	{
-		char *msg, *p;
-		size_t len;
+		i = l + (u - l)/2;
 
-		un_group_reopen_last();
-
-		msg = un_replace_group_msg(NULL);
-		len = strlen(msg);
-		p = realloc(msg, COMMAND_GROUP_INFO_LEN);
-		if(p == NULL)
-			len = COMMAND_GROUP_INFO_LEN;
+		const int cmp = stroscmp(trash_list[order[i]].real_trash_name, real);
+		if(cmp == 0)
+		{
+			return order[i];
+		}
+		else if(cmp < 0)
+		{
+			l = i + 1;
+		}
 		else
-			msg = p;
+		{
+			u = i - 1;
+		}
+	}
+	return -1;
+}
+
+/* Moves file of an entry at specified position of trash_list back to its
+ * original location and appends the operation to the last undo group.  Must be
+ * called within a batch, so that trash_list doesn't change.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+restore_entry(int pos, const char trash_name[])
+{
+	char full[PATH_MAX + 1];
+	char path[PATH_MAX + 1];
+
+	copy_str(path, sizeof(path), trash_list[pos].path);
+	copy_str(full, sizeof(full), trash_list[pos].trash_name);
+	if(perform_operation(OP_MOVE, NULL, NULL, full, path) != 0)
+	{
+		return -1;
+	}
+
+	char *msg, *p;
+	size_t len;
 
-		snprintf(msg + len, COMMAND_GROUP_INFO_LEN - len, "%s%s",
-				(msg[len - 2] != ':') ? ", " : "", strchr(trash_name, '_') + 1);
-		un_replace_group_msg(msg);
-		free(msg);
+	un_group_reopen_last();
 
-		un_group_add_op(OP_MOVE, NULL, NULL, full, path);
-		un_group_close();
+	msg = un_replace_group_msg(NULL);
+	len = strlen(msg);
+	p = realloc(msg, COMMAND_GROUP_INFO_LEN);
+	if(p == NULL)
+		len = COMMAND_GROUP_INFO_LEN;
+	else
+		msg = p;
+
+	snprintf(msg + len, COMMAND_GROUP_INFO_LEN - len, "%s%s",
+			(msg[len - 2] != ':') ? ", " : "", strchr(trash_name, '_') + 1);
+	un_replace_group_msg(msg);
+	free(msg);
+
+	un_group_add_op(OP_MOVE, NULL, NULL, full, path);
+	un_group_close();
+
+	if(queue_change(NULL, trash_name) != 0)
+	{
 		remove_from_trash(trash_name);
-		return 0;
 	}
-	return -1;
+	return 0;
 }
 
 /* Removes record about the file in the trash.  Does nothing if no such record
@@ -600,24 +1210,8 @@ trash_restore(const char trash_name[])
 static void
 remove_from_trash(const char trash_name[])
 {
-	int i;
-	for(i = 0; i < trash_list_size; ++i)
-	{
-		if(entry_is(SAME_AS, &trash_list[i], trash_name))
-		{
-			break;
-		}
-	}
-	if(i >= trash_list_size)
-	{
-		return;
-	}
-
-	free_entry(&trash_list[i]);
-	memmove(trash_list + i, trash_list + i + 1,
-			sizeof(*trash_list)*((trash_list_size - 1) - i));
-
-	--trash_list_size;
+	char *const trash_names[] = { (char *)trash_name };
+	trash_remove_entries(trash_names, 1);
 }
 
 /* Frees memory allocated by given trash entry. */
@@ -965,21 +1559,198 @@ trash_get_real_name_of(const char trash_path[])
 void
 trash_prune_dead_entries(void)
 {
+	flush_pending();
+
+	/* Listing each trash directory once is much cheaper than checking every
+	 * entry separately. */
+	hmap_t *const dirs = hmap_create(sizeof(char));
+	hmap_t *const paths = hmap_create(sizeof(char));
+
 	int i, j;
 
 	j = 0;
 	for(i = 0; i < trash_list_size; ++i)
 	{
-		if(!path_exists(trash_list[i].trash_name, NODEREF))
+		const char *const trash_name = trash_list[i].trash_name;
+		if(!is_in_dir_listing(dirs, paths, trash_name) &&
+				!path_exists(trash_name, NODEREF))
 		{
-			free(trash_list[i].path);
-			free(trash_list[i].trash_name);
+			free_entry(&trash_list[i]);
 			continue;
 		}
 
 		trash_list[j++] = trash_list[i];
 	}
-	trash_list_size = j;
+
+	hmap_free(dirs);
+	hmap_free(paths);
+
+	if(j != trash_list_size)
+	{
+		trash_list_size = j;
+		++generation;
+	}
+}
+
+/* Checks whether the path was found while listing its parent directory.  Lists
+ * the directory on first encounter.  Returns non-zero if so, otherwise zero is
+ * returned and the path should be checked in some other way. */
+static int
+is_in_dir_listing(hmap_t *dirs, hmap_t *paths, const char path[])
+{
+	const char *const slash = strrchr(path, '/');
+	if(dirs == NULL || paths == NULL || slash == NULL)
+	{
+		return 0;
+	}
+
+	const size_t dir_len = slash - path;
+
+	int created;
+	char *const listed = hmap_put(dirs, hmap_str_key(path, dir_len), &created);
+	if(listed == NULL)
+	{
+		return 0;
+	}
+
+	if(created)
+	{
+		*listed = (list_dir_paths(path, dir_len, paths) == 0);
+	}
+
+	return *listed && hmap_get(paths, hmap_str_key(path, strlen(path))) != NULL;
+}
+
+/* Adds paths of files of a directory specified by the prefix of the path to the
+ * set.  Returns zero on success, otherwise non-zero is returned. */
+static int
+list_dir_paths(const char path[], size_t dir_len, hmap_t *paths)
+{
+	char dir[PATH_MAX + 1];
+	if(dir_len == 0U || dir_len >= sizeof(dir))
+	{
+		return 1;
+	}
+	copy_str(dir, dir_len + 1U, path);
+
+	DIR *const d = os_opendir(dir);
+	if(d == NULL)
+	{
+		return 1;
+	}
+
+	int error = 0;
+	struct dirent *dentry;
+	while(!error && (dentry = os_readdir(d)) != NULL)
+	{
+		char file_path[PATH_MAX*2 + 2];
+		const int len = snprintf(file_path, sizeof(file_path), "%s/%s", dir,
+				dentry->d_name);
+
+		int created;
+		error = (hmap_put(paths, hmap_str_key(file_path, len), &created) == NULL);
+	}
+
+	os_closedir(d);
+	return error;
+}
+
+int
+trash_index_read(const char path[])
+{
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	size_t len;
+	char *const text = read_nonseekable_stream(fp, &len, NULL, NULL);
+	fclose(fp);
+
+	if(text == NULL || len < INDEX_HEADER_LEN ||
+			strncmp(text, INDEX_HEADER, INDEX_HEADER_LEN) != 0)
+	{
+		free(text);
+		return 1;
+	}
+
+	/* Each entry is a pair of null-terminated strings. */
+	int count = 0;
+	const char *p;
+	for(p = text + INDEX_HEADER_LEN; p < text + len; p += strlen(p) + 1U)
+	{
+		++count;
+	}
+
+	char **strings = reallocarray(NULL, count, sizeof(*strings));
+	if(strings == NULL && count != 0)
+	{
+		free(text);
+		return 1;
+	}
+
+	int i = 0;
+	for(p = text + INDEX_HEADER_LEN; p < text + len; p += strlen(p) + 1U)
+	{
+		strings[i++] = (char *)p;
+	}
+
+	/* Strings alternate, so they are split into two halves in place. */
+	count /= 2;
+	char **const originals = strings;
+	char **const trash_names = reallocarray(NULL, count, sizeof(*trash_names));
+	int error = (trash_names == NULL && count != 0);
+	if(!error)
+	{
+		for(i = 0; i < count; ++i)
+		{
+			trash_names[i] = strings[i*2 + 1];
+			originals[i] = strings[i*2];
+		}
+		error = trash_add_entries(originals, trash_names, count);
+	}
+
+	free(trash_names);
+	free(strings);
+	free(text);
+	return error;
+}
+
+int
+trash_index_write(const char path[])
+{
+	flush_pending();
+
+	/* Index is replaced atomically, so that other instances never see it
+	 * half-written and it's not lost on a crash. */
+	char tmp_path[PATH_MAX + 64];
+	FILE *const fp = make_file_for_rename(path, tmp_path, sizeof(tmp_path));
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	fputs(INDEX_HEADER, fp);
+
+	/* Entries are stored sorted, so reading doesn't need to sort them. */
+	int i;
+	for(i = 0; i < trash_list_size; ++i)
+	{
+		fputs(trash_list[i].path, fp);
+		fputc('\0', fp);
+		fputs(trash_list[i].trash_name, fp);
+		fputc('\0', fp);
+	}
+
+	int error = ferror(fp);
+	error |= (fclose(fp) != 0);
+	if(error || rename_file(tmp_path, path) != 0)
+	{
+		(void)remove(tmp_path);
+		return 1;
+	}
+	return 0;
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -56,11 +56,29 @@ void trash_empty_all(void);
  * move/rename. */
 void trash_file_moved(const char src[], const char dst[]);
 
+/* Starts collecting updates caused by trash_file_moved() to apply them at once
+ * on matching trash_batch_finish() call.  Calls can be nested.  trash_list
+ * doesn't reflect collected updates until the end of the batch. */
+void trash_batch_start(void);
+
+/* Ends a batch started by trash_batch_start(). */
+void trash_batch_finish(void);
+
 /* Registers file in trash that has a particular original path.  Returns zero
  * on success and non-zero otherwise.  Refusing to add an entry second time is
  * considered to be a success. */
 int trash_add_entry(const char original_path[], const char trash_name[]);
 
+/* Same as trash_add_entry(), but for count files at once.  Much faster than
+ * adding entries one by one, especially if they are sorted like trash_list.
+ * Returns zero on success and non-zero otherwise. */
+int trash_add_entries(char *const originals[], char *const trash_names[],
+		int count);
+
+/* Forgets about files in trash specified by their paths inside trash
+ * directories. */
+void trash_remove_entries(char *const trash_names[], int count);
+
 /* Checks whether given combination of original and trash paths is registered.
  * Returns non-zero if so, otherwise zero is returned. */
 int trash_has_entry(const char original_path[], const char trash_path[]);
@@ -74,6 +92,10 @@ char ** trash_list_trashes(int *ntrashes);
  * zero on success, otherwise non-zero is returned. */
 int trash_restore(const char trash_name[]);
 
+/* Restores count files specified by their trash names (from trash_list array)
+ * stopping on cancellation request.  Returns number of restored files. */
+int trash_restore_entries(char *const trash_names[], int count);
+
 /* Generates unique name for a file at base_path location named name (doesn't
  * have to be base_path/name as long as base_path is at same mount) in a trash
  * directory.  Returns string containing full path that needs to be freed by
@@ -105,6 +127,18 @@ const char * trash_get_real_name_of(const char trash_path[]);
 /* Removes entries that correspond to nonexistent files in trashes. */
 void trash_prune_dead_entries(void);
 
+/* Retrieves number that changes on every change of trash_list.  Returns the
+ * number. */
+int trash_get_generation(void);
+
+/* Adds entries stored in trash index file to trash_list.  Returns zero on
+ * success, otherwise non-zero is returned. */
+int trash_index_read(const char path[]);
+
+/* Stores trash_list into trash index file.  Returns zero on success, otherwise
+ * non-zero is returned. */
+int trash_index_write(const char path[]);
+
 #endif /* VIFM__TRASH_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -40,6 +40,8 @@
 #include "../utils/fsddata.h"
 #include "../utils/macros.h"
 #include "../utils/matchers.h"
+#include "../utils/matchers_set.h"
+#include "../utils/perf.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
 #include "../utils/utils.h"
@@ -448,6 +450,7 @@ static void restore_primary_cs(const col_scheme_t *cs);
 static void reset_to_default_cs(col_scheme_t *cs);
 static void free_cs_highlights(col_scheme_t *cs);
 static file_hi_t * clone_cs_highlights(const col_scheme_t *from);
+static void update_file_hi_set(col_scheme_t *cs);
 static void reset_cs_colors(col_scheme_t *cs);
 static int source_cs(const char name[]);
 static void get_cs_path(const char name[], char buf[], size_t buf_size);
@@ -831,6 +834,8 @@ cs_assign(col_scheme_t *to, const col_scheme_t *from)
 	free_cs_highlights(to);
 	*to = *from;
 	to->file_hi = clone_cs_highlights(from);
+	to->file_hi_set = NULL;
+	update_file_hi_set(to);
 }
 
 /* Resets color scheme to default builtin values. */
@@ -857,9 +862,11 @@ free_cs_highlights(col_scheme_t *cs)
 	}
 
 	free(cs->file_hi);
+	matchers_set_free(cs->file_hi_set);
 
 	cs->file_hi = NULL;
 	cs->file_hi_count = 0;
+	cs->file_hi_set = NULL;
 }
 
 /* Clones filename specific highlight array of the *from color scheme and
@@ -881,6 +888,25 @@ clone_cs_highlights(const col_scheme_t *from)
 	return file_hi;
 }
 
+/* Rebuilds index of filename specific highlights of the color scheme.  On
+ * failure the index is left unset. */
+static void
+update_file_hi_set(col_scheme_t *cs)
+{
+	matchers_set_free(cs->file_hi_set);
+	cs->file_hi_set = matchers_set_alloc();
+
+	int i;
+	for(i = 0; i < cs->file_hi_count && cs->file_hi_set != NULL; ++i)
+	{
+		if(matchers_set_add(cs->file_hi_set, cs->file_hi[i].matchers) != 0)
+		{
+			matchers_set_free(cs->file_hi_set);
+			cs->file_hi_set = NULL;
+		}
+	}
+}
+
 int
 cs_load_local(int left, const char dir[])
 {
@@ -1151,6 +1177,12 @@ cs_add_file_hi(struct matchers_t *matchers, const col_attr_t *hi)
 	file_hi->hi = *hi;
 
 	++cs->file_hi_count;
+
+	if(cs->file_hi_set == NULL ||
+			matchers_set_add(cs->file_hi_set, matchers) != 0)
+	{
+		update_file_hi_set(cs);
+	}
 }
 
 const col_attr_t *
@@ -1167,19 +1199,32 @@ cs_get_file_hi(const col_scheme_t *cs, const char fname[], int *hi_hint)
 		return &cs->file_hi[*hi_hint].hi;
 	}
 
+	const uint64_t start = perf_begin();
+
 	int i;
-	for(i = 0; i < cs->file_hi_count; ++i)
+	if(cs->file_hi_set != NULL)
+	{
+		i = matchers_set_find(cs->file_hi_set, fname, 0);
+	}
+	else
 	{
-		const file_hi_t *const file_hi = &cs->file_hi[i];
-		if(matchers_match(file_hi->matchers, fname))
+		for(i = 0; i < cs->file_hi_count; ++i)
 		{
-			*hi_hint = i;
-			return &file_hi->hi;
+			if(matchers_match(cs->file_hi[i].matchers, fname))
+			{
+				break;
+			}
+		}
+		if(i == cs->file_hi_count)
+		{
+			i = -1;
 		}
 	}
 
-	*hi_hint = INT_MAX;
-	return NULL;
+	perf_end(PP_HIGHLIGHT, start);
+
+	*hi_hint = (i < 0 ? INT_MAX : i);
+	return (i < 0 ? NULL : &cs->file_hi[i].hi);
 }
 
 int
@@ -1196,6 +1241,7 @@ cs_del_file_hi(const char matchers_expr[])
 			memmove(&cs->file_hi[i], &cs->file_hi[i + 1],
 					sizeof(*cs->file_hi)*((cs->file_hi_count - 1) - i));
 			--cs->file_hi_count;
+			update_file_hi_set(cs);
 			return 1;
 		}
 	}
@@ -40,6 +40,7 @@ typedef enum
 }
 ColorSchemeState;
 
+struct matchers_set_t;
 struct matchers_t;
 
 /* Single file highlight description. */
@@ -60,6 +61,8 @@ typedef struct
 
 	file_hi_t *file_hi; /* List of file highlight preferences. */
 	int file_hi_count;  /* Number of file highlight definitions. */
+	/* Index of file_hi for faster lookups or NULL. */
+	struct matchers_set_t *file_hi_set;
 }
 col_scheme_t;
 
@@ -39,6 +39,7 @@
 #include "../utils/fs.h"
 #include "../utils/macros.h"
 #include "../utils/path.h"
+#include "../utils/perf.h"
 #include "../utils/regexp.h"
 #include "../utils/str.h"
 #include "../utils/test_helpers.h"
@@ -260,12 +261,16 @@ fview_reset_cs(view_t *view)
 void
 draw_dir_list(view_t *view)
 {
+	const uint64_t start = perf_begin();
+
 	draw_dir_list_only(view);
 
 	if(view != curr_view)
 	{
 		fview_draw_inactive_cursor(view);
 	}
+
+	perf_end(PP_DRAW, start);
 }
 
 void
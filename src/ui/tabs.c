@@ -57,6 +57,7 @@ typedef struct
 	preview_t preview;      /* Information about state of the quickview. */
 	char *name;             /* Name of the tab.  Might be NULL. */
 	unsigned int init_mark; /* Which initialization this tab has seen. */
+	unsigned int id;        /* Identifier that isn't reused by other tabs. */
 }
 pane_tab_t;
 
@@ -121,6 +122,8 @@ static global_tab_t *gtabs;
 static DA_INSTANCE(gtabs);
 /* Index of current global tab. */
 static int current_gtab;
+/* Last identifier assigned to a pane tab. */
+static unsigned int last_tab_id;
 
 void
 tabs_init(void)
@@ -228,6 +231,8 @@ tabs_new_pane(pane_tabs_t *ptabs, view_t *side, const char name[],
 
 	DA_COMMIT(ptabs->tabs);
 
+	new_tab->id = ++last_tab_id;
+
 	/* When we're called from tabs_init(), we just need to create internal
 	 * structures without cloning data (or it will leak). */
 	if(DA_SIZE(gtabs) != 0U)
@@ -709,6 +714,33 @@ tabs_current(const view_t *side)
 	return (cfg.pane_tabs ? get_pane_tabs(side)->current : current_gtab);
 }
 
+unsigned int
+tabs_current_id(const view_t *side)
+{
+	const pane_tabs_t *const ptabs = get_pane_tabs(side);
+	return ptabs->tabs[ptabs->current]->id;
+}
+
+int
+tabs_has_id(const view_t *side, unsigned int id)
+{
+	int i;
+	for(i = 0; i < (int)DA_SIZE(gtabs); ++i)
+	{
+		const pane_tabs_t *const ptabs = (side == &lwin ? &gtabs[i].left
+		                                                : &gtabs[i].right);
+		int j;
+		for(j = 0; j < (int)DA_SIZE(ptabs->tabs); ++j)
+		{
+			if(ptabs->tabs[j]->id == id)
+			{
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
 int
 tabs_count(const view_t *side)
 {
@@ -92,6 +92,14 @@ int tabs_enum_all(int idx, tab_info_t *tab_info);
 /* Retrieves index of the current tab.  Returns the index. */
 int tabs_current(const struct view_t *side);
 
+/* Retrieves identifier of the tab displayed by the view, which unlike its index
+ * doesn't change on moving tabs around.  Returns the identifier. */
+unsigned int tabs_current_id(const struct view_t *side);
+
+/* Checks whether tab with the identifier still exists for the view.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int tabs_has_id(const struct view_t *side, unsigned int id);
+
 /* Retrieves number of tabs.  Returns the count. */
 int tabs_count(const struct view_t *side);
 
@@ -20,7 +20,8 @@
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* size_t */
-#include <stdio.h>
+#include <stdio.h> /* FILE SEEK_END fclose() fread() fseek() ftell() fwrite()
+                      tmpfile() */
 #include <stdlib.h> /* free() malloc() */
 #include <string.h> /* strcpy() strdup() */
 
@@ -39,6 +40,16 @@
  *      within group of changes, hence fake OP_MOVETMP* operations.  Hard to
  *      tell if this can be done without such workarounds, but worth a try. */
 
+/* Block of memory of an arena of a group. */
+typedef struct arena_block_t
+{
+	struct arena_block_t *prev; /* Previously allocated block or NULL. */
+	size_t size;                /* Size of the data in bytes. */
+	size_t used;                /* Number of bytes already allocated. */
+	void *data[];               /* Memory (of pointers for the sake of alignment). */
+}
+arena_block_t;
+
 typedef struct
 {
 	char *msg;
@@ -46,9 +57,18 @@ typedef struct
 	int balance;
 	int can_undone;
 	int incomplete;
+
+	int ncmds;             /* Number of commands that belong to the group. */
+	arena_block_t *arena;  /* Memory for commands and their paths, which is
+	                          freed at once with the group. */
+	size_t mem;            /* Size of all blocks of the arena. */
+	const char *dirs[2];   /* Directories of operands of the last command. */
+	FILE *spill;           /* Temporary file with paths of commands that were
+	                          added after arena has grown past the limit. */
 }
 group_t;
 
+/* Operation along with its arguments.  Paths are formatted on demand. */
 typedef struct
 {
 	OPS op;
@@ -57,15 +77,25 @@ typedef struct
 	void *data;             /* for uid_t, gid_t and mode_t */
 	const char *exists;     /* NULL, buf1 or buf2 */
 	const char *dont_exist; /* NULL, buf1 or buf2 */
+
+	char *buf1;             /* Path of the first operand. */
+	char *buf2;             /* Path of the second operand. */
 }
 op_t;
 
+/* Compact form of an operation.  Both paths are split at the last slash, their
+ * directories are shared with the previous command of the group when they are
+ * the same, which is the case for bulk operations.  Lives in group's arena. */
 typedef struct cmd_t
 {
-	char *buf1;
-	char *buf2;
-	op_t do_op;
-	op_t undo_op;
+	OPS op;               /* Operation, its undo counterpart is undo_op[op]. */
+	void *do_data;        /* Data of the operation. */
+	void *undo_data;      /* Data of the undo operation. */
+	const char *dirs[2];  /* Directories of buf1 and buf2 or NULL if a path
+	                         doesn't have a slash. */
+	const char *names[2]; /* Rest of buf1 and buf2. */
+	long spill_pos;       /* Offset of paths in the spill file of the group or
+	                         -1 if they are in memory. */
 
 	group_t *group;
 	struct cmd_t *prev;
@@ -227,16 +257,37 @@ static char *group_msg;
 
 static int command_count;
 
+/* Size of arena of a group after which paths of its new commands are written
+ * to a temporary file. */
+static size_t spill_limit = 8U*1024U*1024U;
+
 static int no_function(void);
-static void init_cmd(cmd_t *cmd, OPS op, void *do_data, void *undo_data);
-static void init_entry(cmd_t *cmd, const char **e, int type);
+TSTATIC size_t un_set_spill_limit(size_t limit);
+static group_t * create_group(const char msg[]);
+static void free_group(group_t *group);
+static void * arena_alloc(group_t *group, size_t size);
+static int set_operands(cmd_t *cmd, group_t *group, const char buf1[],
+		const char buf2[]);
+static int spill_operands(cmd_t *cmd, group_t *group, const char buf1[],
+		const char buf2[]);
+static int set_operand(cmd_t *cmd, group_t *group, int i, const char path[]);
+static void free_op_data(OPS op, void *do_data, void *undo_data);
+static int load_op(const cmd_t *cmd, int undo, op_t *op);
+static void free_op(op_t *op);
+static int get_operands(const cmd_t *cmd, char **buf1, char **buf2);
+static char * get_operand(const cmd_t *cmd, int i);
+static char * read_spilled(FILE *fp, size_t len);
+static const char * get_entry(const op_t *op, int type);
 static void remove_cmd(cmd_t *cmd);
 static int is_undo_group_possible(void);
 static int is_redo_group_possible(void);
+static int perform_cmd(const cmd_t *cmd, int undo);
+static int is_cmd_possible(cmd_t *cmd, int undo);
 static int is_op_possible(const op_t *op);
 static void change_filename_in_trash(cmd_t *cmd, const char filename[]);
-static void update_entry(const char **e, const char old[], const char new[]);
 static char ** fill_undolist_detail(char **list);
+static char * format_cmd_desc(const cmd_t *cmd, int undo,
+		const char prefix[]);
 static const char * get_op_desc(op_t op);
 static char ** fill_undolist_nondetail(char **list);
 
@@ -259,6 +310,16 @@ no_function(void)
 	return 0;
 }
 
+/* Sets size of memory of a group after which paths of its commands are kept in
+ * a temporary file.  Returns previous value. */
+TSTATIC size_t
+un_set_spill_limit(size_t limit)
+{
+	const size_t prev = spill_limit;
+	spill_limit = limit;
+	return prev;
+}
+
 void
 un_reset(void)
 {
@@ -312,7 +373,6 @@ int
 un_group_add_op(OPS op, void *do_data, void *undo_data, const char buf1[],
 		const char buf2[])
 {
-	int mem_error;
 	cmd_t *cmd;
 
 	assert(group_opened);
@@ -328,47 +388,43 @@ un_group_add_op(OPS op, void *do_data, void *undo_data, const char buf1[],
 
 	if(*undo_levels <= 0)
 	{
-		if(data_is_ptr[op])
-		{
-			free(do_data);
-		}
-		if(data_is_ptr[undo_op[op]])
-		{
-			free(undo_data);
-		}
+		free_op_data(op, do_data, undo_data);
 		return 0;
 	}
 
-	command_count++;
-
 	/* add operation to the list */
-	cmd = calloc(1, sizeof(*cmd));
-	if(cmd == NULL)
-		return -1;
-
-	cmd->buf1 = strdup(buf1);
-	cmd->buf2 = strdup(buf2);
-	cmd->prev = current;
-	init_cmd(cmd, op, do_data, undo_data);
-	if(last_group != NULL)
+	group_t *group = last_group;
+	if(group == NULL)
 	{
-		cmd->group = last_group;
-	}
-	else if((cmd->group = malloc(sizeof(group_t))) != NULL)
-	{
-		cmd->group->msg = strdup(group_msg);
-		cmd->group->error = 0;
-		cmd->group->balance = 0;
-		cmd->group->can_undone = 1;
-		cmd->group->incomplete = 0;
+		group = create_group(group_msg);
+		if(group == NULL)
+		{
+			free_op_data(op, do_data, undo_data);
+			return -1;
+		}
 	}
-	mem_error = cmd->group == NULL || cmd->buf1 == NULL || cmd->buf2 == NULL;
-	if(mem_error)
+
+	cmd = arena_alloc(group, sizeof(*cmd));
+	if(cmd == NULL || set_operands(cmd, group, buf1, buf2) != 0)
 	{
-		remove_cmd(cmd);
+		free_op_data(op, do_data, undo_data);
+		if(group->ncmds == 0)
+		{
+			free_group(group);
+		}
 		return -1;
 	}
-	last_group = cmd->group;
+
+	cmd->op = op;
+	cmd->do_data = do_data;
+	cmd->undo_data = undo_data;
+	cmd->group = group;
+	cmd->prev = current;
+	cmd->next = NULL;
+
+	++group->ncmds;
+	last_group = group;
+	++command_count;
 
 	if(undo_op[op] == OP_NONE)
 		cmd->group->can_undone = 0;
@@ -380,78 +436,369 @@ un_group_add_op(OPS op, void *do_data, void *undo_data, const char buf1[],
 	return 0;
 }
 
+/* Allocates new group with the message.  Returns the group or NULL on
+ * error. */
+static group_t *
+create_group(const char msg[])
+{
+	group_t *const group = malloc(sizeof(*group));
+	if(group == NULL)
+	{
+		return NULL;
+	}
+
+	group->msg = strdup(msg);
+	if(group->msg == NULL)
+	{
+		free(group);
+		return NULL;
+	}
+
+	group->error = 0;
+	group->balance = 0;
+	group->can_undone = 1;
+	group->incomplete = 0;
+	group->ncmds = 0;
+	group->arena = NULL;
+	group->mem = 0U;
+	group->dirs[0] = NULL;
+	group->dirs[1] = NULL;
+	group->spill = NULL;
+	return group;
+}
+
+/* Frees group along with all of its commands. */
+static void
+free_group(group_t *group)
+{
+	arena_block_t *block = group->arena;
+	while(block != NULL)
+	{
+		arena_block_t *const prev = block->prev;
+		free(block);
+		block = prev;
+	}
+
+	if(group->spill != NULL)
+	{
+		fclose(group->spill);
+	}
+
+	free(group->msg);
+	free(group);
+}
+
+/* Allocates memory that lives as long as the group.  Returns pointer to
+ * the memory or NULL on error. */
+static void *
+arena_alloc(group_t *group, size_t size)
+{
+	/* Blocks grow from small to not waste memory on groups of few commands. */
+	enum { MIN_BLOCK = 256U, MAX_BLOCK = 64U*1024U };
+
+	/* Round size up to keep alignment. */
+	size = (size + sizeof(void *) - 1U)/sizeof(void *)*sizeof(void *);
+
+	arena_block_t *block = group->arena;
+	if(block == NULL || block->size - block->used < size)
+	{
+		size_t block_size = (block == NULL ? MIN_BLOCK : block->size*2U);
+		if(block_size > MAX_BLOCK)
+		{
+			block_size = MAX_BLOCK;
+		}
+		if(block_size < size)
+		{
+			block_size = size;
+		}
+
+		block = malloc(sizeof(*block) + block_size);
+		if(block == NULL)
+		{
+			return NULL;
+		}
+
+		block->prev = group->arena;
+		block->size = block_size;
+		block->used = 0U;
+		group->arena = block;
+		group->mem += block_size;
+	}
+
+	void *const ptr = (char *)block->data + block->used;
+	block->used += size;
+	return ptr;
+}
+
+/* Stores paths of operands of the command in memory or in the spill file if
+ * the group is too big.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+set_operands(cmd_t *cmd, group_t *group, const char buf1[], const char buf2[])
+{
+	if(group->mem >= spill_limit && spill_operands(cmd, group, buf1, buf2) == 0)
+	{
+		return 0;
+	}
+
+	cmd->spill_pos = -1;
+	return set_operand(cmd, group, 0, buf1) != 0 ||
+	       set_operand(cmd, group, 1, buf2) != 0;
+}
+
+/* Appends paths of operands of the command to the spill file of the group.
+ * Each record is two lengths followed by the two strings.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+spill_operands(cmd_t *cmd, group_t *group, const char buf1[],
+		const char buf2[])
+{
+	if(group->spill == NULL)
+	{
+		group->spill = tmpfile();
+		if(group->spill == NULL)
+		{
+			return 1;
+		}
+	}
+
+	const size_t lens[2] = { strlen(buf1), strlen(buf2) };
+
+	FILE *const fp = group->spill;
+	if(fseek(fp, 0L, SEEK_END) != 0)
+	{
+		return 1;
+	}
+	const long pos = ftell(fp);
+	if(pos < 0L || fwrite(lens, sizeof(lens), 1U, fp) != 1U ||
+			fwrite(buf1, lens[0], 1U, fp) != (lens[0] != 0U) ||
+			fwrite(buf2, lens[1], 1U, fp) != (lens[1] != 0U))
+	{
+		return 1;
+	}
+
+	cmd->spill_pos = pos;
+	cmd->dirs[0] = NULL;
+	cmd->dirs[1] = NULL;
+	cmd->names[0] = NULL;
+	cmd->names[1] = NULL;
+	return 0;
+}
+
+/* Stores path of an operand of the command in compact form.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+set_operand(cmd_t *cmd, group_t *group, int i, const char path[])
+{
+	const char *name = path;
+	const char *dir = NULL;
+
+	const char *const slash = strrchr(path, '/');
+	if(slash != NULL)
+	{
+		const size_t dir_len = slash - path;
+		name = slash + 1;
+
+		/* Consecutive commands of a group usually work within the same pair of
+		 * directories. */
+		const char *const last = group->dirs[i];
+		if(last != NULL && strncmp(last, path, dir_len) == 0 &&
+				last[dir_len] == '\0')
+		{
+			dir = last;
+		}
+		else
+		{
+			char *const copy = arena_alloc(group, dir_len + 1U);
+			if(copy == NULL)
+			{
+				return 1;
+			}
+			copy_str(copy, dir_len + 1U, path);
+			dir = copy;
+			group->dirs[i] = copy;
+		}
+	}
+
+	if(name[0] != '\0')
+	{
+		const size_t len = strlen(name);
+		char *const copy = arena_alloc(group, len + 1U);
+		if(copy == NULL)
+		{
+			return 1;
+		}
+		strcpy(copy, name);
+		name = copy;
+	}
+	else
+	{
+		name = "";
+	}
+
+	cmd->dirs[i] = dir;
+	cmd->names[i] = name;
+	return 0;
+}
+
+/* Frees data of an operation that's not going to be stored. */
 static void
-init_cmd(cmd_t *cmd, OPS op, void *do_data, void *undo_data)
-{
-	cmd->do_op.op = op;
-	cmd->do_op.data = do_data;
-	cmd->undo_op.op = undo_op[op];
-	cmd->undo_op.data = undo_data;
-	init_entry(cmd, &cmd->do_op.src, opers[op][0]);
-	init_entry(cmd, &cmd->do_op.dst, opers[op][1]);
-	init_entry(cmd, &cmd->do_op.exists, opers[op][2]);
-	init_entry(cmd, &cmd->do_op.dont_exist, opers[op][3]);
-	init_entry(cmd, &cmd->undo_op.src, opers[op][4]);
-	init_entry(cmd, &cmd->undo_op.dst, opers[op][5]);
-	init_entry(cmd, &cmd->undo_op.exists, opers[op][6]);
-	init_entry(cmd, &cmd->undo_op.dont_exist, opers[op][7]);
+free_op_data(OPS op, void *do_data, void *undo_data)
+{
+	if(data_is_ptr[op])
+	{
+		free(do_data);
+	}
+	if(data_is_ptr[undo_op[op]])
+	{
+		free(undo_data);
+	}
 }
 
+/* Fills *op with do (undo is zero) or undo (undo is non-zero) operation of the
+ * command.  The structure should be freed with free_op().  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+load_op(const cmd_t *cmd, int undo, op_t *op)
+{
+	const int base = (undo ? 4 : 0);
+
+	op->op = (undo ? undo_op[cmd->op] : cmd->op);
+	op->data = (undo ? cmd->undo_data : cmd->do_data);
+
+	if(get_operands(cmd, &op->buf1, &op->buf2) != 0)
+	{
+		return 1;
+	}
+
+	op->src = get_entry(op, opers[cmd->op][base + 0]);
+	op->dst = get_entry(op, opers[cmd->op][base + 1]);
+	op->exists = get_entry(op, opers[cmd->op][base + 2]);
+	op->dont_exist = get_entry(op, opers[cmd->op][base + 3]);
+	return 0;
+}
+
+/* Frees resources of an operation loaded by load_op(). */
 static void
-init_entry(cmd_t *cmd, const char **e, int type)
+free_op(op_t *op)
+{
+	free(op->buf1);
+	free(op->buf2);
+}
+
+/* Retrieves full paths of both operands of the command, reading them from
+ * the spill file if necessary.  Strings should be freed by the caller.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+get_operands(const cmd_t *cmd, char **buf1, char **buf2)
+{
+	if(cmd->spill_pos < 0)
+	{
+		*buf1 = get_operand(cmd, 0);
+		*buf2 = get_operand(cmd, 1);
+	}
+	else
+	{
+		FILE *const fp = cmd->group->spill;
+		size_t lens[2];
+		if(fseek(fp, cmd->spill_pos, SEEK_SET) != 0 ||
+				fread(lens, sizeof(lens), 1U, fp) != 1U)
+		{
+			return 1;
+		}
+
+		*buf1 = read_spilled(fp, lens[0]);
+		*buf2 = (*buf1 == NULL ? NULL : read_spilled(fp, lens[1]));
+	}
+
+	if(*buf1 == NULL || *buf2 == NULL)
+	{
+		free(*buf1);
+		free(*buf2);
+		return 1;
+	}
+	return 0;
+}
+
+/* Reads string of specified length from current position of the file.
+ * Returns newly allocated string or NULL on error. */
+static char *
+read_spilled(FILE *fp, size_t len)
+{
+	char *const str = malloc(len + 1U);
+	if(str == NULL)
+	{
+		return NULL;
+	}
+
+	if(len != 0U && fread(str, len, 1U, fp) != 1U)
+	{
+		free(str);
+		return NULL;
+	}
+
+	str[len] = '\0';
+	return str;
+}
+
+/* Formats full path of an operand of the command, which is stored in memory.
+ * Returns newly allocated string or NULL on error. */
+static char *
+get_operand(const cmd_t *cmd, int i)
+{
+	if(cmd->dirs[i] == NULL)
+	{
+		return strdup(cmd->names[i]);
+	}
+	return format_str("%s/%s", cmd->dirs[i], cmd->names[i]);
+}
+
+/* Retrieves path of an operation that corresponds to the type.  Returns the
+ * path or NULL. */
+static const char *
+get_entry(const op_t *op, int type)
 {
 	if(type == OPER_NON)
-		*e = NULL;
+		return NULL;
 	else if(type == OPER_1ST)
-		*e = cmd->buf1;
+		return op->buf1;
 	else
-		*e = cmd->buf2;
+		return op->buf2;
 }
 
 static void
 remove_cmd(cmd_t *cmd)
 {
-	int last_cmd_in_group = 1;
-
 	if(cmd == current)
 		current = cmd->prev;
 
 	if(cmd->prev != NULL)
 	{
 		cmd->prev->next = cmd->next;
-		if(cmd->group == cmd->prev->group)
-			last_cmd_in_group = 0;
 	}
 	if(cmd->next != NULL)
 	{
 		cmd->next->prev = cmd->prev;
-		if(cmd->group == cmd->next->group)
-			last_cmd_in_group = 0;
 	}
 	else /* this is the last command in the list */
 	{
 		cmds.prev = cmd->prev;
 	}
 
-	if(last_cmd_in_group)
+	free_op_data(cmd->op, cmd->do_data, cmd->undo_data);
+
+	/* Memory of the command is reclaimed along with the group. */
+	group_t *const group = cmd->group;
+	if(--group->ncmds == 0)
 	{
-		free(cmd->group->msg);
-		free(cmd->group);
-		if(last_group == cmd->group)
+		if(last_group == group)
 			last_group = NULL;
+		free_group(group);
 	}
 	else
 	{
-		cmd->group->incomplete = 1;
+		group->incomplete = 1;
 	}
-	free(cmd->buf1);
-	free(cmd->buf2);
-	if(data_is_ptr[cmd->do_op.op])
-		free(cmd->do_op.data);
-	if(data_is_ptr[cmd->undo_op.op])
-		free(cmd->undo_op.data);
-
-	free(cmd);
 
 	command_count--;
 }
@@ -506,8 +853,7 @@ un_group_undo(void)
 	{
 		if(!skip)
 		{
-			int err = do_func(current->undo_op.op, current->undo_op.data,
-					current->undo_op.src, current->undo_op.dst);
+			int err = perform_cmd(current, 1);
 			if(err == SKIP_UNDO_REDO_OPERATION)
 			{
 				skip = 1;
@@ -532,18 +878,30 @@ un_group_undo(void)
 	return UN_ERR_SUCCESS;
 }
 
+/* Performs do (undo is zero) or undo (undo is non-zero) operation of the
+ * command.  Returns result of do_func(). */
+static int
+perform_cmd(const cmd_t *cmd, int undo)
+{
+	op_t op;
+	if(load_op(cmd, undo, &op) != 0)
+	{
+		return 1;
+	}
+
+	const int err = do_func(op.op, op.data, op.src, op.dst);
+	free_op(&op);
+	return err;
+}
+
 static int
 is_undo_group_possible(void)
 {
 	cmd_t *cmd = current;
 	do
 	{
-		int ret;
-		ret = is_op_possible(&cmd->undo_op);
-		if(ret == 0)
+		if(!is_cmd_possible(cmd, 1))
 			return 0;
-		else if(ret < 0)
-			change_filename_in_trash(cmd, cmd->undo_op.dst);
 		cmd = cmd->prev;
 	}
 	while(cmd != &cmds && cmd->group == cmd->next->group);
@@ -581,8 +939,7 @@ un_group_redo(void)
 		current = current->next;
 		if(!skip)
 		{
-			int err = do_func(current->do_op.op, current->do_op.data,
-					current->do_op.src, current->do_op.dst);
+			int err = perform_cmd(current, 0);
 			if(err == SKIP_UNDO_REDO_OPERATION)
 			{
 				current->next->group->balance--;
@@ -612,18 +969,36 @@ is_redo_group_possible(void)
 	cmd_t *cmd = current;
 	do
 	{
-		int ret;
 		cmd = cmd->next;
-		ret = is_op_possible(&cmd->do_op);
-		if(ret == 0)
+		if(!is_cmd_possible(cmd, 0))
 			return 0;
-		else if(ret < 0)
-			change_filename_in_trash(cmd, cmd->do_op.dst);
 	}
 	while(cmd->next != NULL && cmd->group == cmd->next->group);
 	return 1;
 }
 
+/* Checks whether do (undo is zero) or undo (undo is non-zero) operation of the
+ * command can be performed, renaming destination in trash if that's needed.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_cmd_possible(cmd_t *cmd, int undo)
+{
+	op_t op;
+	if(load_op(cmd, undo, &op) != 0)
+	{
+		return 0;
+	}
+
+	const int ret = is_op_possible(&op);
+	if(ret < 0)
+	{
+		change_filename_in_trash(cmd, op.dst);
+	}
+
+	free_op(&op);
+	return (ret != 0);
+}
+
 /*
  * Return value:
  *   0 - impossible
@@ -659,7 +1034,6 @@ change_filename_in_trash(cmd_t *cmd, const char filename[])
 {
 	const char *name_tail;
 	char *new;
-	char *old;
 	char *const base_dir = strdup(filename);
 
 	remove_last_path_component(base_dir);
@@ -670,31 +1044,24 @@ change_filename_in_trash(cmd_t *cmd, const char filename[])
 
 	free(base_dir);
 
-	old = cmd->buf2;
-	cmd->buf2 = new;
-
 	regs_rename_contents(filename, new);
 
-	update_entry(&cmd->do_op.src, old, cmd->buf2);
-	update_entry(&cmd->do_op.dst, old, cmd->buf2);
-	update_entry(&cmd->do_op.exists, old, cmd->buf2);
-	update_entry(&cmd->do_op.dont_exist, old, cmd->buf2);
-	update_entry(&cmd->undo_op.src, old, cmd->buf2);
-	update_entry(&cmd->undo_op.dst, old, cmd->buf2);
-	update_entry(&cmd->undo_op.exists, old, cmd->buf2);
-	update_entry(&cmd->undo_op.dont_exist, old, cmd->buf2);
-
-	free(old);
-}
-
-/* Checks whether *e equals old and updates it to new if so. */
-static void
-update_entry(const char **e, const char old[], const char new[])
-{
-	if(*e == old)
+	/* Failure to allocate memory keeps old path, which will fail later. */
+	if(cmd->spill_pos < 0)
 	{
-		*e = new;
+		(void)set_operand(cmd, cmd->group, 1, new);
 	}
+	else
+	{
+		char *buf1, *buf2;
+		if(get_operands(cmd, &buf1, &buf2) == 0)
+		{
+			(void)spill_operands(cmd, cmd->group, buf1, new);
+			free(buf1);
+			free(buf2);
+		}
+	}
+	free(new);
 }
 
 char **
@@ -749,17 +1116,13 @@ fill_undolist_detail(char **list)
 		list++;
 		do
 		{
-			const char *p;
-
-			p = get_op_desc(cmd->do_op);
-			if((*list = format_str("  do: %s", p)) == NULL)
+			if((*list = format_cmd_desc(cmd, 0, "  do: ")) == NULL)
 			{
 				return list;
 			}
 			++list;
 
-			p = get_op_desc(cmd->undo_op);
-			if((*list = format_str("  undo: %s", p)) == NULL)
+			if((*list = format_cmd_desc(cmd, 1, "  undo: ")) == NULL)
 			{
 				return list;
 			}
@@ -774,6 +1137,23 @@ fill_undolist_detail(char **list)
 	return list;
 }
 
+/* Formats description of do (undo is zero) or undo (undo is non-zero)
+ * operation of the command with a prefix.  Returns newly allocated string or
+ * NULL on error. */
+static char *
+format_cmd_desc(const cmd_t *cmd, int undo, const char prefix[])
+{
+	op_t op;
+	if(load_op(cmd, undo, &op) != 0)
+	{
+		return NULL;
+	}
+
+	char *const desc = format_str("%s%s", prefix, get_op_desc(op));
+	free_op(&op);
+	return desc;
+}
+
 static const char *
 get_op_desc(op_t op)
 {
@@ -932,18 +1312,15 @@ un_clear_cmds_with_trash(const char trash_dir[])
 	{
 		cmd_t *prev = cur->prev;
 
-		if(cur->group->balance < 0)
+		/* Check operation that will be performed next. */
+		op_t op;
+		if(load_op(cur, cur->group->balance >= 0, &op) == 0)
 		{
-			if(cur->do_op.exists != NULL &&
-					trash_has_path_at(trash_dir, cur->do_op.exists))
-			{
-				remove_cmd(cur);
-			}
-		}
-		else
-		{
-			if(cur->undo_op.exists != NULL &&
-					trash_has_path_at(trash_dir, cur->undo_op.exists))
+			const int in_trash = (op.exists != NULL &&
+					trash_has_path_at(trash_dir, op.exists));
+			free_op(&op);
+
+			if(in_trash)
 			{
 				remove_cmd(cur);
 			}
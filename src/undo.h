@@ -19,7 +19,10 @@
 #ifndef VIFM__UNDO_H__
 #define VIFM__UNDO_H__
 
+#include <stddef.h> /* size_t */
+
 #include "ops.h"
+#include "utils/test_helpers.h"
 
 enum
 {
@@ -112,6 +115,12 @@ void un_set_pos(int pos, int detail);
  * special value NULL means "all trash directories". */
 void un_clear_cmds_with_trash(const char trash_dir[]);
 
+TSTATIC_DEFS(
+	/* Sets size of memory of a group after which paths of its commands are kept
+	 * in a temporary file.  Returns previous value. */
+	size_t un_set_spill_limit(size_t limit);
+)
+
 #endif /* VIFM__UNDO_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
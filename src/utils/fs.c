@@ -29,13 +29,13 @@
 
 #include <sys/stat.h> /* S_* statbuf */
 #include <sys/types.h> /* size_t mode_t */
-#include <unistd.h> /* pathconf() readlink() */
+#include <unistd.h> /* close() pathconf() readlink() */
 
 #include <ctype.h> /* isalpha() */
 #include <errno.h> /* errno */
 #include <stddef.h> /* NULL */
-#include <stdio.h> /* snprintf() remove() */
-#include <stdlib.h> /* free() */
+#include <stdio.h> /* FILE fdopen() snprintf() remove() */
+#include <stdlib.h> /* free() mkstemp() */
 #include <string.h> /* strcpy() strdup() strlen() strncmp() strncpy() */
 
 #include "../compat/dtype.h"
@@ -558,6 +558,33 @@ rename_file(const char src[], const char dst[])
 	return error != 0;
 }
 
+FILE *
+make_file_for_rename(const char path[], char tmp_path[], size_t len)
+{
+#ifndef _WIN32
+	snprintf(tmp_path, len, "%s_XXXXXX", path);
+	const int fd = mkstemp(tmp_path);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	FILE *const fp = fdopen(fd, "wb");
+	if(fp == NULL)
+	{
+		close(fd);
+		(void)remove(tmp_path);
+	}
+	return fp;
+#else
+	/* Counter makes names unique among threads of this process. */
+	static unsigned int counter;
+	const unsigned int n = __atomic_fetch_add(&counter, 1U, __ATOMIC_RELAXED);
+	snprintf(tmp_path, len, "%s_%u_%u", path, get_pid(), n);
+	return os_fopen(tmp_path, "wb");
+#endif
+}
+
 void
 remove_dir_content(const char path[])
 {
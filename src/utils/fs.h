@@ -24,6 +24,7 @@
 
 #include <stddef.h> /* size_t */
 #include <stdint.h> /* uint32_t uint64_t */
+#include <stdio.h> /* FILE */
 
 /* Functions to deal with file system objects */
 
@@ -152,6 +153,11 @@ int is_regular_file_noderef(const char path[]);
  * error, otherwise zero is returned. */
 int rename_file(const char src[], const char dst[]);
 
+/* Creates and opens for writing a new file with unique name next to the file
+ * at the path to be renamed over it later.  Name of the new file is written to
+ * the buffer.  Returns opened file or NULL on error. */
+FILE * make_file_for_rename(const char path[], char tmp_path[], size_t len);
+
 /* Removes directory content, but not the directory itself. */
 void remove_dir_content(const char path[]);
 
@@ -16,34 +16,44 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
-/* The implementation is a tree (with links to leftmost child and right
- * sibling), which is traversed according to slash separated path.  Siblings are
- * sorted by name. */
+/* The implementation is a tree, which is traversed according to slash
+ * separated path.  Children of a node are stored in an array sorted by name.
+ * Once there are many of them, the array is indexed by a hash table and new
+ * children are appended to its end, so siblings are sorted only on
+ * traversal. */
 
 #include "fsdata.h"
 #include "private/fsdata.h"
 
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* free() malloc() */
-#include <string.h> /* memcpy() */
+#include <stdlib.h> /* free() malloc() qsort() realloc() */
+#include <string.h> /* memcpy() memmove() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/reallocarray.h"
+#include "hmap.h"
 #include "str.h"
 
 /* Special value for get_or_create_node()'s data_size argument to prevent it
  * from creating a node. */
 #define NO_CREATE (size_t)-1
 
+/* Number of children at which they get indexed by a hash table. */
+#define WIDE_NODE 16U
+
 /* Tree node type. */
 typedef struct node_t
 {
-	char *name;           /* Name of this node. */
-	size_t name_len;      /* Length of the name. */
-	int valid;            /* Whether data in this node is meaningful. */
-	struct node_t *next;  /* Next sibling on this level. */
-	struct node_t *child; /* Leftmost child of this node. */
-	char data[];          /* Data associated with the node follows. */
+	char *name;                /* Name of this node. */
+	size_t name_len;           /* Length of the name. */
+	int valid;                 /* Whether data in this node is meaningful. */
+	unsigned int nchildren;    /* Number of children. */
+	struct node_t **children;  /* Children of this node, capacity is the
+	                              smallest power of two >= nchildren. */
+	hmap_t *index;             /* Name -> position in children plus one for
+	                              wide nodes, otherwise NULL. */
+	char data[];               /* Data associated with the node follows. */
 }
 node_t;
 
@@ -60,6 +70,10 @@ static void do_nothing(void *data);
 static void nodes_free(node_t *node, fsd_cleanup_func cleanup);
 static node_t * get_or_create_node(node_t *root, const char path[],
 		size_t data_size, node_t **last, node_t **link);
+static int find_child(const node_t *node, const char name[], size_t name_len,
+		unsigned int *pos);
+static int insert_child(node_t *node, unsigned int pos, node_t *child);
+static hmap_key_t get_name_key(const char name[], size_t name_len);
 static node_t * make_node(const char name[], size_t name_len, size_t data_size);
 static int map_parents(node_t *root, const char path[],
 		fsdata_visit_func visitor, void *arg);
@@ -67,6 +81,9 @@ static int resolve_path(const fsdata_t *fsd, const char path[],
 		char real_path[]);
 static int traverse_node(node_t *node, const node_t *parent,
 		fsdata_traverser_func traverser, void *arg);
+static int traverse_children(node_t *node, const node_t *parent,
+		fsdata_traverser_func traverser, void *arg);
+static int node_sorter(const void *first, const void *second);
 
 fsdata_t *
 fsdata_create(int prefix, int resolve_paths)
@@ -121,8 +138,13 @@ nodes_free(node_t *node, fsd_cleanup_func cleanup)
 		cleanup(&node->data);
 	}
 
-	nodes_free(node->child, cleanup);
-	nodes_free(node->next, cleanup);
+	unsigned int i;
+	for(i = 0U; i < node->nchildren; ++i)
+	{
+		nodes_free(node->children[i], cleanup);
+	}
+	free(node->children);
+	hmap_free(node->index);
 
 	free(node->name);
 	free(node);
@@ -205,7 +227,7 @@ get_or_create_node(node_t *root, const char path[], size_t data_size,
 {
 	const char *end;
 	size_t name_len;
-	node_t *prev = NULL, *curr;
+	unsigned int pos;
 	node_t *new_node;
 
 	path = skip_char(path, '/');
@@ -223,28 +245,17 @@ get_or_create_node(node_t *root, const char path[], size_t data_size,
 	}
 
 	end = until_first(path, '/');
-
 	name_len = end - path;
-	curr = root->child;
-	while(curr != NULL)
+
+	if(find_child(root, path, name_len, &pos))
 	{
-		int comp = strnoscmp(path, curr->name, name_len);
-		if(comp == 0 && curr->name_len == name_len)
+		node_t *const child = root->children[pos];
+		if(child->valid && last != NULL)
 		{
-			if(curr->valid && last != NULL)
-			{
-				*last = curr;
-			}
-			return get_or_create_node(curr, end, data_size, last,
-					(data_size == NO_CREATE) ? NULL :
-					(root->child == curr) ? &root->child : &prev->next);
+			*last = child;
 		}
-		else if(comp < 0)
-		{
-			break;
-		}
-		prev = curr;
-		curr = curr->next;
+		return get_or_create_node(child, end, data_size, last,
+				(data_size == NO_CREATE) ? NULL : &root->children[pos]);
 	}
 
 	if(data_size == NO_CREATE)
@@ -258,21 +269,162 @@ get_or_create_node(node_t *root, const char path[], size_t data_size,
 		return NULL;
 	}
 
-	new_node->next = curr;
-
-	if(root->child == curr)
+	if(insert_child(root, pos, new_node) != 0)
 	{
-		root->child = new_node;
-	}
-	else
-	{
-		prev->next = new_node;
+		free(new_node->name);
+		free(new_node);
+		return NULL;
 	}
+
 	/* No need to update anything here, because size is guaranteed to be the
 	 * same. */
 	return get_or_create_node(new_node, end, data_size, last, NULL);
 }
 
+/* Looks up child of a node by its name.  Sets *pos to position of the child if
+ * it's found or to position where it should be inserted otherwise.  Returns
+ * non-zero if the child is found, otherwise zero is returned. */
+static int
+find_child(const node_t *node, const char name[], size_t name_len,
+		unsigned int *pos)
+{
+	unsigned int i;
+
+	if(node->index != NULL)
+	{
+		/* Wide nodes aren't sorted, new children are appended. */
+		*pos = node->nchildren;
+
+		const int *const rec = hmap_get(node->index,
+				get_name_key(name, name_len));
+		if(rec == NULL)
+		{
+			return 0;
+		}
+
+		const node_t *const child = node->children[*rec - 1];
+		if(child->name_len == name_len &&
+				strnoscmp(name, child->name, name_len) == 0)
+		{
+			*pos = *rec - 1;
+			return 1;
+		}
+
+		/* Collision of keys, resort to checking all children. */
+		for(i = 0U; i < node->nchildren; ++i)
+		{
+			const node_t *const child = node->children[i];
+			if(child->name_len == name_len &&
+					strnoscmp(name, child->name, name_len) == 0)
+			{
+				*pos = i;
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	for(i = 0U; i < node->nchildren; ++i)
+	{
+		const node_t *const child = node->children[i];
+		const int comp = strnoscmp(name, child->name, name_len);
+		if(comp == 0 && child->name_len == name_len)
+		{
+			*pos = i;
+			return 1;
+		}
+		if(comp < 0)
+		{
+			break;
+		}
+	}
+
+	*pos = i;
+	return 0;
+}
+
+/* Inserts child at specified position, indexing children if there are too many
+ * of them.  Returns zero on success, otherwise non-zero is returned. */
+static int
+insert_child(node_t *node, unsigned int pos, node_t *child)
+{
+	/* Capacity is grown in powers of two. */
+	const unsigned int n = node->nchildren;
+	if((n & (n - 1U)) == 0U)
+	{
+		void *const p = reallocarray(node->children, n == 0U ? 1U : n*2U,
+				sizeof(*node->children));
+		if(p == NULL)
+		{
+			return 1;
+		}
+		node->children = p;
+	}
+
+	if(node->index == NULL && n + 1U >= WIDE_NODE)
+	{
+		node->index = hmap_create(sizeof(int));
+		if(node->index == NULL)
+		{
+			return 1;
+		}
+
+		unsigned int i;
+		for(i = 0U; i < n; ++i)
+		{
+			const node_t *const c = node->children[i];
+			int created;
+			int *const rec = hmap_put(node->index,
+					get_name_key(c->name, c->name_len), &created);
+			if(rec == NULL)
+			{
+				hmap_free(node->index);
+				node->index = NULL;
+				return 1;
+			}
+			if(created)
+			{
+				*rec = i + 1;
+			}
+		}
+
+		/* Appending to the end from now on. */
+		pos = n;
+	}
+
+	if(node->index != NULL)
+	{
+		int created;
+		int *const rec = hmap_put(node->index,
+				get_name_key(child->name, child->name_len), &created);
+		if(rec == NULL)
+		{
+			return 1;
+		}
+		if(created)
+		{
+			*rec = pos + 1;
+		}
+	}
+
+	memmove(&node->children[pos + 1U], &node->children[pos],
+			sizeof(*node->children)*(n - pos));
+	node->children[pos] = child;
+	++node->nchildren;
+	return 0;
+}
+
+/* Computes key of a node name for the index of children.  Returns the key. */
+static hmap_key_t
+get_name_key(const char name[], size_t name_len)
+{
+#ifndef _WIN32
+	return hmap_str_key(name, name_len);
+#else
+	return hmap_istr_key(name, name_len);
+#endif
+}
+
 /* Creates new node for the tree.  Returns the node or NULL on memory allocation
  * error. */
 static node_t *
@@ -294,8 +446,9 @@ make_node(const char name[], size_t name_len, size_t data_size)
 	copy_str(new_node->name, name_len + 1U, name);
 	new_node->name_len = name_len;
 	new_node->valid = 0;
-	new_node->child = NULL;
-	new_node->next = NULL;
+	new_node->nchildren = 0U;
+	new_node->children = NULL;
+	new_node->index = NULL;
 
 	return new_node;
 }
@@ -335,7 +488,7 @@ map_parents(node_t *root, const char path[], fsdata_visit_func visitor,
 {
 	const char *end;
 	size_t name_len;
-	node_t *curr;
+	unsigned int pos;
 
 	path = skip_char(path, '/');
 	if(*path == '\0')
@@ -344,29 +497,16 @@ map_parents(node_t *root, const char path[], fsdata_visit_func visitor,
 	}
 
 	end = until_first(path, '/');
-
 	name_len = end - path;
-	curr = root->child;
-	while(curr != NULL)
+
+	if(find_child(root, path, name_len, &pos) &&
+			map_parents(root->children[pos], end, visitor, arg) == 0)
 	{
-		const int cmp = strnoscmp(path, curr->name, name_len);
-		if(cmp == 0 && curr->name_len == name_len)
-		{
-			if(map_parents(curr, end, visitor, arg) == 0)
-			{
-				if(root->valid)
-				{
-					visitor(&root->data, arg);
-				}
-				return 0;
-			}
-			break;
-		}
-		else if(cmp < 0)
+		if(root->valid)
 		{
-			break;
+			visitor(&root->data, arg);
 		}
-		curr = curr->next;
+		return 0;
 	}
 
 	return 1;
@@ -375,21 +515,12 @@ map_parents(node_t *root, const char path[], fsdata_visit_func visitor,
 int
 fsdata_traverse(fsdata_t *fsd, fsdata_traverser_func traverser, void *arg)
 {
-	node_t *node;
-
 	if(fsd->root == NULL)
 	{
 		return 0;
 	}
 
-	for(node = fsd->root->child; node != NULL; node = node->next)
-	{
-		if(traverse_node(node, NULL, traverser, arg) != 0)
-		{
-			return 1;
-		}
-	}
-	return 0;
+	return traverse_children(fsd->root, NULL, traverser, arg);
 }
 
 /* fsdata_traverse() helper which works with node_t type.  Return non-zero if
@@ -404,14 +535,54 @@ traverse_node(node_t *node, const node_t *parent,
 		return 1;
 	}
 
-	for(parent = node, node = node->child; node != NULL; node = node->next)
+	return traverse_children(node, node, traverser, arg);
+}
+
+/* Traverses children of the node in order of their names.  parent is passed
+ * to traverse_node() as their parent.  Return non-zero if traversing was
+ * stopped prematurely, otherwise zero is returned. */
+static int
+traverse_children(node_t *node, const node_t *parent,
+		fsdata_traverser_func traverser, void *arg)
+{
+	node_t **children = node->children;
+	if(node->index != NULL)
 	{
-		if(traverse_node(node, parent, traverser, arg) != 0)
+		children = reallocarray(NULL, node->nchildren, sizeof(*children));
+		if(children == NULL)
 		{
 			return 1;
 		}
+		memcpy(children, node->children, sizeof(*children)*node->nchildren);
+		qsort(children, node->nchildren, sizeof(*children), &node_sorter);
 	}
-	return 0;
+
+	int stopped = 0;
+	unsigned int i;
+	for(i = 0U; i < node->nchildren; ++i)
+	{
+		if(traverse_node(children[i], parent, traverser, arg) != 0)
+		{
+			stopped = 1;
+			break;
+		}
+	}
+
+	if(children != node->children)
+	{
+		free(children);
+	}
+	return stopped;
+}
+
+/* qsort() comparer that sorts nodes by their names.  Returns standard -1, 0, 1
+ * for comparisons. */
+static int
+node_sorter(const void *first, const void *second)
+{
+	const node_t *const a = *(const node_t **)first;
+	const node_t *const b = *(const node_t **)second;
+	return stroscmp(a->name, b->name);
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -0,0 +1,441 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "hcache.h"
+
+#include <sys/stat.h> /* stat */
+
+#include <stddef.h> /* NULL offsetof() size_t */
+#include <stdint.h> /* int64_t uint32_t uint64_t */
+#include <stdio.h> /* FILE fclose() fread() fwrite() remove() */
+#include <stdlib.h> /* bsearch() free() qsort() */
+#include <string.h> /* memcmp() memcpy() memset() strdup() */
+#include <time.h> /* time() */
+
+#include "../compat/fs_limits.h"
+#include "../compat/os.h"
+#include "../compat/reallocarray.h"
+#include "fs.h"
+#include "utils.h"
+
+/* Identifies file format. */
+#define MAGIC "VIFMHSH1"
+
+/* Size of the key part of a record. */
+#define KEY_SIZE offsetof(hcache_rec_t, prefix)
+
+/* Maximum number of records to keep in the file. */
+#define MAX_RECORDS (1024*1024)
+
+/* Header of the file. */
+typedef struct
+{
+	char magic[8];     /* Must be equal to MAGIC. */
+	uint32_t tag;      /* Tag specified by the client. */
+	uint32_t rec_size; /* Size of a record to detect layout changes. */
+	uint64_t count;    /* Number of records that follow the header. */
+}
+header_t;
+
+/* Cache of hashes. */
+struct hcache_t
+{
+	char *path;        /* Path to the file. */
+	uint32_t tag;      /* Tag of the file. */
+	hcache_rec_t *recs; /* Records sorted by their key. */
+	int count;         /* Number of records. */
+	int changed;       /* Whether there are unsaved changes. */
+};
+
+static int read_recs(const char path[], uint32_t tag, hcache_rec_t **recs);
+static int write_recs(FILE *fp, uint32_t tag, const hcache_rec_t recs[],
+		int count);
+static int merge_recs(const hcache_rec_t a[], int na, const hcache_rec_t b[],
+		int nb, hcache_rec_t **out, int *changed);
+static int fold_recs(hcache_rec_t recs[], int count);
+static int merge_data(hcache_rec_t *to, const hcache_rec_t *from);
+static int key_cmp(const void *a, const void *b);
+static int use_cmp(const void *a, const void *b);
+static uint32_t today(void);
+
+hcache_t *
+hcache_load(const char path[], uint32_t tag)
+{
+	hcache_t *const cache = calloc(1, sizeof(*cache));
+	if(cache == NULL)
+	{
+		return NULL;
+	}
+
+	cache->path = strdup(path);
+	if(cache->path == NULL)
+	{
+		free(cache);
+		return NULL;
+	}
+
+	cache->tag = tag;
+	cache->count = read_recs(path, tag, &cache->recs);
+	return cache;
+}
+
+void
+hcache_free(hcache_t *cache)
+{
+	if(cache != NULL)
+	{
+		free(cache->path);
+		free(cache->recs);
+		free(cache);
+	}
+}
+
+int
+hcache_rec_init(hcache_rec_t *rec, const char path[])
+{
+	struct stat s;
+
+	memset(rec, 0, sizeof(*rec));
+
+#ifdef _WIN32
+	/* Inode numbers aren't available, so there is no reliable key. */
+	(void)path;
+	(void)s;
+	return 1;
+#else
+	if(os_stat(path, &s) != 0)
+	{
+		return 1;
+	}
+
+	rec->dev = s.st_dev;
+	rec->inode = s.st_ino;
+	rec->size = s.st_size;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	rec->mtime = s.st_mtim.tv_sec;
+	rec->mtime_ns = s.st_mtim.tv_nsec;
+#else
+	rec->mtime = s.st_mtime;
+#endif
+	return 0;
+#endif
+}
+
+int
+hcache_get(const hcache_t *cache, hcache_rec_t *rec)
+{
+	const hcache_rec_t *const found = bsearch(rec, cache->recs, cache->count,
+			sizeof(*cache->recs), &key_cmp);
+	if(found == NULL)
+	{
+		return 1;
+	}
+
+	rec->prefix = found->prefix;
+	rec->full = found->full;
+	rec->flags = found->flags;
+	rec->used = found->used;
+	return 0;
+}
+
+void
+hcache_update(hcache_t *cache, const hcache_rec_t recs[], int count)
+{
+	if(count <= 0)
+	{
+		return;
+	}
+
+	hcache_rec_t *const sorted = reallocarray(NULL, count, sizeof(*sorted));
+	if(sorted == NULL)
+	{
+		return;
+	}
+
+	const uint32_t now = today();
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		sorted[i] = recs[i];
+		sorted[i].used = now;
+	}
+
+	safe_qsort(sorted, count, sizeof(*sorted), &key_cmp);
+	count = fold_recs(sorted, count);
+
+	hcache_rec_t *merged;
+	int changed = 0;
+	const int nmerged = merge_recs(cache->recs, cache->count, sorted, count,
+			&merged, &changed);
+	free(sorted);
+
+	if(nmerged >= 0)
+	{
+		free(cache->recs);
+		cache->recs = merged;
+		cache->count = nmerged;
+		cache->changed |= changed;
+	}
+}
+
+int
+hcache_save(hcache_t *cache)
+{
+	if(!cache->changed)
+	{
+		return 0;
+	}
+
+	/* Pick up changes made by other instances, our records take precedence. */
+	hcache_rec_t *on_disk;
+	const int non_disk = read_recs(cache->path, cache->tag, &on_disk);
+	hcache_rec_t *merged;
+	int changed;
+	const int nmerged = merge_recs(on_disk, non_disk, cache->recs, cache->count,
+			&merged, &changed);
+	free(on_disk);
+	if(nmerged < 0)
+	{
+		return 1;
+	}
+
+	free(cache->recs);
+	cache->recs = merged;
+	cache->count = nmerged;
+
+	if(cache->count > MAX_RECORDS)
+	{
+		/* Drop least recently used records. */
+		safe_qsort(cache->recs, cache->count, sizeof(*cache->recs), &use_cmp);
+		cache->count = MAX_RECORDS;
+		safe_qsort(cache->recs, cache->count, sizeof(*cache->recs), &key_cmp);
+	}
+
+	char tmp_file[PATH_MAX + 64];
+	FILE *const fp = make_file_for_rename(cache->path, tmp_file,
+			sizeof(tmp_file));
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	if(write_recs(fp, cache->tag, cache->recs, cache->count) != 0 ||
+			rename_file(tmp_file, cache->path) != 0)
+	{
+		(void)remove(tmp_file);
+		return 1;
+	}
+
+	cache->changed = 0;
+	return 0;
+}
+
+int
+hcache_size(const hcache_t *cache)
+{
+	return cache->count;
+}
+
+/* Reads records from a file.  On failure *recs is set to NULL.  Returns number
+ * of read records. */
+static int
+read_recs(const char path[], uint32_t tag, hcache_rec_t **recs)
+{
+	header_t header;
+	int count;
+	FILE *const fp = os_fopen(path, "rb");
+
+	*recs = NULL;
+	if(fp == NULL)
+	{
+		return 0;
+	}
+
+	if(fread(&header, sizeof(header), 1, fp) != 1 ||
+			memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 ||
+			header.tag != tag || header.rec_size != sizeof(**recs) ||
+			header.count > MAX_RECORDS)
+	{
+		fclose(fp);
+		return 0;
+	}
+
+	count = header.count;
+	*recs = reallocarray(NULL, count, sizeof(**recs));
+	if(*recs == NULL || fread(*recs, sizeof(**recs), count, fp) != (size_t)count)
+	{
+		free(*recs);
+		*recs = NULL;
+		fclose(fp);
+		return 0;
+	}
+
+	fclose(fp);
+
+	/* Make sure that records are sorted and unique even if the file was
+	 * corrupted somehow. */
+	int i;
+	for(i = 1; i < count; ++i)
+	{
+		if(key_cmp(&(*recs)[i - 1], &(*recs)[i]) >= 0)
+		{
+			safe_qsort(*recs, count, sizeof(**recs), &key_cmp);
+			count = fold_recs(*recs, count);
+			break;
+		}
+	}
+
+	return count;
+}
+
+/* Writes records to a file and closes it.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+write_recs(FILE *fp, uint32_t tag, const hcache_rec_t recs[], int count)
+{
+	header_t header = { .tag = tag, .rec_size = sizeof(*recs), .count = count };
+	memcpy(header.magic, MAGIC, sizeof(header.magic));
+
+	int error = (fwrite(&header, sizeof(header), 1, fp) != 1);
+	if(!error && count != 0)
+	{
+		error = (fwrite(recs, sizeof(*recs), count, fp) != (size_t)count);
+	}
+
+	return (fclose(fp) != 0 || error);
+}
+
+/* Merges two sorted arrays of unique records.  Data from records of the second
+ * array is merged into matching records of the first one.  *out is set to newly
+ * allocated array.  *changed is set to non-zero if the result differs from the
+ * first array in a way that's worth saving.  Returns size of the resulting
+ * array or -1 on error. */
+static int
+merge_recs(const hcache_rec_t a[], int na, const hcache_rec_t b[], int nb,
+		hcache_rec_t **out, int *changed)
+{
+	int i = 0, j = 0, n = 0;
+
+	*changed = 0;
+
+	*out = reallocarray(NULL, na + nb, sizeof(**out));
+	if(*out == NULL && na + nb != 0)
+	{
+		return -1;
+	}
+
+	while(i < na || j < nb)
+	{
+		const int cmp = (i == na) ? 1 : (j == nb) ? -1 : key_cmp(&a[i], &b[j]);
+		if(cmp < 0)
+		{
+			(*out)[n++] = a[i++];
+		}
+		else if(cmp > 0)
+		{
+			(*out)[n++] = b[j++];
+			*changed = 1;
+		}
+		else
+		{
+			(*out)[n] = a[i++];
+			*changed |= merge_data(&(*out)[n++], &b[j++]);
+		}
+	}
+
+	return n;
+}
+
+/* Combines records with equal keys in a sorted array.  Returns new size of the
+ * array. */
+static int
+fold_recs(hcache_rec_t recs[], int count)
+{
+	int i, n = 0;
+	for(i = 0; i < count; ++i)
+	{
+		if(n != 0 && key_cmp(&recs[n - 1], &recs[i]) == 0)
+		{
+			(void)merge_data(&recs[n - 1], &recs[i]);
+		}
+		else
+		{
+			recs[n++] = recs[i];
+		}
+	}
+	return n;
+}
+
+/* Merges data of one record into data of another one with the same key.
+ * Returns non-zero if hashes have changed or time of use has advanced enough to
+ * be worth saving. */
+static int
+merge_data(hcache_rec_t *to, const hcache_rec_t *from)
+{
+	/* Granularity of persisted time of use in days. */
+	enum { USE_STEP = 7 };
+
+	const hcache_rec_t old = *to;
+
+	if(from->flags & HCF_PREFIX)
+	{
+		to->prefix = from->prefix;
+	}
+	if(from->flags & HCF_FULL)
+	{
+		to->full = from->full;
+	}
+	to->flags |= from->flags;
+	if(from->used > to->used)
+	{
+		to->used = from->used;
+	}
+
+	return to->prefix != old.prefix
+	    || to->full != old.full
+	    || to->flags != old.flags
+	    || to->used - old.used >= USE_STEP;
+}
+
+/* qsort() and bsearch() comparer that orders records by their keys.  Returns
+ * standard -1, 0, 1 for comparisons. */
+static int
+key_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, KEY_SIZE);
+}
+
+/* qsort() comparer that orders records from most recently used to least
+ * recently used ones.  Returns standard -1, 0, 1 for comparisons. */
+static int
+use_cmp(const void *a, const void *b)
+{
+	const hcache_rec_t *const x = a;
+	const hcache_rec_t *const y = b;
+	return (x->used == y->used) ? 0 : (x->used > y->used ? -1 : 1);
+}
+
+/* Retrieves current day.  Returns number of days since the Epoch. */
+static uint32_t
+today(void)
+{
+	return time(NULL)/(24*60*60);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,92 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__HCACHE_H__
+#define VIFM__UTILS__HCACHE_H__
+
+#include <stdint.h> /* int64_t uint32_t uint64_t */
+
+/* hcache - persistent cache of hashes of contents of files.  Files are
+ * identified by their device, inode, size and modification time, so changing a
+ * file invalidates its record.  Records that weren't used for a long time are
+ * dropped on saving once there are too many of them. */
+
+/* Flags that indicate which hashes are present in a record. */
+enum
+{
+	HCF_PREFIX = 1 << 0, /* hcache_rec_t::prefix is set. */
+	HCF_FULL   = 1 << 1, /* hcache_rec_t::full is set. */
+};
+
+/* Record of the cache. */
+typedef struct
+{
+	/* Key of the record. */
+	uint64_t dev;      /* Device of the file. */
+	uint64_t inode;    /* Inode of the file. */
+	uint64_t size;     /* Size of the file. */
+	int64_t mtime;     /* Modification time (seconds). */
+	int64_t mtime_ns;  /* Modification time (nanoseconds). */
+
+	/* Data of the record. */
+	uint64_t prefix;   /* Hash of a prefix of the file. */
+	uint64_t full;     /* Hash of whole contents of the file. */
+	uint32_t flags;    /* Set of HCF_* flags. */
+	uint32_t used;     /* Time of the last use (in days since the Epoch). */
+}
+hcache_rec_t;
+
+/* Declaration of opaque cache type. */
+typedef struct hcache_t hcache_t;
+
+/* Loads cache from a file.  Records of the file are ignored if it was written
+ * with a different tag (e.g., the tag can identify hashing algorithm).  Missing
+ * or broken file results in an empty cache.  Returns NULL on error. */
+hcache_t * hcache_load(const char path[], uint32_t tag);
+
+/* Frees the cache.  Freeing of NULL cache is OK. */
+void hcache_free(hcache_t *cache);
+
+/* Fills key of the record by querying information about the file specified by
+ * the path.  Hashes and flags are reset.  Returns zero on success, otherwise
+ * non-zero is returned. */
+int hcache_rec_init(hcache_rec_t *rec, const char path[]);
+
+/* Looks up record by its key and fills its data.  Can be called concurrently
+ * with other lookups, but not with updates.  Returns zero on success and
+ * non-zero if there is no such record. */
+int hcache_get(const hcache_t *cache, hcache_rec_t *rec);
+
+/* Adds new records or replaces existing ones.  Data of existing records is
+ * merged with the new data.  Records with no data are used only to mark
+ * existing records as used, which makes the cache changed only once in a few
+ * days. */
+void hcache_update(hcache_t *cache, const hcache_rec_t recs[], int count);
+
+/* Writes the cache back to the file it was loaded from if it was changed.
+ * Changes to the file done by other instances in the meantime are merged in.
+ * Returns zero on success, otherwise non-zero is returned. */
+int hcache_save(hcache_t *cache);
+
+/* Retrieves number of records in the cache.  Returns the number. */
+int hcache_size(const hcache_t *cache);
+
+#endif /* VIFM__UTILS__HCACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
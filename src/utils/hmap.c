@@ -0,0 +1,357 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "hmap.h"
+
+#include <ctype.h> /* tolower() */
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memset() */
+
+/* Initial number of slots (must be a power of two). */
+#define INITIAL_CAPACITY 64U
+
+/* Number of records in the first block of the arena. */
+#define INITIAL_BLOCK 64U
+
+/* Limit on size of a block of the arena in records. */
+#define MAX_BLOCK (64U*1024U)
+
+/* How many times table can be larger than necessary before it's shrunk on
+ * clearing. */
+#define SHRINK_FACTOR 8U
+
+/* Slot of the table. */
+typedef struct
+{
+	hmap_key_t key; /* Key of the record. */
+	void *rec;      /* Record or NULL for an empty slot. */
+}
+slot_t;
+
+/* Block of the arena of records. */
+typedef struct block_t
+{
+	struct block_t *prev; /* Previously allocated block or NULL. */
+	size_t used;          /* Number of used records. */
+	size_t capacity;      /* Max number of records. */
+	char data[];          /* Storage of records. */
+}
+block_t;
+
+/* Hash map itself. */
+struct hmap_t
+{
+	slot_t *slots;   /* Table of slots. */
+	size_t capacity; /* Number of slots (a power of two). */
+	size_t size;     /* Number of occupied slots. */
+	size_t rec_size; /* Size of a record (rounded up for alignment). */
+	block_t *block;  /* Most recently allocated block of records. */
+	block_t *spare;  /* Blocks left after clearing to be reused. */
+};
+
+static slot_t * find_slot(slot_t slots[], size_t capacity, hmap_key_t key);
+static uint64_t mix(hmap_key_t key);
+static int grow(hmap_t *hmap);
+static void * alloc_rec(hmap_t *hmap);
+static void free_blocks(block_t *block);
+
+hmap_t *
+hmap_create(size_t rec_size)
+{
+	hmap_t *const hmap = malloc(sizeof(*hmap));
+	if(hmap == NULL)
+	{
+		return NULL;
+	}
+
+	hmap->slots = calloc(INITIAL_CAPACITY, sizeof(*hmap->slots));
+	if(hmap->slots == NULL)
+	{
+		free(hmap);
+		return NULL;
+	}
+
+	/* Round size of records up to keep them aligned. */
+	const size_t align = sizeof(void *);
+	rec_size = (rec_size == 0U ? align : rec_size);
+
+	hmap->capacity = INITIAL_CAPACITY;
+	hmap->size = 0U;
+	hmap->rec_size = (rec_size + align - 1U)/align*align;
+	hmap->block = NULL;
+	hmap->spare = NULL;
+	return hmap;
+}
+
+void
+hmap_free(hmap_t *hmap)
+{
+	if(hmap == NULL)
+	{
+		return;
+	}
+
+	free_blocks(hmap->block);
+	free_blocks(hmap->spare);
+	free(hmap->slots);
+	free(hmap);
+}
+
+void
+hmap_clear(hmap_t *hmap, size_t expected)
+{
+	/* Capacity that keeps load factor at 1/2 for expected number of records. */
+	size_t needed = INITIAL_CAPACITY;
+	while(needed/2U < expected)
+	{
+		needed *= 2U;
+	}
+
+	/* Don't keep (and keep wiping) a table left from a much larger set. */
+	if(hmap->capacity/SHRINK_FACTOR > needed)
+	{
+		slot_t *const slots = calloc(needed, sizeof(*slots));
+		if(slots != NULL)
+		{
+			free(hmap->slots);
+			hmap->slots = slots;
+			hmap->capacity = needed;
+			hmap->size = 0U;
+
+			free_blocks(hmap->block);
+			free_blocks(hmap->spare);
+			hmap->block = NULL;
+			hmap->spare = NULL;
+			return;
+		}
+	}
+
+	memset(hmap->slots, 0, hmap->capacity*sizeof(*hmap->slots));
+	hmap->size = 0U;
+
+	while(hmap->block != NULL)
+	{
+		block_t *const prev = hmap->block->prev;
+		hmap->block->prev = hmap->spare;
+		hmap->block->used = 0U;
+		hmap->spare = hmap->block;
+		hmap->block = prev;
+	}
+}
+
+void *
+hmap_get(const hmap_t *hmap, hmap_key_t key)
+{
+	return find_slot(hmap->slots, hmap->capacity, key)->rec;
+}
+
+void *
+hmap_put(hmap_t *hmap, hmap_key_t key, int *created)
+{
+	*created = 0;
+
+	/* Keep load factor at or below 1/2 for short probe sequences. */
+	if((hmap->size + 1U)*2U > hmap->capacity && grow(hmap) != 0)
+	{
+		return NULL;
+	}
+
+	slot_t *const slot = find_slot(hmap->slots, hmap->capacity, key);
+	if(slot->rec != NULL)
+	{
+		return slot->rec;
+	}
+
+	void *const rec = alloc_rec(hmap);
+	if(rec == NULL)
+	{
+		return NULL;
+	}
+
+	slot->key = key;
+	slot->rec = rec;
+	++hmap->size;
+	*created = 1;
+	return rec;
+}
+
+size_t
+hmap_size(const hmap_t *hmap)
+{
+	return hmap->size;
+}
+
+hmap_key_t
+hmap_str_key(const char str[], size_t len)
+{
+	hmap_key_t key = { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL };
+	while(len-- > 0U)
+	{
+		const unsigned char c = str[len];
+		key.hi = (key.hi ^ c)*0x100000001b3ULL;
+		key.lo = (key.lo + c + 1U)*0x9e3779b97f4a7c15ULL;
+	}
+	return key;
+}
+
+hmap_key_t
+hmap_istr_key(const char str[], size_t len)
+{
+	hmap_key_t key = { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL };
+	while(len-- > 0U)
+	{
+		hmap_istr_key_prepend(&key, str[len]);
+	}
+	return key;
+}
+
+void
+hmap_istr_key_prepend(hmap_key_t *key, char c)
+{
+	const unsigned char lc = tolower((unsigned char)c);
+	key->hi = (key->hi ^ lc)*0x100000001b3ULL;
+	key->lo = (key->lo + lc + 1U)*0x9e3779b97f4a7c15ULL;
+}
+
+int
+hmap_istr_suffix_keys(const char str[], size_t len, hmap_suffix_key_func cb,
+		void *arg)
+{
+	hmap_key_t key = hmap_istr_key("", 0U);
+	size_t i;
+	for(i = 0U; !cb(key, i, arg); ++i)
+	{
+		if(i == len)
+		{
+			return 0;
+		}
+		hmap_istr_key_prepend(&key, str[len - 1U - i]);
+	}
+	return 1;
+}
+
+/* Finds slot of the key using linear probing.  Returns either the slot that
+ * holds the key or an empty one where it should be inserted. */
+static slot_t *
+find_slot(slot_t slots[], size_t capacity, hmap_key_t key)
+{
+	const size_t mask = capacity - 1U;
+	size_t i = (size_t)mix(key) & mask;
+	while(slots[i].rec != NULL &&
+			(slots[i].key.hi != key.hi || slots[i].key.lo != key.lo))
+	{
+		i = (i + 1U) & mask;
+	}
+	return &slots[i];
+}
+
+/* Turns key into a well distributed hash (finalizer of MurmurHash3).  Returns
+ * the hash. */
+static uint64_t
+mix(hmap_key_t key)
+{
+	uint64_t h = key.lo ^ (key.hi*0x9e3779b97f4a7c15ULL);
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* Doubles number of slots.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+grow(hmap_t *hmap)
+{
+	size_t i;
+	const size_t capacity = hmap->capacity*2U;
+	slot_t *const slots = calloc(capacity, sizeof(*slots));
+	if(slots == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < hmap->capacity; ++i)
+	{
+		if(hmap->slots[i].rec != NULL)
+		{
+			*find_slot(slots, capacity, hmap->slots[i].key) = hmap->slots[i];
+		}
+	}
+
+	free(hmap->slots);
+	hmap->slots = slots;
+	hmap->capacity = capacity;
+	return 0;
+}
+
+/* Allocates zero-filled record in the arena.  Returns the record or NULL on
+ * error. */
+static void *
+alloc_rec(hmap_t *hmap)
+{
+	block_t *block = hmap->block;
+	if((block == NULL || block->used == block->capacity) && hmap->spare != NULL)
+	{
+		block = hmap->spare;
+		hmap->spare = block->prev;
+		block->prev = hmap->block;
+		hmap->block = block;
+	}
+	else if(block == NULL || block->used == block->capacity)
+	{
+		size_t capacity = (block == NULL ? INITIAL_BLOCK : block->capacity*2U);
+		if(capacity > MAX_BLOCK)
+		{
+			capacity = MAX_BLOCK;
+		}
+
+		block = malloc(sizeof(*block) + capacity*hmap->rec_size);
+		if(block == NULL)
+		{
+			return NULL;
+		}
+
+		block->prev = hmap->block;
+		block->used = 0U;
+		block->capacity = capacity;
+		hmap->block = block;
+	}
+
+	void *const rec = &block->data[block->used++*hmap->rec_size];
+	memset(rec, 0, hmap->rec_size);
+	return rec;
+}
+
+/* Frees a chain of blocks. */
+static void
+free_blocks(block_t *block)
+{
+	while(block != NULL)
+	{
+		block_t *const prev = block->prev;
+		free(block);
+		block = prev;
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,92 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__HMAP_H__
+#define VIFM__UTILS__HMAP_H__
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+/* hmap - hash map with open addressing, which maps 128-bit binary keys to
+ * records of fixed size.  Records are allocated in large blocks and never move,
+ * so pointers to them stay valid until the map is freed.  Keys are expected to
+ * be well distributed in at least one half (e.g., be hashes) or be small
+ * integers, they are mixed anyway. */
+
+/* Key of the map. */
+typedef struct
+{
+	uint64_t hi; /* Upper half of the key. */
+	uint64_t lo; /* Lower half of the key. */
+}
+hmap_key_t;
+
+/* Declaration of opaque hash map type. */
+typedef struct hmap_t hmap_t;
+
+/* Callback for hmap_istr_suffix_keys() that receives key of a suffix and its
+ * length.  Should return non-zero to stop the walk. */
+typedef int (*hmap_suffix_key_func)(hmap_key_t key, size_t len, void *arg);
+
+/* Creates new empty map with records of specified size.  Returns NULL on
+ * error. */
+hmap_t * hmap_create(size_t rec_size);
+
+/* Frees memory allocated for the map and its records.  Freeing of NULL map is
+ * OK. */
+void hmap_free(hmap_t *hmap);
+
+/* Removes all records from the map keeping memory allocated for them to be
+ * reused by future insertions unless it's much more than expected number of
+ * records needs.  Pointers to records become invalid. */
+void hmap_clear(hmap_t *hmap, size_t expected);
+
+/* Looks up record by its key.  Returns pointer to the record or NULL if
+ * there is no such key in the map. */
+void * hmap_get(const hmap_t *hmap, hmap_key_t key);
+
+/* Looks up record by its key inserting a new one filled with zeroes if it's
+ * not in the map yet.  *created is set to non-zero if a record was inserted.
+ * Returns pointer to the record or NULL on error. */
+void * hmap_put(hmap_t *hmap, hmap_key_t key, int *created);
+
+/* Retrieves number of records in the map.  Returns the number. */
+size_t hmap_size(const hmap_t *hmap);
+
+/* Computes key of a string of specified length.  Returns the key. */
+hmap_key_t hmap_str_key(const char str[], size_t len);
+
+/* Computes case-insensitive key of a string of specified length.  Returns the
+ * key. */
+hmap_key_t hmap_istr_key(const char str[], size_t len);
+
+/* Turns key of a string into key of the string prefixed with the character.
+ * This allows computing keys of all suffixes of a string in a single pass
+ * starting with key of an empty string. */
+void hmap_istr_key_prepend(hmap_key_t *key, char c);
+
+/* Computes case-insensitive keys of all suffixes of a string in a single pass
+ * from its end, i.e. from the empty suffix up to the whole string.  Returns
+ * non-zero if the callback stopped the walk, otherwise zero is returned. */
+int hmap_istr_suffix_keys(const char str[], size_t len,
+		hmap_suffix_key_func cb, void *arg);
+
+#endif /* VIFM__UTILS__HMAP_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -20,16 +20,21 @@
 
 #include <regex.h> /* regex_t regcomp() regexec() regfree() */
 
-#include <stddef.h> /* NULL */
-#include <stdlib.h> /* free() malloc() */
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* calloc() free() malloc() */
 #include <string.h> /* strcspn() strdup() strlen() strrchr() */
 
+#include "../compat/reallocarray.h"
 #include "../int/file_magic.h"
 #include "globs.h"
+#include "hmap.h"
 #include "path.h"
 #include "regexp.h"
 #include "str.h"
 
+/* Minimal number of globs in a list to index them with hash tables. */
+#define FGLOBS_INDEX_MIN 8
+
 /* Type of a matcher. */
 typedef enum
 {
@@ -39,6 +44,38 @@ typedef enum
 }
 MType;
 
+/* Single "faster" glob. */
+typedef struct
+{
+	const char *str; /* Literal name or suffix without leading "*". */
+	size_t len;      /* Length of the str. */
+	int suffix;      /* Whether this is a suffix pattern. */
+	int next;        /* Next glob with the same key in the index or -1. */
+}
+fglob_t;
+
+/* Pre-parsed list of "faster" globs. */
+typedef struct
+{
+	char *buf;         /* Storage of strings of globs. */
+	fglob_t *list;     /* The globs. */
+	int count;         /* Number of globs. */
+	hmap_t *names;     /* Literal names -> index of first glob plus one. */
+	hmap_t *suffixes;  /* Suffixes -> index of first glob plus one. */
+	char *suffix_lens; /* Flags of lengths of suffixes, has max_len + 1 items. */
+	size_t max_len;    /* Length of the longest suffix. */
+}
+fglobs_t;
+
+/* State of looking up a name among "faster" globs. */
+typedef struct
+{
+	const fglobs_t *fglobs; /* Globs to look the name up in. */
+	const char *name;       /* The name. */
+	size_t len;             /* Length of the name. */
+}
+fglobs_lookup_t;
+
 /* Wrapper for a regular expression, its state and compiled form. */
 struct matcher_t
 {
@@ -51,6 +88,7 @@ struct matcher_t
 	unsigned int negated : 1;   /* Whether match is inverted. */
 	unsigned int fglobs : 1;    /* Whether this matcher is a special case of
 	                               globs ("faster" globs) that is optimized. */
+	fglobs_t *globs; /* Parsed "faster" globs, set when fglobs is set. */
 	regex_t regex; /* The expression in compiled form, unless matcher is empty. */
 };
 
@@ -60,11 +98,19 @@ static MType determine_type(const char expr[], int re, int glob,
 static int compile_expr(matcher_t *m, int strip, int cs_by_def,
 		const char on_empty_re[], char **error);
 static int parse_glob(matcher_t *m, int strip, char **error);
-static int is_fglobs(char expr[]);
+static fglobs_t * fglobs_parse(const char expr[]);
+static int fglobs_index(fglobs_t *fglobs);
+static void fglobs_free(fglobs_t *fglobs);
 static int parse_re(matcher_t *m, int strip, int cs_by_def,
 		const char on_empty_re[], char **error);
 static void free_matcher_items(matcher_t *matcher);
 static int fglobs_matches(const matcher_t *matcher, const char path[]);
+static int fglobs_scan(const fglobs_t *fglobs, const char name[], size_t len);
+static int fglobs_lookup(const fglobs_t *fglobs, const char name[],
+		size_t len);
+static int fglobs_lookup_key(hmap_key_t key, size_t len, void *arg);
+static int fglobs_chain_matches(const fglobs_t *fglobs, int i,
+		const char str[]);
 static int fglobs_includes(const matcher_t *matcher, const matcher_t *like);
 static int is_negated(const char **expr);
 static int is_re_expr(const char expr[], int allow_empty);
@@ -233,7 +279,8 @@ parse_glob(matcher_t *m, int strip, char **error)
 		return 1;
 	}
 
-	if(is_fglobs(m->raw))
+	m->globs = fglobs_parse(m->raw);
+	if(m->globs != NULL)
 	{
 		m->fglobs = 1;
 		return 0;
@@ -253,35 +300,130 @@ parse_glob(matcher_t *m, int strip, char **error)
 	return 0;
 }
 
-/* Checks whether expression (command-separated list of glob patterns) can be
- * implemented without regular expressions.  Returns non-zero if so, otherwise
- * zero is returned. */
-static int
-is_fglobs(char expr[])
+/* Parses expression (comma-separated list of glob patterns) if it can be
+ * implemented without regular expressions.  Returns parsed list or NULL if
+ * expression is of a different form or on error. */
+static fglobs_t *
+fglobs_parse(const char expr[])
 {
 	if(expr[0] == '\0')
 	{
-		return 0;
+		return NULL;
 	}
 
-	expr = strdup(expr);
+	fglobs_t *const fglobs = calloc(1, sizeof(*fglobs));
+	if(fglobs == NULL)
+	{
+		return NULL;
+	}
+
+	fglobs->buf = strdup(expr);
+	if(fglobs->buf == NULL)
+	{
+		free(fglobs);
+		return NULL;
+	}
 
-	char *glob = expr, *state = NULL;
+	char *glob = fglobs->buf, *state = NULL;
 	while((glob = split_and_get_dc(glob, &state)) != NULL)
 	{
-		if(glob[strcspn(glob, "[?*")] == '\0')
+		fglob_t g = { .str = glob, .next = -1 };
+		if(glob[strcspn(glob, "[?*")] != '\0')
 		{
-			continue;
+			if(glob[0] != '*' || glob[1 + strcspn(glob + 1, "[?*")] != '\0')
+			{
+				fglobs_free(fglobs);
+				return NULL;
+			}
+			g.suffix = 1;
+			++g.str;
 		}
-		if(glob[0] == '*' && glob[1 + strcspn(glob + 1, "[?*")] == '\0')
+		g.len = strlen(g.str);
+
+		void *const p = reallocarray(fglobs->list, fglobs->count + 1,
+				sizeof(*fglobs->list));
+		if(p == NULL)
 		{
-			continue;
+			fglobs_free(fglobs);
+			return NULL;
 		}
-		break;
+		fglobs->list = p;
+		fglobs->list[fglobs->count++] = g;
 	}
 
-	free(expr);
-	return (glob == NULL);
+	if(fglobs->count >= FGLOBS_INDEX_MIN && fglobs_index(fglobs) != 0)
+	{
+		fglobs_free(fglobs);
+		return NULL;
+	}
+
+	return fglobs;
+}
+
+/* Puts globs into hash tables to avoid checking each of them on matching.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+fglobs_index(fglobs_t *fglobs)
+{
+	fglobs->names = hmap_create(sizeof(int));
+	fglobs->suffixes = hmap_create(sizeof(int));
+	if(fglobs->names == NULL || fglobs->suffixes == NULL)
+	{
+		return 1;
+	}
+
+	int i;
+	for(i = 0; i < fglobs->count; ++i)
+	{
+		if(fglobs->list[i].suffix && fglobs->list[i].len > fglobs->max_len)
+		{
+			fglobs->max_len = fglobs->list[i].len;
+		}
+	}
+
+	fglobs->suffix_lens = calloc(fglobs->max_len + 1U, 1U);
+	if(fglobs->suffix_lens == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < fglobs->count; ++i)
+	{
+		fglob_t *const g = &fglobs->list[i];
+		hmap_t *const map = (g->suffix ? fglobs->suffixes : fglobs->names);
+
+		int created;
+		int *const head = hmap_put(map, hmap_istr_key(g->str, g->len), &created);
+		if(head == NULL)
+		{
+			return 1;
+		}
+
+		g->next = *head - 1;
+		*head = i + 1;
+
+		if(g->suffix)
+		{
+			fglobs->suffix_lens[g->len] = 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Frees parsed list of globs.  fglobs can be NULL. */
+static void
+fglobs_free(fglobs_t *fglobs)
+{
+	if(fglobs != NULL)
+	{
+		hmap_free(fglobs->names);
+		hmap_free(fglobs->suffixes);
+		free(fglobs->suffix_lens);
+		free(fglobs->list);
+		free(fglobs->buf);
+		free(fglobs);
+	}
 }
 
 /* Parses regexp flags.  Returns zero on success or non-zero on error with
@@ -338,8 +480,10 @@ matcher_clone(const matcher_t *matcher)
 	clone->expr = strdup(matcher->expr);
 	clone->raw = strdup(matcher->raw);
 	clone->undec = strdup(matcher->undec);
+	clone->globs = (matcher->fglobs ? fglobs_parse(clone->raw) : NULL);
 
-	if(clone->expr == NULL || clone->raw == NULL || clone->undec == NULL)
+	if(clone->expr == NULL || clone->raw == NULL || clone->undec == NULL ||
+			(clone->fglobs && clone->globs == NULL))
 	{
 		matcher_free(clone);
 		return NULL;
@@ -378,6 +522,7 @@ free_matcher_items(matcher_t *matcher)
 		/* Regex is compiled only for non-empty matchers of unoptimized patterns. */
 		regfree(&matcher->regex);
 	}
+	fglobs_free(matcher->globs);
 	free(matcher->expr);
 	free(matcher->raw);
 	free(matcher->undec);
@@ -413,32 +558,91 @@ matcher_matches(const matcher_t *matcher, const char path[])
 	return (regexec(&matcher->regex, path, 0, NULL, 0) == 0)^matcher->negated;
 }
 
-/* Checks whether given path/name is matched by a fglobs matcher.  Returns
- * non-zero if so, otherwise zero is returned. */
+/* Checks whether given path/name is matched by a fglobs matcher.  Doesn't
+ * allocate memory.  Returns non-zero if so, otherwise zero is returned. */
 static int
 fglobs_matches(const matcher_t *matcher, const char path[])
 {
-	char *globs = strdup(matcher->raw);
-	char *glob = globs, *state = NULL;
-	while((glob = split_and_get_dc(glob, &state)) != NULL)
+	const size_t len = strlen(path);
+	const int matched = (matcher->globs->names == NULL)
+	                  ? fglobs_scan(matcher->globs, path, len)
+	                  : fglobs_lookup(matcher->globs, path, len);
+	return matched^matcher->negated;
+}
+
+/* Checks name against each of the globs.  Returns non-zero on match, otherwise
+ * zero is returned. */
+static int
+fglobs_scan(const fglobs_t *fglobs, const char name[], size_t len)
+{
+	int i;
+	for(i = 0; i < fglobs->count; ++i)
 	{
-		if(glob[strcspn(glob, "[?*")] == '\0')
+		const fglob_t *const g = &fglobs->list[i];
+		if(!g->suffix)
 		{
-			if(strcasecmp(path, glob) == 0)
+			if(g->len == len && strcasecmp(name, g->str) == 0)
 			{
-				break;
+				return 1;
 			}
 		}
-		if(glob[0] == '*' && glob[1 + strcspn(glob + 1, "[?*")] == '\0')
+		else if(name[0] != '.' && len > g->len &&
+				strcasecmp(name + (len - g->len), g->str) == 0)
 		{
-			if(path[0] != '.' && ends_with_case(path + 1, glob + 1))
-			{
-				break;
-			}
+			return 1;
 		}
 	}
-	free(globs);
-	return (glob != NULL)^matcher->negated;
+	return 0;
+}
+
+/* Checks name against globs by looking up its suffixes and the whole name in
+ * hash tables.  Returns non-zero on match, otherwise zero is returned. */
+static int
+fglobs_lookup(const fglobs_t *fglobs, const char name[], size_t len)
+{
+	fglobs_lookup_t lookup = { .fglobs = fglobs, .name = name, .len = len };
+	return hmap_istr_suffix_keys(name, len, &fglobs_lookup_key, &lookup);
+}
+
+/* Checks globs that have key of a suffix of the name (whole name included).
+ * Returns non-zero on match, otherwise zero is returned. */
+static int
+fglobs_lookup_key(hmap_key_t key, size_t len, void *arg)
+{
+	const fglobs_lookup_t *const lookup = arg;
+	const fglobs_t *const fglobs = lookup->fglobs;
+
+	if(len == lookup->len)
+	{
+		const int *const head = hmap_get(fglobs->names, key);
+		return (head != NULL &&
+				fglobs_chain_matches(fglobs, *head - 1, lookup->name));
+	}
+
+	if(lookup->name[0] == '.' || len > fglobs->max_len ||
+			!fglobs->suffix_lens[len])
+	{
+		return 0;
+	}
+
+	const int *const head = hmap_get(fglobs->suffixes, key);
+	return (head != NULL && fglobs_chain_matches(fglobs, *head - 1,
+				lookup->name + (lookup->len - len)));
+}
+
+/* Checks whether string is equal to one of globs in a chain of globs that share
+ * the same key.  Returns non-zero if so, otherwise zero is returned. */
+static int
+fglobs_chain_matches(const fglobs_t *fglobs, int i, const char str[])
+{
+	for(; i != -1; i = fglobs->list[i].next)
+	{
+		if(strcasecmp(fglobs->list[i].str, str) == 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
 }
 
 int
@@ -484,32 +688,28 @@ matcher_includes(const matcher_t *matcher, const matcher_t *like)
 static int
 fglobs_includes(const matcher_t *matcher, const matcher_t *like)
 {
-	char *like_globs_copy = strdup(like->raw);
-
-	int all_matched = 1;
-	char *like_glob = like_globs_copy, *like_state = NULL;
-	while((like_glob = split_and_get_dc(like_glob, &like_state)) != NULL)
+	int i;
+	for(i = 0; i < like->globs->count; ++i)
 	{
-		char *mglobs_copy = strdup(matcher->raw);
-		char *mglob = mglobs_copy, *mstate = NULL;
-		while((mglob = split_and_get_dc(mglob, &mstate)) != NULL)
+		const fglob_t *const like_glob = &like->globs->list[i];
+
+		int j;
+		for(j = 0; j < matcher->globs->count; ++j)
 		{
-			if(strcasecmp(like_glob, mglob) == 0)
+			const fglob_t *const mglob = &matcher->globs->list[j];
+			if(mglob->suffix == like_glob->suffix &&
+					strcasecmp(mglob->str, like_glob->str) == 0)
 			{
 				break;
 			}
 		}
-		free(mglobs_copy);
 
-		if(mglob == NULL)
+		if(j == matcher->globs->count)
 		{
-			all_matched = 0;
-			break;
+			return 0;
 		}
 	}
-
-	free(like_globs_copy);
-	return all_matched;
+	return 1;
 }
 
 /* Checks whether *expr specifies negated pattern.  Adjusts pointer if so.
@@ -560,5 +760,28 @@ matcher_is_full_path(const matcher_t *matcher)
 	return matcher->full_path;
 }
 
+const char *
+matcher_get_fglobs(const matcher_t *matcher)
+{
+	if(!matcher->fglobs || matcher->negated || matcher->full_path ||
+			matcher->type == MT_MIME)
+	{
+		return NULL;
+	}
+	return matcher->raw;
+}
+
+const char *
+matcher_get_name_regex(const matcher_t *matcher, int *cflags)
+{
+	if(matcher->fglobs || matcher->negated || matcher->full_path ||
+			matcher->type == MT_MIME || matcher_is_empty(matcher))
+	{
+		return NULL;
+	}
+	*cflags = matcher->cflags;
+	return matcher->raw;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
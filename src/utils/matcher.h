@@ -64,6 +64,16 @@ int matcher_includes(const matcher_t *matcher, const matcher_t *like);
  * otherwise zero is returned. */
 int matcher_is_full_path(const matcher_t *matcher);
 
+/* Retrieves list of "faster" globs (literal names and "*suffix" patterns
+ * separated by commas, literal commas are doubled) of a non-negated matcher of
+ * file names.  Returns the list or NULL if matcher is of a different kind. */
+const char * matcher_get_fglobs(const matcher_t *matcher);
+
+/* Retrieves regular expression of a non-empty non-negated matcher of file
+ * names.  Sets *cflags to compilation flags of the expression.  Returns the
+ * expression or NULL if matcher is of a different kind. */
+const char * matcher_get_name_regex(const matcher_t *matcher, int *cflags);
+
 #endif /* VIFM__UTILS__MATCHER_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -232,6 +232,18 @@ matchers_includes(const matchers_t *matchers, const matchers_t *like)
 	return 1;
 }
 
+int
+matchers_count(const matchers_t *matchers)
+{
+	return matchers->count;
+}
+
+const matcher_t *
+matchers_get(const matchers_t *matchers, int idx)
+{
+	return matchers->list[idx];
+}
+
 int
 matchers_is_expr(const char str[])
 {
@@ -21,6 +21,8 @@
 
 #include "test_helpers.h"
 
+struct matcher_t;
+
 /* Opaque matchers type. */
 typedef struct matchers_t matchers_t;
 
@@ -50,6 +52,12 @@ const char * matchers_get_expr(const matchers_t *matchers);
  * Returns non-zero if so, otherwise zero is returned. */
 int matchers_includes(const matchers_t *matchers, const matchers_t *like);
 
+/* Retrieves number of matchers in the list.  Returns the number. */
+int matchers_count(const matchers_t *matchers);
+
+/* Retrieves matcher by its index in the list.  Returns the matcher. */
+const struct matcher_t * matchers_get(const matchers_t *matchers, int idx);
+
 /* Checks whether given string is a list of match expressions.  Returns non-zero
  * if so, otherwise zero is returned. */
 int matchers_is_expr(const char str[]);
@@ -0,0 +1,593 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "matchers_set.h"
+
+#include <regex.h> /* regex_t regcomp() regexec() regfree() */
+
+#include <ctype.h> /* isdigit() */
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* memset() strcspn() strdup() strlen() strstr() */
+
+#include "darray.h"
+#include "hmap.h"
+#include "matcher.h"
+#include "matchers.h"
+#include "path.h"
+#include "str.h"
+
+/* Maximum number of regular expressions merged into a single prefilter. */
+#define MAX_MERGED 64
+
+/* State of a prefilter's regular expression. */
+typedef enum
+{
+	PS_OUTDATED, /* Not compiled or compiled form is outdated. */
+	PS_COMPILED, /* Compiled and ready to be used. */
+	PS_BROKEN,   /* Failed to compile, never rejects anything. */
+}
+PrefilterState;
+
+/* Rule of the set. */
+typedef struct
+{
+	const matchers_t *matchers; /* Matchers of the rule. */
+	int prefilter;              /* Index of prefilter for this rule or -1. */
+}
+rule_t;
+
+/* Element of a list of rules that share the same key. */
+typedef struct
+{
+	int rule; /* Index of the rule. */
+	int next; /* Index of next entry or -1. */
+}
+entry_t;
+
+/* Record of a hash map. */
+typedef struct
+{
+	int head; /* Index of the first entry plus one. */
+	int tail; /* Index of the last entry. */
+}
+bucket_t;
+
+/* Alternation of several regular expressions with the same flags.  If it
+ * doesn't match, none of the merged expressions do. */
+typedef struct
+{
+	char *expr;           /* Merged expression. */
+	int cflags;           /* Compilation flags of all merged expressions. */
+	int size;             /* Number of merged expressions. */
+	PrefilterState state; /* State of the regex field. */
+	regex_t regex;        /* Compiled expr. */
+	unsigned int gen;     /* Lookup at which matched field was computed. */
+	int matched;          /* Whether the expression matched during lookup. */
+}
+prefilter_t;
+
+/* State of looking up a path among literal names and suffixes. */
+typedef struct
+{
+	matchers_set_t *set; /* Set to look the path up in. */
+	const char *path;    /* The path. */
+	const char *name;    /* Last component of the path. */
+	size_t len;          /* Length of the name. */
+	int from;            /* Index of the first rule to consider. */
+	int best;            /* Index of the best matching rule so far. */
+}
+lookup_t;
+
+/* Compiled set of rules. */
+struct matchers_set_t
+{
+	rule_t *rules;                  /* All rules of the set. */
+	DA_INSTANCE_FIELD(rules);       /* Declarations to enable use of DA_*. */
+	entry_t *entries;               /* Storage of lists of rules of buckets. */
+	DA_INSTANCE_FIELD(entries);     /* Declarations to enable use of DA_*. */
+	int *generic;                   /* Indexes of rules that aren't hashed. */
+	DA_INSTANCE_FIELD(generic);     /* Declarations to enable use of DA_*. */
+	prefilter_t *prefilters;        /* Merged regular expressions. */
+	DA_INSTANCE_FIELD(prefilters);  /* Declarations to enable use of DA_*. */
+	char *suffix_lens;              /* Flags of lengths of known suffixes. */
+	DA_INSTANCE_FIELD(suffix_lens); /* Declarations to enable use of DA_*. */
+	hmap_t *names;                  /* Literal names -> bucket_t. */
+	hmap_t *suffixes;               /* Suffixes -> bucket_t. */
+	unsigned int gen;               /* Number of current lookup. */
+};
+
+static int index_globs(matchers_set_t *set, int rule, const char globs[]);
+static int add_entry(matchers_set_t *set, hmap_t *map, hmap_key_t key,
+		int rule);
+static int add_to_prefilter(matchers_set_t *set, const char re[], int cflags);
+static int is_mergeable(const char re[]);
+static int lookup_key(hmap_key_t key, size_t len, void *arg);
+static int find_in_bucket(matchers_set_t *set, const bucket_t *bucket,
+		const char path[], int from, int best);
+static int prefilter_matches(matchers_set_t *set, prefilter_t *prefilter,
+		const char name[]);
+static void free_prefilter(prefilter_t *prefilter);
+
+matchers_set_t *
+matchers_set_alloc(void)
+{
+	matchers_set_t *const set = calloc(1, sizeof(*set));
+	if(set == NULL)
+	{
+		return NULL;
+	}
+
+	set->names = hmap_create(sizeof(bucket_t));
+	set->suffixes = hmap_create(sizeof(bucket_t));
+	if(set->names == NULL || set->suffixes == NULL)
+	{
+		matchers_set_free(set);
+		return NULL;
+	}
+
+	return set;
+}
+
+void
+matchers_set_free(matchers_set_t *set)
+{
+	if(set == NULL)
+	{
+		return;
+	}
+
+	size_t i;
+	for(i = 0U; i < DA_SIZE(set->prefilters); ++i)
+	{
+		free_prefilter(&set->prefilters[i]);
+	}
+
+	DA_REMOVE_ALL(set->rules);
+	DA_REMOVE_ALL(set->entries);
+	DA_REMOVE_ALL(set->generic);
+	DA_REMOVE_ALL(set->prefilters);
+	DA_REMOVE_ALL(set->suffix_lens);
+	hmap_free(set->names);
+	hmap_free(set->suffixes);
+	free(set);
+}
+
+int
+matchers_set_add(matchers_set_t *set, const matchers_t *matchers)
+{
+	rule_t *const rule = DA_EXTEND(set->rules);
+	if(rule == NULL)
+	{
+		return 1;
+	}
+
+	const int idx = DA_SIZE(set->rules);
+	const int count = matchers_count(matchers);
+
+	rule->matchers = matchers;
+	rule->prefilter = -1;
+
+	/* All matchers of a rule must match, so it's enough to index only one of
+	 * them. */
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		const char *const globs = matcher_get_fglobs(matchers_get(matchers, i));
+		if(globs != NULL)
+		{
+			const int result = index_globs(set, idx, globs);
+			if(result < 0)
+			{
+				return 1;
+			}
+			if(result == 0)
+			{
+				DA_COMMIT(set->rules);
+				return 0;
+			}
+		}
+	}
+
+	for(i = 0; i < count; ++i)
+	{
+		int cflags;
+		const char *const re = matcher_get_name_regex(matchers_get(matchers, i),
+				&cflags);
+		if(re != NULL && is_mergeable(re))
+		{
+			rule->prefilter = add_to_prefilter(set, re, cflags);
+			if(rule->prefilter < 0)
+			{
+				return 1;
+			}
+			break;
+		}
+	}
+
+	int *const generic = DA_EXTEND(set->generic);
+	if(generic == NULL)
+	{
+		return 1;
+	}
+	*generic = idx;
+	DA_COMMIT(set->generic);
+
+	DA_COMMIT(set->rules);
+	return 0;
+}
+
+/* Puts all globs of the list into hash tables.  Returns zero on success,
+ * positive number if some of globs can't be indexed and negative number on
+ * error. */
+static int
+index_globs(matchers_set_t *set, int rule, const char globs[])
+{
+	char *const copy = strdup(globs);
+	if(copy == NULL)
+	{
+		return -1;
+	}
+
+	int result = 0;
+	char *glob = copy, *state = NULL;
+	while(result == 0 && (glob = split_and_get_dc(glob, &state)) != NULL)
+	{
+		if(glob[strcspn(glob, "[?*")] == '\0')
+		{
+			hmap_key_t key = hmap_istr_key(glob, strlen(glob));
+			result = add_entry(set, set->names, key, rule);
+			continue;
+		}
+
+		if(glob[0] != '*' || glob[1 + strcspn(glob + 1, "[?*")] != '\0')
+		{
+			result = 1;
+			continue;
+		}
+
+		const size_t len = strlen(glob + 1);
+		while(DA_SIZE(set->suffix_lens) <= len)
+		{
+			char *const flag = DA_EXTEND(set->suffix_lens);
+			if(flag == NULL)
+			{
+				result = -1;
+				break;
+			}
+			*flag = 0;
+			DA_COMMIT(set->suffix_lens);
+		}
+
+		if(result == 0)
+		{
+			set->suffix_lens[len] = 1;
+			const hmap_key_t key = hmap_istr_key(glob + 1, len);
+			result = add_entry(set, set->suffixes, key, rule);
+		}
+	}
+
+	free(copy);
+	return result;
+}
+
+/* Appends rule to the list of a bucket corresponding to the key.  Returns zero
+ * on success, otherwise negative number is returned. */
+static int
+add_entry(matchers_set_t *set, hmap_t *map, hmap_key_t key, int rule)
+{
+	int created;
+	bucket_t *const bucket = hmap_put(map, key, &created);
+	if(bucket == NULL)
+	{
+		return -1;
+	}
+
+	if(bucket->head != 0 && set->entries[bucket->tail].rule == rule)
+	{
+		/* Rule has several globs that differ only in case. */
+		return 0;
+	}
+
+	entry_t *const entry = DA_EXTEND(set->entries);
+	if(entry == NULL)
+	{
+		return -1;
+	}
+
+	const int idx = DA_SIZE(set->entries);
+	entry->rule = rule;
+	entry->next = -1;
+	DA_COMMIT(set->entries);
+
+	if(bucket->head == 0)
+	{
+		bucket->head = idx + 1;
+	}
+	else
+	{
+		set->entries[bucket->tail].next = idx;
+	}
+	bucket->tail = idx;
+	return 0;
+}
+
+/* Merges regular expression into one of prefilters.  Returns index of the
+ * prefilter or -1 on error. */
+static int
+add_to_prefilter(matchers_set_t *set, const char re[], int cflags)
+{
+	prefilter_t *prefilter = NULL;
+
+	size_t i;
+	for(i = DA_SIZE(set->prefilters); i-- > 0U; )
+	{
+		if(set->prefilters[i].cflags == cflags)
+		{
+			if(set->prefilters[i].size < MAX_MERGED)
+			{
+				prefilter = &set->prefilters[i];
+			}
+			break;
+		}
+	}
+
+	if(prefilter == NULL)
+	{
+		prefilter = DA_EXTEND(set->prefilters);
+		if(prefilter == NULL)
+		{
+			return -1;
+		}
+		memset(prefilter, 0, sizeof(*prefilter));
+		prefilter->cflags = cflags;
+		prefilter->expr = strdup("");
+		if(prefilter->expr == NULL)
+		{
+			return -1;
+		}
+		DA_COMMIT(set->prefilters);
+	}
+
+	char *const expr = format_str("%s%s(%s)", prefilter->expr,
+			prefilter->size == 0 ? "" : "|", re);
+	if(expr == NULL)
+	{
+		return -1;
+	}
+	free(prefilter->expr);
+	prefilter->expr = expr;
+	++prefilter->size;
+
+	if(prefilter->state == PS_COMPILED)
+	{
+		regfree(&prefilter->regex);
+	}
+	prefilter->state = PS_OUTDATED;
+
+	return prefilter - set->prefilters;
+}
+
+/* Checks whether regular expression can be merged with others without changing
+ * its meaning, which isn't the case for back-references and unbalanced
+ * parenthesis.  Returns non-zero if so, otherwise zero is returned. */
+static int
+is_mergeable(const char re[])
+{
+	int depth = 0;
+	while(*re != '\0')
+	{
+		if(re[0] == '\\')
+		{
+			if(re[1] == '\0' || isdigit((unsigned char)re[1]))
+			{
+				return 0;
+			}
+			re += 2;
+			continue;
+		}
+
+		if(re[0] == '[')
+		{
+			/* Skip bracket expression, in which "]" right after opening bracket is
+			 * a literal. */
+			re += (re[1] == '^') ? 2 : 1;
+			re += (re[0] == ']') ? 1 : 0;
+			while(*re != ']')
+			{
+				if(*re == '\0')
+				{
+					return 0;
+				}
+				if(re[0] == '[' && (re[1] == ':' || re[1] == '.' || re[1] == '='))
+				{
+					const char end[] = { re[1], ']', '\0' };
+					re = strstr(re + 2, end);
+					if(re == NULL)
+					{
+						return 0;
+					}
+					re += 2;
+					continue;
+				}
+				++re;
+			}
+			++re;
+			continue;
+		}
+
+		if(re[0] == '(')
+		{
+			++depth;
+		}
+		else if(re[0] == ')' && --depth < 0)
+		{
+			return 0;
+		}
+		++re;
+	}
+	return (depth == 0);
+}
+
+int
+matchers_set_find(matchers_set_t *set, const char path[], int from)
+{
+	const int count = DA_SIZE(set->rules);
+	const char *const name = get_last_path_component(path);
+
+	lookup_t lookup = {
+		.set = set, .path = path, .name = name, .len = strlen(name), .from = from,
+		.best = count,
+	};
+	(void)hmap_istr_suffix_keys(name, lookup.len, &lookup_key, &lookup);
+	int best = lookup.best;
+
+	size_t i;
+	if(++set->gen == 0U)
+	{
+		/* Make sure results of old lookups can't be mistaken for fresh ones. */
+		for(i = 0U; i < DA_SIZE(set->prefilters); ++i)
+		{
+			set->prefilters[i].gen = 0U;
+		}
+		set->gen = 1U;
+	}
+
+	for(i = 0U; i < DA_SIZE(set->generic); ++i)
+	{
+		const int idx = set->generic[i];
+		if(idx >= best)
+		{
+			break;
+		}
+		if(idx < from)
+		{
+			continue;
+		}
+
+		const rule_t *const rule = &set->rules[idx];
+		if(rule->prefilter >= 0 &&
+				!prefilter_matches(set, &set->prefilters[rule->prefilter], name))
+		{
+			continue;
+		}
+
+		if(matchers_match(rule->matchers, path))
+		{
+			best = idx;
+			break;
+		}
+	}
+
+	return (best == count ? -1 : best);
+}
+
+/* Updates lookup with rules of a bucket of the key of a suffix of the name
+ * (whole name included).  Returns zero to continue the walk. */
+static int
+lookup_key(hmap_key_t key, size_t len, void *arg)
+{
+	lookup_t *const lookup = arg;
+	matchers_set_t *const set = lookup->set;
+
+	hmap_t *map = set->names;
+	if(len < lookup->len)
+	{
+		if(lookup->name[0] == '.' || len >= DA_SIZE(set->suffix_lens) ||
+				!set->suffix_lens[len])
+		{
+			return 0;
+		}
+		map = set->suffixes;
+	}
+
+	const bucket_t *const bucket = hmap_get(map, key);
+	if(bucket != NULL)
+	{
+		lookup->best = find_in_bucket(set, bucket, lookup->path, lookup->from,
+				lookup->best);
+	}
+	return 0;
+}
+
+/* Finds first rule in the bucket that has index in [from; best) range and
+ * matches the path.  Returns index of such rule or best. */
+static int
+find_in_bucket(matchers_set_t *set, const bucket_t *bucket, const char path[],
+		int from, int best)
+{
+	int i;
+	for(i = bucket->head - 1; i != -1; i = set->entries[i].next)
+	{
+		const int idx = set->entries[i].rule;
+		if(idx >= best)
+		{
+			break;
+		}
+		if(idx >= from && matchers_match(set->rules[idx].matchers, path))
+		{
+			return idx;
+		}
+	}
+	return best;
+}
+
+/* Checks whether merged expression matches the name.  The result is computed
+ * once per lookup.  Returns non-zero if so, otherwise zero is returned. */
+static int
+prefilter_matches(matchers_set_t *set, prefilter_t *prefilter,
+		const char name[])
+{
+	if(prefilter->gen == set->gen)
+	{
+		return prefilter->matched;
+	}
+
+	if(prefilter->state == PS_OUTDATED)
+	{
+		const int cflags = prefilter->cflags | REG_NOSUB;
+		if(regcomp(&prefilter->regex, prefilter->expr, cflags) == 0)
+		{
+			prefilter->state = PS_COMPILED;
+		}
+		else
+		{
+			regfree(&prefilter->regex);
+			prefilter->state = PS_BROKEN;
+		}
+	}
+
+	prefilter->gen = set->gen;
+	prefilter->matched = (prefilter->state == PS_BROKEN)
+	                  || regexec(&prefilter->regex, name, 0, NULL, 0) == 0;
+	return prefilter->matched;
+}
+
+/* Frees resources of a prefilter. */
+static void
+free_prefilter(prefilter_t *prefilter)
+{
+	if(prefilter->state == PS_COMPILED)
+	{
+		regfree(&prefilter->regex);
+	}
+	free(prefilter->expr);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
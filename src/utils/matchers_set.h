@@ -0,0 +1,54 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__MATCHERS_SET_H__
+#define VIFM__UTILS__MATCHERS_SET_H__
+
+/* matchers_set - index over an ordered list of rules (matchers_t objects) that
+ * finds first rule which matches a path without trying every rule in turn.
+ * Literal names and "*suffix" globs are looked up in hash tables, regular
+ * expressions are merged into alternations that allow skipping whole groups of
+ * rules at once and only the rest is checked one by one.  Candidates are always
+ * verified with matchers_match(), so results are the same as of a linear
+ * scan. */
+
+struct matchers_t;
+
+/* Opaque set type. */
+typedef struct matchers_set_t matchers_set_t;
+
+/* Creates an empty set.  Returns the set or NULL on error. */
+matchers_set_t * matchers_set_alloc(void);
+
+/* Frees the set, but not the matchers it refers to.  set can be NULL. */
+void matchers_set_free(matchers_set_t *set);
+
+/* Appends a rule to the set, index of the rule equals to number of rules added
+ * before it.  The matchers must outlive the set.  Returns zero on success,
+ * otherwise non-zero is returned and the set shouldn't be used anymore. */
+int matchers_set_add(matchers_set_t *set, const struct matchers_t *matchers);
+
+/* Finds first rule with index not less than from that matches the path.  The
+ * set isn't thread-safe even for lookups.  Returns index of the rule or -1 if
+ * there is no such rule. */
+int matchers_set_find(matchers_set_t *set, const char path[], int from);
+
+#endif /* VIFM__UTILS__MATCHERS_SET_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,211 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "mntindex.h"
+
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* strdup() strlen() strncmp() */
+
+#include "../compat/mntent.h"
+#include "../compat/reallocarray.h"
+#include "hmap.h"
+
+/* Index of mount points. */
+struct mntindex_t
+{
+	mntindex_entry_t *entries; /* Entries in order of addition. */
+	int nentries;              /* Number of entries. */
+	hmap_t *by_dir;            /* Mount point -> position of its entry. */
+};
+
+static size_t dir_length(const char path[], size_t len);
+static int clone_mnt_entry(struct mntent *lhs, const struct mntent *rhs);
+static void free_mnt_entry(struct mntent *entry);
+
+mntindex_t *
+mntindex_create(void)
+{
+	mntindex_t *const index = malloc(sizeof(*index));
+	if(index == NULL)
+	{
+		return NULL;
+	}
+
+	index->entries = NULL;
+	index->nentries = 0;
+	index->by_dir = hmap_create(sizeof(int));
+	if(index->by_dir == NULL)
+	{
+		free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+void
+mntindex_free(mntindex_t *index)
+{
+	if(index == NULL)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < index->nentries; ++i)
+	{
+		free_mnt_entry(&index->entries[i].ent);
+		free(index->entries[i].slow_specs);
+	}
+	free(index->entries);
+	hmap_free(index->by_dir);
+	free(index);
+}
+
+int
+mntindex_add(mntindex_t *index, const struct mntent *ent)
+{
+	mntindex_entry_t *const entries = reallocarray(index->entries,
+			index->nentries + 1, sizeof(*entries));
+	if(entries == NULL)
+	{
+		return 1;
+	}
+	index->entries = entries;
+
+	mntindex_entry_t *const entry = &entries[index->nentries];
+	if(clone_mnt_entry(&entry->ent, ent) != 0)
+	{
+		return 1;
+	}
+	entry->dir_len = dir_length(ent->mnt_dir, strlen(ent->mnt_dir));
+	entry->slow_specs = NULL;
+	entry->slow = 0;
+
+	int created;
+	int *const pos = hmap_put(index->by_dir,
+			hmap_str_key(ent->mnt_dir, entry->dir_len), &created);
+	if(pos == NULL)
+	{
+		free_mnt_entry(&entry->ent);
+		return 1;
+	}
+
+	if(created)
+	{
+		*pos = index->nentries;
+	}
+	++index->nentries;
+	return 0;
+}
+
+mntindex_entry_t *
+mntindex_find(mntindex_t *index, const char path[])
+{
+	if(path[0] != '/')
+	{
+		return NULL;
+	}
+
+	size_t len = dir_length(path, strlen(path));
+	while(1)
+	{
+		const int *const pos = hmap_get(index->by_dir, hmap_str_key(path, len));
+		if(pos != NULL)
+		{
+			mntindex_entry_t *const entry = &index->entries[*pos];
+			/* Protect against hash collisions. */
+			if(entry->dir_len == len && strncmp(entry->ent.mnt_dir, path, len) == 0)
+			{
+				return entry;
+			}
+		}
+
+		if(len == 1)
+		{
+			return NULL;
+		}
+
+		/* Drop the last path component. */
+		while(path[len - 1] != '/')
+		{
+			--len;
+		}
+		len = dir_length(path, len);
+	}
+}
+
+int
+mntindex_count(const mntindex_t *index)
+{
+	return index->nentries;
+}
+
+mntindex_entry_t *
+mntindex_at(mntindex_t *index, int i)
+{
+	return &index->entries[i];
+}
+
+/* Computes length of a path of specified length without trailing slashes,
+ * while keeping root directory as is.  Returns the length. */
+static size_t
+dir_length(const char path[], size_t len)
+{
+	while(len > 1 && path[len - 1] == '/')
+	{
+		--len;
+	}
+	return len;
+}
+
+/* Clones *rhs mount entry into *lhs, which is assumed to do not contain data.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+clone_mnt_entry(struct mntent *lhs, const struct mntent *rhs)
+{
+	lhs->mnt_fsname = strdup(rhs->mnt_fsname);
+	lhs->mnt_dir = strdup(rhs->mnt_dir);
+	lhs->mnt_type = strdup(rhs->mnt_type);
+	lhs->mnt_opts = strdup(rhs->mnt_opts);
+	lhs->mnt_freq = rhs->mnt_freq;
+	lhs->mnt_passno = rhs->mnt_passno;
+
+	if(lhs->mnt_fsname == NULL || lhs->mnt_dir == NULL || lhs->mnt_type == NULL ||
+			lhs->mnt_opts == NULL)
+	{
+		free_mnt_entry(lhs);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Frees memory allocated for a mount entry. */
+static void
+free_mnt_entry(struct mntent *entry)
+{
+	free(entry->mnt_fsname);
+	free(entry->mnt_dir);
+	free(entry->mnt_type);
+	free(entry->mnt_opts);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
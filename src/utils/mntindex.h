@@ -0,0 +1,71 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__MNTINDEX_H__
+#define VIFM__UTILS__MNTINDEX_H__
+
+#include <stddef.h> /* size_t */
+
+#include "../compat/mntent.h"
+
+/* mntindex - list of mount points indexed by their paths.  Mount point of a
+ * path is found by looking up the path and its parent directories in a hash
+ * table, which takes time proportional to depth of the path rather than to
+ * number of mounts.  Entries also carry attributes derived from them, so that
+ * they are computed once per mount point. */
+
+/* Mount point with its attributes. */
+typedef struct
+{
+	struct mntent ent; /* Copy of the mount entry. */
+	size_t dir_len;    /* Length of mount point path without trailing slash. */
+
+	char *slow_specs;  /* List of slow file systems for which slow field was
+	                      computed or NULL. */
+	int slow;          /* Whether file system is in slow_specs list. */
+}
+mntindex_entry_t;
+
+/* Opaque index type. */
+typedef struct mntindex_t mntindex_t;
+
+/* Creates an empty index.  Returns the index or NULL on error. */
+mntindex_t * mntindex_create(void);
+
+/* Frees the index and all its entries.  index can be NULL. */
+void mntindex_free(mntindex_t *index);
+
+/* Appends copy of mount entry to the index.  Out of several entries for the
+ * same mount point lookups find the one added first.  Invalidates pointers to
+ * entries.  Returns zero on success, otherwise non-zero is returned. */
+int mntindex_add(mntindex_t *index, const struct mntent *ent);
+
+/* Finds entry of mount point that contains absolute path (longest mount point
+ * which is a prefix of the path).  Returns the entry or NULL. */
+mntindex_entry_t * mntindex_find(mntindex_t *index, const char path[]);
+
+/* Retrieves number of entries in the index.  Returns the number. */
+int mntindex_count(const mntindex_t *index);
+
+/* Retrieves entry by its position in order of addition.  Returns the entry. */
+mntindex_entry_t * mntindex_at(mntindex_t *index, int i);
+
+#endif /* VIFM__UTILS__MNTINDEX_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -768,6 +768,13 @@ find_cmd_in_path(const char cmd[], size_t path_len, char path[])
 	paths = get_paths(&paths_count);
 	for(i = 0; i < paths_count; i++)
 	{
+		/* Skip directories that certainly don't have the command to save on
+		 * queries to the file system. */
+		if(!path_env_may_contain(i, cmd))
+		{
+			continue;
+		}
+
 		char tmp_path[PATH_MAX + 1];
 		snprintf(tmp_path, sizeof(tmp_path), "%s/%s", paths[i], cmd);
 
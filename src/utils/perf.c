@@ -0,0 +1,263 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "perf.h"
+
+#include <stdint.h> /* uint32_t uint64_t */
+#include <stdio.h> /* FILE fclose() fprintf() fputs() */
+#include <string.h> /* memset() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() timespec */
+
+#include "../compat/os.h"
+#include "macros.h"
+
+/* Maximum number of recorded events, the rest is only counted. */
+#define MAX_EVENTS (64*1024)
+
+/* Single recorded event. */
+typedef struct
+{
+	uint64_t start; /* Time of the start relative to epoch. */
+	uint64_t dur;   /* Duration, zero for counting probes. */
+	uint32_t tid;   /* Identifier of the thread. */
+	uint32_t probe; /* Probe plus one, zero means the slot isn't filled yet. */
+}
+event_t;
+
+static void record(PerfProbe probe, uint64_t start, uint64_t dur);
+static uint32_t get_tid(void);
+static uint64_t now(void);
+
+/* Names of probes. */
+static const char *probe_names[] = {
+	[PP_DIR_LOAD]    = "dir_load",
+	[PP_STAT]        = "stat",
+	[PP_SORT]        = "sort",
+	[PP_FILTER]      = "filter",
+	[PP_HIGHLIGHT]   = "highlight",
+	[PP_DRAW]        = "draw",
+	[PP_VIEWER]      = "viewer",
+	[PP_VCACHE_HIT]  = "vcache_hit",
+	[PP_VCACHE_MISS] = "vcache_miss",
+	[PP_BG_JOB]      = "bg_job",
+};
+ARRAY_GUARD(probe_names, PP_COUNT);
+
+/* Whether statistics are collected. */
+static int enabled;
+/* Moment relative to which events are recorded. */
+static uint64_t epoch;
+/* Statistics per probe. */
+static perf_stats_t stats[PP_COUNT];
+/* Buffer of recorded events. */
+static event_t events[MAX_EVENTS];
+/* Number of reserved slots of the buffer (can exceed its size). */
+static uint64_t nevents;
+/* Source of thread identifiers. */
+static uint32_t last_tid;
+/* Identifier of current thread or zero if it wasn't assigned yet. */
+static __thread uint32_t tid;
+
+void
+perf_enable(int enable)
+{
+	if(enable && __atomic_load_n(&epoch, __ATOMIC_RELAXED) == 0)
+	{
+		__atomic_store_n(&epoch, now(), __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&enabled, enable, __ATOMIC_RELEASE);
+}
+
+int
+perf_enabled(void)
+{
+	return __atomic_load_n(&enabled, __ATOMIC_ACQUIRE);
+}
+
+void
+perf_reset(void)
+{
+	/* Concurrent updates can survive this, which is fine for statistics. */
+	memset(stats, 0, sizeof(stats));
+	memset(events, 0, sizeof(events));
+	__atomic_store_n(&nevents, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&epoch, perf_enabled() ? now() : 0, __ATOMIC_RELAXED);
+}
+
+uint64_t
+perf_begin(void)
+{
+	return perf_enabled() ? now() : 0;
+}
+
+void
+perf_end(PerfProbe probe, uint64_t start)
+{
+	if(start == 0 || !perf_enabled())
+	{
+		return;
+	}
+
+	const uint64_t dur = now() - start;
+	perf_stats_t *const s = &stats[probe];
+
+	__atomic_add_fetch(&s->count, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&s->total_ns, dur, __ATOMIC_RELAXED);
+
+	uint64_t max = __atomic_load_n(&s->max_ns, __ATOMIC_RELAXED);
+	while(dur > max && !__atomic_compare_exchange_n(&s->max_ns, &max, dur, 1,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		/* max is updated on failure. */
+	}
+
+	record(probe, start, dur);
+}
+
+void
+perf_count(PerfProbe probe)
+{
+	if(!perf_enabled())
+	{
+		return;
+	}
+
+	__atomic_add_fetch(&stats[probe].count, 1, __ATOMIC_RELAXED);
+	record(probe, now(), 0);
+}
+
+perf_stats_t
+perf_get(PerfProbe probe)
+{
+	perf_stats_t s = {
+		.count = __atomic_load_n(&stats[probe].count, __ATOMIC_RELAXED),
+		.total_ns = __atomic_load_n(&stats[probe].total_ns, __ATOMIC_RELAXED),
+		.max_ns = __atomic_load_n(&stats[probe].max_ns, __ATOMIC_RELAXED),
+	};
+	return s;
+}
+
+int
+perf_is_timed(PerfProbe probe)
+{
+	return probe != PP_VCACHE_HIT && probe != PP_VCACHE_MISS;
+}
+
+const char *
+perf_probe_name(PerfProbe probe)
+{
+	return probe_names[probe];
+}
+
+uint64_t
+perf_dropped(void)
+{
+	const uint64_t n = __atomic_load_n(&nevents, __ATOMIC_ACQUIRE);
+	return (n > MAX_EVENTS ? n - MAX_EVENTS : 0);
+}
+
+int
+perf_dump(const char path[])
+{
+	FILE *const fp = os_fopen(path, "w");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	const uint64_t base = __atomic_load_n(&epoch, __ATOMIC_RELAXED);
+	uint64_t n = __atomic_load_n(&nevents, __ATOMIC_ACQUIRE);
+	if(n > MAX_EVENTS)
+	{
+		n = MAX_EVENTS;
+	}
+
+	fputs("{\"traceEvents\":[", fp);
+
+	const char *sep = "\n";
+	uint64_t i;
+	for(i = 0U; i < n; ++i)
+	{
+		const event_t *const e = &events[i];
+		const uint32_t probe = __atomic_load_n(&e->probe, __ATOMIC_ACQUIRE);
+		if(probe == 0U || e->start < base)
+		{
+			/* Not yet filled or stale. */
+			continue;
+		}
+
+		const double ts = (e->start - base)/1000.0;
+		if(perf_is_timed(probe - 1U))
+		{
+			fprintf(fp, "%s{\"name\":\"%s\",\"cat\":\"vifm\",\"ph\":\"X\","
+					"\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", sep,
+					probe_names[probe - 1U], (unsigned int)e->tid, ts, e->dur/1000.0);
+		}
+		else
+		{
+			fprintf(fp, "%s{\"name\":\"%s\",\"cat\":\"vifm\",\"ph\":\"i\","
+					"\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}", sep,
+					probe_names[probe - 1U], (unsigned int)e->tid, ts);
+		}
+		sep = ",\n";
+	}
+
+	fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fp);
+
+	return (fclose(fp) != 0);
+}
+
+/* Records an event into the buffer if there is space left. */
+static void
+record(PerfProbe probe, uint64_t start, uint64_t dur)
+{
+	const uint64_t i = __atomic_fetch_add(&nevents, 1, __ATOMIC_RELAXED);
+	if(i >= MAX_EVENTS)
+	{
+		return;
+	}
+
+	event_t *const e = &events[i];
+	e->start = start;
+	e->dur = dur;
+	e->tid = get_tid();
+	__atomic_store_n(&e->probe, probe + 1U, __ATOMIC_RELEASE);
+}
+
+/* Retrieves small identifier of current thread.  Returns the identifier. */
+static uint32_t
+get_tid(void)
+{
+	if(tid == 0U)
+	{
+		tid = __atomic_add_fetch(&last_tid, 1, __ATOMIC_RELAXED);
+	}
+	return tid;
+}
+
+/* Retrieves current monotonic time.  Returns the time in nanoseconds. */
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000U + ts.tv_nsec;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,100 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__PERF_H__
+#define VIFM__UTILS__PERF_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* perf - lightweight instrumentation of hot paths.  Probes either time a scope
+ * (perf_begin() + perf_end()) or count events (perf_count()).  Nothing is
+ * collected while disabled, which is the default, and checking for that is
+ * the only overhead then.  In addition to per-probe statistics, a bounded
+ * number of individual events is recorded to be dumped as a Chrome trace.  All
+ * functions are thread-safe. */
+
+/* Kinds of probes. */
+typedef enum
+{
+	PP_DIR_LOAD,    /* Loading of a file list. */
+	PP_STAT,        /* Querying information about a file of a list. */
+	PP_SORT,        /* Sorting of a file list. */
+	PP_FILTER,      /* Checking whether a file passes filters. */
+	PP_HIGHLIGHT,   /* Looking up highlighting of a file. */
+	PP_DRAW,        /* Drawing of a file list. */
+	PP_VIEWER,      /* Spawning of an external viewer. */
+	PP_VCACHE_HIT,  /* Viewer cache lookup that found valid data. */
+	PP_VCACHE_MISS, /* Viewer cache lookup that had to (re)load data. */
+	PP_BG_JOB,      /* Execution of a background task. */
+
+	PP_COUNT        /* Number of probes, not a valid probe. */
+}
+PerfProbe;
+
+/* Statistics of a single probe. */
+typedef struct
+{
+	uint64_t count;    /* Number of times probe was hit. */
+	uint64_t total_ns; /* Total time spent in a timed probe. */
+	uint64_t max_ns;   /* Longest time spent in a timed probe. */
+}
+perf_stats_t;
+
+/* Enables or disables collection of statistics.  Statistics collected so far
+ * are kept. */
+void perf_enable(int enable);
+
+/* Checks whether statistics are being collected.  Returns non-zero if so. */
+int perf_enabled(void);
+
+/* Discards all statistics and recorded events. */
+void perf_reset(void);
+
+/* Starts timing a scope.  Returns value to be passed to perf_end(), which is
+ * zero if collection is disabled. */
+uint64_t perf_begin(void);
+
+/* Finishes timing a scope started by perf_begin(). */
+void perf_end(PerfProbe probe, uint64_t start);
+
+/* Counts an event of a probe that doesn't measure time. */
+void perf_count(PerfProbe probe);
+
+/* Retrieves statistics of a probe.  Returns the statistics. */
+perf_stats_t perf_get(PerfProbe probe);
+
+/* Checks whether the probe measures time as opposed to just counting events.
+ * Returns non-zero if so. */
+int perf_is_timed(PerfProbe probe);
+
+/* Retrieves short name of the probe.  Returns the name. */
+const char * perf_probe_name(PerfProbe probe);
+
+/* Retrieves number of events which didn't fit into event buffer.  Returns the
+ * number. */
+uint64_t perf_dropped(void);
+
+/* Writes recorded events to a file in Chrome trace format (JSON) that can be
+ * loaded into chrome://tracing or compatible viewers.  Returns zero on success,
+ * otherwise non-zero is returned. */
+int perf_dump(const char path[]);
+
+#endif /* VIFM__UTILS__PERF_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,465 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "rmtree.h"
+
+#include <errno.h> /* ETIMEDOUT */
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* remove() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* strdup() */
+#include <time.h> /* CLOCK_REALTIME clock_gettime() timespec */
+
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "fs.h"
+#include "path.h"
+#include "str.h"
+#include "string_array.h"
+#include "utils.h"
+
+/* Period of invoking progress callback in milliseconds. */
+#define PROGRESS_PERIOD_MS 100
+
+/* Maximum number of files in a single piece of work. */
+#define BATCH_SIZE 64
+
+/* Directory whose contents is being removed. */
+typedef struct dir_node_t
+{
+	char *path;                /* Path to the directory. */
+	struct dir_node_t *parent; /* Directory containing this one or NULL. */
+	int pending;               /* Number of unfinished pieces of work and
+	                              subdirectories. */
+	int failed;                /* Whether something inside wasn't removed. */
+}
+dir_node_t;
+
+/* Piece of work: listing of a directory or removal of a batch of its files. */
+typedef struct work_t
+{
+	dir_node_t *dir;     /* Directory this work belongs to. */
+	char **files;        /* Paths of files to remove or NULL for listing. */
+	int nfiles;          /* Number of elements in files array. */
+	struct work_t *next; /* Next element of the stack. */
+}
+work_t;
+
+/* State shared by all threads of a removal. */
+typedef struct
+{
+	pthread_mutex_t lock;    /* Guards fields below and fields of nodes. */
+	pthread_cond_t changed;  /* Signaled when work is added or finished. */
+	pthread_cond_t finished; /* Signaled when the last worker is done. */
+	work_t *stack;           /* Work that wasn't taken yet. */
+	int busy;                /* Number of pieces of work being processed. */
+	int running;             /* Number of running workers. */
+	int cancelled;           /* Whether cancellation was requested. */
+	int failed;              /* Whether anything failed. */
+	long long removed;       /* Number of removed files and directories. */
+}
+rm_job_t;
+
+static void * rm_worker(void *arg);
+static void process_work(rm_job_t *job);
+static void list_dir(rm_job_t *job, dir_node_t *dir);
+static void add_subdir(rm_job_t *job, dir_node_t *dir, char path[]);
+static void add_file(rm_job_t *job, dir_node_t *dir, char ***files,
+		int *nfiles, char path[]);
+static void remove_files(rm_job_t *job, dir_node_t *dir, char *files[],
+		int nfiles);
+static int push_work(rm_job_t *job, dir_node_t *dir, char *files[],
+		int nfiles);
+static void finish_work(rm_job_t *job, dir_node_t *dir);
+static void mark_failed(rm_job_t *job, dir_node_t *dir);
+static int is_cancelled(rm_job_t *job);
+
+int
+rmtree_remove_contents(char *const dirs[], int ndirs, int nworkers,
+		rmtree_progress_cb cb, void *arg)
+{
+	if(cb != NULL && cb(0, arg))
+	{
+		return 1;
+	}
+
+	rm_job_t job = {
+		.stack = NULL,
+		.busy = 0,
+		.running = 0,
+		.cancelled = 0,
+		.failed = 0,
+		.removed = 0,
+	};
+
+	pthread_mutex_init(&job.lock, NULL);
+	pthread_cond_init(&job.changed, NULL);
+	pthread_cond_init(&job.finished, NULL);
+
+	int i;
+	for(i = 0; i < ndirs; ++i)
+	{
+		dir_node_t *const root = calloc(1, sizeof(*root));
+		if(root == NULL || (root->path = strdup(dirs[i])) == NULL ||
+				push_work(&job, root, NULL, 0) != 0)
+		{
+			if(root != NULL)
+			{
+				free(root->path);
+			}
+			free(root);
+			job.failed = 1;
+		}
+	}
+
+	pthread_mutex_lock(&job.lock);
+	for(i = 0; i < nworkers; ++i)
+	{
+		pthread_t id;
+		if(pthread_create(&id, NULL, &rm_worker, &job) == 0)
+		{
+			(void)pthread_detach(id);
+			++job.running;
+		}
+	}
+
+	if(job.running == 0)
+	{
+		/* Fallback to doing all work on this thread. */
+		job.running = 1;
+		pthread_mutex_unlock(&job.lock);
+		process_work(&job);
+		pthread_mutex_lock(&job.lock);
+	}
+
+	while(job.running != 0)
+	{
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += PROGRESS_PERIOD_MS*1000000L;
+		deadline.tv_sec += deadline.tv_nsec/1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+
+		if(pthread_cond_timedwait(&job.finished, &job.lock, &deadline) !=
+				ETIMEDOUT)
+		{
+			continue;
+		}
+
+		const long long removed = job.removed;
+		pthread_mutex_unlock(&job.lock);
+
+		const int cancel = (cb != NULL && cb(removed, arg));
+
+		pthread_mutex_lock(&job.lock);
+		if(cancel && !job.cancelled)
+		{
+			job.cancelled = 1;
+			pthread_cond_broadcast(&job.changed);
+		}
+	}
+
+	const int result = (job.failed || job.cancelled);
+	pthread_mutex_unlock(&job.lock);
+
+	pthread_cond_destroy(&job.finished);
+	pthread_cond_destroy(&job.changed);
+	pthread_mutex_destroy(&job.lock);
+
+	return result;
+}
+
+/* Entry point of a worker thread.  Returns NULL. */
+static void *
+rm_worker(void *arg)
+{
+	block_all_thread_signals();
+	process_work(arg);
+	return NULL;
+}
+
+/* Takes work from the stack until there is none left and nobody can add
+ * more.  Work taken after cancellation is discarded. */
+static void
+process_work(rm_job_t *job)
+{
+	pthread_mutex_lock(&job->lock);
+	while(job->stack != NULL || job->busy != 0)
+	{
+		if(job->stack == NULL)
+		{
+			pthread_cond_wait(&job->changed, &job->lock);
+			continue;
+		}
+
+		work_t *const work = job->stack;
+		job->stack = work->next;
+		++job->busy;
+		const int cancelled = job->cancelled;
+		pthread_mutex_unlock(&job->lock);
+
+		if(cancelled)
+		{
+			/* Nothing to do. */
+		}
+		else if(work->files == NULL)
+		{
+			list_dir(job, work->dir);
+		}
+		else
+		{
+			remove_files(job, work->dir, work->files, work->nfiles);
+		}
+
+		finish_work(job, work->dir);
+		free_string_array(work->files, work->nfiles);
+		free(work);
+
+		pthread_mutex_lock(&job->lock);
+		if(--job->busy == 0)
+		{
+			/* Let waiting workers check whether everything is done. */
+			pthread_cond_broadcast(&job->changed);
+		}
+	}
+
+	if(--job->running == 0)
+	{
+		pthread_cond_signal(&job->finished);
+	}
+	pthread_mutex_unlock(&job->lock);
+}
+
+/* Lists the directory turning its subdirectories and files into work. */
+static void
+list_dir(rm_job_t *job, dir_node_t *dir)
+{
+	DIR *const d = os_opendir(dir->path);
+	if(d == NULL)
+	{
+		mark_failed(job, dir);
+		return;
+	}
+
+	char **files = NULL;
+	int nfiles = 0;
+
+	struct dirent *dentry;
+	while((dentry = os_readdir(d)) != NULL)
+	{
+		if(is_builtin_dir(dentry->d_name))
+		{
+			continue;
+		}
+
+		char *const path = format_str("%s/%s", dir->path, dentry->d_name);
+		if(path == NULL)
+		{
+			mark_failed(job, dir);
+		}
+		else if(entry_is_dir(path, dentry))
+		{
+			add_subdir(job, dir, path);
+		}
+		else
+		{
+			add_file(job, dir, &files, &nfiles, path);
+			if(nfiles == 0 && is_cancelled(job))
+			{
+				break;
+			}
+		}
+	}
+	os_closedir(d);
+
+	if(nfiles != 0 && push_work(job, dir, files, nfiles) != 0)
+	{
+		remove_files(job, dir, files, nfiles);
+		free_string_array(files, nfiles);
+	}
+}
+
+/* Schedules listing of a subdirectory.  Takes ownership of the path. */
+static void
+add_subdir(rm_job_t *job, dir_node_t *dir, char path[])
+{
+	/* Attempt to make sure that we can list and modify the directory. */
+	(void)os_chmod(path, 0777);
+
+	dir_node_t *const child = calloc(1, sizeof(*child));
+	if(child == NULL)
+	{
+		free(path);
+		mark_failed(job, dir);
+		return;
+	}
+
+	child->path = path;
+	child->parent = dir;
+
+	pthread_mutex_lock(&job->lock);
+	++dir->pending;
+	pthread_mutex_unlock(&job->lock);
+
+	if(push_work(job, child, NULL, 0) != 0)
+	{
+		/* Account for the child as if it was processed and failed. */
+		child->pending = 1;
+		child->failed = 1;
+		finish_work(job, child);
+	}
+}
+
+/* Adds file to a batch scheduling the batch once it's full.  Takes ownership
+ * of the path. */
+static void
+add_file(rm_job_t *job, dir_node_t *dir, char ***files, int *nfiles,
+		char path[])
+{
+	if(*files == NULL)
+	{
+		*files = reallocarray(NULL, BATCH_SIZE, sizeof(**files));
+		if(*files == NULL)
+		{
+			remove_files(job, dir, &path, 1);
+			free(path);
+			return;
+		}
+	}
+
+	(*files)[(*nfiles)++] = path;
+	if(*nfiles != BATCH_SIZE)
+	{
+		return;
+	}
+
+	if(push_work(job, dir, *files, *nfiles) != 0)
+	{
+		remove_files(job, dir, *files, *nfiles);
+		free_string_array(*files, *nfiles);
+	}
+	*files = NULL;
+	*nfiles = 0;
+}
+
+/* Removes files of a directory. */
+static void
+remove_files(rm_job_t *job, dir_node_t *dir, char *files[], int nfiles)
+{
+	int i;
+	int nremoved = 0;
+	for(i = 0; i < nfiles; ++i)
+	{
+		nremoved += (remove(files[i]) == 0);
+	}
+
+	pthread_mutex_lock(&job->lock);
+	job->removed += nremoved;
+	if(nremoved != nfiles)
+	{
+		dir->failed = 1;
+		job->failed = 1;
+	}
+	pthread_mutex_unlock(&job->lock);
+}
+
+/* Adds work to the stack taking ownership of the files array.  Returns zero on
+ * success, otherwise non-zero is returned and ownership isn't taken. */
+static int
+push_work(rm_job_t *job, dir_node_t *dir, char *files[], int nfiles)
+{
+	work_t *const work = malloc(sizeof(*work));
+	if(work == NULL)
+	{
+		return 1;
+	}
+
+	work->dir = dir;
+	work->files = files;
+	work->nfiles = nfiles;
+
+	pthread_mutex_lock(&job->lock);
+	++dir->pending;
+	work->next = job->stack;
+	job->stack = work;
+	pthread_cond_broadcast(&job->changed);
+	pthread_mutex_unlock(&job->lock);
+
+	return 0;
+}
+
+/* Accounts for finishing a piece of work of the directory.  Directory which
+ * has nothing pending is removed (unless it's one of the roots) and freed,
+ * which in turn might finish its parent. */
+static void
+finish_work(rm_job_t *job, dir_node_t *dir)
+{
+	pthread_mutex_lock(&job->lock);
+	while(dir != NULL && --dir->pending == 0)
+	{
+		dir_node_t *const parent = dir->parent;
+		if(parent != NULL)
+		{
+			const int keep = (job->cancelled || dir->failed);
+			pthread_mutex_unlock(&job->lock);
+
+			const int removed = (!keep && os_rmdir(dir->path) == 0);
+
+			pthread_mutex_lock(&job->lock);
+			if(removed)
+			{
+				++job->removed;
+			}
+			else
+			{
+				parent->failed = 1;
+				job->failed = 1;
+			}
+		}
+
+		free(dir->path);
+		free(dir);
+		dir = parent;
+	}
+	pthread_mutex_unlock(&job->lock);
+}
+
+/* Remembers that something inside of the directory wasn't removed. */
+static void
+mark_failed(rm_job_t *job, dir_node_t *dir)
+{
+	pthread_mutex_lock(&job->lock);
+	dir->failed = 1;
+	job->failed = 1;
+	pthread_mutex_unlock(&job->lock);
+}
+
+/* Checks whether cancellation was requested.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+is_cancelled(rm_job_t *job)
+{
+	pthread_mutex_lock(&job->lock);
+	const int cancelled = job->cancelled;
+	pthread_mutex_unlock(&job->lock);
+	return cancelled;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
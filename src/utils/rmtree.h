@@ -0,0 +1,45 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__RMTREE_H__
+#define VIFM__UTILS__RMTREE_H__
+
+/* rmtree - removal of contents of directory trees by a number of threads.
+ * Threads take work from a shared stack: directories to be listed and batches
+ * of files to be removed.  Listing a directory pushes its subdirectories and
+ * files back to the stack, so even a single large directory is processed in
+ * parallel.  A directory is removed as soon as all its children are gone. */
+
+/* Callback invoked periodically on the calling thread.  removed is the number
+ * of files and directories removed so far.  Should return non-zero to request
+ * cancellation. */
+typedef int (*rmtree_progress_cb)(long long removed, void *arg);
+
+/* Removes contents of directories (but not the directories themselves) using
+ * up to nworkers threads.  The callback can be NULL, otherwise it's also
+ * invoked before starting.  On cancellation files that are being removed at the
+ * moment are finished and the rest is left intact.  Returns zero on success,
+ * otherwise (on failure to remove anything or cancellation) non-zero is
+ * returned. */
+int rmtree_remove_contents(char *const dirs[], int ndirs, int nworkers,
+		rmtree_progress_cb cb, void *arg);
+
+#endif /* VIFM__UTILS__RMTREE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
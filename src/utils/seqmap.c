@@ -0,0 +1,438 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "seqmap.h"
+
+#include <pthread.h> /* pthread_mutex_* */
+#include <sched.h> /* sched_yield() */
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcpy() */
+
+#include "hmap.h"
+
+/* Number of bits of a hash that select a shard. */
+#define SHARD_BITS 4
+
+/* Number of shards. */
+#define NSHARDS (1U << SHARD_BITS)
+
+/* Initial number of slots of a shard (must be a power of two). */
+#define INITIAL_CAPACITY 16U
+
+/* Header of a slot, which is followed by a record. */
+typedef struct
+{
+	hmap_key_t key; /* Key of the record. */
+	uint64_t used;  /* Whether the slot is occupied. */
+}
+slot_t;
+
+/* Table of slots of a shard. */
+typedef struct table_t
+{
+	struct table_t *prev; /* Table replaced by this one or NULL. */
+	size_t capacity;      /* Number of slots (a power of two). */
+	uint64_t data[];      /* Storage of slots. */
+}
+table_t;
+
+/* Part of the map. */
+typedef struct
+{
+	unsigned int seq;     /* Modification counter, odd during modification. */
+	pthread_mutex_t lock; /* Serializes writers. */
+	table_t *table;       /* Current table of slots. */
+	size_t size;          /* Number of occupied slots. */
+}
+shard_t;
+
+/* Map itself. */
+struct seqmap_t
+{
+	size_t rec_size;          /* Size of a record. */
+	size_t slot_size;         /* Size of a slot with a record in bytes. */
+	shard_t shards[NSHARDS];  /* Shards of the map. */
+};
+
+static table_t * alloc_table(const seqmap_t *map, size_t capacity);
+static void update_shard(seqmap_t *map, shard_t *shard, const hmap_key_t keys[],
+		const uint64_t hashes[], size_t nkeys, int create,
+		seqmap_update_func updater, void *arg, int *error);
+static void reserve(const seqmap_t *map, shard_t *shard,
+		const hmap_key_t keys[], const uint64_t hashes[], size_t nkeys);
+static int grow(const seqmap_t *map, shard_t *shard);
+static slot_t * find_slot(const seqmap_t *map, table_t *table, hmap_key_t key,
+		uint64_t hash);
+static uint64_t mix(hmap_key_t key);
+
+seqmap_t *
+seqmap_create(size_t rec_size)
+{
+	seqmap_t *const map = malloc(sizeof(*map));
+	if(map == NULL)
+	{
+		return NULL;
+	}
+
+	map->rec_size = rec_size;
+	map->slot_size = sizeof(slot_t)
+	               + (rec_size + sizeof(uint64_t) - 1U)/sizeof(uint64_t)
+	                 *sizeof(uint64_t);
+
+	unsigned int i;
+	for(i = 0U; i < NSHARDS; ++i)
+	{
+		shard_t *const shard = &map->shards[i];
+		shard->seq = 0U;
+		shard->size = 0U;
+		shard->table = alloc_table(map, INITIAL_CAPACITY);
+		if(shard->table == NULL)
+		{
+			while(i-- > 0U)
+			{
+				pthread_mutex_destroy(&map->shards[i].lock);
+				free(map->shards[i].table);
+			}
+			free(map);
+			return NULL;
+		}
+		pthread_mutex_init(&shard->lock, NULL);
+	}
+
+	return map;
+}
+
+void
+seqmap_free(seqmap_t *map)
+{
+	if(map == NULL)
+	{
+		return;
+	}
+
+	unsigned int i;
+	for(i = 0U; i < NSHARDS; ++i)
+	{
+		table_t *table = map->shards[i].table;
+		while(table != NULL)
+		{
+			table_t *const prev = table->prev;
+			free(table);
+			table = prev;
+		}
+		pthread_mutex_destroy(&map->shards[i].lock);
+	}
+
+	free(map);
+}
+
+/* Allocates table with all slots empty.  Returns the table or NULL on
+ * error. */
+static table_t *
+alloc_table(const seqmap_t *map, size_t capacity)
+{
+	table_t *const table = calloc(1, sizeof(*table) + capacity*map->slot_size);
+	if(table != NULL)
+	{
+		table->capacity = capacity;
+	}
+	return table;
+}
+
+int
+seqmap_get(seqmap_t *map, hmap_key_t key, void *rec)
+{
+	const uint64_t hash = mix(key);
+	shard_t *const shard = &map->shards[hash >> (64 - SHARD_BITS)];
+
+	enum { NTRIES = 100 };
+
+	int tries = 0;
+	while(1)
+	{
+		const unsigned int seq = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+		if(seq & 1U)
+		{
+			/* A writer is in the middle of a modification, which is short but
+			 * includes calls of an updater, so don't burn CPU for too long. */
+			if(++tries % NTRIES == 0)
+			{
+				sched_yield();
+			}
+			continue;
+		}
+
+		/* Data read here might be inconsistent, but it's all within valid memory
+		 * and the result is discarded unless the shard stayed the same. */
+		table_t *const table = __atomic_load_n(&shard->table, __ATOMIC_ACQUIRE);
+		const slot_t *const slot = find_slot(map, table, key, hash);
+		const int found = (slot != NULL && slot->used);
+		if(found)
+		{
+			memcpy(rec, slot + 1, map->rec_size);
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if(__atomic_load_n(&shard->seq, __ATOMIC_RELAXED) == seq)
+		{
+			return !found;
+		}
+	}
+}
+
+int
+seqmap_update(seqmap_t *map, const hmap_key_t keys[], size_t nkeys,
+		int create, seqmap_update_func updater, void *arg)
+{
+	enum { BATCH = 64 };
+
+	int error = 0;
+	while(nkeys != 0U)
+	{
+		uint64_t hashes[BATCH];
+		const size_t n = (nkeys < BATCH ? nkeys : BATCH);
+
+		size_t i;
+		for(i = 0U; i < n; ++i)
+		{
+			hashes[i] = mix(keys[i]);
+		}
+
+		for(i = 0U; i < n; ++i)
+		{
+			const unsigned int idx = hashes[i] >> (64 - SHARD_BITS);
+
+			size_t j;
+			for(j = 0U; j < i; ++j)
+			{
+				if(hashes[j] >> (64 - SHARD_BITS) == idx)
+				{
+					break;
+				}
+			}
+
+			/* Shard of this key was processed along with one of previous keys. */
+			if(j == i)
+			{
+				update_shard(map, &map->shards[idx], keys + i, hashes + i, n - i,
+						create, updater, arg, &error);
+			}
+		}
+
+		keys += n;
+		nkeys -= n;
+	}
+
+	return error;
+}
+
+/* Processes all the keys that belong to the shard within a single
+ * modification.  Sets *error to non-zero on failure. */
+static void
+update_shard(seqmap_t *map, shard_t *shard, const hmap_key_t keys[],
+		const uint64_t hashes[], size_t nkeys, int create,
+		seqmap_update_func updater, void *arg, int *error)
+{
+	const unsigned int idx = shard - map->shards;
+
+	pthread_mutex_lock(&shard->lock);
+
+	if(create)
+	{
+		reserve(map, shard, keys, hashes, nkeys);
+	}
+
+	const unsigned int seq = shard->seq;
+	__atomic_store_n(&shard->seq, seq + 1U, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	size_t i;
+	for(i = 0U; i < nkeys; ++i)
+	{
+		if(hashes[i] >> (64 - SHARD_BITS) != idx)
+		{
+			continue;
+		}
+
+		slot_t *slot = find_slot(map, shard->table, keys[i], hashes[i]);
+		if(slot->used)
+		{
+			updater(slot + 1, 0, arg);
+			continue;
+		}
+
+		if(!create)
+		{
+			continue;
+		}
+
+		if((shard->size + 1U)*2U > shard->table->capacity)
+		{
+			if(grow(map, shard) != 0)
+			{
+				*error = 1;
+				continue;
+			}
+			slot = find_slot(map, shard->table, keys[i], hashes[i]);
+		}
+
+		slot->key = keys[i];
+		slot->used = 1U;
+		__atomic_store_n(&shard->size, shard->size + 1U, __ATOMIC_RELAXED);
+		updater(slot + 1, 1, arg);
+	}
+
+	__atomic_store_n(&shard->seq, seq + 2U, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&shard->lock);
+}
+
+/* Grows table of the shard in advance to fit keys that aren't in it yet, so
+ * that readers aren't held up by rehashing.  Publishing a copy of the table is
+ * safe outside of modification because its contents are the same.  Failure is
+ * ignored, growing will be retried on insertion. */
+static void
+reserve(const seqmap_t *map, shard_t *shard, const hmap_key_t keys[],
+		const uint64_t hashes[], size_t nkeys)
+{
+	const unsigned int idx = shard - map->shards;
+
+	size_t i, nnew = 0U;
+	for(i = 0U; i < nkeys; ++i)
+	{
+		if(hashes[i] >> (64 - SHARD_BITS) == idx &&
+				!find_slot(map, shard->table, keys[i], hashes[i])->used)
+		{
+			++nnew;
+		}
+	}
+
+	while((shard->size + nnew)*2U > shard->table->capacity)
+	{
+		if(grow(map, shard) != 0)
+		{
+			break;
+		}
+	}
+}
+
+/* Replaces table of the shard with a twice larger one.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+grow(const seqmap_t *map, shard_t *shard)
+{
+	table_t *const old = shard->table;
+	table_t *const table = alloc_table(map, old->capacity*2U);
+	if(table == NULL)
+	{
+		return 1;
+	}
+
+	size_t i;
+	for(i = 0U; i < old->capacity; ++i)
+	{
+		const slot_t *const slot =
+			(const slot_t *)((const char *)old->data + i*map->slot_size);
+		if(slot->used)
+		{
+			slot_t *const new_slot = find_slot(map, table, slot->key, mix(slot->key));
+			memcpy(new_slot, slot, map->slot_size);
+		}
+	}
+
+	table->prev = old;
+	__atomic_store_n(&shard->table, table, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* Finds slot of the key using linear probing.  Returns either the slot that
+ * holds the key, an empty one where it should be inserted or NULL if a reader
+ * observed partially modified table without empty slots. */
+static slot_t *
+find_slot(const seqmap_t *map, table_t *table, hmap_key_t key, uint64_t hash)
+{
+	const size_t mask = table->capacity - 1U;
+	size_t i = (size_t)hash & mask;
+	size_t n;
+	for(n = 0U; n < table->capacity; ++n)
+	{
+		slot_t *const slot = (slot_t *)((char *)table->data + i*map->slot_size);
+		if(!slot->used || (slot->key.hi == key.hi && slot->key.lo == key.lo))
+		{
+			return slot;
+		}
+		i = (i + 1U) & mask;
+	}
+	return NULL;
+}
+
+void
+seqmap_traverse(seqmap_t *map, seqmap_visit_func visitor, void *arg)
+{
+	unsigned int i;
+	for(i = 0U; i < NSHARDS; ++i)
+	{
+		shard_t *const shard = &map->shards[i];
+		pthread_mutex_lock(&shard->lock);
+
+		size_t j;
+		for(j = 0U; j < shard->table->capacity; ++j)
+		{
+			const slot_t *const slot =
+				(const slot_t *)((const char *)shard->table->data + j*map->slot_size);
+			if(slot->used)
+			{
+				visitor(slot->key, slot + 1, arg);
+			}
+		}
+
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
+
+size_t
+seqmap_size(seqmap_t *map)
+{
+	size_t size = 0U;
+	unsigned int i;
+	for(i = 0U; i < NSHARDS; ++i)
+	{
+		size += __atomic_load_n(&map->shards[i].size, __ATOMIC_RELAXED);
+	}
+	return size;
+}
+
+/* Turns key into a well distributed hash (finalizer of MurmurHash3).  Upper
+ * bits select a shard, lower ones select a slot.  Returns the hash. */
+static uint64_t
+mix(hmap_key_t key)
+{
+	uint64_t h = key.lo ^ (key.hi*0x9e3779b97f4a7c15ULL);
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
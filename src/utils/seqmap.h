@@ -0,0 +1,75 @@
+/* vifm
+ * Copyright (C) 2021 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__SEQMAP_H__
+#define VIFM__UTILS__SEQMAP_H__
+
+#include <stddef.h> /* size_t */
+
+#include "hmap.h"
+
+/* seqmap - thread-safe hash map from 128-bit keys (see hmap.h) to records of
+ * fixed size, which is split into shards by hash of the key.  Readers don't
+ * take any locks: every shard is guarded by a sequence counter and a reader
+ * just retries if a writer modified the shard while the record was being
+ * copied.  Writers are serialized per shard, so writers of different shards
+ * don't wait for each other.  Tables replaced on growth are kept until the map
+ * is freed, because a reader might still be looking at them; their total size
+ * doesn't exceed size of the current tables. */
+
+/* Declaration of opaque map type. */
+typedef struct seqmap_t seqmap_t;
+
+/* Type of callback of seqmap_update().  rec is either an existing record or a
+ * new one filled with zeroes, in which case created is non-zero. */
+typedef void (*seqmap_update_func)(void *rec, int created, void *arg);
+
+/* Type of callback of seqmap_traverse(). */
+typedef void (*seqmap_visit_func)(hmap_key_t key, const void *rec, void *arg);
+
+/* Creates new empty map with records of specified size.  Returns NULL on
+ * error. */
+seqmap_t * seqmap_create(size_t rec_size);
+
+/* Frees memory allocated for the map and its records.  Freeing of NULL map is
+ * OK.  No other operations on the map should be in progress. */
+void seqmap_free(seqmap_t *map);
+
+/* Copies record of the key into rec.  Never blocks.  Returns zero on success
+ * and non-zero if there is no such key in the map. */
+int seqmap_get(seqmap_t *map, hmap_key_t key, void *rec);
+
+/* Invokes updater on records of all the keys as a batch: every affected shard
+ * is locked and marked as modified only once.  Missing records are created only
+ * if create is non-zero, otherwise they are skipped.  Returns zero on success,
+ * otherwise non-zero is returned. */
+int seqmap_update(seqmap_t *map, const hmap_key_t keys[], size_t nkeys,
+		int create, seqmap_update_func updater, void *arg);
+
+/* Invokes visitor for every record of the map.  Writers of a shard wait while
+ * it's being visited, readers don't.  The visitor must not modify the map. */
+void seqmap_traverse(seqmap_t *map, seqmap_visit_func visitor, void *arg);
+
+/* Retrieves number of records in the map.  The result is approximate if there
+ * are concurrent writers.  Returns the number. */
+size_t seqmap_size(seqmap_t *map);
+
+#endif /* VIFM__UTILS__SEQMAP_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
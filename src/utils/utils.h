@@ -280,6 +280,10 @@ uint64_t get_free_space(const char at[]);
  * links if necessary.  Returns the inode number. */
 uint64_t get_true_inode(const struct dir_entry_t *entry);
 
+/* Retrieves number of processors available to the process.  Returns the number,
+ * which is always positive. */
+int get_cpu_count(void);
+
 #ifdef _WIN32
 #include "utils_win.h"
 #else
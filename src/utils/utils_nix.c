@@ -35,9 +35,12 @@
 #include <sys/statvfs.h> /* statvfs statvfs() */
 #include <sys/time.h> /* timeval futimens() utimes() */
 #include <sys/wait.h> /* WEXITSTATUS() WIFEXITED() WIFSIGNALED() waitpid() */
-#include <fcntl.h> /* open() close() */
+#include <fcntl.h> /* O_CLOEXEC O_RDONLY open() close() */
 #include <grp.h> /* getgrnam() getgrgid_r() */
-#include <pthread.h> /* pthread_sigmask() */
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_t
+                       pthread_mutex_lock() pthread_mutex_unlock()
+                       pthread_sigmask() */
+#include <poll.h> /* POLLERR POLLPRI poll() pollfd */
 #include <pwd.h> /* getpwnam() getpwuid_r() */
 #include <unistd.h> /* X_OK chown() dup() dup2() getpid() isatty() pause()
                        sysconf() ttyname() */
@@ -50,7 +53,8 @@
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* FILE stderr fclose() fdopen() fprintf() snprintf() */
 #include <stdlib.h> /* atoi() free() */
-#include <string.h> /* strchr() strdup() strerror() strlen() strncmp() */
+#include <string.h> /* strchr() strcspn() strdup() strerror() strlen()
+                       strncmp() */
 
 #include "../cfg/config.h"
 #include "../compat/fs_limits.h"
@@ -64,39 +68,35 @@
 #include "../status.h"
 #include "cancellation.h"
 #include "env.h"
+#include "file_streams.h"
 #include "filemon.h"
 #include "fs.h"
 #include "fswatch.h"
 #include "log.h"
 #include "macros.h"
+#include "mntindex.h"
 #include "path.h"
 #include "str.h"
 #include "utils.h"
 
-/* Types of mount point information for get_mount_point_traverser_state. */
-typedef enum
-{
-	MI_MOUNT_POINT, /* Path to the mount point. */
-	MI_FS_TYPE,     /* File system name. */
-}
-mntinfo;
+/* Protects index of mount points, which is used from background threads. */
+static pthread_mutex_t mount_index_lock = PTHREAD_MUTEX_INITIALIZER;
 
-/* State for get_mount_point() traverser. */
-typedef struct
-{
-	mntinfo type;     /* Type of information to put into the buffer. */
-	const char *path; /* Path whose mount point we're looking for. */
-	size_t buf_len;   /* Output buffer length. */
-	char *buf;        /* Output buffer. */
-	size_t curr_len;  /* Max length among all found points (len of buf string). */
-}
-get_mount_point_traverser_state;
+#ifdef __linux__
+/* Descriptor of /proc/self/mountinfo used to detect changes of mounts. */
+static int mountinfo_fd = -1;
+#endif
 
-static int get_mount_info_traverser(struct mntent *entry, void *arg);
-static void free_mnt_entries(struct mntent *entries, unsigned int nentries);
-static struct mntent * read_mnt_entries(unsigned int *nentries);
-static int clone_mnt_entry(struct mntent *lhs, const struct mntent *rhs);
-static void free_mnt_entry(struct mntent *entry);
+static mntindex_t * get_mount_index(void);
+static int mount_index_changed(void);
+static mntindex_t * read_mount_index(void);
+#ifdef __linux__
+static void parse_mountinfo_line(mntindex_t *index, char line[]);
+static char * next_mountinfo_field(char **line);
+static char * unescape_mountinfo_field(char field[]);
+static int is_octal(char c);
+#endif
+static mntindex_t * read_mtab_index(void);
 static int starts_with_list_item(const char str[], const char list[]);
 static int find_path_prefix_index(const char path[], const char list[]);
 static int open_tty(void);
@@ -435,15 +435,6 @@ refers_to_slower_fs(const char from[], const char to[])
 int
 is_on_slow_fs(const char full_path[], const char slowfs_specs[])
 {
-	char fs_name[PATH_MAX + 1];
-	get_mount_point_traverser_state state = {
-		.type = MI_FS_TYPE,
-		.path = full_path,
-		.buf_len = sizeof(fs_name),
-		.buf = fs_name,
-		.curr_len = 0UL,
-	};
-
 	/* Empty list optimization. */
 	if(slowfs_specs[0] == '\0')
 	{
@@ -458,176 +449,315 @@ is_on_slow_fs(const char full_path[], const char slowfs_specs[])
 		return 1;
 	}
 
-	if(traverse_mount_points(&get_mount_info_traverser, &state) == 0)
+	int slow = 0;
+
+	pthread_mutex_lock(&mount_index_lock);
+	mntindex_entry_t *const entry = mntindex_find(get_mount_index(), full_path);
+	if(entry != NULL)
 	{
-		if(state.curr_len > 0)
+		/* Type of file system doesn't change, so the result is cached per mount
+		 * point until the list of file systems changes. */
+		if(entry->slow_specs == NULL || strcmp(entry->slow_specs, slowfs_specs) != 0)
 		{
-			if(starts_with_list_item(fs_name, slowfs_specs))
-			{
-				return 1;
-			}
+			entry->slow = starts_with_list_item(entry->ent.mnt_type, slowfs_specs);
+			(void)replace_string(&entry->slow_specs, slowfs_specs);
 		}
+		slow = entry->slow;
 	}
+	pthread_mutex_unlock(&mount_index_lock);
 
-	return find_path_prefix_index(full_path, slowfs_specs) != -1;
+	return slow || find_path_prefix_index(full_path, slowfs_specs) != -1;
 }
 
 int
 get_mount_point(const char path[], size_t buf_len, char buf[])
 {
-	get_mount_point_traverser_state state = {
-		.type = MI_MOUNT_POINT,
-		.path = path,
-		.buf_len = buf_len,
-		.buf = buf,
-		.curr_len = 0UL,
-	};
-	return traverse_mount_points(&get_mount_info_traverser, &state);
+	int error = 1;
+
+	pthread_mutex_lock(&mount_index_lock);
+	const mntindex_entry_t *const entry = mntindex_find(get_mount_index(), path);
+	if(entry != NULL)
+	{
+		copy_str(buf, buf_len, entry->ent.mnt_dir);
+		error = 0;
+	}
+	pthread_mutex_unlock(&mount_index_lock);
+
+	return error;
 }
 
-/* traverse_mount_points client that gets mount point info for a given path. */
-static int
-get_mount_info_traverser(struct mntent *entry, void *arg)
+int
+traverse_mount_points(mptraverser client, void *arg)
 {
-	get_mount_point_traverser_state *const state = arg;
-	if(path_starts_with(state->path, entry->mnt_dir))
+	/* Clients are called on a copy of the index to not hold the lock while they
+	 * access file systems. */
+	mntindex_t *const snapshot = mntindex_create();
+	if(snapshot == NULL)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&mount_index_lock);
+	mntindex_t *const index = get_mount_index();
+	int i;
+	for(i = 0; i < mntindex_count(index); ++i)
+	{
+		(void)mntindex_add(snapshot, &mntindex_at(index, i)->ent);
+	}
+	pthread_mutex_unlock(&mount_index_lock);
+
+	const int nentries = mntindex_count(snapshot);
+	for(i = 0; i < nentries; ++i)
 	{
-		const size_t new_len = strlen(entry->mnt_dir);
-		if(new_len > state->curr_len)
+		if(client(&mntindex_at(snapshot, i)->ent, arg))
 		{
-			state->curr_len = new_len;
-			switch(state->type)
-			{
-				case MI_MOUNT_POINT:
-					copy_str(state->buf, state->buf_len, entry->mnt_dir);
-					break;
-				case MI_FS_TYPE:
-					copy_str(state->buf, state->buf_len, entry->mnt_type);
-					break;
-
-				default:
-					assert(0 && "Unknown mount information type.");
-					break;
-			}
+			break;
 		}
 	}
-	return 0;
+
+	mntindex_free(snapshot);
+	return (nentries == 0);
 }
 
-int
-traverse_mount_points(mptraverser client, void *arg)
+/* Retrieves up-to-date index of mount points, rebuilding it if list of mounts
+ * has changed.  Must be called with mount_index_lock held.  Returns the index,
+ * which is never NULL. */
+static mntindex_t *
+get_mount_index(void)
 {
-	/* Cached mount entries, updated only when /etc/mtab changes. */
+	/* Cached index and an empty one to return when the cache can't be built. */
+	static mntindex_t *index;
+	static mntindex_t *empty;
+
+	if(mount_index_changed() || index == NULL)
+	{
+		mntindex_free(index);
+		index = read_mount_index();
+	}
+
+	if(index != NULL)
+	{
+		return index;
+	}
+
+	if(empty == NULL)
+	{
+		empty = mntindex_create();
+		assert(empty != NULL && "Failed to allocate an empty mount index.");
+	}
+	return empty;
+}
+
+/* Checks whether list of mounts has changed since the last call.  On Linux
+ * mount table of the process is polled for an exceptional condition, which
+ * kernel signals on every change, so that the check doesn't even read the
+ * table.  Returns non-zero if so, otherwise zero is returned. */
+static int
+mount_index_changed(void)
+{
+#ifdef __linux__
+	static int mountinfo_opened;
+	if(!mountinfo_opened)
+	{
+		mountinfo_opened = 1;
+		mountinfo_fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+		if(mountinfo_fd != -1)
+		{
+			return 1;
+		}
+	}
+
+	if(mountinfo_fd != -1)
+	{
+		struct pollfd pfd = { .fd = mountinfo_fd, .events = POLLPRI };
+		return poll(&pfd, 1, 0) == 1 && (pfd.revents & (POLLPRI | POLLERR));
+	}
+#endif
+
+	/* Otherwise cache is updated only when /etc/mtab changes. */
 	static filemon_t mtab_mon;
-	static struct mntent *entries;
-	static unsigned int nentries;
 
 	filemon_t mon;
-	unsigned int i;
-
-	/* Check for cache validity. */
 	if(filemon_from_file("/etc/mtab", FMT_MODIFIED, &mon) != 0 ||
 			!filemon_equal(&mon, &mtab_mon))
 	{
 		mtab_mon = mon;
-		free_mnt_entries(entries, nentries);
-		entries = read_mnt_entries(&nentries);
+		return 1;
 	}
+	return 0;
+}
 
-	if(nentries == 0U)
+#ifdef __linux__
+
+/* Builds index of mount points out of /proc/self/mountinfo, which also resets
+ * its change status for mount_index_changed().  Falls back to reading /etc/mtab
+ * if the file isn't available.  Returns the index or NULL on error. */
+static mntindex_t *
+read_mount_index(void)
+{
+	if(mountinfo_fd == -1 || lseek(mountinfo_fd, 0, SEEK_SET) != 0)
 	{
-		return 1;
+		return read_mtab_index();
 	}
 
-	for(i = 0; i < nentries; ++i)
+	const int fd = dup(mountinfo_fd);
+	FILE *const fp = (fd == -1) ? NULL : fdopen(fd, "r");
+	if(fp == NULL)
 	{
-		if(client(&entries[i], arg))
+		if(fd != -1)
 		{
-			break;
+			close(fd);
 		}
+		return read_mtab_index();
 	}
 
-	return 0;
+	mntindex_t *const index = mntindex_create();
+
+	char *line = NULL;
+	while(index != NULL && (line = read_line(fp, line)) != NULL)
+	{
+		parse_mountinfo_line(index, line);
+	}
+	free(line);
+
+	fclose(fp);
+	return index;
 }
 
-/* Frees array of mount entries. */
+/* Parses a line of /proc/self/mountinfo and adds its entry to the index:
+ *   id parent major:minor root mount-point options [tags...] - type source
+ *   super-options
+ * Malformed lines are ignored. */
 static void
-free_mnt_entries(struct mntent *entries, unsigned int nentries)
+parse_mountinfo_line(mntindex_t *index, char line[])
 {
-	unsigned int i;
+	char *fields[6];
+	int i;
 
-	for(i = 0; i < nentries; ++i)
+	for(i = 0; i < 6; ++i)
 	{
-		free_mnt_entry(&entries[i]);
+		if((fields[i] = next_mountinfo_field(&line)) == NULL)
+		{
+			return;
+		}
 	}
 
-	free(entries);
-}
+	/* Skip optional tags up to the separator. */
+	char *field;
+	do
+	{
+		if((field = next_mountinfo_field(&line)) == NULL)
+		{
+			return;
+		}
+	}
+	while(strcmp(field, "-") != 0);
 
-/* Reads in array of mount entries.  Always sets *nentries.  Returns the array,
- * which might be NULL if empty.  On memory allocation error, skips entries. */
-static struct mntent *
-read_mnt_entries(unsigned int *nentries)
-{
-	FILE *f;
-	struct mntent *entries = NULL;
-	struct mntent *ent;
+	char *const type = next_mountinfo_field(&line);
+	char *const source = next_mountinfo_field(&line);
+	if(type == NULL || source == NULL)
+	{
+		return;
+	}
 
-	*nentries = 0U;
+	struct mntent ent = {
+		.mnt_fsname = unescape_mountinfo_field(source),
+		.mnt_dir = unescape_mountinfo_field(fields[4]),
+		.mnt_type = unescape_mountinfo_field(type),
+		.mnt_opts = fields[5],
+	};
+	(void)mntindex_add(index, &ent);
+}
 
-	if((f = setmntent("/etc/mtab", "r")) == NULL)
+/* Terminates next space-separated field of a mountinfo line and advances *line
+ * past it.  Returns the field or NULL if there are no more fields. */
+static char *
+next_mountinfo_field(char **line)
+{
+	char *field = *line;
+	while(*field == ' ')
+	{
+		++field;
+	}
+	if(*field == '\0')
 	{
 		return NULL;
 	}
 
-	while((ent = getmntent(f)) != NULL)
+	char *end = field + strcspn(field, " ");
+	if(*end != '\0')
 	{
-		void *p = reallocarray(entries, *nentries + 1, sizeof(*entries));
-		if(p != NULL)
+		*end++ = '\0';
+	}
+	*line = end;
+	return field;
+}
+
+/* Replaces octal escape sequences (like "\040" for space) of a mountinfo field
+ * in place.  Returns the field. */
+static char *
+unescape_mountinfo_field(char field[])
+{
+	char *out = field;
+	const char *in = field;
+	while(*in != '\0')
+	{
+		if(in[0] == '\\' && is_octal(in[1]) && is_octal(in[2]) && is_octal(in[3]))
 		{
-			entries = p;
-			if(clone_mnt_entry(&entries[*nentries], ent) == 0)
-			{
-				++*nentries;
-			}
+			*out++ = ((in[1] - '0') << 6) | ((in[2] - '0') << 3) | (in[3] - '0');
+			in += 4;
+		}
+		else
+		{
+			*out++ = *in++;
 		}
 	}
-
-	(void)endmntent(f);
-
-	return entries;
+	*out = '\0';
+	return field;
 }
 
-/* Clones *rhs mount entry into *lhs, which is assumed to do not contain data.
- * Returns zero on success, otherwise non-zero is returned. */
+/* Checks whether character is an octal digit.  Returns non-zero if so,
+ * otherwise zero is returned. */
 static int
-clone_mnt_entry(struct mntent *lhs, const struct mntent *rhs)
+is_octal(char c)
 {
-	lhs->mnt_fsname = strdup(rhs->mnt_fsname);
-	lhs->mnt_dir = strdup(rhs->mnt_dir);
-	lhs->mnt_type = strdup(rhs->mnt_type);
-	lhs->mnt_opts = strdup(rhs->mnt_opts);
-	lhs->mnt_freq = rhs->mnt_freq;
-	lhs->mnt_passno = rhs->mnt_passno;
+	return c >= '0' && c <= '7';
+}
 
-	if(lhs->mnt_fsname == NULL || lhs->mnt_dir == NULL || lhs->mnt_type == NULL ||
-			lhs->mnt_opts == NULL)
-	{
-		free_mnt_entry(lhs);
-		return 1;
-	}
+#else
 
-	return 0;
+/* Builds index of mount points.  Returns the index or NULL on error. */
+static mntindex_t *
+read_mount_index(void)
+{
+	return read_mtab_index();
 }
 
-/* Frees single mount entry. */
-static void
-free_mnt_entry(struct mntent *entry)
+#endif
+
+/* Builds index of mount points out of /etc/mtab.  Returns the index or NULL on
+ * error. */
+static mntindex_t *
+read_mtab_index(void)
 {
-	free(entry->mnt_fsname);
-	free(entry->mnt_dir);
-	free(entry->mnt_type);
-	free(entry->mnt_opts);
+	FILE *const f = setmntent("/etc/mtab", "r");
+	if(f == NULL)
+	{
+		return NULL;
+	}
+
+	mntindex_t *const index = mntindex_create();
+	if(index != NULL)
+	{
+		struct mntent *ent;
+		while((ent = getmntent(f)) != NULL)
+		{
+			(void)mntindex_add(index, ent);
+		}
+	}
+
+	(void)endmntent(f);
+	return index;
 }
 
 /* Checks that the str has at least one of comma separated list (the list) items
@@ -1201,5 +1331,12 @@ get_true_inode(const struct dir_entry_t *entry)
 	return entry->inode;
 }
 
+int
+get_cpu_count(void)
+{
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0 ? (int)count : 1);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
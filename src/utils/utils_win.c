@@ -1302,5 +1302,13 @@ get_true_inode(const struct dir_entry_t *entry)
 	return 0;
 }
 
+int
+get_cpu_count(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -33,6 +33,7 @@
 #include "utils/filemon.h"
 #include "utils/fs.h"
 #include "utils/path.h"
+#include "utils/perf.h"
 #include "utils/selector.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
@@ -145,9 +146,12 @@ vcache_lookup(const char full_path[], const char viewer[], ViewerKind kind,
 	vcache_entry_t *centry = find_cache_entry(full_path, viewer, max_lines);
 	if(centry != NULL && is_cache_valid(centry, full_path, viewer, max_lines))
 	{
+		perf_count(PP_VCACHE_HIT);
 		return centry->lines;
 	}
 
+	perf_count(PP_VCACHE_MISS);
+
 	if(centry == NULL)
 	{
 		centry = alloc_cache_entry();
@@ -533,7 +537,9 @@ get_data(vcache_entry_t *centry, const char **error)
 	}
 	else
 	{
+		const uint64_t start = perf_begin();
 		centry->job = bg_run_external_job(centry->viewer, BJF_MERGE_STREAMS);
+		perf_end(PP_VIEWER, start);
 		if(centry->job != NULL)
 		{
 			ui_cancellation_pop();
@@ -90,17 +90,20 @@
 #include "registers.h"
 #include "running.h"
 #include "signals.h"
+#include "startup.h"
 #include "status.h"
 #include "trash.h"
 #include "undo.h"
 #include "vcache.h"
 
 static int vifm_main(int argc, char *argv[]);
+static void prefetch_initial_directory(const view_t *view, const char dir[]);
 static int get_start_cwd(char buf[], size_t buf_len);
 static int undo_perform_func(OPS op, void *data, const char src[],
 		const char dst[]);
 static void parse_received_arguments(char *args[]);
 static char * eval_received_expression(const char expr[]);
+static char ** exec_received_batch(char *items[], int nitems);
 static void remote_cd(view_t *view, const char path[], int handle);
 static void check_path_for_file(view_t *view, const char path[], int handle);
 static int need_to_switch_active_pane(const char lwin_path[],
@@ -176,6 +179,12 @@ vifm_main(int argc, char *argv[])
 	json_set_check_strings(0);
 
 	args_parse(&vifm_args, argc, argv, dir);
+	if(vifm_args.startup_time_path != NULL &&
+			startup_time_open(vifm_args.startup_time_path) != 0)
+	{
+		fprintf(stderr, "Failed to open startup time report file: %s\n",
+				vifm_args.startup_time_path);
+	}
 	args_process(&vifm_args, 1);
 
 	lwin_cv = (strcmp(vifm_args.lwin_path, "-") == 0 && vifm_args.lwin_handle);
@@ -227,16 +236,18 @@ vifm_main(int argc, char *argv[])
 	ft_reset(curr_stats.exec_env_type == EET_EMULATOR_WITH_X);
 
 	init_option_handlers();
+	startup_time_mark("initialization of units");
 
 	if(!vifm_args.no_configs)
 	{
 		/* vifminfo must be processed this early so that it can restore last visited
-		 * directory. */
-		state_load(0);
+		 * directory.  The rest of it is loaded after the first drawing. */
+		state_load_lazily();
+		startup_time_mark("reading of vifminfo");
 	}
 
 	curr_stats.ipc = ipc_init(vifm_args.server_name, &parse_received_arguments,
-			&eval_received_expression);
+			&eval_received_expression, &exec_received_batch);
 	if(ipc_enabled() && curr_stats.ipc == NULL)
 	{
 		fputs("Failed to initialize IPC unit", stderr);
@@ -263,8 +274,18 @@ vifm_main(int argc, char *argv[])
 		swap_view_roles();
 	}
 
+	/* Read directories in background while configuration is being processed to
+	 * have them cached by the time views are loaded. */
+	prefetch_initial_directory(&lwin, dir);
+	if(stroscmp(lwin.curr_dir, rwin.curr_dir) != 0)
+	{
+		prefetch_initial_directory(&rwin, dir);
+	}
+	startup_time_mark("IPC and fops initialization");
+
 	load_initial_directory(&lwin, dir);
 	load_initial_directory(&rwin, dir);
+	startup_time_mark("setting initial directories");
 
 	/* Force split view when two paths are specified on command-line. */
 	if(vifm_args.lwin_path[0] != '\0' && vifm_args.rwin_path[0] != '\0')
@@ -285,6 +306,7 @@ vifm_main(int argc, char *argv[])
 		free_string_array(files, nfiles);
 		return -1;
 	}
+	startup_time_mark("terminal setup");
 
 	init_modes();
 	un_init(&undo_perform_func, NULL, &ui_cancellation_requested,
@@ -295,11 +317,14 @@ vifm_main(int argc, char *argv[])
 
 	curr_stats.vlua = vlua_init();
 	curr_stats.plugs = plugs_create(curr_stats.vlua);
+	startup_time_mark("initialization of modes and Lua");
 
 	if(!vifm_args.no_configs)
 	{
 		load_scheme();
+		startup_time_mark("loading color scheme");
 		cfg_load();
+		startup_time_mark("sourcing vifmrc");
 	}
 
 	if(lwin_cv || rwin_cv)
@@ -319,6 +344,7 @@ vifm_main(int argc, char *argv[])
 	}
 
 	plugs_load(curr_stats.plugs, cfg.config_dir);
+	startup_time_mark("loading plugins");
 
 	check_path_for_file(&lwin, vifm_args.lwin_path, vifm_args.lwin_handle);
 	check_path_for_file(&rwin, vifm_args.rwin_path, vifm_args.rwin_handle);
@@ -345,18 +371,41 @@ vifm_main(int argc, char *argv[])
 
 	update_screen(UT_FULL);
 	modes_update();
+	startup_time_mark("loading and drawing views");
+
+	/* Histories and registers weren't needed to draw the panes, but startup
+	 * commands might use them. */
+	state_load_rest();
+	startup_time_mark("reading rest of vifminfo");
 
 	/* Run startup commands after loading file lists into views, so that commands
 	 * like +1 work. */
 	exec_startup_commands(&vifm_args);
+	startup_time_mark("running startup commands");
 
 	curr_stats.load_stage = 3;
+	startup_time_close();
 
 	event_loop(&quit);
 
 	return 0;
 }
 
+/* Starts reading directory that will be loaded into the view at startup. */
+static void
+prefetch_initial_directory(const view_t *view, const char dir[])
+{
+	/* Mirror the logic of load_initial_directory(). */
+	if(view->curr_dir[0] == '\0' || strcmp(view->curr_dir, "-") == 0)
+	{
+		startup_prefetch_dir(dir);
+	}
+	else
+	{
+		startup_prefetch_dir(view->curr_dir);
+	}
+}
+
 /* Loads original working directory of the process attempting to avoid resolving
  * symbolic links in the path.  Returns zero on success, otherwise non-zero is
  * returned. */
@@ -511,6 +560,46 @@ eval_received_expression(const char expr[])
 	return result_str;
 }
 
+/* Executes commands and evaluates expressions (prefixed with "=") from a remote
+ * instance as a whole with UI updates suspended until the end.  Returns array
+ * of results or NULL on error. */
+static char **
+exec_received_batch(char *items[], int nitems)
+{
+	char **const results = reallocarray(NULL, nitems, sizeof(*results));
+	if(results == NULL)
+	{
+		return NULL;
+	}
+
+	abort_menu_like_mode();
+
+	stats_silence_ui(1);
+
+	int i;
+	for(i = 0; i < nitems; ++i)
+	{
+		if(items[i][0] == '=')
+		{
+			results[i] = eval_received_expression(items[i] + 1);
+			continue;
+		}
+
+		/* Make sure we're executing commands in correct directory. */
+		(void)vifm_chdir(flist_get_dir(curr_view));
+
+		results[i] = (exec_commands(items[i], curr_view, CIT_COMMAND) < 0)
+		           ? NULL
+		           : strdup("");
+	}
+
+	/* Skipped updates and the ones requested by commands are done at once. */
+	stats_silence_ui_end_later();
+	update_screen(stats_update_fetch());
+
+	return results;
+}
+
 /* Loads color scheme.  Converts old format to the new one if needed. */
 static void
 load_scheme(void)
@@ -649,6 +738,7 @@ void _gnuc_noreturn
 vifm_exit(int exit_code)
 {
 	vcache_finish();
+	(void)dcache_save();
 	plugs_free(curr_stats.plugs);
 	vlua_finish(curr_stats.vlua);
 	ipc_free(curr_stats.ipc);
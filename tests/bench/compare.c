@@ -0,0 +1,66 @@
+#include <stic.h>
+
+#include <string.h> /* strcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/ui/column_view.h"
+#include "../../src/ui/ui.h"
+#include "../../src/compare.h"
+
+#include "utils.h"
+
+SETUP()
+{
+	view_setup(&lwin);
+	view_setup(&rwin);
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	opt_handlers_setup();
+
+	columns_setup_column(SK_BY_NAME);
+	columns_setup_column(SK_BY_SIZE);
+}
+
+TEARDOWN()
+{
+	columns_teardown();
+
+	opt_handlers_teardown();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+}
+
+TEST(comparison_of_deep_trees)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		bench_make_tree(SANDBOX_PATH "/a", SHAPE_DEEP, sizes[i], 0);
+		bench_make_tree(SANDBOX_PATH "/b", SHAPE_DEEP, sizes[i], 1);
+
+		strcpy(lwin.curr_dir, SANDBOX_PATH "/a");
+		strcpy(rwin.curr_dir, SANDBOX_PATH "/b");
+
+		bench_start();
+		assert_success(compare_two_panes(CT_NAME, LT_ALL, 1, 0));
+		bench_report("compare_name", SHAPE_DEEP, sizes[i]);
+
+		/* Comparison replaces contents of both panes with custom views. */
+		strcpy(lwin.curr_dir, SANDBOX_PATH "/a");
+		strcpy(rwin.curr_dir, SANDBOX_PATH "/b");
+
+		bench_start();
+		assert_success(compare_two_panes(CT_CONTENTS, LT_ALL, 1, 0));
+		bench_report("compare_contents", SHAPE_DEEP, sizes[i]);
+
+		bench_remove_tree(SANDBOX_PATH "/a");
+		bench_remove_tree(SANDBOX_PATH "/b");
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
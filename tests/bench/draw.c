@@ -0,0 +1,77 @@
+#include <stic.h>
+
+#include <string.h> /* strcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/column_view.h"
+#include "../../src/ui/fileview.h"
+#include "../../src/ui/ui.h"
+#include "../../src/filelist.h"
+#include "../../src/status.h"
+
+#include "utils.h"
+
+/* Number of redraws per tree. */
+#define NREDRAWS 100
+
+SETUP()
+{
+	view_setup(&lwin);
+	view_setup(&rwin);
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	opt_handlers_setup();
+
+	cfg.columns = 100;
+	fview_setup();
+	lwin.window_cols = 100;
+	lwin.window_rows = 50;
+	lwin.columns = columns_create();
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/wide");
+
+	(void)stats_update_fetch();
+	curr_stats.load_stage = 2;
+}
+
+TEARDOWN()
+{
+	curr_stats.load_stage = 0;
+
+	columns_free(lwin.columns);
+	lwin.columns = NULL;
+	columns_teardown();
+
+	opt_handlers_teardown();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+}
+
+TEST(scrolling)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		bench_make_tree(SANDBOX_PATH "/wide", SHAPE_WIDE, sizes[i], 0);
+		assert_success(populate_dir_list(&lwin, 0));
+
+		int j;
+		bench_start();
+		for(j = 0; j < NREDRAWS; ++j)
+		{
+			lwin.list_pos = (long long)j*(lwin.list_rows - 1)/(NREDRAWS - 1);
+			draw_dir_list(&lwin);
+		}
+		bench_report("draw", SHAPE_WIDE, sizes[i]);
+
+		bench_remove_tree(SANDBOX_PATH "/wide");
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
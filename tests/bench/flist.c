@@ -0,0 +1,145 @@
+#include <stic.h>
+
+#include <stdlib.h> /* free() */
+#include <string.h> /* memset() strcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/filter.h"
+#include "../../src/utils/matcher.h"
+#include "../../src/filelist.h"
+#include "../../src/filtering.h"
+#include "../../src/sort.h"
+
+#include "utils.h"
+
+static void sort_by(int key, int size);
+static int every_tenth_filter(view_t *view, const dir_entry_t *entry,
+		void *arg);
+
+SETUP()
+{
+	view_setup(&lwin);
+	view_setup(&rwin);
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	opt_handlers_setup();
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/wide");
+}
+
+TEARDOWN()
+{
+	opt_handlers_teardown();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+}
+
+TEST(loading_and_reloading)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		bench_make_tree(SANDBOX_PATH "/wide", SHAPE_WIDE, sizes[i], 0);
+
+		bench_start();
+		assert_success(populate_dir_list(&lwin, 0));
+		bench_report("populate", SHAPE_WIDE, sizes[i]);
+		assert_int_equal(sizes[i], lwin.list_rows);
+
+		/* Reload goes through merging of old and new lists. */
+		bench_start();
+		assert_success(populate_dir_list(&lwin, 1));
+		bench_report("reload", SHAPE_WIDE, sizes[i]);
+		assert_int_equal(sizes[i], lwin.list_rows);
+
+		sort_by(SK_BY_NAME, sizes[i]);
+		sort_by(SK_BY_SIZE, sizes[i]);
+		sort_by(SK_BY_EXTENSION, sizes[i]);
+
+		bench_remove_tree(SANDBOX_PATH "/wide");
+	}
+}
+
+TEST(zapping)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		bench_make_tree(SANDBOX_PATH "/wide", SHAPE_WIDE, sizes[i], 0);
+		assert_success(populate_dir_list(&lwin, 0));
+
+		int count = lwin.list_rows;
+		bench_start();
+		(void)zap_entries(&lwin, lwin.dir_entry, &count, &every_tenth_filter, NULL,
+				0, 0);
+		bench_report("zap", SHAPE_WIDE, sizes[i]);
+		lwin.list_rows = count;
+		assert_true(count < sizes[i]);
+
+		bench_remove_tree(SANDBOX_PATH "/wide");
+	}
+}
+
+TEST(filtering)
+{
+	char *error;
+	matcher_free(lwin.manual_filter);
+	lwin.manual_filter = matcher_alloc("{*.ext3,*.ext5}", 0, 1, "", &error);
+	assert_non_null(lwin.manual_filter);
+	free(error);
+	assert_success(filter_set(&lwin.auto_filter, "file0000042.ext0"));
+
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		bench_make_tree(SANDBOX_PATH "/wide", SHAPE_WIDE, sizes[i], 0);
+		assert_success(populate_dir_list(&lwin, 0));
+
+		int j, visible = 0;
+		bench_start();
+		for(j = 0; j < lwin.list_rows; ++j)
+		{
+			const dir_entry_t *const entry = &lwin.dir_entry[j];
+			visible += filters_file_is_visible(&lwin, entry->origin, entry->name,
+					fentry_is_dir(entry), 1);
+		}
+		bench_report("filter", SHAPE_WIDE, sizes[i]);
+		assert_true(visible > 0);
+
+		bench_remove_tree(SANDBOX_PATH "/wide");
+	}
+}
+
+/* Measures sorting of the left view by the key. */
+static void
+sort_by(int key, int size)
+{
+	lwin.sort[0] = key;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	const char *const name = (key == SK_BY_NAME) ? "sort_name"
+	                       : (key == SK_BY_SIZE) ? "sort_size"
+	                       : "sort_ext";
+
+	bench_start();
+	sort_view(&lwin);
+	bench_report(name, SHAPE_WIDE, size);
+}
+
+/* Drops every tenth entry. */
+static int
+every_tenth_filter(view_t *view, const dir_entry_t *entry, void *arg)
+{
+	return (entry - view->dir_entry)%10 != 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,47 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+
+#include "../../src/utils/fsdata.h"
+
+#include "utils.h"
+
+static fsdata_t *fsd;
+
+SETUP()
+{
+	fsd = fsdata_create(0, 0);
+	assert_non_null(fsd);
+}
+
+TEARDOWN()
+{
+	fsdata_free(fsd);
+}
+
+TEST(siblings_of_wide_node)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		char path[64];
+		int j, data;
+
+		bench_start();
+		for(j = 0; j < sizes[i]; ++j)
+		{
+			snprintf(path, sizeof(path), "/%d/wide/dir%d", i, j);
+			assert_success(fsdata_set(fsd, path, &j, sizeof(j)));
+		}
+		for(j = 0; j < sizes[i]; ++j)
+		{
+			snprintf(path, sizeof(path), "/%d/wide/dir%d", i, j);
+			assert_success(fsdata_get(fsd, path, &data, sizeof(data)));
+		}
+		bench_report("fsdata_set_get", SHAPE_WIDE, sizes[i]);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
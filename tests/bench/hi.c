@@ -0,0 +1,72 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/color_scheme.h"
+#include "../../src/ui/colors.h"
+#include "../../src/utils/matchers.h"
+#include "../../src/status.h"
+
+#include "utils.h"
+
+/* Number of highlight rules, typical for a large configuration. */
+#define NRULES 300
+
+SETUP()
+{
+	const col_attr_t attr = { .fg = 1, .bg = -1 };
+	char expr[64];
+	int i;
+
+	curr_stats.cs = &cfg.cs;
+	for(i = 0; i < NRULES; ++i)
+	{
+		if(i%3 == 0)
+		{
+			snprintf(expr, sizeof(expr), "/^prefix%d_/", i);
+		}
+		else
+		{
+			snprintf(expr, sizeof(expr), "{*.ext%d,name%d}", i, i);
+		}
+
+		char *error;
+		struct matchers_t *const ms = matchers_alloc(expr, 0, 1, "", &error);
+		assert_non_null(ms);
+		free(error);
+		cs_add_file_hi(ms, &attr);
+	}
+}
+
+TEARDOWN()
+{
+	cs_reset(&cfg.cs);
+}
+
+TEST(file_highlights)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		char name[64];
+		int j, found = 0;
+
+		bench_start();
+		for(j = 0; j < sizes[i]; ++j)
+		{
+			int hint = -1;
+			snprintf(name, sizeof(name), "file%07d.ext%d", j, j%(NRULES*2));
+			found += (cs_get_file_hi(&cfg.cs, name, &hint) != NULL);
+		}
+		bench_report("file_hi", SHAPE_WIDE, sizes[i]);
+		assert_true(found > 0);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
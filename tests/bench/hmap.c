@@ -0,0 +1,69 @@
+#include <stic.h>
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* snprintf() */
+
+#include "../../src/utils/hmap.h"
+#include "../../src/utils/trie.h"
+
+#include "utils.h"
+
+/* Keys are of the kind compare.c used to put into trie (decimal representation
+ * of two numbers). */
+TEST(trie_insertions_and_lookups)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		uint64_t j;
+		char buf[64];
+
+		trie_t *const trie = trie_create();
+		bench_start();
+		for(j = 0; j < (uint64_t)sizes[i]; ++j)
+		{
+			snprintf(buf, sizeof(buf), "%llu|%llu", (unsigned long long)j*4099U,
+					(unsigned long long)j*2654435761U);
+			(void)trie_set(trie, buf, NULL);
+		}
+		for(j = 0; j < (uint64_t)sizes[i]; ++j)
+		{
+			void *data;
+			snprintf(buf, sizeof(buf), "%llu|%llu", (unsigned long long)j*4099U,
+					(unsigned long long)j*2654435761U);
+			assert_success(trie_get(trie, buf, &data));
+		}
+		bench_report("trie", SHAPE_WIDE, sizes[i]);
+		trie_free(trie);
+	}
+}
+
+TEST(hmap_insertions_and_lookups)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		uint64_t j;
+		int created;
+
+		hmap_t *const hmap = hmap_create(sizeof(int));
+		bench_start();
+		for(j = 0; j < (uint64_t)sizes[i]; ++j)
+		{
+			const hmap_key_t key = { j*4099U, j*2654435761U };
+			*(int *)hmap_put(hmap, key, &created) = (int)j;
+		}
+		for(j = 0; j < (uint64_t)sizes[i]; ++j)
+		{
+			const hmap_key_t key = { j*4099U, j*2654435761U };
+			assert_non_null(hmap_get(hmap, key));
+		}
+		bench_report("hmap", SHAPE_WIDE, sizes[i]);
+		hmap_free(hmap);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
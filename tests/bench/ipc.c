@@ -0,0 +1,73 @@
+#include <stic.h>
+
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
+#include <test-utils.h>
+
+#include "../../src/background.h"
+#include "../../src/ipc.h"
+
+#include "utils.h"
+
+static void ignore_ipc_args(char *args[]);
+static char * echo_ipc_eval(const char expr[]);
+static void serving_instance(bg_op_t *bg_op, void *arg);
+
+static const char NAME[] = "vifm-bench";
+static volatile int stop_serving;
+
+TEST(eval_round_trips, IF(ipc_enabled))
+{
+	ipc_t *const ipc1 = ipc_init(NAME, &ignore_ipc_args, &echo_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &ignore_ipc_args, &echo_ipc_eval, NULL);
+
+	stop_serving = 0;
+	assert_success(bg_execute("", "", 0, 1, &serving_instance, ipc2));
+
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		int j;
+
+		bench_start();
+		for(j = 0; j < sizes[i]; ++j)
+		{
+			char *const result = ipc_eval(ipc1, ipc_get_name(ipc2), "expr");
+			assert_string_equal("expr", result);
+			free(result);
+		}
+		bench_report("ipc_eval", SHAPE_WIDE, sizes[i]);
+	}
+
+	stop_serving = 1;
+	wait_for_bg();
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+}
+
+static void
+ignore_ipc_args(char *args[])
+{
+}
+
+static char *
+echo_ipc_eval(const char expr[])
+{
+	return strdup(expr);
+}
+
+static void
+serving_instance(bg_op_t *bg_op, void *arg)
+{
+	ipc_t *const ipc = arg;
+	while(!stop_serving)
+	{
+		(void)ipc_check(ipc);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
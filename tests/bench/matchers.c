@@ -0,0 +1,158 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+
+#include "../../src/utils/matcher.h"
+#include "../../src/utils/matchers.h"
+#include "../../src/utils/matchers_set.h"
+
+#include "utils.h"
+
+/* Number of rules, typical for a large configuration. */
+#define NRULES 300
+
+/* List of globs long enough to be indexed. */
+#define LONG_LIST "{*.c,*.h,*.cpp,*.hpp,*.cc,*.hh,*.cxx,*.hxx,*.py,*.rb," \
+                  "*.tar.gz,*.tar.bz2,*~,Makefile,CMakeLists.txt}"
+
+static void match_globs(const char name[], const char expr[]);
+static int find_linearly(const char path[]);
+
+static matchers_set_t *set;
+static matchers_t *rules[NRULES];
+
+SETUP()
+{
+	char expr[64];
+	int i;
+
+	set = matchers_set_alloc();
+	assert_non_null(set);
+
+	for(i = 0; i < NRULES; ++i)
+	{
+		if(i%3 == 0)
+		{
+			snprintf(expr, sizeof(expr), "/^prefix%d_/", i);
+		}
+		else
+		{
+			snprintf(expr, sizeof(expr), "{*.ext%d,name%d}", i, i);
+		}
+
+		char *error;
+		rules[i] = matchers_alloc(expr, 0, 1, "", &error);
+		assert_non_null(rules[i]);
+		free(error);
+		assert_success(matchers_set_add(set, rules[i]));
+	}
+}
+
+TEARDOWN()
+{
+	int i;
+
+	matchers_set_free(set);
+	for(i = 0; i < NRULES; ++i)
+	{
+		matchers_free(rules[i]);
+	}
+}
+
+TEST(linear_scan_over_rules)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		char name[64];
+		int j, found = 0;
+
+		bench_start();
+		for(j = 0; j < sizes[i]; ++j)
+		{
+			snprintf(name, sizeof(name), "file%d.ext%d", j, j%(NRULES*2));
+			found += (find_linearly(name) >= 0);
+		}
+		bench_report("matchers_linear", SHAPE_WIDE, sizes[i]);
+		assert_true(found > 0);
+	}
+}
+
+TEST(lookup_in_set_of_rules)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		char name[64];
+		int j, found = 0;
+
+		bench_start();
+		for(j = 0; j < sizes[i]; ++j)
+		{
+			snprintf(name, sizeof(name), "file%d.ext%d", j, j%(NRULES*2));
+			found += (matchers_set_find(set, name, 0) >= 0);
+		}
+		bench_report("matchers_set", SHAPE_WIDE, sizes[i]);
+		assert_true(found > 0);
+	}
+}
+
+TEST(short_list_of_globs)
+{
+	match_globs("fglobs_short", "{*.c,Makefile,*~}");
+}
+
+TEST(long_list_of_globs)
+{
+	match_globs("fglobs_long", LONG_LIST);
+}
+
+/* Measures matching of names against a list of globs. */
+static void
+match_globs(const char name[], const char expr[])
+{
+	const char *const names[] = { "main.c", "main.o", "archive.tar.gz" };
+
+	char *error;
+	matcher_t *const m = matcher_alloc(expr, 0, 1, "", &error);
+	assert_non_null(m);
+	free(error);
+
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		int j;
+
+		bench_start();
+		for(j = 0; j < sizes[i]; ++j)
+		{
+			(void)matcher_matches(m, names[j%3]);
+		}
+		bench_report(name, SHAPE_WIDE, sizes[i]);
+	}
+
+	matcher_free(m);
+}
+
+/* Finds first matching rule the way it's done without the set.  Returns index
+ * of the rule or -1. */
+static int
+find_linearly(const char path[])
+{
+	int i;
+	for(i = 0; i < NRULES; ++i)
+	{
+		if(matchers_match(rules[i], path))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,42 @@
+#include <stic.h>
+
+#include <test-utils.h>
+
+#include "../../src/utils/rmtree.h"
+
+#include "utils.h"
+
+static void remove_tree(const char name[], int nworkers);
+
+TEST(removal_by_single_worker)
+{
+	remove_tree("rmtree_1_worker", 1);
+}
+
+TEST(removal_by_pool_of_workers)
+{
+	remove_tree("rmtree_4_workers", 4);
+}
+
+/* Measures emptying of deep trees by the specified number of workers. */
+static void
+remove_tree(const char name[], int nworkers)
+{
+	char *const dirs[] = { SANDBOX_PATH "/root" };
+
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		bench_make_tree(SANDBOX_PATH "/root", SHAPE_DEEP, sizes[i], 0);
+
+		bench_start();
+		assert_success(rmtree_remove_contents(dirs, 1, nworkers, NULL, NULL));
+		bench_report(name, SHAPE_DEEP, sizes[i]);
+
+		remove_dir(SANDBOX_PATH "/root");
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,29 @@
+#include <stic.h>
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/status.h"
+
+#include "utils.h"
+
+DEFINE_SUITE();
+
+SETUP_ONCE()
+{
+	fix_environ();
+
+	stub_colmgr();
+
+	assert_success(stats_init(&cfg));
+
+	bench_init();
+}
+
+TEARDOWN_ONCE()
+{
+	bench_finish();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,99 @@
+#include <stic.h>
+
+#include <stdlib.h> /* malloc() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/trash.h"
+
+#include "utils.h"
+
+static void make_entries(int count, char ***originals, char ***trash_names);
+
+static char trash_dir[PATH_MAX + 1];
+
+SETUP()
+{
+	create_dir(SANDBOX_PATH "/trash");
+	make_abs_path(trash_dir, sizeof(trash_dir), SANDBOX_PATH, "trash", NULL);
+	assert_success(trash_set_specs(trash_dir));
+}
+
+TEARDOWN()
+{
+	trash_empty_all();
+	wait_for_bg();
+	assert_int_equal(0, trash_list_size);
+
+	remove_dir(SANDBOX_PATH "/trash");
+}
+
+TEST(adding_trash_entries_one_by_one)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		char **originals, **trash_names;
+		int j;
+
+		make_entries(sizes[i], &originals, &trash_names);
+
+		bench_start();
+		for(j = 0; j < sizes[i]; ++j)
+		{
+			assert_success(trash_add_entry(originals[j], trash_names[j]));
+		}
+		bench_report("trash_add_single", SHAPE_WIDE, sizes[i]);
+
+		trash_remove_entries(trash_names, sizes[i]);
+		assert_int_equal(0, trash_list_size);
+
+		free_string_array(originals, sizes[i]);
+		free_string_array(trash_names, sizes[i]);
+	}
+}
+
+TEST(adding_trash_entries_as_a_batch)
+{
+	const int *sizes;
+	int i, nsizes = bench_sizes(&sizes);
+	for(i = 0; i < nsizes; ++i)
+	{
+		char **originals, **trash_names;
+
+		make_entries(sizes[i], &originals, &trash_names);
+
+		bench_start();
+		assert_success(trash_add_entries(originals, trash_names, sizes[i]));
+		bench_report("trash_add_batch", SHAPE_WIDE, sizes[i]);
+
+		assert_int_equal(sizes[i], trash_list_size);
+		trash_remove_entries(trash_names, sizes[i]);
+
+		free_string_array(originals, sizes[i]);
+		free_string_array(trash_names, sizes[i]);
+	}
+}
+
+/* Makes lists of original paths in shuffled order and of their names in
+ * trash. */
+static void
+make_entries(int count, char ***originals, char ***trash_names)
+{
+	int i;
+
+	*originals = malloc(sizeof(**originals)*count);
+	*trash_names = malloc(sizeof(**trash_names)*count);
+	for(i = 0; i < count; ++i)
+	{
+		(*originals)[i] = format_str("/dir/%d", (int)(i*7919LL % count));
+		(*trash_names)[i] = format_str("%s/%d_file", trash_dir, i);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,374 @@
+#include "utils.h"
+
+#include <sys/stat.h> /* stat64 */
+#include <sys/types.h> /* mode_t */
+#include <dirent.h> /* DIR dirent64 */
+#include <fcntl.h> /* O_CREAT O_WRONLY */
+#include <unistd.h> /* close() ssize_t write() */
+
+#include <stdarg.h> /* va_list va_arg() va_end() va_start() */
+#include <stddef.h> /* NULL size_t */
+#include <stdio.h> /* FILE fclose() fflush() fopen() fprintf() snprintf() */
+#include <stdlib.h> /* getenv() strtol() */
+#include <string.h> /* strcmp() strlen() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() timespec */
+
+#if defined(__linux__) && defined(__GLIBC__)
+#include <dlfcn.h> /* RTLD_NEXT dlsym() */
+#define COUNT_CALLS 1
+#endif
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/utils/fs.h"
+
+/* Maximum number of sizes in VIFM_BENCH_SIZES. */
+#define MAX_SIZES 16
+
+/* Fan-out of directories of deep trees. */
+#define FANOUT 10
+
+static void make_file_of(const char path[], int i, int variant);
+static void make_dirs_for(char path[]);
+static const char * shape_name(Shape shape);
+static double now(void);
+
+/* Where results are written. */
+static FILE *out;
+/* Time of the start of current measurement. */
+static double start_time;
+
+/* Number of memory allocations so far. */
+static size_t nallocs;
+/* Number of file-system calls made through libc so far. */
+static size_t nfscalls;
+
+#ifdef COUNT_CALLS
+
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t nmemb, size_t size);
+void * __libc_realloc(void *ptr, size_t size);
+
+/* Resolves next definition of a function, which is the one in libc.  Returns
+ * pointer to the function. */
+#define REAL(name) \
+	({ \
+		static __typeof__(&name) real; \
+		if(real == NULL) \
+		{ \
+			real = (__typeof__(&name))dlsym(RTLD_NEXT, #name); \
+		} \
+		real; \
+	})
+
+void *
+malloc(size_t size)
+{
+	++nallocs;
+	return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	++nallocs;
+	return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+	++nallocs;
+	return __libc_realloc(ptr, size);
+}
+
+int
+stat64(const char *path, struct stat64 *buf)
+{
+	++nfscalls;
+	return REAL(stat64)(path, buf);
+}
+
+int
+lstat64(const char *path, struct stat64 *buf)
+{
+	++nfscalls;
+	return REAL(lstat64)(path, buf);
+}
+
+int
+open64(const char *path, int flags, ...)
+{
+	mode_t mode = 0;
+	if(flags & O_CREAT)
+	{
+		va_list ap;
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+
+	++nfscalls;
+	return REAL(open64)(path, flags, mode);
+}
+
+DIR *
+opendir(const char *path)
+{
+	++nfscalls;
+	return REAL(opendir)(path);
+}
+
+struct dirent64 *
+readdir64(DIR *dir)
+{
+	++nfscalls;
+	return REAL(readdir64)(dir);
+}
+
+int
+access(const char *path, int mode)
+{
+	++nfscalls;
+	return REAL(access)(path, mode);
+}
+
+ssize_t
+readlink(const char *path, char *buf, size_t len)
+{
+	++nfscalls;
+	return REAL(readlink)(path, buf, len);
+}
+
+char *
+realpath(const char *path, char *resolved)
+{
+	++nfscalls;
+	return REAL(realpath)(path, resolved);
+}
+
+#endif
+
+void
+bench_init(void)
+{
+	const char *const path = getenv("VIFM_BENCH_OUT");
+	out = (path == NULL ? stdout : fopen(path, "w"));
+	if(out == NULL)
+	{
+		out = stdout;
+	}
+}
+
+void
+bench_finish(void)
+{
+	if(out != stdout)
+	{
+		fclose(out);
+	}
+	out = NULL;
+}
+
+int
+bench_sizes(const int **sizes)
+{
+	static int list[MAX_SIZES] = { 1000, 10*1000, 100*1000 };
+	static int count = 3;
+
+	const char *spec = getenv("VIFM_BENCH_SIZES");
+	if(spec != NULL)
+	{
+		count = 0;
+		while(*spec != '\0' && count < MAX_SIZES)
+		{
+			char *end;
+			const long size = strtol(spec, &end, 10);
+			if(end == spec)
+			{
+				break;
+			}
+			if(size > 0)
+			{
+				list[count++] = size;
+			}
+			spec = (*end == ',' ? end + 1 : end);
+		}
+	}
+
+	*sizes = list;
+	return count;
+}
+
+void
+bench_make_tree(const char root[], Shape shape, int size, int variant)
+{
+	int depth = 0;
+	if(shape == SHAPE_DEEP)
+	{
+		/* Leave at most FANOUT files per leaf directory. */
+		int capacity;
+		for(capacity = FANOUT; capacity < size; capacity *= FANOUT)
+		{
+			++depth;
+		}
+	}
+
+	create_dir(root);
+
+	int i;
+	for(i = 0; i < size; ++i)
+	{
+		char path[PATH_MAX + 1];
+		size_t len = snprintf(path, sizeof(path), "%s", root);
+
+		int level, divisor = 1;
+		for(level = 0; level < depth; ++level)
+		{
+			divisor *= FANOUT;
+		}
+		for(level = 0; level < depth; ++level)
+		{
+			len += snprintf(path + len, sizeof(path) - len, "/d%d",
+					i/divisor%FANOUT);
+			divisor /= FANOUT;
+		}
+
+		/* Vary extensions and mix in some directories for wide trees. */
+		if(shape == SHAPE_WIDE && i%10 == 9)
+		{
+			snprintf(path + len, sizeof(path) - len, "/dir%07d", i);
+		}
+		else
+		{
+			snprintf(path + len, sizeof(path) - len, "/file%07d.ext%d", i, i%7);
+		}
+
+		make_file_of(path, i, variant);
+	}
+}
+
+/* Creates a file or a directory (if name starts with "dir") at the path
+ * creating parent directories as needed. */
+static void
+make_file_of(const char path[], int i, int variant)
+{
+	char dir[PATH_MAX + 1];
+	snprintf(dir, sizeof(dir), "%s", path);
+	make_dirs_for(dir);
+
+	const char *const name = strrchr(path, '/') + 1;
+	if(strncmp(name, "dir", 3) == 0)
+	{
+		(void)os_mkdir(path, 0700);
+		return;
+	}
+
+	const int fd = open(path, O_CREAT | O_WRONLY, 0600);
+	if(fd != -1)
+	{
+		char contents[32];
+		const int len = snprintf(contents, sizeof(contents), "%d\n",
+				(i%100 == 0) ? i + variant : i);
+		(void)write(fd, contents, len);
+		close(fd);
+	}
+}
+
+/* Creates parent directories of the path, which is modified temporarily. */
+static void
+make_dirs_for(char path[])
+{
+	char *const slash = strrchr(path, '/');
+	if(slash == NULL || slash == path)
+	{
+		return;
+	}
+
+	*slash = '\0';
+	if(!is_dir(path))
+	{
+		make_dirs_for(path);
+		(void)os_mkdir(path, 0700);
+	}
+	*slash = '/';
+}
+
+void
+bench_remove_tree(const char root[])
+{
+	DIR *const dir = os_opendir(root);
+	if(dir == NULL)
+	{
+		return;
+	}
+
+	struct dirent *d;
+	while((d = os_readdir(dir)) != NULL)
+	{
+		if(strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+		{
+			continue;
+		}
+
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/%s", root, d->d_name);
+		if(is_dir(path))
+		{
+			bench_remove_tree(path);
+		}
+		else
+		{
+			(void)remove(path);
+		}
+	}
+	os_closedir(dir);
+
+	(void)os_rmdir(root);
+}
+
+void
+bench_start(void)
+{
+	nallocs = 0U;
+	nfscalls = 0U;
+	start_time = now();
+}
+
+void
+bench_report(const char name[], Shape shape, int size)
+{
+	const double wall = now() - start_time;
+
+	long allocs = -1, fscalls = -1;
+#ifdef COUNT_CALLS
+	allocs = nallocs;
+	fscalls = nfscalls;
+#endif
+
+	fprintf(out, "{\"bench\":\"%s\",\"shape\":\"%s\",\"size\":%d,"
+			"\"wall_s\":%.6f,\"allocs\":%ld,\"fs_calls\":%ld}\n", name,
+			shape_name(shape), size, wall, allocs, fscalls);
+	fflush(out);
+}
+
+/* Maps shape onto its name.  Returns the name. */
+static const char *
+shape_name(Shape shape)
+{
+	return (shape == SHAPE_WIDE ? "wide" : "deep");
+}
+
+/* Retrieves current monotonic time.  Returns the time in seconds. */
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,43 @@
+#ifndef VIFM_TESTS__BENCH__UTILS_H__
+#define VIFM_TESTS__BENCH__UTILS_H__
+
+/* Shape of a synthetic file tree. */
+typedef enum
+{
+	SHAPE_WIDE, /* All files in a single directory. */
+	SHAPE_DEEP, /* Files spread over nested directories with small fan-out. */
+}
+Shape;
+
+/* Opens output for results, which is standard output unless VIFM_BENCH_OUT
+ * environment variable specifies a file. */
+void bench_init(void);
+
+/* Closes output for results. */
+void bench_finish(void);
+
+/* Retrieves sizes of trees to run benchmarks on.  They are taken from
+ * comma-separated VIFM_BENCH_SIZES environment variable or default to 1k, 10k
+ * and 100k entries.  Returns number of sizes. */
+int bench_sizes(const int **sizes);
+
+/* Creates synthetic tree of the shape with the specified number of files at the
+ * root, which must not exist.  Contents of every 100-th file depends on the
+ * variant to produce differences for comparison. */
+void bench_make_tree(const char root[], Shape shape, int size, int variant);
+
+/* Removes a tree created by bench_make_tree(). */
+void bench_remove_tree(const char root[]);
+
+/* Resets counters and remembers time of the start of a measurement. */
+void bench_start(void);
+
+/* Finishes a measurement started by bench_start() and prints it as a single
+ * JSON object per line.  Allocation and file-system call counts are -1 where
+ * counting isn't supported. */
+void bench_report(const char name[], Shape shape, int size);
+
+#endif /* VIFM_TESTS__BENCH__UTILS_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -22,6 +22,7 @@
 #include "../../src/utils/fs.h"
 #include "../../src/utils/macros.h"
 #include "../../src/utils/path.h"
+#include "../../src/utils/perf.h"
 #include "../../src/utils/str.h"
 #include "../../src/utils/string_array.h"
 #include "../../src/builtin_functions.h"
@@ -794,6 +795,35 @@ TEST(plugin_command)
 	curr_stats.vlua = NULL;
 }
 
+TEST(perfstats_command)
+{
+	ui_sb_msg("");
+	assert_failure(exec_commands("perfstats on off", &lwin, CIT_COMMAND));
+	assert_string_equal("Trailing characters", ui_sb_last());
+	assert_failure(exec_commands("perfstats wrong", &lwin, CIT_COMMAND));
+	assert_string_equal("Unknown subcommand: wrong", ui_sb_last());
+	assert_failure(exec_commands("perfstats dump", &lwin, CIT_COMMAND));
+	assert_string_equal("Too few arguments", ui_sb_last());
+
+	assert_success(exec_commands("perfstats on", &lwin, CIT_COMMAND));
+	assert_true(perf_enabled());
+
+	populate_dir_list(&lwin, 0);
+	assert_true(perf_get(PP_DIR_LOAD).count > 0);
+
+	assert_success(exec_commands("perfstats dump " SANDBOX_PATH "/trace.json",
+				&lwin, CIT_COMMAND));
+	assert_success(remove(SANDBOX_PATH "/trace.json"));
+	assert_failure(exec_commands("perfstats dump " SANDBOX_PATH "/no/trace",
+				&lwin, CIT_COMMAND));
+
+	assert_success(exec_commands("perfstats reset", &lwin, CIT_COMMAND));
+	assert_true(perf_get(PP_DIR_LOAD).count == 0);
+
+	assert_success(exec_commands("perfstats off", &lwin, CIT_COMMAND));
+	assert_false(perf_enabled());
+}
+
 static void
 strings_list_is(const strlist_t expected, const strlist_t actual)
 {
@@ -0,0 +1,62 @@
+#include <stic.h>
+
+#include <unistd.h> /* chdir() unlink() */
+
+#include <test-utils.h>
+
+#include "../../src/ui/statusbar.h"
+#include "../../src/utils/fs.h"
+#include "../../src/filelist.h"
+#include "../../src/fops_misc.h"
+#include "../../src/registers.h"
+
+static char *saved_cwd;
+
+SETUP()
+{
+	saved_cwd = save_cwd();
+	assert_success(chdir(SANDBOX_PATH));
+
+	view_setup(&lwin);
+	assert_non_null(get_cwd(lwin.curr_dir, sizeof(lwin.curr_dir)));
+
+	regs_init();
+}
+
+TEARDOWN()
+{
+	regs_reset();
+	view_teardown(&lwin);
+	restore_cwd(saved_cwd);
+}
+
+TEST(yanked_files_are_counted)
+{
+	create_file("a");
+	create_file("b");
+	populate_dir_list(&lwin, 0);
+	lwin.dir_entry[0].marked = 1;
+	lwin.dir_entry[1].marked = 1;
+
+	(void)fops_yank(&lwin, 'a');
+	assert_string_equal("2 files yanked", ui_sb_last());
+	assert_int_equal(2, regs_find('a')->nfiles);
+
+	assert_success(unlink("a"));
+	assert_success(unlink("b"));
+}
+
+TEST(files_yanked_to_blackhole_register_are_counted)
+{
+	create_file("a");
+	populate_dir_list(&lwin, 0);
+	lwin.dir_entry[0].marked = 1;
+
+	(void)fops_yank(&lwin, BLACKHOLE_REG_NAME);
+	assert_string_equal("1 file yanked", ui_sb_last());
+
+	assert_success(unlink("a"));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,95 @@
+#include <stic.h>
+
+#include <stddef.h> /* NULL */
+
+#include "../../src/io/private/ioeta.h"
+#include "../../src/io/ioeta.h"
+#include "../../src/io/ionotif.h"
+
+static void progress_changed(const io_progress_t *progress);
+
+static int invoked_eta;
+static int invoked_progress;
+
+static ioeta_estim_t *estim;
+
+SETUP()
+{
+	const io_cancellation_t no_cancellation = {};
+	estim = ioeta_alloc(NULL, no_cancellation);
+
+	invoked_eta = 0;
+	invoked_progress = 0;
+
+	ionotif_register(&progress_changed);
+	/* Large enough to not expire while running the tests. */
+	ionotif_set_interval(1000*1000);
+}
+
+TEARDOWN()
+{
+	ionotif_set_interval(0);
+	ionotif_register(NULL);
+
+	ioeta_free(estim);
+}
+
+static void
+progress_changed(const io_progress_t *progress)
+{
+	switch(progress->stage)
+	{
+		case IO_PS_ESTIMATING:
+			++invoked_eta;
+			break;
+		case IO_PS_IN_PROGRESS:
+			++invoked_progress;
+			break;
+	}
+}
+
+TEST(frequent_updates_are_throttled)
+{
+	ioeta_update(estim, "a", "x", 0, 10);
+	ioeta_update(estim, NULL, NULL, 0, 10);
+	ioeta_update(estim, NULL, NULL, 1, 10);
+
+	assert_int_equal(1, invoked_progress);
+	assert_int_equal(30, estim->current_byte);
+	assert_int_equal(1, estim->current_item);
+}
+
+TEST(paths_are_not_copied_when_throttled)
+{
+	ioeta_update(estim, "a", "x", 0, 10);
+	ioeta_update(estim, "b", "y", 0, 10);
+
+	assert_string_equal("a", estim->item);
+	assert_string_equal("x", estim->target);
+}
+
+TEST(stage_change_is_always_reported)
+{
+	ioeta_add_item(estim, "a");
+	ioeta_add_item(estim, "b");
+	ioeta_update(estim, "a", "x", 0, 10);
+	ioeta_update(estim, "b", "y", 0, 10);
+
+	assert_int_equal(1, invoked_eta);
+	assert_int_equal(1, invoked_progress);
+	assert_int_equal(2, estim->total_items);
+}
+
+TEST(zero_interval_disables_throttling)
+{
+	ionotif_set_interval(0);
+
+	ioeta_update(estim, "a", "x", 0, 10);
+	ioeta_update(estim, "b", "y", 0, 10);
+
+	assert_int_equal(2, invoked_progress);
+	assert_string_equal("b", estim->item);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -166,6 +166,16 @@ TEST(logging_with_arg)
 	args_free(&args);
 }
 
+TEST(startuptime_takes_path)
+{
+	args_t args = { };
+	char *argv[] = { "vifm", "--startuptime", "report", NULL };
+
+	args_parse(&args, ARRAY_LEN(argv) - 1U, argv, "/");
+	assert_string_equal("report", args.startup_time_path);
+	args_free(&args);
+}
+
 TEST(various_flags)
 {
 	args_t args = { };
@@ -211,6 +221,21 @@ TEST(remote_expr_is_parsed, IF(with_remote_cmds))
 	args_free(&args);
 }
 
+TEST(remote_batch_takes_all_arguments_to_the_right, IF(with_remote_cmds))
+{
+	args_t args = { };
+	char *argv[] = { "vifm", "--remote-batch", "cd /", "=1", NULL };
+
+	args_parse(&args, ARRAY_LEN(argv) - 1U, argv, "/");
+
+	assert_null(args.remote_cmds);
+	assert_string_equal("cd /", args.remote_batch[0]);
+	assert_string_equal("=1", args.remote_batch[1]);
+	assert_string_equal(NULL, args.remote_batch[2]);
+
+	args_free(&args);
+}
+
 TEST(server_name_becomes_target_name, IF(with_remote_cmds))
 {
 	args_t args = { };
@@ -0,0 +1,169 @@
+#include <stic.h>
+
+#include <stddef.h> /* size_t */
+#include <string.h> /* strcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/column_view.h"
+#include "../../src/ui/tabs.h"
+#include "../../src/ui/ui.h"
+#include "../../src/compare.h"
+#include "../../src/filelist.h"
+#include "../../src/status.h"
+
+static void column_line_print(const char buf[], size_t offset, AlignType align,
+		const char full_column[], const format_info_t *info);
+
+SETUP()
+{
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	view_setup(&lwin);
+	view_setup(&rwin);
+
+	opt_handlers_setup();
+
+	columns_setup_column(SK_BY_NAME);
+	columns_setup_column(SK_BY_SIZE);
+	columns_set_line_print_func(&column_line_print);
+	lwin.columns = columns_create();
+	rwin.columns = columns_create();
+
+	/* Comparison is done in background only when TUI is fully loaded. */
+	curr_stats.load_stage = 3;
+}
+
+TEARDOWN()
+{
+	curr_stats.load_stage = 0;
+
+	tabs_only(&lwin);
+	cfg.pane_tabs = 0;
+
+	columns_free(lwin.columns);
+	lwin.columns = NULL;
+	columns_free(rwin.columns);
+	rwin.columns = NULL;
+	columns_teardown();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+
+	opt_handlers_teardown();
+}
+
+static void
+column_line_print(const char buf[], size_t offset, AlignType align,
+		const char full_column[], const format_info_t *info)
+{
+	/* Do nothing. */
+}
+
+TEST(one_pane_is_compared_in_background)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0));
+	wait_for_bg();
+
+	/* Views are updated only on request. */
+	assert_false(flist_custom_active(&lwin));
+
+	compare_check_for_updates();
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(4, lwin.list_rows);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_int_equal(1, lwin.dir_entry[1].id);
+	assert_int_equal(2, lwin.dir_entry[2].id);
+	assert_int_equal(3, lwin.dir_entry[3].id);
+}
+
+TEST(two_panes_are_compared_in_background)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/a");
+	strcpy(rwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_two_panes(CT_NAME, LT_ALL, 0, 0));
+	wait_for_bg();
+	compare_check_for_updates();
+
+	assert_int_equal(CV_DIFF, lwin.custom.type);
+	assert_int_equal(CV_DIFF, rwin.custom.type);
+	assert_int_equal(4, lwin.list_rows);
+	assert_int_equal(4, rwin.list_rows);
+	assert_string_equal("same-content-different-name-1", lwin.dir_entry[0].name);
+	assert_string_equal("same-content-different-name-1", rwin.dir_entry[0].name);
+	assert_string_equal("", lwin.dir_entry[3].name);
+	assert_string_equal("same-content-different-name-2", rwin.dir_entry[3].name);
+}
+
+TEST(results_are_dropped_if_view_changes_location)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0));
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/a");
+	wait_for_bg();
+	compare_check_for_updates();
+
+	assert_false(flist_custom_active(&lwin));
+	assert_string_equal(TEST_DATA_PATH "/compare/a", lwin.curr_dir);
+}
+
+TEST(newer_comparison_replaces_older_one)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0));
+	assert_success(compare_one_pane(&lwin, CT_NAME, LT_ALL, 0));
+	wait_for_bg();
+	compare_check_for_updates();
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(4, lwin.list_rows);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_int_equal(2, lwin.dir_entry[1].id);
+	assert_int_equal(3, lwin.dir_entry[2].id);
+	assert_int_equal(4, lwin.dir_entry[3].id);
+}
+
+TEST(results_wait_for_their_tab_after_it_is_moved)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	load_dir_list(&lwin, 1);
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0));
+	/* Switching tabs with loaded TUI needs real windows. */
+	curr_stats.load_stage = 0;
+	cfg.pane_tabs = 1;
+	assert_success(tabs_new(NULL, NULL));
+	tabs_move(&lwin, 0);
+	wait_for_bg();
+
+	compare_check_for_updates();
+	assert_false(flist_custom_active(&lwin));
+
+	tabs_goto(1);
+	compare_check_for_updates();
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+}
+
+TEST(results_are_dropped_if_their_tab_is_closed)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	load_dir_list(&lwin, 1);
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0));
+	/* Switching tabs with loaded TUI needs real windows. */
+	curr_stats.load_stage = 0;
+	cfg.pane_tabs = 1;
+	assert_success(tabs_new(NULL, NULL));
+	tabs_goto(0);
+	tabs_close();
+	wait_for_bg();
+
+	compare_check_for_updates();
+	assert_false(flist_custom_active(&lwin));
+	assert_string_equal(TEST_DATA_PATH "/compare/b", lwin.curr_dir);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
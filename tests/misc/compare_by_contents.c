@@ -0,0 +1,151 @@
+#include <stic.h>
+
+#include <stdio.h> /* FILE fclose() fopen() fwrite() */
+#include <string.h> /* memset() strcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/hcache.h"
+#include "../../src/compare.h"
+#include "../../src/running.h"
+
+static void make_large_file(const char path[], char last);
+
+SETUP()
+{
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	view_setup(&lwin);
+	view_setup(&rwin);
+
+	opt_handlers_setup();
+}
+
+TEARDOWN()
+{
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+
+	opt_handlers_teardown();
+}
+
+TEST(files_are_distinguished_after_prefix)
+{
+	make_large_file(SANDBOX_PATH "/a", 'x');
+	make_large_file(SANDBOX_PATH "/b", 'x');
+	make_large_file(SANDBOX_PATH "/c", 'y');
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(3, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("c", lwin.dir_entry[2].name);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_int_equal(1, lwin.dir_entry[1].id);
+	assert_int_equal(2, lwin.dir_entry[2].id);
+
+	remove_file(SANDBOX_PATH "/a");
+	remove_file(SANDBOX_PATH "/b");
+	remove_file(SANDBOX_PATH "/c");
+}
+
+TEST(files_are_matched_across_panes)
+{
+	create_dir(SANDBOX_PATH "/left");
+	create_dir(SANDBOX_PATH "/right");
+	make_large_file(SANDBOX_PATH "/left/a", 'x');
+	make_large_file(SANDBOX_PATH "/left/b", 'y');
+	make_large_file(SANDBOX_PATH "/right/c", 'y');
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/left");
+	strcpy(rwin.curr_dir, SANDBOX_PATH "/right");
+	compare_two_panes(CT_CONTENTS, LT_DUPS, 1, 0);
+
+	assert_int_equal(1, lwin.list_rows);
+	assert_int_equal(1, rwin.list_rows);
+	assert_string_equal("b", lwin.dir_entry[0].name);
+	assert_string_equal("c", rwin.dir_entry[0].name);
+	assert_int_equal(lwin.dir_entry[0].id, rwin.dir_entry[0].id);
+
+	remove_file(SANDBOX_PATH "/left/a");
+	remove_file(SANDBOX_PATH "/left/b");
+	remove_file(SANDBOX_PATH "/right/c");
+	remove_dir(SANDBOX_PATH "/left");
+	remove_dir(SANDBOX_PATH "/right");
+}
+
+TEST(empty_files_are_all_identical)
+{
+	create_file(SANDBOX_PATH "/a");
+	create_file(SANDBOX_PATH "/b");
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, 0);
+
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(lwin.dir_entry[0].id, lwin.dir_entry[1].id);
+
+	remove_file(SANDBOX_PATH "/a");
+	remove_file(SANDBOX_PATH "/b");
+}
+
+TEST(hashes_are_cached, IF(not_windows))
+{
+	create_dir(SANDBOX_PATH "/dir");
+	make_large_file(SANDBOX_PATH "/dir/a", 'x');
+	make_large_file(SANDBOX_PATH "/dir/b", 'x');
+	make_large_file(SANDBOX_PATH "/dir/c", 'y');
+	strcpy(cfg.hashes_file, SANDBOX_PATH "/hashes");
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/dir");
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+	assert_int_equal(3, lwin.list_rows);
+
+	hcache_t *const cache = hcache_load(cfg.hashes_file, sizeof(void *)*8);
+	assert_int_equal(3, hcache_size(cache));
+
+	hcache_rec_t rec;
+	assert_success(hcache_rec_init(&rec, SANDBOX_PATH "/dir/c"));
+	assert_success(hcache_get(cache, &rec));
+	assert_int_equal(HCF_PREFIX | HCF_FULL, rec.flags);
+	hcache_free(cache);
+
+	/* Results are the same when using the cache. */
+	rn_leave(&lwin, 1);
+	compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, 0);
+	assert_int_equal(3, lwin.list_rows);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_int_equal(1, lwin.dir_entry[1].id);
+	assert_int_equal(2, lwin.dir_entry[2].id);
+
+	cfg.hashes_file[0] = '\0';
+	remove_file(SANDBOX_PATH "/hashes");
+	remove_file(SANDBOX_PATH "/dir/a");
+	remove_file(SANDBOX_PATH "/dir/b");
+	remove_file(SANDBOX_PATH "/dir/c");
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+/* Creates a file which is larger than a prefix used for hashing and differs
+ * from similar files only by the last byte. */
+static void
+make_large_file(const char path[], char last)
+{
+	char block[16*1024];
+	memset(block, 'a', sizeof(block));
+	block[sizeof(block) - 1] = last;
+
+	FILE *const f = fopen(path, "wb");
+	assert_non_null(f);
+	assert_int_equal(sizeof(block), fwrite(block, 1, sizeof(block), f));
+	fclose(f);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -11,6 +11,7 @@
 #include "../../src/cfg/config.h"
 #include "../../src/compat/os.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
 #include "../../src/utils/str.h"
 #include "../../src/status.h"
 
@@ -23,6 +24,7 @@ SETUP()
 TEARDOWN()
 {
 	update_string(&cfg.shell, NULL);
+	cfg.dcache_file[0] = '\0';
 }
 
 TEST(size_does_not_clobber_nitems)
@@ -92,6 +94,94 @@ TEST(can_query_one_parameter_at_a_time)
 	assert_ulong_equal(11, data.value);
 }
 
+TEST(parent_sizes_are_updated)
+{
+	uint64_t size;
+
+	dcache_set_at(TEST_DATA_PATH, 0, 100, DCACHE_UNKNOWN);
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, DCACHE_UNKNOWN);
+	dcache_set_at(TEST_DATA_PATH "/read", 0, DCACHE_UNKNOWN, 1);
+
+	dcache_update_parent_sizes(TEST_DATA_PATH "/read", 5);
+
+	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, NULL);
+	assert_ulong_equal(105, size);
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0, &size, NULL);
+	assert_ulong_equal(10, size);
+}
+
+TEST(parents_without_size_are_not_updated)
+{
+	uint64_t size, nitems;
+
+	dcache_set_at(TEST_DATA_PATH, 0, DCACHE_UNKNOWN, 2);
+	dcache_update_parent_sizes(TEST_DATA_PATH "/read", 5);
+
+	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, &nitems);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+	assert_ulong_equal(2, nitems);
+}
+
+TEST(cache_is_persisted)
+{
+	uint64_t size, nitems;
+
+	copy_str(cfg.dcache_file, sizeof(cfg.dcache_file), SANDBOX_PATH "/dcache");
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, 11);
+	assert_success(dcache_save());
+
+	assert_success(stats_init(&cfg));
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0, &size, &nitems);
+	assert_ulong_equal(10, size);
+	assert_ulong_equal(11, nitems);
+
+	remove_file(SANDBOX_PATH "/dcache");
+}
+
+TEST(unchanged_cache_is_not_written)
+{
+	copy_str(cfg.dcache_file, sizeof(cfg.dcache_file), SANDBOX_PATH "/dcache");
+	assert_success(dcache_save());
+	assert_false(path_exists(SANDBOX_PATH "/dcache", NODEREF));
+}
+
+TEST(broken_cache_file_is_ignored)
+{
+	uint64_t size;
+
+	make_file(SANDBOX_PATH "/dcache", "VIFMDCH1 garbage");
+	copy_str(cfg.dcache_file, sizeof(cfg.dcache_file), SANDBOX_PATH "/dcache");
+
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+
+	remove_file(SANDBOX_PATH "/dcache");
+}
+
+TEST(records_of_other_instances_are_merged_in)
+{
+	uint64_t size;
+
+	copy_str(cfg.dcache_file, sizeof(cfg.dcache_file), SANDBOX_PATH "/dcache");
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, DCACHE_UNKNOWN);
+	assert_success(dcache_save());
+
+	/* Make this instance unaware of the file until it's saved. */
+	assert_success(stats_init(&cfg));
+	cfg.dcache_file[0] = '\0';
+	dcache_set_at(TEST_DATA_PATH, 0, 20, DCACHE_UNKNOWN);
+	copy_str(cfg.dcache_file, sizeof(cfg.dcache_file), SANDBOX_PATH "/dcache");
+	assert_success(dcache_save());
+
+	assert_success(stats_init(&cfg));
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0, &size, NULL);
+	assert_ulong_equal(10, size);
+	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, NULL);
+	assert_ulong_equal(20, size);
+
+	remove_file(SANDBOX_PATH "/dcache");
+}
+
 #ifndef _WIN32
 
 TEST(symlink_inode_resolution, IF(not_windows))
@@ -1,9 +1,34 @@
 #include <stic.h>
 
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
 #include <test-utils.h>
 
 #include "../../src/cmd_completion.h"
 #include "../../src/filetype.h"
+#include "../../src/int/path_env.h"
+#include "../../src/utils/env.h"
+#include "../../src/compat/fs_limits.h"
+
+static int has_inotify(void);
+
+static char *saved_path_env;
+static char sandbox[PATH_MAX + 1];
+
+SETUP()
+{
+	saved_path_env = strdup(env_get("PATH"));
+	make_abs_path(sandbox, sizeof(sandbox), SANDBOX_PATH, "", NULL);
+}
+
+TEARDOWN()
+{
+	env_set("PATH", saved_path_env);
+	update_path_env(1);
+	free(saved_path_env);
+}
 
 TEST(system_shell_exists)
 {
@@ -29,5 +54,55 @@ TEST(exe_path_with_backslashes, IF(windows))
 	ft_init(NULL);
 }
 
+TEST(commands_in_path_are_found, IF(not_windows))
+{
+	create_dir(SANDBOX_PATH "/a");
+	create_dir(SANDBOX_PATH "/b");
+	create_executable(SANDBOX_PATH "/b/exe");
+	create_file(SANDBOX_PATH "/a/data");
+
+	char path[PATH_MAX*2 + 2];
+	snprintf(path, sizeof(path), "%s/a:%s/b", sandbox, sandbox);
+	env_set("PATH", path);
+	update_path_env(1);
+
+	assert_true(external_command_exists("exe"));
+	assert_false(external_command_exists("data"));
+	assert_false(external_command_exists("missing"));
+
+	remove_file(SANDBOX_PATH "/a/data");
+	remove_file(SANDBOX_PATH "/b/exe");
+	remove_dir(SANDBOX_PATH "/a");
+	remove_dir(SANDBOX_PATH "/b");
+}
+
+TEST(changes_of_path_directories_are_noticed, IF(has_inotify))
+{
+	create_dir(SANDBOX_PATH "/bin");
+
+	char path[PATH_MAX + 8];
+	snprintf(path, sizeof(path), "%s/bin", sandbox);
+	env_set("PATH", path);
+	update_path_env(1);
+
+	assert_false(external_command_exists("exe"));
+	create_executable(SANDBOX_PATH "/bin/exe");
+	assert_true(external_command_exists("exe"));
+	remove_file(SANDBOX_PATH "/bin/exe");
+	assert_false(external_command_exists("exe"));
+
+	remove_dir(SANDBOX_PATH "/bin");
+}
+
+static int
+has_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -126,6 +126,33 @@ TEST(custom_view_replaces_custom_view_fine)
 	assert_true(flist_custom_active(&lwin));
 }
 
+TEST(reload_preserves_selection)
+{
+	create_file(SANDBOX_PATH "/a");
+	create_file(SANDBOX_PATH "/b");
+	create_file(SANDBOX_PATH "/c");
+
+	flist_custom_start(&lwin, "test");
+	flist_custom_add(&lwin, SANDBOX_PATH "/a");
+	flist_custom_add(&lwin, SANDBOX_PATH "/b");
+	flist_custom_add(&lwin, SANDBOX_PATH "/c");
+	assert_true(flist_custom_finish(&lwin, CV_REGULAR, 0) == 0);
+	assert_int_equal(3, lwin.list_rows);
+
+	lwin.dir_entry[2].selected = 1;
+	lwin.selected_files = 1;
+	remove_file(SANDBOX_PATH "/a");
+
+	load_dir_list(&lwin, 1);
+	assert_int_equal(2, lwin.list_rows);
+	assert_false(lwin.dir_entry[0].selected);
+	assert_true(lwin.dir_entry[1].selected);
+	assert_int_equal(1, lwin.selected_files);
+
+	remove_file(SANDBOX_PATH "/b");
+	remove_file(SANDBOX_PATH "/c");
+}
+
 TEST(reload_does_not_remove_broken_symlinks, IF(not_windows))
 {
 	char test_file[PATH_MAX + 1];
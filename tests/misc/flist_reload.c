@@ -95,5 +95,24 @@ TEST(selection_is_preserved)
 	assert_int_equal(2, view->selected_files);
 }
 
+TEST(selection_is_preserved_when_entries_are_added)
+{
+	view->list_pos = 2;
+	view->dir_entry[1].selected = 1;
+	view->dir_entry[3].selected = 1;
+	view->selected_files = 2;
+	assert_success(os_mkdir("00", 0000));
+
+	populate_dir_list(view, 1);
+	assert_int_equal(5, view->list_rows);
+	assert_false(view->dir_entry[1].selected);
+	assert_true(view->dir_entry[2].selected);
+	assert_true(view->dir_entry[4].selected);
+	assert_int_equal(2, view->selected_files);
+	assert_string_equal("2", view->dir_entry[view->list_pos].name);
+
+	(void)rmdir("00");
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -5,8 +5,8 @@
 #endif
 
 #include <stddef.h> /* NULL */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strcmp() strdup() */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* memset() strcmp() strdup() strlen() */
 
 #include <test-utils.h>
 
@@ -20,7 +20,10 @@ static void test_ipc_args2(char *args[]);
 static void recursive_ipc_args(char *args[]);
 static char * test_ipc_eval(const char expr[]);
 static char * test_ipc_eval_error(const char expr[]);
+static char * echo_ipc_eval(const char expr[]);
+static char ** test_ipc_batch(char *items[], int nitems);
 static void other_instance(bg_op_t *bg_op, void *arg);
+static void serving_instance(bg_op_t *bg_op, void *arg);
 static int enabled_and_not_in_wine(void);
 static int enabled_and_not_windows(void);
 
@@ -30,11 +33,14 @@ static char *message;
 static int nmessages2;
 static char *message2;
 static ipc_t *recursive_ipc;
+static volatile int stop_serving;
+static int nbatches;
 
 TEARDOWN()
 {
 	nmessages = 0;
 	nmessages2 = 0;
+	nbatches = 0;
 	update_string(&message, NULL);
 	update_string(&message2, NULL);
 }
@@ -46,29 +52,29 @@ TEST(destroy_null, IF(ipc_enabled))
 
 TEST(create_and_destroy, IF(ipc_enabled))
 {
-	ipc_t *const ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
 	assert_non_null(ipc);
 	ipc_free(ipc);
 }
 
 TEST(name_can_be_null, IF(ipc_enabled))
 {
-	ipc_t *const ipc = ipc_init(NULL, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc = ipc_init(NULL, &test_ipc_args, &test_ipc_eval, NULL);
 	assert_non_null(ipc);
 	ipc_free(ipc);
 }
 
 TEST(name_is_taken_into_account, IF(ipc_enabled))
 {
-	ipc_t *const ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
 	assert_true(starts_with_lit(ipc_get_name(ipc), NAME));
 	ipc_free(ipc);
 }
 
 TEST(names_do_not_repeat, IF(enabled_and_not_in_wine))
 {
-	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
-	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
 	assert_true(strcmp(ipc_get_name(ipc1), ipc_get_name(ipc2)) != 0);
 	ipc_free(ipc1);
 	ipc_free(ipc2);
@@ -77,7 +83,7 @@ TEST(names_do_not_repeat, IF(enabled_and_not_in_wine))
 TEST(instance_is_listed_when_it_exists, IF(enabled_and_not_in_wine))
 {
 	int len;
-	ipc_t *const ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
 	char **const list = ipc_list(&len);
 	assert_true(is_in_string_array(list, len, ipc_get_name(ipc)));
 	free_string_array(list, len);
@@ -89,7 +95,7 @@ TEST(instance_is_not_listed_after_it_is_freed, IF(ipc_enabled))
 	int len;
 	char **list;
 
-	ipc_t *const ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
 	char *const name = strdup(ipc_get_name(ipc));
 	ipc_free(ipc);
 
@@ -105,8 +111,8 @@ TEST(message_is_delivered, IF(enabled_and_not_in_wine))
 	char msg[] = "test message";
 	char *data[] = { msg, NULL };
 
-	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
-	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval, NULL);
 
 	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
 	assert_false(ipc_check(ipc1));
@@ -127,8 +133,8 @@ TEST(expr_is_evaluated, IF(enabled_and_not_in_wine))
 	const char expr[] = "good expression";
 	char *result;
 
-	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
-	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval, NULL);
 
 	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
 
@@ -154,8 +160,9 @@ TEST(eval_error_is_handled, IF(enabled_and_not_in_wine))
 	const char expr[] = "bad expression";
 	char *result;
 
-	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
-	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval_error);
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval_error,
+			NULL);
 
 	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
 
@@ -181,8 +188,9 @@ TEST(checking_ipc_from_ipc_handler_is_noop, IF(enabled_and_not_windows))
 	char msg[] = "test message";
 	char *data[] = { msg, NULL };
 
-	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
-	ipc_t *const ipc2 = ipc_init(NAME, &recursive_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &recursive_ipc_args, &test_ipc_eval,
+			NULL);
 
 	recursive_ipc = ipc2;
 
@@ -195,6 +203,143 @@ TEST(checking_ipc_from_ipc_handler_is_noop, IF(enabled_and_not_windows))
 	ipc_free(ipc2);
 }
 
+TEST(long_message_is_delivered, IF(enabled_and_not_windows))
+{
+	/* Bigger than fixed-size buffer that was used for packages. */
+	static char msg[20000];
+	memset(msg, 'x', sizeof(msg) - 1U);
+	char *data[] = { msg, NULL };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval, NULL);
+
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+	assert_true(ipc_check(ipc2));
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+
+	assert_int_equal(2, nmessages2);
+	assert_int_equal(sizeof(msg) - 1U, strlen(message2));
+}
+
+TEST(instance_with_long_path_is_usable, IF(enabled_and_not_windows))
+{
+	/* Path of the instance doesn't fit into an address of a socket. */
+	char name[151];
+	memset(name, 'n', sizeof(name) - 1U);
+	name[sizeof(name) - 1U] = '\0';
+
+	char msg[] = "test message";
+	char *data[] = { msg, NULL };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(name, &test_ipc_args2, &test_ipc_eval, NULL);
+	assert_non_null(ipc2);
+
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+	assert_true(ipc_check(ipc2));
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+
+	assert_int_equal(2, nmessages2);
+	assert_string_equal(msg, message2);
+}
+
+TEST(message_larger_than_socket_buffer_is_delivered,
+     IF(enabled_and_not_windows))
+{
+	/* Doesn't fit into a single message of a socket with default settings. */
+	static char msg[1024*1024];
+	memset(msg, 'x', sizeof(msg) - 1U);
+	char *data[] = { msg, NULL };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval, NULL);
+
+	/* Receiver must be running for the sender to not block forever. */
+	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+	wait_for_bg();
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+
+	assert_int_equal(2, nmessages2);
+	assert_int_equal(sizeof(msg) - 1U, strlen(message2));
+}
+
+TEST(replies_match_requests, IF(enabled_and_not_windows))
+{
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &echo_ipc_eval, NULL);
+
+	stop_serving = 0;
+	assert_success(bg_execute("", "", 0, 1, &serving_instance, ipc2));
+
+	char *const result1 = ipc_eval(ipc1, ipc_get_name(ipc2), "first");
+	char *const result2 = ipc_eval(ipc1, ipc_get_name(ipc2), "second");
+
+	stop_serving = 1;
+	wait_for_bg();
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+
+	assert_string_equal("first", result1);
+	assert_string_equal("second", result2);
+	free(result1);
+	free(result2);
+}
+
+TEST(batch_is_processed_as_a_whole, IF(enabled_and_not_in_wine))
+{
+	char *items[] = { "cmd", "=expr", "fail", "" };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval,
+			&test_ipc_batch);
+
+	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
+
+	char **const results = ipc_batch(ipc1, ipc_get_name(ipc2), items, 4, 5000);
+	assert_false(ipc_check(ipc1));
+
+	wait_for_bg();
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+
+	/* Callback is invoked once for the whole batch. */
+	assert_int_equal(1, nbatches);
+	assert_non_null(results);
+	assert_string_equal("", results[0]);
+	assert_string_equal("expr", results[1]);
+	assert_string_equal(NULL, results[2]);
+	assert_string_equal("", results[3]);
+	free_string_array(results, 4);
+}
+
+TEST(batch_is_rejected_without_callback, IF(enabled_and_not_in_wine))
+{
+	char *items[] = { "cmd" };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval, NULL);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval, NULL);
+
+	assert_success(bg_execute("", "", 0, 1, &other_instance, ipc2));
+
+	char **const results = ipc_batch(ipc1, ipc_get_name(ipc2), items, 1, 5000);
+
+	wait_for_bg();
+
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+
+	assert_null(results);
+}
+
 static void
 test_ipc_args(char *args[])
 {
@@ -231,6 +376,33 @@ test_ipc_eval_error(const char expr[])
 	return NULL;
 }
 
+static char *
+echo_ipc_eval(const char expr[])
+{
+	return strdup(expr);
+}
+
+static char **
+test_ipc_batch(char *items[], int nitems)
+{
+	char **const results = calloc(nitems, sizeof(*results));
+	int i;
+	for(i = 0; i < nitems; ++i)
+	{
+		if(items[i][0] == '=')
+		{
+			results[i] = strdup(items[i] + 1);
+		}
+		else if(strcmp(items[i], "fail") != 0)
+		{
+			results[i] = strdup("");
+		}
+	}
+
+	++nbatches;
+	return results;
+}
+
 static void
 other_instance(bg_op_t *bg_op, void *arg)
 {
@@ -241,6 +413,16 @@ other_instance(bg_op_t *bg_op, void *arg)
 	}
 }
 
+static void
+serving_instance(bg_op_t *bg_op, void *arg)
+{
+	ipc_t *const ipc = arg;
+	while(!stop_serving)
+	{
+		(void)ipc_check(ipc);
+	}
+}
+
 static int
 enabled_and_not_in_wine(void)
 {
@@ -3,6 +3,7 @@
 #include <unistd.h> /* chdir() */
 
 #include <stddef.h> /* wchar_t */
+#include <string.h> /* strdup() */
 
 #include "../../src/registers.h"
 
@@ -70,6 +71,58 @@ TEST(suggestion_trims_extra_lines_multiple_regs)
 	assert_string_equal("b", descr);
 }
 
+TEST(many_files_are_appended_in_sorted_order_without_duplicates)
+{
+	char *files[] = {
+		strdup("/d"), strdup("/b"), strdup("/c"), strdup("/b"), strdup("/a")
+	};
+
+	assert_int_equal(0, regs_append('a', "/c"));
+	assert_int_equal(3, regs_append_many('a', files, 5));
+
+	const reg_t *reg = regs_find('a');
+	assert_int_equal(4, reg->nfiles);
+	assert_string_equal("/a", reg->files[0]);
+	assert_string_equal("/b", reg->files[1]);
+	assert_string_equal("/c", reg->files[2]);
+	assert_string_equal("/d", reg->files[3]);
+
+	/* Registers stay searchable after batch append. */
+	assert_failure(regs_append('a', "/b"));
+	assert_success(regs_append('a', "/bb"));
+	assert_string_equal("/bb", reg->files[2]);
+}
+
+TEST(appending_many_files_to_blackhole_or_invalid_register_does_nothing)
+{
+	char *files[] = { strdup("/a") };
+	assert_int_equal(0, regs_append_many(BLACKHOLE_REG_NAME, files, 1));
+	files[0] = strdup("/a");
+	assert_int_equal(0, regs_append_many('#', files, 1));
+	assert_int_equal(0, regs_append_many('a', files, 0));
+}
+
+TEST(renaming_contents_keeps_register_sorted)
+{
+	char *files[] = { strdup("/a"), strdup("/b"), strdup("/c") };
+	assert_int_equal(3, regs_append_many('a', files, 3));
+
+	regs_rename_contents("/a", "/d");
+
+	const reg_t *reg = regs_find('a');
+	assert_int_equal(3, reg->nfiles);
+	assert_string_equal("/b", reg->files[0]);
+	assert_string_equal("/c", reg->files[1]);
+	assert_string_equal("/d", reg->files[2]);
+	assert_failure(regs_append('a', "/d"));
+
+	/* Renaming onto existing path doesn't produce duplicates. */
+	regs_rename_contents("/b", "/c");
+	assert_int_equal(2, reg->nfiles);
+	assert_string_equal("/c", reg->files[0]);
+	assert_string_equal("/d", reg->files[1]);
+}
+
 static void
 suggest_cb(const wchar_t text[], const wchar_t value[], const char d[])
 {
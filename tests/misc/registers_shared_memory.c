@@ -207,6 +207,21 @@ TEST(chg_update_in_place)
 	check_is_initial(0, TEST_REGISTERS_MINUS_D);
 }
 
+TEST(only_changed_registers_are_imported)
+{
+	/* Local change that's not synchronized yet. */
+	send_query(0, "set,h,local\n");
+
+	send_query(1, "set,d,newd,nd1,nd2\n");
+	sync_to_from(1);
+
+	check_register_contents(0, 'd', TEST_EXPECT_FOR_D);
+	check_register_contents(0, 'h', "h,1,local,");
+
+	/* Restore initial value. */
+	send_query(0, "set,h,_initialh,ih1,ih2,ih3\n");
+}
+
 static void
 check_register_contents(int instance, char register_name,
 		const char expected_content[])
@@ -1,6 +1,6 @@
 #include <stic.h>
 
-#include <stdio.h> /* rename() */
+#include <stdio.h> /* remove() rename() */
 
 #include <test-utils.h>
 
@@ -26,6 +26,9 @@ TEARDOWN()
 	histories_init(0);
 	cfg.session_options = 0;
 	cfg.vifm_info = 0;
+
+	/* Storing state twice can produce a journal. */
+	(void)remove(SANDBOX_PATH "/vifminfo.journal");
 }
 
 TEST(not_in_a_session_initially)
@@ -0,0 +1,76 @@
+#include <stic.h>
+
+#include <stdio.h> /* FILE fclose() fopen() remove() */
+#include <string.h> /* strstr() */
+
+#include "../../src/utils/file_streams.h"
+#include "../../src/startup.h"
+
+/* Path to report file. */
+#define REPORT SANDBOX_PATH "/report"
+
+static int count_lines_with(const char path[], const char substr[]);
+
+TEST(marks_are_ignored_without_report)
+{
+	startup_time_mark("stage");
+	startup_time_close();
+}
+
+TEST(report_lists_stages)
+{
+	assert_success(startup_time_open(REPORT));
+	startup_time_mark("first stage");
+	startup_time_mark("second stage");
+	startup_time_close();
+
+	assert_int_equal(1, count_lines_with(REPORT, "times in msec"));
+	assert_int_equal(1, count_lines_with(REPORT, "STARTING"));
+	assert_int_equal(1, count_lines_with(REPORT, ": first stage"));
+	assert_int_equal(1, count_lines_with(REPORT, ": second stage"));
+	assert_int_equal(1, count_lines_with(REPORT, "STARTED"));
+
+	/* Nothing is written after closing. */
+	startup_time_mark("third stage");
+	assert_int_equal(0, count_lines_with(REPORT, "third stage"));
+
+	assert_success(remove(REPORT));
+}
+
+TEST(report_is_appended)
+{
+	assert_success(startup_time_open(REPORT));
+	startup_time_close();
+	assert_success(startup_time_open(REPORT));
+	startup_time_close();
+
+	assert_int_equal(2, count_lines_with(REPORT, "STARTED"));
+
+	assert_success(remove(REPORT));
+}
+
+TEST(bad_report_path_is_an_error)
+{
+	assert_failure(startup_time_open(SANDBOX_PATH "/no/such/dir/report"));
+	startup_time_close();
+}
+
+static int
+count_lines_with(const char path[], const char substr[])
+{
+	FILE *const fp = fopen(path, "r");
+	assert_non_null(fp);
+
+	int count = 0;
+	char *line = NULL;
+	while((line = read_line(fp, line)) != NULL)
+	{
+		count += (strstr(line, substr) != NULL);
+	}
+	fclose(fp);
+
+	return count;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -684,5 +684,21 @@ TEST(special_marks_are_not_shared_among_tabs)
 	assert_string_equal("l1file<", mark->file);
 }
 
+TEST(tab_id_is_kept_on_move_and_forgotten_on_close)
+{
+	const unsigned int id = tabs_current_id(&lwin);
+	assert_true(tabs_has_id(&lwin, id));
+	assert_false(tabs_has_id(&rwin, id));
+
+	tabs_new(NULL, NULL);
+	assert_true(tabs_current_id(&lwin) != id);
+	tabs_move(&lwin, 0);
+	tabs_goto(1);
+	assert_true(tabs_current_id(&lwin) == id);
+
+	tabs_close();
+	assert_false(tabs_has_id(&lwin, id));
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
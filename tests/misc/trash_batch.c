@@ -0,0 +1,209 @@
+#include <stic.h>
+
+#include <stdio.h> /* remove() snprintf() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/pthread.h"
+#include "../../src/utils/str.h"
+#include "../../src/trash.h"
+
+static void * move_to_trash(void *arg);
+static void make_trash_name(char buf[], size_t buf_len, const char name[]);
+static int is_sorted(void);
+
+static char trash_dir[PATH_MAX + 1];
+static char index_path[PATH_MAX + 1];
+
+SETUP()
+{
+	create_dir(SANDBOX_PATH "/trash");
+	make_abs_path(trash_dir, sizeof(trash_dir), SANDBOX_PATH, "trash", NULL);
+	make_abs_path(index_path, sizeof(index_path), SANDBOX_PATH, "index", NULL);
+	assert_success(trash_set_specs(trash_dir));
+}
+
+TEARDOWN()
+{
+	trash_empty_all();
+	wait_for_bg();
+	assert_int_equal(0, trash_list_size);
+
+	remove_dir(SANDBOX_PATH "/trash");
+}
+
+TEST(batch_is_merged_into_sorted_list)
+{
+	char a[PATH_MAX + 1], b[PATH_MAX + 1], c[PATH_MAX + 1];
+	make_trash_name(a, sizeof(a), "0_a");
+	make_trash_name(b, sizeof(b), "1_b");
+	make_trash_name(c, sizeof(c), "2_c");
+
+	assert_success(trash_add_entry("/b", b));
+
+	char *originals[] = { "/c", "/a", "/b", "/c" };
+	char *trash_names[] = { c, a, b, c };
+	assert_success(trash_add_entries(originals, trash_names, 4));
+
+	assert_int_equal(3, trash_list_size);
+	assert_true(is_sorted());
+	assert_true(trash_has_entry("/a", a));
+	assert_true(trash_has_entry("/b", b));
+	assert_true(trash_has_entry("/c", c));
+}
+
+TEST(batch_of_entries_is_removed)
+{
+	char a[PATH_MAX + 1], b[PATH_MAX + 1], c[PATH_MAX + 1];
+	make_trash_name(a, sizeof(a), "0_a");
+	make_trash_name(b, sizeof(b), "1_b");
+	make_trash_name(c, sizeof(c), "2_c");
+
+	char *originals[] = { "/a", "/b", "/c", "/d" };
+	char *trash_names[] = { a, b, c, a };
+	assert_success(trash_add_entries(originals, trash_names, 4));
+	assert_int_equal(4, trash_list_size);
+
+	char *removed[] = { c, a };
+	trash_remove_entries(removed, 2);
+
+	assert_int_equal(1, trash_list_size);
+	assert_true(trash_has_entry("/b", b));
+}
+
+TEST(moves_are_applied_at_the_end_of_batch)
+{
+	char a[PATH_MAX + 1], b[PATH_MAX + 1];
+	make_trash_name(a, sizeof(a), "0_a");
+	make_trash_name(b, sizeof(b), "1_b");
+
+	trash_batch_start();
+	trash_file_moved("/a", a);
+	trash_file_moved("/b", b);
+	assert_int_equal(0, trash_list_size);
+	trash_batch_start();
+	trash_file_moved(a, "/a");
+	trash_batch_finish();
+	assert_int_equal(0, trash_list_size);
+	trash_batch_finish();
+
+	assert_int_equal(1, trash_list_size);
+	assert_false(trash_has_entry("/a", a));
+	assert_true(trash_has_entry("/b", b));
+}
+
+TEST(queries_apply_pending_moves)
+{
+	char a[PATH_MAX + 1];
+	make_trash_name(a, sizeof(a), "0_a");
+
+	trash_batch_start();
+	trash_file_moved("/a", a);
+	assert_true(trash_has_entry("/a", a));
+	trash_batch_finish();
+
+	assert_int_equal(1, trash_list_size);
+}
+
+TEST(moves_from_other_threads_join_active_batch)
+{
+	char a[PATH_MAX + 1];
+	make_trash_name(a, sizeof(a), "0_a");
+
+	trash_batch_start();
+
+	pthread_t thread;
+	assert_success(pthread_create(&thread, NULL, &move_to_trash, a));
+	assert_success(pthread_join(thread, NULL));
+
+	trash_batch_finish();
+
+	assert_int_equal(1, trash_list_size);
+	assert_true(trash_has_entry("/a", a));
+}
+
+TEST(index_is_written_and_read_back)
+{
+	char a[PATH_MAX + 1], b[PATH_MAX + 1];
+	make_trash_name(a, sizeof(a), "0_a");
+	make_trash_name(b, sizeof(b), "1_b");
+
+	char *originals[] = { "/b", "/a" };
+	char *trash_names[] = { b, a };
+	assert_success(trash_add_entries(originals, trash_names, 2));
+	assert_success(trash_index_write(index_path));
+
+	trash_remove_entries(trash_names, 2);
+	assert_int_equal(0, trash_list_size);
+
+	const int generation = trash_get_generation();
+	assert_success(trash_index_read(index_path));
+	assert_false(trash_get_generation() == generation);
+
+	assert_int_equal(2, trash_list_size);
+	assert_true(is_sorted());
+	assert_true(trash_has_entry("/a", a));
+	assert_true(trash_has_entry("/b", b));
+
+	assert_success(remove(index_path));
+}
+
+TEST(bad_index_is_rejected)
+{
+	assert_failure(trash_index_read(index_path));
+
+	create_file(index_path);
+	assert_failure(trash_index_read(index_path));
+	assert_success(remove(index_path));
+}
+
+TEST(dead_entries_are_pruned)
+{
+	char a[PATH_MAX + 1], b[PATH_MAX + 1];
+	make_trash_name(a, sizeof(a), "0_a");
+	make_trash_name(b, sizeof(b), "1_b");
+	create_file(a);
+
+	char *originals[] = { "/a", "/b" };
+	char *trash_names[] = { a, b };
+	assert_success(trash_add_entries(originals, trash_names, 2));
+
+	trash_prune_dead_entries();
+	assert_int_equal(1, trash_list_size);
+	assert_true(trash_has_entry("/a", a));
+}
+
+/* Reports moving of "/a" to trash as a background operation would.  Returns
+ * NULL. */
+static void *
+move_to_trash(void *arg)
+{
+	trash_file_moved("/a", arg);
+	return NULL;
+}
+
+static void
+make_trash_name(char buf[], size_t buf_len, const char name[])
+{
+	snprintf(buf, buf_len, "%s/%s", trash_dir, name);
+}
+
+/* Checks whether trash_list is sorted by original paths.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+is_sorted(void)
+{
+	int i;
+	for(i = 1; i < trash_list_size; ++i)
+	{
+		if(stroscmp(trash_list[i - 1].path, trash_list[i].path) > 0)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
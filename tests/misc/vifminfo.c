@@ -3,7 +3,7 @@
 #include <sys/stat.h> /* stat */
 #include <unistd.h> /* stat() */
 
-#include <stdio.h> /* fclose() fopen() fprintf() remove() */
+#include <stdio.h> /* FILE fclose() fopen() fprintf() remove() */
 #include <stdlib.h> /* free() */
 #include <string.h> /* memset() */
 
@@ -14,6 +14,7 @@
 #include "../../src/cfg/info_chars.h"
 #include "../../src/ui/column_view.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
 #include "../../src/utils/matcher.h"
 #include "../../src/utils/matchers.h"
 #include "../../src/utils/parson.h"
@@ -22,7 +23,9 @@
 #include "../../src/filetype.h"
 #include "../../src/flist_hist.h"
 #include "../../src/opt_handlers.h"
+#include "../../src/registers.h"
 #include "../../src/status.h"
+#include "../../src/trash.h"
 
 SETUP_ONCE()
 {
@@ -53,6 +56,9 @@ TEARDOWN()
 	view_teardown(&rwin);
 
 	cfg.vifm_info = 0;
+
+	/* Storing state twice can produce a journal. */
+	(void)remove(SANDBOX_PATH "/vifminfo.journal");
 }
 
 TEST(view_sorting_is_read_from_vifminfo)
@@ -492,5 +498,248 @@ TEST(active_pane_is_respected_both_ways)
 	remove_file(SANDBOX_PATH "/vifminfo.json");
 }
 
+TEST(changes_are_appended_to_journal)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	hist_add(&curr_stats.cmd_hist, "command0", 0);
+	write_info_file();
+
+	hist_add(&curr_stats.cmd_hist, "command1", 1);
+	write_info_file();
+
+	/* vifminfo.json wasn't rewritten. */
+	JSON_Value *value = json_parse_file(SANDBOX_PATH "/vifminfo.json");
+	assert_non_null(value);
+	JSON_Array *hist = json_object_get_array(json_object(value), "cmd-hist");
+	assert_int_equal(1, json_array_get_count(hist));
+	json_value_free(value);
+
+	cfg_resize_histories(0);
+	cfg_resize_histories(10);
+
+	state_load(0);
+
+	assert_int_equal(2, curr_stats.cmd_hist.size);
+	assert_string_equal("command1", curr_stats.cmd_hist.items[0].text);
+	assert_string_equal("command0", curr_stats.cmd_hist.items[1].text);
+
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+	remove_file(SANDBOX_PATH "/vifminfo.journal");
+}
+
+TEST(concurrent_journal_records_are_merged)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	make_file(SANDBOX_PATH "/vifminfo.json",
+			"{\"cmd-hist\":[{\"text\":\"base\",\"ts\":0}]}");
+	make_file(SANDBOX_PATH "/vifminfo.journal",
+			"{\"seen\":0,\"delta\":{\"cmd-hist\":[{\"text\":\"base\",\"ts\":0},"
+			"{\"text\":\"a\",\"ts\":1}]}}\n"
+			"invalid\n"
+			"{\"seen\":0,\"delta\":{\"cmd-hist\":[{\"text\":\"base\",\"ts\":0},"
+			"{\"text\":\"b\",\"ts\":2}]}}\n");
+
+	state_load(0);
+
+	assert_int_equal(3, curr_stats.cmd_hist.size);
+	assert_string_equal("b", curr_stats.cmd_hist.items[0].text);
+	assert_string_equal("a", curr_stats.cmd_hist.items[1].text);
+	assert_string_equal("base", curr_stats.cmd_hist.items[2].text);
+
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+	remove_file(SANDBOX_PATH "/vifminfo.journal");
+}
+
+TEST(large_journal_is_merged_into_vifminfo)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	hist_add(&curr_stats.cmd_hist, "command0", 0);
+	write_info_file();
+
+	hist_add(&curr_stats.cmd_hist, "command1", 1);
+	write_info_file();
+
+	/* Grow the journal beyond the limit with lines that are ignored. */
+	FILE *const f = fopen(SANDBOX_PATH "/vifminfo.journal", "a");
+	assert_non_null(f);
+	int i;
+	for(i = 0; i < 512*1024/64; ++i)
+	{
+		fprintf(f, "%063d\n", i);
+	}
+	fclose(f);
+
+	hist_add(&curr_stats.cmd_hist, "command2", 2);
+	write_info_file();
+
+	assert_false(path_exists(SANDBOX_PATH "/vifminfo.journal", NODEREF));
+
+	JSON_Value *value = json_parse_file(SANDBOX_PATH "/vifminfo.json");
+	assert_non_null(value);
+	JSON_Array *hist = json_object_get_array(json_object(value), "cmd-hist");
+	assert_int_equal(3, json_array_get_count(hist));
+	json_value_free(value);
+
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+}
+
+TEST(journal_is_put_back_if_vifminfo_can_not_be_updated)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	/* Directory can't be replaced with an updated file. */
+	create_dir(SANDBOX_PATH "/vifminfo.json");
+	make_file(SANDBOX_PATH "/vifminfo.journal",
+			"{\"seen\":0,\"delta\":{\"cmd-hist\":[{\"text\":\"a\",\"ts\":1}]}}\n");
+
+	write_info_file();
+
+	const char *lines[] = {
+		"{\"seen\":-1,\"delta\":{\"cmd-hist\":[{\"text\":\"a\",\"ts\":1}]}}"
+	};
+	file_is(SANDBOX_PATH "/vifminfo.journal", lines, ARRAY_LEN(lines));
+
+	remove_dir(SANDBOX_PATH "/vifminfo.json");
+	remove_file(SANDBOX_PATH "/vifminfo.journal");
+}
+
+TEST(lazy_loading_postpones_histories_and_registers)
+{
+	regs_init();
+
+	make_file(SANDBOX_PATH "/vifminfo.json",
+			"{ \"color-scheme\": \"lazy\","
+			"  \"cmd-hist\": [{\"text\":\"cmd\",\"ts\":1}],"
+			"  \"regs\": {\"a\": [\"/file\"]} }");
+
+	state_load_lazily();
+	assert_string_equal("lazy", curr_stats.color_scheme);
+	assert_int_equal(0, curr_stats.cmd_hist.size);
+	assert_int_equal(0, regs_find('a')->nfiles);
+
+	state_load_rest();
+	assert_int_equal(1, curr_stats.cmd_hist.size);
+	assert_string_equal("cmd", curr_stats.cmd_hist.items[0].text);
+	assert_int_equal(1, regs_find('a')->nfiles);
+	assert_string_equal("/file", regs_find('a')->files[0]);
+
+	/* Second call does nothing. */
+	state_load_rest();
+	assert_int_equal(1, regs_find('a')->nfiles);
+
+	regs_reset();
+	curr_stats.color_scheme[0] = '\0';
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+}
+
+TEST(lazy_loading_applies_journal)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	make_file(SANDBOX_PATH "/vifminfo.json",
+			"{\"cmd-hist\":[{\"text\":\"base\",\"ts\":0}]}");
+	make_file(SANDBOX_PATH "/vifminfo.journal",
+			"{\"seen\":0,\"delta\":{\"cmd-hist\":[{\"text\":\"a\",\"ts\":1}]}}\n");
+
+	state_load_lazily();
+	assert_int_equal(0, curr_stats.cmd_hist.size);
+	state_load_rest();
+
+	assert_int_equal(1, curr_stats.cmd_hist.size);
+	assert_string_equal("a", curr_stats.cmd_hist.items[0].text);
+
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+	remove_file(SANDBOX_PATH "/vifminfo.journal");
+}
+
+TEST(lazy_loading_merges_concurrent_journal_records)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	make_file(SANDBOX_PATH "/vifminfo.json",
+			"{\"cmd-hist\":[{\"text\":\"base\",\"ts\":0}]}");
+	make_file(SANDBOX_PATH "/vifminfo.journal",
+			"{\"seen\":0,\"delta\":{\"cmd-hist\":[{\"text\":\"base\",\"ts\":0},"
+			"{\"text\":\"a\",\"ts\":1}]}}\n"
+			"{\"seen\":0,\"delta\":{\"cmd-hist\":[{\"text\":\"base\",\"ts\":0},"
+			"{\"text\":\"b\",\"ts\":2}]}}\n");
+
+	state_load_lazily();
+	state_load_rest();
+
+	assert_int_equal(3, curr_stats.cmd_hist.size);
+	assert_string_equal("b", curr_stats.cmd_hist.items[0].text);
+	assert_string_equal("a", curr_stats.cmd_hist.items[1].text);
+	assert_string_equal("base", curr_stats.cmd_hist.items[2].text);
+
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+	remove_file(SANDBOX_PATH "/vifminfo.journal");
+}
+
+TEST(lazily_loaded_history_respects_new_history_size)
+{
+	make_file(SANDBOX_PATH "/vifminfo.json",
+			"{\"cmd-hist\":[{\"text\":\"1\",\"ts\":1},{\"text\":\"2\",\"ts\":2},"
+			"{\"text\":\"3\",\"ts\":3}]}");
+
+	state_load_lazily();
+	cfg_resize_histories(2);
+	state_load_rest();
+
+	assert_int_equal(2, cfg.history_len);
+	assert_int_equal(2, curr_stats.cmd_hist.size);
+	assert_string_equal("3", curr_stats.cmd_hist.items[0].text);
+	assert_string_equal("2", curr_stats.cmd_hist.items[1].text);
+
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+}
+
+TEST(storing_state_finishes_lazy_loading)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	make_file(SANDBOX_PATH "/vifminfo.json",
+			"{\"cmd-hist\":[{\"text\":\"cmd\",\"ts\":1}]}");
+
+	state_load_lazily();
+	write_info_file();
+
+	assert_int_equal(1, curr_stats.cmd_hist.size);
+
+	JSON_Value *value = json_parse_file(SANDBOX_PATH "/vifminfo.json");
+	assert_non_null(value);
+	JSON_Array *hist = json_object_get_array(json_object(value), "cmd-hist");
+	assert_int_equal(1, json_array_get_count(hist));
+	json_value_free(value);
+
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+}
+
+TEST(trash_is_moved_from_vifminfo_to_index)
+{
+	make_file(SANDBOX_PATH "/vifminfo.json",
+			"{\"trash\":[{\"trashed\":\"/trash/0_file\",\"original\":\"/file\"}]}");
+
+	state_load(0);
+	assert_int_equal(1, trash_list_size);
+	assert_true(trash_has_entry("/file", "/trash/0_file"));
+
+	state_store();
+	assert_true(path_exists(SANDBOX_PATH "/trash-index", NODEREF));
+
+	char *trash_names[] = { "/trash/0_file" };
+	trash_remove_entries(trash_names, 1);
+
+	/* Neither unchanged index nor trash of vifminfo is loaded again. */
+	state_load(0);
+	assert_int_equal(0, trash_list_size);
+
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+	remove_file(SANDBOX_PATH "/trash-index");
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
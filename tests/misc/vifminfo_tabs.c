@@ -57,6 +57,8 @@ TEARDOWN()
 	tabs_only(&lwin);
 
 	assert_success(remove(SANDBOX_PATH "/vifminfo.json"));
+	/* Storing state twice can produce a journal. */
+	(void)remove(SANDBOX_PATH "/vifminfo.journal");
 
 	cfg.vifm_info = 0;
 }
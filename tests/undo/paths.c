@@ -0,0 +1,149 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strcpy() */
+
+#include "../../src/ops.h"
+#include "../../src/undo.h"
+#include "../../src/utils/string_array.h"
+
+#include "test.h"
+
+/* Number of operations in a large group. */
+#define BULK_SIZE 10000
+
+static int capture(OPS op, void *data, const char *src, const char *dst);
+
+static int undo_levels;
+static char last_src[128];
+static char last_dst[128];
+static int nexecs;
+
+SETUP()
+{
+	undo_levels = 2*BULK_SIZE;
+	init_undo_list_for_tests(&capture, &undo_levels);
+	un_reset();
+	nexecs = 0;
+}
+
+TEST(paths_are_passed_back_unchanged)
+{
+	un_group_open("msg");
+	assert_success(un_group_add_op(OP_MOVE, NULL, NULL, "/root", "rel"));
+	assert_success(un_group_add_op(OP_MOVE, NULL, NULL, "dir/", "/x/"));
+	assert_success(un_group_add_op(OP_MOVE, NULL, NULL, "//a//b", "a/b/c/d"));
+	un_group_close();
+
+	assert_int_equal(UN_ERR_SUCCESS, un_group_undo());
+	assert_int_equal(3, nexecs);
+	assert_string_equal("rel", last_src);
+	assert_string_equal("/root", last_dst);
+
+	assert_int_equal(UN_ERR_SUCCESS, un_group_redo());
+	assert_int_equal(6, nexecs);
+	assert_string_equal("//a//b", last_src);
+	assert_string_equal("a/b/c/d", last_dst);
+}
+
+TEST(operations_of_large_group_are_undone)
+{
+	char src[64], dst[64];
+	int i;
+
+	un_group_open("bulk");
+	for(i = 0; i < BULK_SIZE; ++i)
+	{
+		snprintf(src, sizeof(src), "/from/dir%d/file%d", i/1000, i);
+		snprintf(dst, sizeof(dst), "/to/file%d", i);
+		assert_success(un_group_add_op(OP_MOVE, NULL, NULL, src, dst));
+	}
+	un_group_close();
+
+	assert_int_equal(UN_ERR_SUCCESS, un_group_undo());
+	assert_int_equal(BULK_SIZE, nexecs);
+	assert_string_equal("/to/file0", last_src);
+	assert_string_equal("/from/dir0/file0", last_dst);
+
+	assert_int_equal(UN_ERR_SUCCESS, un_group_redo());
+	assert_int_equal(2*BULK_SIZE, nexecs);
+	snprintf(src, sizeof(src), "/from/dir%d/file%d", (BULK_SIZE - 1)/1000,
+			BULK_SIZE - 1);
+	assert_string_equal(src, last_src);
+}
+
+TEST(paths_of_large_group_are_read_back_from_spill_file)
+{
+	char src[64], dst[64];
+	int i;
+
+	const size_t limit = un_set_spill_limit(1024);
+
+	un_group_open("bulk");
+	for(i = 0; i < BULK_SIZE; ++i)
+	{
+		snprintf(src, sizeof(src), "/from/dir%d/file%d", i/1000, i);
+		snprintf(dst, sizeof(dst), "/to/file%d", i);
+		assert_success(un_group_add_op(OP_MOVE, NULL, NULL, src, dst));
+	}
+	assert_success(un_group_add_op(OP_MOVE, NULL, NULL, "", "last"));
+	un_group_close();
+
+	(void)un_set_spill_limit(limit);
+
+	char **const list = un_get_list(1);
+	assert_string_equal("  do: mv  to last", list[1]);
+	assert_string_equal("  undo: mv /to/file9999 to /from/dir9/file9999",
+			list[4]);
+	free_string_array(list, count_strings(list));
+
+	assert_int_equal(UN_ERR_SUCCESS, un_group_undo());
+	assert_int_equal(BULK_SIZE + 1, nexecs);
+	assert_string_equal("/to/file0", last_src);
+	assert_string_equal("/from/dir0/file0", last_dst);
+
+	assert_int_equal(UN_ERR_SUCCESS, un_group_redo());
+	assert_int_equal(2*(BULK_SIZE + 1), nexecs);
+	assert_string_equal("", last_src);
+	assert_string_equal("last", last_dst);
+}
+
+TEST(old_groups_are_dropped_as_a_whole)
+{
+	undo_levels = 3;
+
+	un_group_open("first");
+	assert_success(un_group_add_op(OP_MOVE, NULL, NULL, "/a/1", "/b/1"));
+	assert_success(un_group_add_op(OP_MOVE, NULL, NULL, "/a/2", "/b/2"));
+	un_group_close();
+
+	un_group_open("second");
+	assert_success(un_group_add_op(OP_MOVE, NULL, NULL, "/a/3", "/b/3"));
+	assert_success(un_group_add_op(OP_MOVE, NULL, NULL, "/a/4", "/b/4"));
+	un_group_close();
+
+	char **const list = un_get_list(1);
+	assert_int_equal(5, count_strings(list));
+	assert_string_equal(" second", list[0]);
+	assert_string_equal("  do: mv /a/4 to /b/4", list[1]);
+	assert_string_equal("  undo: mv /b/4 to /a/4", list[2]);
+	assert_string_equal("  do: mv /a/3 to /b/3", list[3]);
+	free_string_array(list, count_strings(list));
+
+	assert_int_equal(UN_ERR_SUCCESS, un_group_undo());
+	assert_int_equal(UN_ERR_NONE, un_group_undo());
+	assert_int_equal(2, nexecs);
+}
+
+static int
+capture(OPS op, void *data, const char *src, const char *dst)
+{
+	strcpy(last_src, src);
+	strcpy(last_dst, dst);
+	++nexecs;
+	return 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
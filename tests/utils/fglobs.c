@@ -0,0 +1,147 @@
+#include <stic.h>
+
+#include <stddef.h> /* size_t */
+#include <stdlib.h> /* free() */
+
+#include "../../src/utils/matcher.h"
+
+/* List of globs long enough to be indexed. */
+#define LONG_LIST "{*.c,*.h,*.cpp,*.hpp,*.cc,*.hh,*.cxx,*.hxx,*.py,*.rb," \
+                  "*.tar.gz,*.tar.bz2,*~,Makefile,CMakeLists.txt}"
+
+static matcher_t * alloc_matcher(const char expr[]);
+static int can_count_allocs(void);
+
+#ifdef __GLIBC__
+
+/* Number of calls to malloc() so far. */
+static size_t nallocs;
+
+void * __libc_malloc(size_t size);
+
+/* Counts allocations by calling allocator of libc directly. */
+void *
+malloc(size_t size)
+{
+	++nallocs;
+	return __libc_malloc(size);
+}
+
+#endif
+
+TEST(short_list_is_matched)
+{
+	matcher_t *const m = alloc_matcher("{*.c,Makefile,*~}");
+
+	assert_true(matcher_matches(m, "main.c"));
+	assert_true(matcher_matches(m, "dir/MAIN.C"));
+	assert_true(matcher_matches(m, "makefile"));
+	assert_true(matcher_matches(m, "file~"));
+	assert_false(matcher_matches(m, ".c"));
+	assert_false(matcher_matches(m, ".main.c"));
+	assert_false(matcher_matches(m, "Makefile.am"));
+	assert_false(matcher_matches(m, "~"));
+	assert_false(matcher_matches(m, ""));
+
+	matcher_free(m);
+}
+
+TEST(long_list_is_matched)
+{
+	matcher_t *const m = alloc_matcher(LONG_LIST);
+
+	assert_true(matcher_matches(m, "main.c"));
+	assert_true(matcher_matches(m, "dir/MAIN.CPP"));
+	assert_true(matcher_matches(m, "archive.Tar.Gz"));
+	assert_true(matcher_matches(m, "makefile"));
+	assert_true(matcher_matches(m, "CMakeLists.txt"));
+	assert_true(matcher_matches(m, "file~"));
+	assert_false(matcher_matches(m, ".c"));
+	assert_false(matcher_matches(m, ".main.c"));
+	assert_false(matcher_matches(m, "archive.gz"));
+	assert_false(matcher_matches(m, "Makefile.am"));
+	assert_false(matcher_matches(m, "~"));
+	assert_false(matcher_matches(m, "x.txt"));
+	assert_false(matcher_matches(m, ""));
+
+	matcher_free(m);
+}
+
+TEST(negated_long_list_is_matched)
+{
+	matcher_t *const m = alloc_matcher("!" LONG_LIST);
+
+	assert_false(matcher_matches(m, "main.c"));
+	assert_true(matcher_matches(m, "main.o"));
+
+	matcher_free(m);
+}
+
+TEST(cloned_long_list_is_matched)
+{
+	matcher_t *const m = alloc_matcher(LONG_LIST);
+	matcher_t *const clone = matcher_clone(m);
+	matcher_free(m);
+
+	assert_true(matcher_matches(clone, "main.hxx"));
+	assert_false(matcher_matches(clone, "main.o"));
+
+	matcher_free(clone);
+}
+
+TEST(inclusion_of_lists)
+{
+	matcher_t *const m = alloc_matcher(LONG_LIST);
+	matcher_t *const like = alloc_matcher("{*.C,makefile}");
+	matcher_t *const unlike = alloc_matcher("{*.c,c}");
+
+	assert_true(matcher_includes(m, like));
+	assert_false(matcher_includes(m, unlike));
+	assert_false(matcher_includes(like, m));
+
+	matcher_free(m);
+	matcher_free(like);
+	matcher_free(unlike);
+}
+
+TEST(matching_does_not_allocate, IF(can_count_allocs))
+{
+#ifdef __GLIBC__
+	matcher_t *const short_m = alloc_matcher("{*.c,Makefile,*~}");
+	matcher_t *const long_m = alloc_matcher(LONG_LIST);
+
+	nallocs = 0U;
+	(void)matcher_matches(short_m, "main.c");
+	(void)matcher_matches(short_m, "main.o");
+	(void)matcher_matches(long_m, "main.c");
+	(void)matcher_matches(long_m, "main.o");
+	assert_int_equal(0, nallocs);
+
+	matcher_free(short_m);
+	matcher_free(long_m);
+#endif
+}
+
+static matcher_t *
+alloc_matcher(const char expr[])
+{
+	char *error;
+	matcher_t *const m = matcher_alloc(expr, 0, 1, "", &error);
+	assert_non_null(m);
+	assert_null(error);
+	free(error);
+	return m;
+}
+
+static int
+can_count_allocs(void)
+{
+#ifdef __GLIBC__
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
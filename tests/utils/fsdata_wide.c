@@ -0,0 +1,112 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* memset() strcmp() strcpy() */
+
+#include "../../src/utils/fsdata.h"
+
+/* Number of siblings, enough for children to be indexed. */
+#define WIDE 100
+
+static int traverser(const char name[], int valid, const void *parent_data,
+		void *data, void *arg);
+
+static fsdata_t *fsd;
+static char last_name[64];
+static int nnodes;
+static int unordered;
+
+SETUP()
+{
+	fsd = fsdata_create(0, 0);
+	assert_non_null(fsd);
+}
+
+TEARDOWN()
+{
+	fsdata_free(fsd);
+}
+
+TEST(many_siblings_are_found)
+{
+	char path[64];
+	int i, data;
+
+	/* Insert in an order that differs from sorted one. */
+	for(i = WIDE - 1; i >= 0; --i)
+	{
+		snprintf(path, sizeof(path), "/dir/%d", i*7%WIDE);
+		data = i*7%WIDE;
+		assert_success(fsdata_set(fsd, path, &data, sizeof(data)));
+	}
+
+	for(i = 0; i < WIDE; ++i)
+	{
+		snprintf(path, sizeof(path), "/dir/%d", i);
+		assert_success(fsdata_get(fsd, path, &data, sizeof(data)));
+		assert_int_equal(i, data);
+	}
+
+	assert_failure(fsdata_get(fsd, "/dir/100", &data, sizeof(data)));
+	assert_failure(fsdata_get(fsd, "/dir/1/2", &data, sizeof(data)));
+}
+
+TEST(siblings_are_traversed_in_order)
+{
+	char path[64];
+	int i, data = 0;
+
+	for(i = WIDE - 1; i >= 0; --i)
+	{
+		snprintf(path, sizeof(path), "/dir/%03d", i);
+		assert_success(fsdata_set(fsd, path, &data, sizeof(data)));
+	}
+
+	last_name[0] = '\0';
+	nnodes = 0;
+	unordered = 0;
+	assert_success(fsdata_traverse(fsd, &traverser, NULL));
+	assert_int_equal(WIDE + 1, nnodes);
+	assert_false(unordered);
+}
+
+TEST(data_size_of_indexed_child_can_change)
+{
+	char path[64];
+	char small_data[1] = { 'a' };
+	/* Big buffer to make reallocation move the node. */
+	char big_data[1024];
+	int i;
+
+	for(i = 0; i < WIDE; ++i)
+	{
+		snprintf(path, sizeof(path), "/%d", i);
+		assert_success(fsdata_set(fsd, path, small_data, sizeof(small_data)));
+	}
+
+	memset(big_data, 'b', sizeof(big_data));
+	assert_success(fsdata_set(fsd, "/50", big_data, sizeof(big_data)));
+	assert_success(fsdata_set(fsd, "/50/x", big_data, sizeof(big_data)));
+
+	big_data[0] = '\0';
+	assert_success(fsdata_get(fsd, "/50", big_data, sizeof(big_data)));
+	assert_int_equal('b', big_data[0]);
+	assert_success(fsdata_get(fsd, "/51", small_data, sizeof(small_data)));
+	assert_int_equal('a', small_data[0]);
+}
+
+static int
+traverser(const char name[], int valid, const void *parent_data, void *data,
+		void *arg)
+{
+	if(parent_data != NULL)
+	{
+		unordered |= (strcmp(last_name, name) >= 0);
+		strcpy(last_name, name);
+	}
+	++nnodes;
+	return 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,196 @@
+#include <stic.h>
+
+#include <stdio.h> /* remove() */
+
+#include <test-utils.h>
+
+#include "../../src/utils/hcache.h"
+
+#define CACHE_FILE SANDBOX_PATH "/hashes"
+
+static hcache_rec_t make_rec(uint64_t inode, int flags, uint64_t hash);
+
+TEARDOWN()
+{
+	(void)remove(CACHE_FILE);
+}
+
+TEST(freeing_null_cache_is_ok)
+{
+	hcache_free(NULL);
+}
+
+TEST(missing_file_results_in_empty_cache)
+{
+	hcache_t *const cache = hcache_load(CACHE_FILE, 0);
+	assert_non_null(cache);
+	assert_int_equal(0, hcache_size(cache));
+	hcache_free(cache);
+}
+
+TEST(unchanged_cache_is_not_written)
+{
+	hcache_t *const cache = hcache_load(CACHE_FILE, 0);
+	assert_success(hcache_save(cache));
+	hcache_free(cache);
+
+	no_remove_file(CACHE_FILE);
+}
+
+TEST(records_are_found_after_update)
+{
+	hcache_t *const cache = hcache_load(CACHE_FILE, 0);
+
+	hcache_rec_t recs[] = {
+		make_rec(3, HCF_PREFIX, 30),
+		make_rec(1, HCF_FULL, 10),
+		make_rec(2, HCF_PREFIX, 20),
+	};
+	hcache_update(cache, recs, 3);
+	assert_int_equal(3, hcache_size(cache));
+
+	hcache_rec_t rec = make_rec(1, 0, 0);
+	assert_success(hcache_get(cache, &rec));
+	assert_int_equal(HCF_FULL, rec.flags);
+	assert_int_equal(10, rec.full);
+
+	rec = make_rec(3, 0, 0);
+	assert_success(hcache_get(cache, &rec));
+	assert_int_equal(HCF_PREFIX, rec.flags);
+	assert_int_equal(30, rec.prefix);
+
+	rec = make_rec(4, 0, 0);
+	assert_failure(hcache_get(cache, &rec));
+
+	hcache_free(cache);
+}
+
+TEST(data_of_records_is_merged)
+{
+	hcache_t *const cache = hcache_load(CACHE_FILE, 0);
+
+	hcache_rec_t rec = make_rec(1, HCF_PREFIX, 10);
+	hcache_update(cache, &rec, 1);
+	rec = make_rec(1, HCF_FULL, 20);
+	hcache_update(cache, &rec, 1);
+	rec = make_rec(1, 0, 0);
+	hcache_update(cache, &rec, 1);
+	assert_int_equal(1, hcache_size(cache));
+
+	rec = make_rec(1, 0, 0);
+	assert_success(hcache_get(cache, &rec));
+	assert_int_equal(HCF_PREFIX | HCF_FULL, rec.flags);
+	assert_int_equal(10, rec.prefix);
+	assert_int_equal(20, rec.full);
+
+	hcache_free(cache);
+}
+
+TEST(records_are_saved_and_loaded)
+{
+	hcache_t *cache = hcache_load(CACHE_FILE, 1);
+	hcache_rec_t rec = make_rec(1, HCF_PREFIX, 10);
+	hcache_update(cache, &rec, 1);
+	assert_success(hcache_save(cache));
+	hcache_free(cache);
+
+	cache = hcache_load(CACHE_FILE, 1);
+	assert_int_equal(1, hcache_size(cache));
+	rec = make_rec(1, 0, 0);
+	assert_success(hcache_get(cache, &rec));
+	assert_int_equal(10, rec.prefix);
+	hcache_free(cache);
+}
+
+TEST(using_records_again_does_not_make_cache_changed)
+{
+	hcache_t *cache = hcache_load(CACHE_FILE, 1);
+	hcache_rec_t rec = make_rec(1, HCF_PREFIX, 10);
+	hcache_update(cache, &rec, 1);
+	assert_success(hcache_save(cache));
+	hcache_free(cache);
+
+	cache = hcache_load(CACHE_FILE, 1);
+	assert_success(remove(CACHE_FILE));
+	rec = make_rec(1, HCF_PREFIX, 10);
+	hcache_update(cache, &rec, 1);
+	assert_success(hcache_save(cache));
+	hcache_free(cache);
+
+	no_remove_file(CACHE_FILE);
+}
+
+TEST(file_with_different_tag_is_ignored)
+{
+	hcache_t *cache = hcache_load(CACHE_FILE, 1);
+	hcache_rec_t rec = make_rec(1, HCF_PREFIX, 10);
+	hcache_update(cache, &rec, 1);
+	assert_success(hcache_save(cache));
+	hcache_free(cache);
+
+	cache = hcache_load(CACHE_FILE, 2);
+	assert_int_equal(0, hcache_size(cache));
+	hcache_free(cache);
+}
+
+TEST(changes_of_other_instances_are_merged_on_save)
+{
+	hcache_t *const cache1 = hcache_load(CACHE_FILE, 0);
+	hcache_t *const cache2 = hcache_load(CACHE_FILE, 0);
+
+	hcache_rec_t rec = make_rec(1, HCF_PREFIX, 10);
+	hcache_update(cache1, &rec, 1);
+	rec = make_rec(2, HCF_PREFIX, 20);
+	hcache_update(cache2, &rec, 1);
+
+	assert_success(hcache_save(cache1));
+	assert_success(hcache_save(cache2));
+	assert_int_equal(2, hcache_size(cache2));
+
+	hcache_free(cache1);
+	hcache_free(cache2);
+}
+
+TEST(key_of_a_file_depends_on_its_size, IF(not_windows))
+{
+	hcache_rec_t rec1, rec2;
+
+	make_file(SANDBOX_PATH "/file", "a");
+	assert_success(hcache_rec_init(&rec1, SANDBOX_PATH "/file"));
+	make_file(SANDBOX_PATH "/file", "ab");
+	assert_success(hcache_rec_init(&rec2, SANDBOX_PATH "/file"));
+	remove_file(SANDBOX_PATH "/file");
+
+	assert_int_equal(1, rec1.size);
+	assert_int_equal(2, rec2.size);
+	assert_int_equal(0, rec1.flags);
+
+	hcache_t *const cache = hcache_load(CACHE_FILE, 0);
+	rec1.flags = HCF_PREFIX;
+	hcache_update(cache, &rec1, 1);
+	assert_failure(hcache_get(cache, &rec2));
+	hcache_free(cache);
+}
+
+TEST(key_can_not_be_made_for_missing_file)
+{
+	hcache_rec_t rec;
+	assert_failure(hcache_rec_init(&rec, SANDBOX_PATH "/no-such-file"));
+}
+
+static hcache_rec_t
+make_rec(uint64_t inode, int flags, uint64_t hash)
+{
+	hcache_rec_t rec = {
+		.dev = 1,
+		.inode = inode,
+		.size = 100,
+		.flags = flags,
+		.prefix = (flags & HCF_PREFIX) ? hash : 0,
+		.full = (flags & HCF_FULL) ? hash : 0,
+	};
+	return rec;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
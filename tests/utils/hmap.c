@@ -0,0 +1,228 @@
+#include <stic.h>
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* free() malloc() */
+
+#include "../../src/utils/hmap.h"
+
+static int check_suffix_key(hmap_key_t key, size_t len, void *arg);
+
+static int nkeys;
+static int stop_at;
+
+TEST(freeing_null_map_is_ok)
+{
+	hmap_free(NULL);
+}
+
+TEST(new_map_is_empty)
+{
+	hmap_t *const hmap = hmap_create(sizeof(int));
+	assert_non_null(hmap);
+
+	const hmap_key_t key = { 1, 2 };
+	assert_int_equal(0, hmap_size(hmap));
+	assert_null(hmap_get(hmap, key));
+
+	hmap_free(hmap);
+}
+
+TEST(put_creates_zeroed_record_once)
+{
+	int created;
+	hmap_t *const hmap = hmap_create(sizeof(int));
+	const hmap_key_t key = { 1, 2 };
+
+	int *const rec = hmap_put(hmap, key, &created);
+	assert_non_null(rec);
+	assert_true(created);
+	assert_int_equal(0, *rec);
+	*rec = 10;
+
+	assert_true(hmap_put(hmap, key, &created) == rec);
+	assert_false(created);
+	assert_int_equal(1, hmap_size(hmap));
+
+	hmap_free(hmap);
+}
+
+TEST(both_halves_of_key_matter)
+{
+	int created;
+	hmap_t *const hmap = hmap_create(sizeof(int));
+	const hmap_key_t a = { 1, 2 }, b = { 2, 1 }, c = { 1, 1 };
+
+	*(int *)hmap_put(hmap, a, &created) = 1;
+	*(int *)hmap_put(hmap, b, &created) = 2;
+	*(int *)hmap_put(hmap, c, &created) = 3;
+
+	assert_int_equal(3, hmap_size(hmap));
+	assert_int_equal(1, *(int *)hmap_get(hmap, a));
+	assert_int_equal(2, *(int *)hmap_get(hmap, b));
+	assert_int_equal(3, *(int *)hmap_get(hmap, c));
+
+	hmap_free(hmap);
+}
+
+TEST(records_do_not_move_on_growth)
+{
+	int created;
+	uint64_t i;
+	hmap_t *const hmap = hmap_create(sizeof(uint64_t));
+	uint64_t **const recs = malloc(sizeof(*recs)*10000);
+
+	for(i = 0; i < 10000; ++i)
+	{
+		const hmap_key_t key = { 0, i };
+		recs[i] = hmap_put(hmap, key, &created);
+		assert_true(created);
+		*recs[i] = i;
+	}
+
+	assert_int_equal(10000, hmap_size(hmap));
+	for(i = 0; i < 10000; ++i)
+	{
+		const hmap_key_t key = { 0, i };
+		assert_true(hmap_get(hmap, key) == recs[i]);
+		assert_true(*recs[i] == i);
+	}
+
+	const hmap_key_t missing = { 1, 0 };
+	assert_null(hmap_get(hmap, missing));
+
+	free(recs);
+	hmap_free(hmap);
+}
+
+TEST(large_records_are_supported)
+{
+	int created;
+	hmap_t *const hmap = hmap_create(100);
+	const hmap_key_t a = { 1, 2 }, b = { 3, 4 };
+
+	char *const rec_a = hmap_put(hmap, a, &created);
+	char *const rec_b = hmap_put(hmap, b, &created);
+	assert_true(rec_b - rec_a >= 100 || rec_a - rec_b >= 100);
+	assert_int_equal(0, rec_b[99]);
+
+	hmap_free(hmap);
+}
+
+TEST(cleared_map_reuses_memory_for_zeroed_records)
+{
+	int created;
+	uint64_t i;
+	hmap_t *const hmap = hmap_create(sizeof(uint64_t));
+
+	for(i = 0; i < 1000; ++i)
+	{
+		const hmap_key_t key = { 0, i };
+		*(uint64_t *)hmap_put(hmap, key, &created) = i + 1;
+	}
+
+	hmap_clear(hmap, 1000);
+	assert_int_equal(0, hmap_size(hmap));
+
+	const hmap_key_t old_key = { 0, 1 };
+	assert_null(hmap_get(hmap, old_key));
+
+	for(i = 0; i < 2000; ++i)
+	{
+		const hmap_key_t key = { 1, i };
+		uint64_t *const rec = hmap_put(hmap, key, &created);
+		assert_true(created);
+		assert_true(*rec == 0);
+		*rec = i;
+	}
+
+	assert_int_equal(2000, hmap_size(hmap));
+	for(i = 0; i < 2000; ++i)
+	{
+		const hmap_key_t key = { 1, i };
+		assert_true(*(uint64_t *)hmap_get(hmap, key) == i);
+	}
+
+	hmap_free(hmap);
+}
+
+TEST(map_cleared_for_fewer_records_keeps_working)
+{
+	int created;
+	uint64_t i;
+	hmap_t *const hmap = hmap_create(sizeof(uint64_t));
+
+	for(i = 0; i < 10000; ++i)
+	{
+		const hmap_key_t key = { 0, i };
+		*(uint64_t *)hmap_put(hmap, key, &created) = i + 1;
+	}
+
+	hmap_clear(hmap, 10);
+	assert_int_equal(0, hmap_size(hmap));
+
+	const hmap_key_t old_key = { 0, 1 };
+	assert_null(hmap_get(hmap, old_key));
+
+	for(i = 0; i < 100; ++i)
+	{
+		const hmap_key_t key = { 1, i };
+		uint64_t *const rec = hmap_put(hmap, key, &created);
+		assert_true(created);
+		assert_true(*rec == 0);
+		*rec = i;
+	}
+
+	assert_int_equal(100, hmap_size(hmap));
+	for(i = 0; i < 100; ++i)
+	{
+		const hmap_key_t key = { 1, i };
+		assert_true(*(uint64_t *)hmap_get(hmap, key) == i);
+	}
+
+	hmap_free(hmap);
+}
+
+TEST(string_keys_ignore_case_and_can_be_built_from_the_end)
+{
+	const hmap_key_t full = hmap_istr_key("File.TXT", 8);
+	const hmap_key_t other = hmap_istr_key("file.txt", 8);
+	assert_true(full.hi == other.hi && full.lo == other.lo);
+
+	hmap_key_t key = hmap_istr_key("", 0);
+	hmap_istr_key_prepend(&key, 't');
+	hmap_istr_key_prepend(&key, 'x');
+	hmap_istr_key_prepend(&key, 't');
+	hmap_istr_key_prepend(&key, '.');
+	const hmap_key_t suffix = hmap_istr_key(".txt", 4);
+	assert_true(key.hi == suffix.hi && key.lo == suffix.lo);
+
+	const hmap_key_t different = hmap_istr_key("file.tx", 7);
+	assert_false(full.hi == different.hi && full.lo == different.lo);
+}
+
+TEST(keys_of_all_suffixes_are_walked)
+{
+	nkeys = 0;
+	stop_at = -1;
+	assert_false(hmap_istr_suffix_keys("a.TXT", 5, &check_suffix_key, NULL));
+	assert_int_equal(6, nkeys);
+
+	nkeys = 0;
+	stop_at = 3;
+	assert_true(hmap_istr_suffix_keys("a.TXT", 5, &check_suffix_key, NULL));
+	assert_int_equal(3, nkeys);
+}
+
+/* Checks that key is of a suffix of "a.txt" of the specified length.  Stops the
+ * walk after stop_at keys. */
+static int
+check_suffix_key(hmap_key_t key, size_t len, void *arg)
+{
+	const hmap_key_t expected = hmap_istr_key("a.txt" + (5 - len), len);
+	assert_true(key.hi == expected.hi && key.lo == expected.lo);
+	return (++nkeys == stop_at);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
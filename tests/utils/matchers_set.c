@@ -0,0 +1,192 @@
+#include <stic.h>
+
+#include <stdlib.h> /* free() */
+
+#include "../../src/utils/matchers.h"
+#include "../../src/utils/matchers_set.h"
+#include "../../src/utils/utils.h"
+
+/* Maximum number of rules used by a test. */
+#define MAX_RULES 16
+
+static void add_rule(const char expr[]);
+static int find_linearly(const char path[], int from);
+
+static matchers_set_t *set;
+static matchers_t *rules[MAX_RULES];
+static int nrules;
+
+SETUP()
+{
+	set = matchers_set_alloc();
+	assert_non_null(set);
+	nrules = 0;
+}
+
+TEARDOWN()
+{
+	matchers_set_free(set);
+	while(nrules > 0)
+	{
+		matchers_free(rules[--nrules]);
+	}
+}
+
+TEST(freeing_null_set_is_ok)
+{
+	matchers_set_free(NULL);
+}
+
+TEST(empty_set_matches_nothing)
+{
+	assert_int_equal(-1, matchers_set_find(set, "file", 0));
+}
+
+TEST(literal_names_match_case_insensitively)
+{
+	add_rule("{Makefile,README}");
+	add_rule("{readme.md}");
+
+	assert_int_equal(0, matchers_set_find(set, "makefile", 0));
+	assert_int_equal(0, matchers_set_find(set, "dir/README", 0));
+	assert_int_equal(1, matchers_set_find(set, "README.md", 0));
+	assert_int_equal(-1, matchers_set_find(set, "Makefile.am", 0));
+}
+
+TEST(suffixes_match_case_insensitively)
+{
+	add_rule("{*.c,*.h}");
+	add_rule("{*.tar.gz}");
+	add_rule("{*~}");
+
+	assert_int_equal(0, matchers_set_find(set, "main.C", 0));
+	assert_int_equal(0, matchers_set_find(set, "/usr/include/stdio.h", 0));
+	assert_int_equal(1, matchers_set_find(set, "archive.TAR.gz", 0));
+	assert_int_equal(2, matchers_set_find(set, "file~", 0));
+	assert_int_equal(-1, matchers_set_find(set, "archive.gz", 0));
+	assert_int_equal(-1, matchers_set_find(set, "~", 0));
+}
+
+TEST(suffixes_do_not_match_dot_files)
+{
+	add_rule("{*.swp}");
+
+	assert_int_equal(-1, matchers_set_find(set, ".file.swp", 0));
+	assert_int_equal(-1, matchers_set_find(set, ".swp", 0));
+	assert_int_equal(0, matchers_set_find(set, "a.swp", 0));
+}
+
+TEST(first_matching_rule_wins_across_kinds)
+{
+	add_rule("/^main/");
+	add_rule("{*.c}");
+	add_rule("{main.c}");
+	add_rule("{*}");
+
+	assert_int_equal(0, matchers_set_find(set, "main.c", 0));
+	assert_int_equal(1, matchers_set_find(set, "main.c", 1));
+	assert_int_equal(2, matchers_set_find(set, "main.c", 2));
+	assert_int_equal(3, matchers_set_find(set, "main.c", 3));
+	assert_int_equal(-1, matchers_set_find(set, "main.c", 4));
+	assert_int_equal(1, matchers_set_find(set, "lib.c", 0));
+	assert_int_equal(3, matchers_set_find(set, "lib.h", 0));
+}
+
+TEST(merged_regexes_report_right_rule)
+{
+	add_rule("/^a/");
+	add_rule("/b$/I");
+	add_rule("/^(c|d)+$/");
+	add_rule("/[)]/");
+	add_rule("/(.)\\1/");
+
+	assert_int_equal(0, matchers_set_find(set, "ab", 0));
+	assert_int_equal(1, matchers_set_find(set, "xb", 0));
+	assert_int_equal(-1, matchers_set_find(set, "xB", 0));
+	assert_int_equal(2, matchers_set_find(set, "cdc", 0));
+	assert_int_equal(3, matchers_set_find(set, "x)", 0));
+	assert_int_equal(4, matchers_set_find(set, "xyyz", 0));
+	assert_int_equal(-1, matchers_set_find(set, "xyz", 0));
+}
+
+TEST(complex_rules_are_checked)
+{
+	add_rule("!{*.c}");
+	add_rule("{*.h}{main*}");
+	add_rule("{{/tmp/*}}");
+
+	assert_int_equal(0, matchers_set_find(set, "main.h", 0));
+	assert_int_equal(1, matchers_set_find(set, "main.h", 1));
+	assert_int_equal(-1, matchers_set_find(set, "lib.c", 0));
+	assert_int_equal(2, matchers_set_find(set, "/tmp/lib.c", 0));
+}
+
+TEST(rules_can_be_added_after_lookups)
+{
+	add_rule("/^a/");
+	assert_int_equal(-1, matchers_set_find(set, "ba", 0));
+
+	add_rule("/a$/");
+	add_rule("{ba}");
+	assert_int_equal(1, matchers_set_find(set, "ba", 0));
+	assert_int_equal(2, matchers_set_find(set, "ba", 2));
+}
+
+TEST(results_are_the_same_as_of_linear_scan)
+{
+	const char *const exprs[] = {
+		"{*.c,*.cpp}", "/\\.h$/", "{README,*.md}", "{*.C}", "/^[A-Z]/",
+		"{.*}", "!/x/", "{*.o}{lib*}", "<text/plain>", "{*}",
+	};
+	const char *const names[] = {
+		"a.c", "b.cpp", "lib.h", "README", "x.md", "Abc", ".vimrc", "libx.o",
+		"lib.o", "x", "a.CPP", "dir/", "a.tar", "yyy",
+	};
+
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(exprs); ++i)
+	{
+		add_rule(exprs[i]);
+	}
+
+	for(i = 0; i < (int)ARRAY_LEN(names); ++i)
+	{
+		int from;
+		for(from = 0; from <= nrules; ++from)
+		{
+			assert_int_equal(find_linearly(names[i], from),
+					matchers_set_find(set, names[i], from));
+		}
+	}
+}
+
+static void
+add_rule(const char expr[])
+{
+	char *error;
+	rules[nrules] = matchers_alloc(expr, 0, 1, "", &error);
+	assert_non_null(rules[nrules]);
+	free(error);
+
+	assert_success(matchers_set_add(set, rules[nrules]));
+	++nrules;
+}
+
+/* Finds first matching rule the way it's done without the set.  Returns index
+ * of the rule or -1. */
+static int
+find_linearly(const char path[], int from)
+{
+	int i;
+	for(i = from; i < nrules; ++i)
+	{
+		if(matchers_match(rules[i], path))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
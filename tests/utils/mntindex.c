@@ -0,0 +1,132 @@
+#include <stic.h>
+
+#ifndef _WIN32
+
+#include <stddef.h> /* NULL */
+
+#include "../../src/compat/mntent.h"
+#include "../../src/utils/mntindex.h"
+
+static void add_mount(const char dir[], const char type[]);
+static const char * find_dir(const char path[]);
+static const char * find_type(const char path[]);
+
+static mntindex_t *mnt_index;
+
+SETUP()
+{
+	mnt_index = mntindex_create();
+	assert_non_null(mnt_index);
+}
+
+TEARDOWN()
+{
+	mntindex_free(mnt_index);
+}
+
+TEST(freeing_null_index_is_ok)
+{
+	mntindex_free(NULL);
+}
+
+TEST(empty_index_finds_nothing)
+{
+	assert_string_equal(NULL, find_dir("/"));
+	assert_string_equal(NULL, find_dir("/home/user"));
+}
+
+TEST(longest_prefix_wins)
+{
+	add_mount("/", "ext4");
+	add_mount("/home", "xfs");
+	add_mount("/home/user/net", "nfs");
+
+	assert_string_equal("/", find_dir("/"));
+	assert_string_equal("/", find_dir("/usr/bin"));
+	assert_string_equal("/home", find_dir("/home"));
+	assert_string_equal("/home", find_dir("/home/user/file"));
+	assert_string_equal("/home/user/net", find_dir("/home/user/net/a/b"));
+	assert_string_equal("nfs", find_type("/home/user/net/a/b"));
+}
+
+TEST(only_whole_components_are_matched)
+{
+	add_mount("/", "ext4");
+	add_mount("/home", "xfs");
+
+	assert_string_equal("/", find_dir("/homework"));
+	assert_string_equal("/", find_dir("/hom"));
+}
+
+TEST(trailing_slashes_are_ignored)
+{
+	add_mount("/", "ext4");
+	add_mount("/mnt/usb/", "vfat");
+
+	assert_string_equal("/mnt/usb/", find_dir("/mnt/usb"));
+	assert_string_equal("/mnt/usb/", find_dir("/mnt/usb//"));
+	assert_string_equal("/mnt/usb/", find_dir("/mnt/usb/dir/"));
+	assert_string_equal("/", find_dir("//"));
+}
+
+TEST(first_entry_for_the_same_dir_is_found)
+{
+	add_mount("/mnt", "ext4");
+	add_mount("/mnt", "tmpfs");
+
+	assert_string_equal("ext4", find_type("/mnt/file"));
+	assert_int_equal(2, mntindex_count(mnt_index));
+	assert_string_equal("tmpfs", mntindex_at(mnt_index, 1)->ent.mnt_type);
+}
+
+TEST(relative_paths_are_not_found)
+{
+	add_mount("/", "ext4");
+
+	assert_string_equal(NULL, find_dir("home"));
+	assert_string_equal(NULL, find_dir(""));
+}
+
+TEST(entries_are_copied)
+{
+	char dir[] = "/mnt";
+	struct mntent ent = {
+		.mnt_fsname = "dev", .mnt_dir = dir, .mnt_type = "ext4", .mnt_opts = "rw",
+	};
+	assert_success(mntindex_add(mnt_index, &ent));
+	dir[1] = 'x';
+
+	assert_string_equal("/mnt", find_dir("/mnt/file"));
+	assert_string_equal(NULL, find_dir("/xnt/file"));
+}
+
+static void
+add_mount(const char dir[], const char type[])
+{
+	struct mntent ent = {
+		.mnt_fsname = "dev",
+		.mnt_dir = (char *)dir,
+		.mnt_type = (char *)type,
+		.mnt_opts = "rw",
+	};
+	assert_success(mntindex_add(mnt_index, &ent));
+}
+
+static const char *
+find_dir(const char path[])
+{
+	const mntindex_entry_t *const entry = mntindex_find(mnt_index, path);
+	return (entry == NULL ? NULL : entry->ent.mnt_dir);
+}
+
+static const char *
+find_type(const char path[])
+{
+	const mntindex_entry_t *const entry = mntindex_find(mnt_index, path);
+	return (entry == NULL ? NULL : entry->ent.mnt_type);
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
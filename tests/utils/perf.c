@@ -0,0 +1,105 @@
+#include <stic.h>
+
+#include <stdio.h> /* FILE fclose() fopen() fread() remove() */
+#include <string.h> /* strstr() */
+
+#include "../../src/utils/perf.h"
+
+SETUP()
+{
+	perf_reset();
+}
+
+TEARDOWN()
+{
+	perf_enable(0);
+	perf_reset();
+}
+
+TEST(nothing_is_collected_when_disabled)
+{
+	const uint64_t start = perf_begin();
+	assert_true(start == 0);
+	perf_end(PP_SORT, start);
+	perf_count(PP_VCACHE_HIT);
+
+	assert_true(perf_get(PP_SORT).count == 0);
+	assert_true(perf_get(PP_VCACHE_HIT).count == 0);
+}
+
+TEST(probes_are_collected_when_enabled)
+{
+	perf_enable(1);
+	assert_true(perf_enabled());
+
+	uint64_t start = perf_begin();
+	perf_end(PP_SORT, start);
+	start = perf_begin();
+	perf_end(PP_SORT, start);
+	perf_count(PP_VCACHE_MISS);
+
+	const perf_stats_t s = perf_get(PP_SORT);
+	assert_true(s.count == 2);
+	assert_true(s.max_ns <= s.total_ns);
+	assert_true(perf_get(PP_VCACHE_MISS).count == 1);
+	assert_true(perf_get(PP_DRAW).count == 0);
+}
+
+TEST(scope_started_while_disabled_is_not_counted)
+{
+	const uint64_t start = perf_begin();
+	perf_enable(1);
+	perf_end(PP_DRAW, start);
+
+	assert_true(perf_get(PP_DRAW).count == 0);
+}
+
+TEST(reset_discards_statistics)
+{
+	perf_enable(1);
+	perf_count(PP_VCACHE_HIT);
+	perf_reset();
+
+	assert_true(perf_enabled());
+	assert_true(perf_get(PP_VCACHE_HIT).count == 0);
+}
+
+TEST(probes_have_names)
+{
+	assert_string_equal("dir_load", perf_probe_name(PP_DIR_LOAD));
+	assert_string_equal("bg_job", perf_probe_name(PP_BG_JOB));
+	assert_true(perf_is_timed(PP_STAT));
+	assert_false(perf_is_timed(PP_VCACHE_HIT));
+}
+
+TEST(trace_is_dumped)
+{
+	char buf[1024];
+	size_t len;
+
+	perf_enable(1);
+	perf_end(PP_HIGHLIGHT, perf_begin());
+	perf_count(PP_VCACHE_HIT);
+
+	assert_success(perf_dump(SANDBOX_PATH "/trace.json"));
+
+	FILE *const fp = fopen(SANDBOX_PATH "/trace.json", "r");
+	assert_non_null(fp);
+	len = fread(buf, 1, sizeof(buf) - 1, fp);
+	buf[len] = '\0';
+	fclose(fp);
+	assert_success(remove(SANDBOX_PATH "/trace.json"));
+
+	assert_non_null(strstr(buf, "{\"traceEvents\":["));
+	assert_non_null(strstr(buf, "\"name\":\"highlight\",\"cat\":\"vifm\",\"ph\":\"X\""));
+	assert_non_null(strstr(buf, "\"name\":\"vcache_hit\",\"cat\":\"vifm\",\"ph\":\"i\""));
+	assert_non_null(strstr(buf, "],\"displayTimeUnit\":\"ms\"}"));
+}
+
+TEST(dumping_to_bad_path_fails)
+{
+	assert_failure(perf_dump(SANDBOX_PATH "/no/such/dir/trace.json"));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,131 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* chmod() */
+
+#include <stdio.h> /* snprintf() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/rmtree.h"
+
+static void make_tree(const char root[], int ndirs, int nfiles);
+static int count_calls(long long removed, void *arg);
+static int cancel(long long removed, void *arg);
+
+static int ncalls;
+
+SETUP()
+{
+	ncalls = 0;
+	create_dir(SANDBOX_PATH "/root");
+}
+
+TEARDOWN()
+{
+	remove_dir(SANDBOX_PATH "/root");
+}
+
+TEST(nested_tree_is_removed)
+{
+	char *const dirs[] = { SANDBOX_PATH "/root" };
+
+	make_tree(SANDBOX_PATH "/root", 10, 200);
+	create_dir(SANDBOX_PATH "/root/0/nested");
+	create_dir(SANDBOX_PATH "/root/0/nested/deeper");
+	create_file(SANDBOX_PATH "/root/0/nested/deeper/file");
+
+	assert_success(rmtree_remove_contents(dirs, 1, 4, &count_calls, NULL));
+	assert_true(ncalls > 0);
+	assert_true(is_dir_empty(SANDBOX_PATH "/root"));
+}
+
+TEST(several_roots_are_emptied_but_kept)
+{
+	char *const dirs[] = { SANDBOX_PATH "/root/a", SANDBOX_PATH "/root/b" };
+
+	create_dir(SANDBOX_PATH "/root/a");
+	create_dir(SANDBOX_PATH "/root/b");
+	make_tree(SANDBOX_PATH "/root/a", 2, 3);
+	make_tree(SANDBOX_PATH "/root/b", 3, 2);
+
+	assert_success(rmtree_remove_contents(dirs, 2, 2, NULL, NULL));
+	assert_true(is_dir_empty(SANDBOX_PATH "/root/a"));
+	assert_true(is_dir_empty(SANDBOX_PATH "/root/b"));
+
+	remove_dir(SANDBOX_PATH "/root/a");
+	remove_dir(SANDBOX_PATH "/root/b");
+}
+
+TEST(works_without_workers)
+{
+	char *const dirs[] = { SANDBOX_PATH "/root" };
+
+	make_tree(SANDBOX_PATH "/root", 3, 100);
+
+	assert_success(rmtree_remove_contents(dirs, 1, 0, NULL, NULL));
+	assert_true(is_dir_empty(SANDBOX_PATH "/root"));
+}
+
+TEST(cancellation_leaves_files_intact)
+{
+	char *const dirs[] = { SANDBOX_PATH "/root" };
+
+	create_file(SANDBOX_PATH "/root/file");
+
+	assert_failure(rmtree_remove_contents(dirs, 1, 4, &cancel, NULL));
+	assert_success(remove(SANDBOX_PATH "/root/file"));
+}
+
+TEST(missing_root_is_an_error)
+{
+	char *const dirs[] = { SANDBOX_PATH "/no-such-dir" };
+	assert_failure(rmtree_remove_contents(dirs, 1, 2, NULL, NULL));
+}
+
+TEST(read_only_subdirectory_is_removed, IF(not_windows))
+{
+	char *const dirs[] = { SANDBOX_PATH "/root" };
+
+	create_dir(SANDBOX_PATH "/root/ro");
+	create_file(SANDBOX_PATH "/root/ro/file");
+	assert_success(chmod(SANDBOX_PATH "/root/ro", 0555));
+
+	assert_success(rmtree_remove_contents(dirs, 1, 2, NULL, NULL));
+	assert_true(is_dir_empty(SANDBOX_PATH "/root"));
+}
+
+/* Creates ndirs subdirectories of the root with nfiles files in each. */
+static void
+make_tree(const char root[], int ndirs, int nfiles)
+{
+	char path[PATH_MAX + 1];
+	int i, j;
+	for(i = 0; i < ndirs; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/%d", root, i);
+		create_dir(path);
+		for(j = 0; j < nfiles; ++j)
+		{
+			snprintf(path, sizeof(path), "%s/%d/%d", root, i, j);
+			create_file(path);
+		}
+	}
+}
+
+static int
+count_calls(long long removed, void *arg)
+{
+	++ncalls;
+	return 0;
+}
+
+static int
+cancel(long long removed, void *arg)
+{
+	return 1;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,181 @@
+#include <stic.h>
+
+#include <pthread.h> /* pthread_create() pthread_join() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strlen() */
+
+#include "../../src/utils/hmap.h"
+#include "../../src/utils/seqmap.h"
+#include "../../src/utils/utils.h"
+
+/* Number of records, enough for tables of shards to grow. */
+#define NRECS 2000
+
+/* Number of modifications performed by concurrent writer. */
+#define NWRITES (100*1000)
+
+/* Record of tests. */
+typedef struct
+{
+	uint64_t a; /* First copy of a value. */
+	uint64_t b; /* Second copy of a value. */
+}
+rec_t;
+
+static void setter(void *data, int created, void *arg);
+static void incrementer(void *data, int created, void *arg);
+static void * writer(void *arg);
+static hmap_key_t key_of(int i);
+
+static seqmap_t *map;
+
+SETUP()
+{
+	map = seqmap_create(sizeof(rec_t));
+	assert_non_null(map);
+}
+
+TEARDOWN()
+{
+	seqmap_free(map);
+}
+
+TEST(freeing_null_map_is_ok)
+{
+	seqmap_free(NULL);
+}
+
+TEST(missing_key_is_not_found)
+{
+	rec_t rec;
+	assert_failure(seqmap_get(map, key_of(1), &rec));
+	assert_int_equal(0, seqmap_size(map));
+}
+
+TEST(records_are_created_and_updated)
+{
+	uint64_t value = 10;
+	hmap_key_t key = key_of(1);
+
+	assert_success(seqmap_update(map, &key, 1U, 1, &setter, &value));
+	assert_int_equal(1, seqmap_size(map));
+
+	rec_t rec;
+	assert_success(seqmap_get(map, key, &rec));
+	assert_ulong_equal(10, rec.a);
+	assert_ulong_equal(10, rec.b);
+
+	value = 20;
+	assert_success(seqmap_update(map, &key, 1U, 1, &setter, &value));
+	assert_int_equal(1, seqmap_size(map));
+	assert_success(seqmap_get(map, key, &rec));
+	assert_ulong_equal(20, rec.a);
+}
+
+TEST(missing_records_are_skipped_unless_asked)
+{
+	uint64_t value = 10;
+	hmap_key_t keys[] = { key_of(1), key_of(2), key_of(3) };
+
+	assert_success(seqmap_update(map, &keys[1], 1U, 1, &setter, &value));
+	assert_success(seqmap_update(map, keys, ARRAY_LEN(keys), 0, &incrementer,
+				NULL));
+	assert_int_equal(1, seqmap_size(map));
+
+	rec_t rec;
+	assert_failure(seqmap_get(map, keys[0], &rec));
+	assert_success(seqmap_get(map, keys[1], &rec));
+	assert_ulong_equal(11, rec.a);
+	assert_failure(seqmap_get(map, keys[2], &rec));
+}
+
+TEST(batches_update_every_key)
+{
+	static hmap_key_t keys[NRECS];
+	uint64_t value = 0;
+
+	int i;
+	for(i = 0; i < NRECS; ++i)
+	{
+		keys[i] = key_of(i);
+	}
+
+	assert_success(seqmap_update(map, keys, NRECS, 1, &setter, &value));
+	assert_success(seqmap_update(map, keys, NRECS, 0, &incrementer, NULL));
+	assert_int_equal(NRECS, seqmap_size(map));
+
+	for(i = 0; i < NRECS; ++i)
+	{
+		rec_t rec;
+		assert_success(seqmap_get(map, keys[i], &rec));
+		assert_ulong_equal(1, rec.a);
+		assert_ulong_equal(1, rec.b);
+	}
+}
+
+TEST(readers_see_consistent_records_during_writes)
+{
+	pthread_t thread;
+	uint64_t value = 0;
+	hmap_key_t key = key_of(0);
+	assert_success(seqmap_update(map, &key, 1U, 1, &setter, &value));
+
+	assert_success(pthread_create(&thread, NULL, &writer, NULL));
+
+	int i, torn = 0;
+	for(i = 0; i < NWRITES; ++i)
+	{
+		rec_t rec;
+		assert_success(seqmap_get(map, key, &rec));
+		torn |= (rec.a != rec.b);
+	}
+
+	assert_success(pthread_join(thread, NULL));
+	assert_false(torn);
+}
+
+/* Sets both fields of a record to the value. */
+static void
+setter(void *data, int created, void *arg)
+{
+	rec_t *const rec = data;
+	const uint64_t *const value = arg;
+	rec->a = *value;
+	rec->b = *value;
+}
+
+/* Increments both fields of a record. */
+static void
+incrementer(void *data, int created, void *arg)
+{
+	rec_t *const rec = data;
+	++rec->a;
+	++rec->b;
+}
+
+/* Keeps modifying the first record while adding new ones to make tables
+ * grow. */
+static void *
+writer(void *arg)
+{
+	int i;
+	for(i = 0; i < NWRITES; ++i)
+	{
+		hmap_key_t keys[] = { key_of(0), key_of(1 + i%NRECS) };
+		(void)seqmap_update(map, keys, ARRAY_LEN(keys), 1, &incrementer, NULL);
+	}
+	return NULL;
+}
+
+static hmap_key_t
+key_of(int i)
+{
+	char str[32];
+	snprintf(str, sizeof(str), "/path/%d", i);
+	return hmap_str_key(str, strlen(str));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */